@@ -0,0 +1,397 @@
+// alarm_server: reads alarm commands from stdin and prints expired alarms.
+// With -b (or -f file) commands are read in batch mode: no prompt, results
+// are not flushed per line, and commands go to the shards in batches. With
+// -p port and/or -U path it serves the same protocol to network clients
+// instead of stdin, until SIGINT or SIGTERM. With -D dir the alarms are
+// kept in a write-ahead log and snapshots in `dir` and survive a restart.
+// With -R host:port the log is also shipped to a follower started with
+// -F port -D dir, whose directory a server can be started on after the
+// leader fails. With -r lo-hi=host:port the network server hands commands
+// for those ids to the server at host:port and relays its answers.
+//
+//   Start_Alarm(id): [every] delay [count=N|until=T] [group=TAG] message
+//   Change_Alarm(id): [every] delay [count=N|until=T] [group=TAG] message
+//
+// where delay is seconds, optionally fractional or with a unit: 30, 1.5s,
+// 250ms, 500us.
+//   Cancel_Alarm(id)
+//   View_Alarms
+//   Start_Alarms(ids): [every] delay [count=N|until=T] [group=TAG] message
+//   Cancel_Alarms(ids)
+//   Cancel_Group(TAG)
+//   Change_Group(TAG): [+|-]delta
+//   Stats
+//   Config [display=N] [capacity=N] [overflow=block|shed|coalesce] [slack=T]
+//          [flush=T] [trace=on|off|clear] [dump=PATH]
+//
+// where ids is a comma-separated list of ids and ranges: 1,5,1000-1999.
+// Config changes the display pool, expiry slack and output batching of the
+// running server and records alarm lifecycle events while trace=on; dump=
+// writes them as a Chrome/Perfetto trace. Network clients fetch the trace
+// with GET /trace instead.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <csignal>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "alarmd/batch_input.hpp"
+#include "alarmd/clock.hpp"
+#include "alarmd/cpu_affinity.hpp"
+#include "alarmd/latency_stats.hpp"
+#include "alarmd/net_server.hpp"
+#include "alarmd/parser.hpp"
+#include "alarmd/replication.hpp"
+#include "alarmd/scheduler.hpp"
+
+namespace {
+
+void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [-d display_threads] [-s shards] [-q list|heap|wheel] [-c slack_ms]\n"
+                 "          [-l flush_latency_us] [-b] [-f command_file] [-p tcp_port]\n"
+                 "          [-U unix_socket] [-D data_dir] [-Q display_capacity]\n"
+                 "          [-O block|shed|coalesce] [-A shard_cpus] [-W display_cpus]\n"
+                 "          [-N net_cpu] [-T] [-H cold_horizon_s] [-R host:port]\n"
+                 "          [-r lo-hi=host:port]... [-F follower_port]\n"
+                 "  -l  longest an output line waits to be batched into one write (default 1000)\n"
+                 "  -b  batch mode: read commands from stdin without a prompt\n"
+                 "  -f  batch mode reading commands from a file\n"
+                 "  -p  serve clients on a TCP port instead of stdin\n"
+                 "  -U  serve clients on a Unix socket instead of stdin\n"
+                 "  -D  keep alarms in this directory across restarts\n"
+                 "  -Q  expired alarms each display thread may hold back (default 65536,\n"
+                 "      0 for no bound)\n"
+                 "  -O  what a full display queue does: block the alarm thread (default),\n"
+                 "      shed the alarm, or coalesce it with a queued duplicate\n"
+                 "  -A  pin shard alarm threads to these CPUs in turn, e.g. 0-7 (their alarm\n"
+                 "      memory then comes from each CPU's NUMA node)\n"
+                 "  -W  pin display threads to these CPUs in turn\n"
+                 "  -N  pin the network event loop to this CPU\n"
+                 "  -T  with -p or -U: expire alarms on the network event loop through\n"
+                 "      timerfds instead of one alarm thread per shard\n"
+                 "  -H  keep one-shot alarms due more than this many seconds out in a\n"
+                 "      compact cold tier until they come closer (default 0: off)\n"
+                 "  -R  with -D: ship the write-ahead log to the follower at host:port\n"
+                 "  -r  with -p or -U: send commands for these ids to the server at\n"
+                 "      host:port; repeat for more ranges\n"
+                 "  -F  run as a follower: take a leader's log on this port into -D's\n"
+                 "      directory until SIGINT or SIGTERM\n",
+                 argv0);
+}
+
+// -b / -f: read commands without a prompt.
+bool g_interactive = true;
+// Results are written through the scheduler's output stage so they stay
+// ordered with the expiry notices of the same alarms.
+alarmd::Scheduler* g_scheduler = nullptr;
+
+long now() { return static_cast<long>(std::time(nullptr)); }
+
+// Prints the outcome of a posted command; runs on the shard's alarm thread.
+void report(const alarmd::RequestResult& r) {
+    char line[alarmd::kMaxLine];
+    g_scheduler->write_line(std::string_view(line, alarmd::format_result(r, now(), line)));
+}
+
+void execute(alarmd::Scheduler& scheduler, const alarmd::Command& cmd) {
+    using alarmd::CommandType;
+    using alarmd::RequestKind;
+    switch (cmd.type) {
+        case CommandType::StartAlarm:
+            scheduler.post({RequestKind::Start, cmd.id, cmd.delay, alarmd::Message(cmd.message), 0,
+                            cmd.repeats, alarmd::Message(cmd.group)});
+            break;
+        case CommandType::ChangeAlarm:
+            scheduler.post({RequestKind::Change, cmd.id, cmd.delay, alarmd::Message(cmd.message), 0,
+                            cmd.repeats, alarmd::Message(cmd.group)});
+            break;
+        case CommandType::CancelAlarm:
+            scheduler.post({RequestKind::Cancel, cmd.id, {}, {}});
+            break;
+        case CommandType::StartAlarms:
+        case CommandType::CancelAlarms:
+        case CommandType::CancelGroup:
+        case CommandType::ChangeGroup: {
+            char line[alarmd::kMaxLine];
+            scheduler.write_line(
+                std::string_view(line, alarmd::run_bulk_command(scheduler, cmd, 0, line)));
+            break;
+        }
+        case CommandType::ViewAlarms:
+            scheduler.view_alarms(stdout, cmd.view);
+            break;
+        case CommandType::Stats:
+            scheduler.write_line(scheduler.render_stats(now()));
+            break;
+        case CommandType::Config: {
+            char line[alarmd::kMaxLine];
+            scheduler.write_line(
+                std::string_view(line, alarmd::run_config_command(scheduler, cmd, true, line)));
+            break;
+        }
+        case CommandType::Invalid:
+            break;
+    }
+}
+
+void run_interactive(alarmd::Scheduler& scheduler) {
+    // getline() grows the buffer to fit, so a long id list is read whole,
+    // as in batch mode, rather than split into two commands.
+    char* line = nullptr;
+    std::size_t capacity = 0;
+    alarmd::Command cmd;
+    for (;;) {
+        // The previous command's result is reported by its shard and goes
+        // through the batched output stage; apply it and let it out before
+        // the prompt that follows it.
+        scheduler.drain();
+        scheduler.flush_output();
+        std::printf("alarm> ");
+        std::fflush(stdout);
+        const ssize_t len = getline(&line, &capacity, stdin);
+        if (len < 0) {
+            break;
+        }
+        const std::string_view text(line, static_cast<std::size_t>(len));
+        if (text.find_first_not_of(" \t\r\n") == std::string_view::npos) {
+            continue;
+        }
+        const std::int64_t parse_start = alarmd::monotonic_ns();
+        const bool parsed = alarmd::parse_command(text, cmd);
+        alarmd::record_latency(alarmd::Metric::Parse, alarmd::monotonic_ns() - parse_start);
+        if (!parsed) {
+            scheduler.write_line("Bad command\n");
+            continue;
+        }
+        execute(scheduler, cmd);
+    }
+    std::free(line);
+}
+
+void run_batch(alarmd::Scheduler& scheduler, int fd) {
+    alarmd::BatchSubmitter submitter(scheduler);
+    std::uint64_t line_no = 0;
+    alarmd::for_each_line(fd, [&](std::string_view line) {
+        ++line_no;
+        if (!submitter.submit(line)) {
+            std::fprintf(stderr, "Bad command at line %llu\n",
+                         static_cast<unsigned long long>(line_no));
+        }
+    });
+    submitter.flush();
+    const alarmd::BatchStats& stats = submitter.stats();
+    std::fprintf(stderr, "alarm_server: %llu commands, %llu invalid\n",
+                 static_cast<unsigned long long>(stats.commands),
+                 static_cast<unsigned long long>(stats.invalid));
+}
+
+void report_restored(alarmd::Scheduler& scheduler) {
+    if (const alarmd::AlarmStore* store = scheduler.store()) {
+        const alarmd::RecoveryStats& r = store->recovery();
+        std::fprintf(stderr,
+                     "alarm_server: restored %zu alarms (%zu from the snapshot, %zu log records"
+                     "%s)\n",
+                     scheduler.pending(), r.snapshot_alarms, r.log_records,
+                     r.torn_logs != 0 ? ", torn tail dropped" : "");
+    }
+}
+
+// Blocks SIGINT and SIGTERM before any thread starts, so every thread
+// inherits the mask and only sigwait() sees them.
+sigset_t block_signals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+    return signals;
+}
+
+// Serves network clients until SIGINT or SIGTERM.
+int run_network(const alarmd::SchedulerOptions& options, const alarmd::NetOptions& net) {
+    // One descriptor per client: lift the soft limit to the hard one.
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    sigset_t signals = block_signals();
+
+    alarmd::NetServer server(options, net);
+    server.start();
+    report_restored(server.scheduler());
+    if (server.tcp_port() >= 0) {
+        std::fprintf(stderr, "alarm_server: listening on port %d\n", server.tcp_port());
+    }
+    if (!net.unix_path.empty()) {
+        std::fprintf(stderr, "alarm_server: listening on %s\n", net.unix_path.c_str());
+    }
+    int sig = 0;
+    sigwait(&signals, &sig);
+    server.stop();
+    return EXIT_SUCCESS;
+}
+
+// Writes a leader's shipped log into `dir` until SIGINT or SIGTERM.
+int run_follower(const std::string& dir, int port) {
+    sigset_t signals = block_signals();
+    alarmd::LogReplica replica({.dir = dir, .port = port});
+    replica.start();
+    std::fprintf(stderr, "alarm_server: following on port %d into %s\n", replica.port(),
+                 dir.c_str());
+    int sig = 0;
+    sigwait(&signals, &sig);
+    replica.stop();
+    const alarmd::ReplicaStats stats = replica.stats();
+    std::fprintf(stderr, "alarm_server: %llu dumps, %llu log records taken\n",
+                 static_cast<unsigned long long>(stats.dumps),
+                 static_cast<unsigned long long>(stats.records));
+    return EXIT_SUCCESS;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    alarmd::SchedulerOptions options;
+    options.on_result = report;
+    const unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+    options.display_threads =
+        static_cast<int>(std::min(cores, unsigned(alarmd::kMaxDisplayThreads)));
+    options.shards = static_cast<int>(std::min(cores, 16u));
+    const char* command_file = nullptr;
+    alarmd::NetOptions net;
+    int follower_port = -1;
+    int opt;
+    options.batch_output = true;
+    while ((opt = getopt(argc, argv, "d:s:q:c:l:bf:p:U:D:Q:O:A:W:N:TH:R:r:F:h")) != -1) {
+        switch (opt) {
+            case 'l':
+                options.flush_latency = std::chrono::microseconds(std::atol(optarg));
+                break;
+            case 'p':
+                net.tcp_port = std::atoi(optarg);
+                break;
+            case 'U':
+                net.unix_path = optarg;
+                break;
+            case 'D':
+                options.data_dir = optarg;
+                break;
+            case 'Q':
+                options.display_capacity = std::strtoull(optarg, nullptr, 10);
+                break;
+            case 'A':
+            case 'W':
+                if (!alarmd::parse_cpu_list(optarg, opt == 'A' ? options.shard_cpus
+                                                               : options.display_cpus)) {
+                    std::fprintf(stderr, "%s: bad CPU list '%s'\n", argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'N':
+                net.cpu = std::atoi(optarg);
+                break;
+            case 'T':
+                net.timerfd = true;
+                break;
+            case 'H':
+                options.cold_horizon = std::chrono::seconds(std::atol(optarg));
+                break;
+            case 'R':
+                options.replica = optarg;
+                break;
+            case 'r':
+                if (!alarmd::parse_route(optarg, net.routes.emplace_back())) {
+                    std::fprintf(stderr, "%s: bad route '%s'\n", argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'F':
+                follower_port = std::atoi(optarg);
+                break;
+            case 'O':
+                if (!alarmd::parse_overflow_policy(optarg, options.display_overflow)) {
+                    std::fprintf(stderr, "%s: unknown overflow policy '%s'\n", argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'b':
+                g_interactive = false;
+                break;
+            case 'f':
+                command_file = optarg;
+                g_interactive = false;
+                break;
+            case 'd':
+                options.display_threads = std::atoi(optarg);
+                break;
+            case 's':
+                options.shards = std::atoi(optarg);
+                break;
+            case 'c':
+                options.expiry_slack = std::chrono::milliseconds(std::atol(optarg));
+                break;
+            case 'q':
+                if (!alarmd::parse_queue_kind(optarg, options.queue)) {
+                    std::fprintf(stderr, "%s: unknown queue '%s'\n", argv[0], optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    try {
+        if (follower_port >= 0) {
+            if (options.data_dir.empty()) {
+                std::fprintf(stderr, "%s: -F needs -D\n", argv[0]);
+                return EXIT_FAILURE;
+            }
+            return run_follower(options.data_dir, follower_port);
+        }
+        if (net.tcp_port >= 0 || !net.unix_path.empty()) {
+            return run_network(options, net);
+        }
+        int fd = STDIN_FILENO;
+        if (command_file != nullptr && (fd = open(command_file, O_RDONLY | O_CLOEXEC)) < 0) {
+            std::fprintf(stderr, "alarm_server: %s: %s\n", command_file, std::strerror(errno));
+            return EXIT_FAILURE;
+        }
+        alarmd::Scheduler scheduler(options);
+        g_scheduler = &scheduler;
+        scheduler.start();
+        report_restored(scheduler);
+        if (g_interactive) {
+            run_interactive(scheduler);
+        } else {
+            run_batch(scheduler, fd);
+        }
+        if (fd != STDIN_FILENO) {
+            close(fd);
+        }
+        scheduler.drain();
+        scheduler.stop();
+        std::fflush(stdout);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "alarm_server: %s\n", e.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,38 @@
+#include "alarmd/alarm_list.hpp"
+#include "alarmd/slab_pool.hpp"
+
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+namespace alarmd {
+namespace {
+
+// Insert into a list already holding state.range(0) alarms with random
+// expiry times, then remove the new node again.
+void BM_AlarmListInsert(benchmark::State& state) {
+    SlabPool<Alarm> pool;
+    AlarmList list;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<Deadline> expiry(0, 1'000'000);
+    for (int i = 0; i < state.range(0); ++i) {
+        Alarm* a = pool.create();
+        a->id = i;
+        a->deadline = expiry(rng);
+        list.insert(a);
+    }
+    const int id = static_cast<int>(state.range(0));
+    Alarm probe;
+    probe.id = id;
+    for (auto _ : state) {
+        probe.deadline = expiry(rng);
+        list.insert(&probe);
+        list.unlink(&probe);
+    }
+    list.clear([&](Alarm* a) { pool.destroy(a); });
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_AlarmListInsert)->RangeMultiplier(10)->Range(10, 10'000);
+
+}  // namespace
+}  // namespace alarmd
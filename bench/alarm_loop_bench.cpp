@@ -0,0 +1,133 @@
+#include "alarmd/alarm_loop.hpp"
+
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+#include <benchmark/benchmark.h>
+
+namespace alarmd {
+namespace {
+
+// schedule() then cancel() of one alarm among state.range(0) pending ones:
+// what an in-process caller pays to arm and disarm a timeout.
+void BM_LoopScheduleCancel(benchmark::State& state) {
+    AlarmLoop loop;
+    const Deadline t = monotonic_now() + 3'600'000'000;
+    const auto pending = static_cast<int>(state.range(0));
+    for (int id = 0; id < pending; ++id) {
+        loop.schedule(id, t + id * 1000, "background");
+    }
+    for (auto _ : state) {
+        const AlarmHandle h = loop.schedule(pending, t + 500'000, "timeout");
+        benchmark::DoNotOptimize(loop.cancel(h));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoopScheduleCancel)->Arg(0)->Arg(100'000);
+
+// One alarm scheduled and fired through poll() per iteration.
+void BM_LoopScheduleFire(benchmark::State& state) {
+    std::size_t fired = 0;
+    AlarmLoop loop({.on_fired = [&fired](FiredAlarm&) { ++fired; }});
+    const Deadline t = monotonic_now();
+    for (auto _ : state) {
+        loop.schedule(1, t, "due");
+        loop.poll(t);
+    }
+    benchmark::DoNotOptimize(fired);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoopScheduleFire);
+
+AlarmTask sleep_forever(AlarmLoop& loop, Deadline t) {
+    for (Deadline until = t;; ++until) {
+        co_await loop.sleep_until(until);
+    }
+}
+
+// A coroutine suspending on sleep_until and resumed by poll() per iteration.
+void BM_LoopSleepResume(benchmark::State& state) {
+    AlarmLoop loop;
+    const Deadline t = monotonic_now() + 3'600'000'000;
+    sleep_forever(loop, t);
+    Deadline now = t;
+    for (auto _ : state) {
+        loop.poll(now++);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoopSleepResume);
+
+// Per iteration, with 1000 alarms pending an hour out: arm a timeout,
+// schedule an alarm that is due, cancel the timeout and poll the due alarm
+// out. Instantiated for every queue, clock and lock policy below.
+template <typename Queue, typename Clock, typename Lock>
+void BM_EngineChurn(benchmark::State& state) {
+    std::size_t fired = 0;
+    BasicAlarmLoop<Queue, Clock, Lock> loop({.on_fired = [&fired](FiredAlarm&) { ++fired; }});
+    const Deadline base = loop.clock().now();
+    for (int id = 0; id < 1000; ++id) {
+        loop.schedule(id, base + 3'600'000'000 + id, "background");
+    }
+    for (auto _ : state) {
+        const Deadline now = loop.clock().now();
+        const AlarmHandle timeout = loop.schedule(1000, now + 1'000'000, "timeout");
+        loop.schedule(1001, now, "due");
+        loop.cancel(timeout);
+        loop.poll(now);
+    }
+    benchmark::DoNotOptimize(fired);
+    state.SetItemsProcessed(state.iterations() * 3);
+}
+
+template <typename Queue>
+const char* queue_name();
+template <>
+const char* queue_name<ListQueue>() { return "list"; }
+template <>
+const char* queue_name<HeapQueue>() { return "heap"; }
+template <>
+const char* queue_name<TimingWheel>() { return "wheel"; }
+template <>
+const char* queue_name<TimerQueue>() { return "runtime"; }
+
+template <typename Lock>
+const char* lock_name() {
+    if constexpr (std::is_same_v<Lock, std::mutex>) {
+        return "mutex";
+    } else {
+        return Lock::kName;
+    }
+}
+
+template <typename Queue, typename Clock, typename Lock>
+void register_engine() {
+    const std::string name = std::string("BM_EngineChurn/") + queue_name<Queue>() + "/" +
+                             Clock::kName + "/" + lock_name<Lock>();
+    benchmark::RegisterBenchmark(name.c_str(), BM_EngineChurn<Queue, Clock, Lock>);
+}
+
+template <typename Queue, typename Clock>
+void register_locks() {
+    register_engine<Queue, Clock, NullLock>();
+    register_engine<Queue, Clock, std::mutex>();
+    register_engine<Queue, Clock, SpinLock>();
+}
+
+template <typename Queue>
+void register_clocks() {
+    register_locks<Queue, MonotonicClock>();
+    register_locks<Queue, VirtualClock>();
+}
+
+const bool kEnginesRegistered = [] {
+    register_clocks<ListQueue>();
+    register_clocks<HeapQueue>();
+    register_clocks<TimingWheel>();
+    register_clocks<TimerQueue>();  // the runtime choice, a wheel by default
+    return true;
+}();
+
+}  // namespace
+}  // namespace alarmd
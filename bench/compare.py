@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Compares two alarm_bench JSON outputs (bench_output.txt) benchmark by benchmark.
+
+    bench/compare.py BASELINE.json CURRENT.json [--threshold 0.10]
+
+Prints the change in real time per iteration for every benchmark present in
+both files and exits with status 1 if any got slower by more than the
+threshold, so it can gate a change against the numbers of its parent commit.
+Repetition aggregates (mean, median, stddev) are compared when present;
+otherwise each run is.
+"""
+
+import argparse
+import json
+import sys
+
+_UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    runs = {}
+    for b in data.get("benchmarks", []):
+        if b.get("run_type") == "aggregate" and b.get("aggregate_name") != "median":
+            continue
+        if b.get("error_occurred"):
+            continue
+        name = b["run_name"] if b.get("run_type") == "aggregate" else b["name"]
+        runs[name] = b["real_time"] * _UNITS[b.get("time_unit", "ns")]
+    return data.get("context", {}), runs
+
+
+def describe(context):
+    commit = context.get("alarmd_commit", "?")
+    return "%s (%s, %s CPUs)" % (commit, context.get("date", "?"), context.get("num_cpus", "?"))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="relative slowdown that counts as a regression (default 0.10)")
+    args = parser.parse_args()
+
+    base_context, base = load(args.baseline)
+    cur_context, cur = load(args.current)
+    print("baseline: " + describe(base_context))
+    print("current:  " + describe(cur_context))
+
+    width = max((len(n) for n in cur if n in base), default=10)
+    regressions = 0
+    for name, time in cur.items():
+        if name not in base or base[name] == 0:
+            continue
+        change = time / base[name] - 1.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        elif change < -args.threshold:
+            flag = "  faster"
+        print("%-*s %12.1f ns -> %12.1f ns  %+7.1f%%%s"
+              % (width, name, base[name], time, change * 100, flag))
+
+    missing = sorted(set(base) - set(cur))
+    if missing:
+        print("not in current: " + ", ".join(missing))
+    print("%d regression(s) over %.0f%%" % (regressions, args.threshold * 100))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
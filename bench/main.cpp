@@ -0,0 +1,34 @@
+// Google Benchmark entry point. Unless --benchmark_out is given, results are
+// also written as JSON to bench_output.txt at the repository root, tagged
+// with the commit they were built from; bench/compare.py diffs two of them.
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+int main(int argc, char** argv) {
+    std::vector<char*> args(argv, argv + argc);
+    bool has_out = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--benchmark_out=", 16) == 0) {
+            has_out = true;
+        }
+    }
+    std::string out = "--benchmark_out=" ALARMD_BENCH_OUTPUT;
+    std::string format = "--benchmark_out_format=json";
+    if (!has_out) {
+        args.push_back(out.data());
+        args.push_back(format.data());
+    }
+    int n = static_cast<int>(args.size());
+    benchmark::Initialize(&n, args.data());
+    benchmark::AddCustomContext("alarmd_commit", ALARMD_GIT_COMMIT);
+    if (benchmark::ReportUnrecognizedArguments(n, args.data())) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,34 @@
+#include "alarmd/parser.hpp"
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace alarmd {
+namespace {
+
+// Parse a rotating mix of the four commands, as read from a command stream.
+void BM_ParseCommand(benchmark::State& state) {
+    const std::vector<std::string> lines = {
+        "Start_Alarm(12345): 30 wake up and check the oven\n",
+        "Change_Alarm(12345): 1.5s sooner\n",
+        "Cancel_Alarm(12345)\n",
+        "View_Alarms\n",
+    };
+    Command cmd;
+    std::size_t bytes = 0;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        const std::string& line = lines[i++ % lines.size()];
+        benchmark::DoNotOptimize(parse_command(line, cmd));
+        benchmark::DoNotOptimize(cmd);
+        bytes += line.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+BENCHMARK(BM_ParseCommand);
+
+}  // namespace
+}  // namespace alarmd
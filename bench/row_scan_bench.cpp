@@ -0,0 +1,76 @@
+#include "alarmd/row_scan.hpp"
+#include "alarmd/cold_tier.hpp"
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace alarmd {
+namespace {
+
+constexpr std::size_t kRows = 50'000'000;
+
+// One kernel (state.range(0), a ScanIsa) over 50M rows of random offsets
+// keeping about state.range(1) per mille of them: a "due in the next five
+// minutes" query over a full day of alarms keeps about 3.
+void BM_RowScan(benchmark::State& state) {
+    const auto isa = static_cast<ScanIsa>(state.range(0));
+    const RowScanFn kernel = row_scan_kernel(isa);
+    if (kernel == nullptr) {
+        state.SkipWithError("not supported on this CPU");
+        return;
+    }
+    std::vector<std::uint32_t> offset(kRows);
+    std::vector<int> id(kRows);
+    std::vector<std::uint32_t> delay(kRows, 1000);
+    std::mt19937 rng(42);
+    for (std::size_t row = 0; row < kRows; ++row) {
+        offset[row] = static_cast<std::uint32_t>(rng());
+        id[row] = static_cast<int>(row);
+    }
+    const auto hi = static_cast<std::uint32_t>(0xFFFFFFFFull * state.range(1) / 1000);
+    const RowFilter filter{.offset_lo = 0, .offset_hi = hi, .id_lo = 0, .id_hi = 1 << 30};
+    std::vector<std::uint32_t> out(kRows);
+    std::size_t kept = 0;
+    for (auto _ : state) {
+        kept = kernel(offset.data(), id.data(), delay.data(), kRows, filter, out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.counters["kept"] = static_cast<double>(kept);
+    state.SetItemsProcessed(state.iterations() * kRows);
+    state.SetLabel(scan_isa_name(isa));
+}
+BENCHMARK(BM_RowScan)
+    ->ArgNames({"isa", "per_mille"})
+    ->ArgsProduct({{static_cast<int>(ScanIsa::Scalar), static_cast<int>(ScanIsa::Avx2),
+                    static_cast<int>(ScanIsa::Neon)},
+                   {3, 500}})
+    ->Unit(benchmark::kMillisecond);
+
+// An id-range query (range(0) != 0, every alarm of the query's range) or
+// a deadline query (the next five minutes) over 10M cold alarms spread
+// across a day.
+void BM_ColdTierScan(benchmark::State& state) {
+    constexpr int n = 10'000'000;
+    constexpr Deadline kDay = 86'400'000'000;
+    ColdTier tier;
+    for (int id = 0; id < n; ++id) {
+        tier.insert(id, kDay + static_cast<Deadline>(id) * kDay / n, std::chrono::hours(24),
+                    "wake up", 0);
+    }
+    const ColdQuery query = state.range(0) != 0
+                                ? ColdQuery{.id_lo = 5'000'000, .id_hi = 5'009'999}
+                                : ColdQuery{.from = kDay, .to = kDay + 300'000'000};
+    std::size_t kept = 0;
+    for (auto _ : state) {
+        kept = 0;
+        tier.scan(query, [&kept](const ColdAlarm&) { ++kept; });
+    }
+    state.counters["kept"] = static_cast<double>(kept);
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_ColdTierScan)->ArgName("by_id")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace alarmd
@@ -0,0 +1,173 @@
+// End-to-end scenarios against a whole Scheduler, parameterised so that
+// queue kinds, the locked and posted command paths, and shard and display
+// thread counts can be compared run over run (see bench/compare.py).
+
+#include "alarmd/scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "workload.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace alarmd {
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr int kQueueKinds[] = {static_cast<int>(QueueKind::List), static_cast<int>(QueueKind::Heap),
+                               static_cast<int>(QueueKind::Wheel)};
+
+// Expiry notices are formatted and written as usual, but to /dev/null.
+std::FILE* null_output() {
+    static std::FILE* out = std::fopen("/dev/null", "w");
+    return out;
+}
+
+void prefill(Scheduler& scheduler, bench::Workload& workload, int first, int n) {
+    std::vector<AlarmRequest> entries;
+    constexpr int kChunk = 1 << 16;
+    for (int id = first; id < first + n; id += kChunk) {
+        workload.starts(id, std::min(kChunk, first + n - id), entries);
+        scheduler.start_alarms(entries);
+        entries.clear();
+    }
+}
+
+// Start + Cancel churn on top of state.range(1) pending alarms in a
+// state.range(0) queue over 4 shards, through the locked start_alarm /
+// cancel_alarm calls or (range(2) != 0) the lock-free post() rings.
+void BM_ScenarioChurn(benchmark::State& state) {
+    const auto kind = static_cast<QueueKind>(state.range(0));
+    const auto pending = static_cast<int>(state.range(1));
+    const bool posted = state.range(2) != 0;
+    Scheduler scheduler({.display_threads = 1, .shards = 4, .queue = kind, .out = null_output()});
+    scheduler.start();
+    bench::Workload workload;
+    prefill(scheduler, workload, 0, pending);
+    int id = pending;
+    for (auto _ : state) {
+        const std::chrono::microseconds delay = workload.delay();
+        if (posted) {
+            scheduler.post({RequestKind::Start, id, delay, Message("churn")});
+            scheduler.post({RequestKind::Cancel, id, {}, {}});
+        } else {
+            scheduler.start_alarm(id, delay, "churn");
+            scheduler.cancel_alarm(id);
+        }
+        ++id;
+    }
+    scheduler.drain();
+    state.SetItemsProcessed(state.iterations() * 2);
+    state.SetLabel(std::string(queue_kind_name(kind)) + (posted ? "/posted" : "/locked"));
+}
+
+void churn_args(benchmark::internal::Benchmark* b) {
+    for (const int kind : kQueueKinds) {
+        for (const int pending : {1'000, 100'000, 1'000'000, 10'000'000}) {
+            // A sorted list inserts in O(n); past 100k one insert is a full
+            // scan of a cold list and says nothing new.
+            if (kind == static_cast<int>(QueueKind::List) && pending > 100'000) {
+                continue;
+            }
+            for (const int posted : {0, 1}) {
+                b->Args({kind, pending, posted});
+            }
+        }
+    }
+}
+BENCHMARK(BM_ScenarioChurn)
+    ->ArgNames({"queue", "pending", "posted"})
+    ->Apply(churn_args)
+    ->UseRealTime();
+
+// state.range(2) alarms that all come due at the same instant, with
+// state.range(0) display threads and state.range(1) shards. The time is
+// from the shared deadline until the last notice is written.
+void BM_ScenarioExpiryStorm(benchmark::State& state) {
+    const auto n = static_cast<int>(state.range(2));
+    Scheduler scheduler({.display_threads = static_cast<int>(state.range(0)),
+                         .shards = static_cast<int>(state.range(1)),
+                         .out = null_output()});
+    scheduler.start();
+    std::vector<AlarmRequest> entries;
+    std::uint64_t fired = 0;
+    for (auto _ : state) {
+        // Far enough out that inserting the whole storm finishes first.
+        const auto due = std::chrono::steady_clock::now() + 200ms;
+        for (int id = 0; id < n; ++id) {
+            entries.push_back({RequestKind::Start, id,
+                               std::chrono::duration_cast<std::chrono::microseconds>(
+                                   due - std::chrono::steady_clock::now()),
+                               Message("storm")});
+        }
+        scheduler.start_alarms(entries);
+        entries.clear();
+        fired += static_cast<std::uint64_t>(n);
+        std::this_thread::sleep_until(due);
+        while (scheduler.fired() < fired) {
+            std::this_thread::yield();
+        }
+        state.SetIterationTime(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - due).count());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_ScenarioExpiryStorm)
+    ->ArgNames({"display", "shards", "alarms"})
+    ->ArgsProduct({{1, 2, 4, 8}, {1, 4, 16}, {100'000}})
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+// A read-heavy mix from state.threads() command threads on 100k pending
+// alarms over 4 shards: state.range(0) percent of operations are a 50-alarm
+// View_Alarms page at a random offset, the rest Start + Cancel churn.
+Scheduler* g_mixed = nullptr;
+
+void BM_ScenarioViewMix(benchmark::State& state) {
+    constexpr int kPending = 100'000;
+    if (state.thread_index() == 0) {
+        g_mixed = new Scheduler({.display_threads = 1, .shards = 4, .out = null_output()});
+        g_mixed->start();
+        bench::Workload workload;
+        prefill(*g_mixed, workload, 0, kPending);
+    }
+    bench::Workload workload(bench::kSeed + static_cast<std::uint32_t>(state.thread_index()));
+    const auto reads = static_cast<std::uint64_t>(state.range(0));
+    ViewFilter filter;
+    filter.limit = 50;
+    std::vector<AlarmView> page;
+    int id = kPending + state.thread_index() * 100'000'000;
+    for (auto _ : state) {
+        if (workload.below(100) < reads) {
+            filter.offset = static_cast<std::size_t>(workload.below(kPending));
+            page.clear();
+            benchmark::DoNotOptimize(g_mixed->snapshot(filter, page));
+        } else {
+            g_mixed->start_alarm(id, workload.delay(), "mixed");
+            g_mixed->cancel_alarm(id);
+            ++id;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        delete g_mixed;
+        g_mixed = nullptr;
+    }
+}
+BENCHMARK(BM_ScenarioViewMix)
+    ->ArgName("read_pct")
+    ->Arg(50)
+    ->Arg(90)
+    ->Arg(99)
+    ->ThreadRange(1, 8)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace alarmd
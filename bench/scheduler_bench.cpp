@@ -0,0 +1,218 @@
+#include "alarmd/scheduler.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+namespace alarmd {
+namespace {
+
+using namespace std::chrono_literals;
+
+Scheduler* g_scheduler = nullptr;
+
+// Start_Alarm + Cancel_Alarm churn from state.threads() command threads
+// against a scheduler with state.range(0) shards. Each thread owns its own
+// id range, so only shard locks are shared.
+void BM_SchedulerChurn(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        g_scheduler = new Scheduler({.display_threads = 1,
+                                     .shards = static_cast<int>(state.range(0)),
+                                     .out = stderr});
+        g_scheduler->start();
+    }
+    int id = state.thread_index() * 100'000'000;
+    for (auto _ : state) {
+        g_scheduler->start_alarm(id, 3600s, "bench");
+        g_scheduler->cancel_alarm(id);
+        ++id;
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    if (state.thread_index() == 0) {
+        delete g_scheduler;
+        g_scheduler = nullptr;
+    }
+}
+BENCHMARK(BM_SchedulerChurn)
+    ->ArgName("shards")
+    ->Arg(1)
+    ->Arg(16)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+// The same churn through the asynchronous post() path: command threads only
+// touch the shard rings; the alarm threads apply the requests in batches.
+void BM_SchedulerPostChurn(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        g_scheduler = new Scheduler({.display_threads = 1,
+                                     .shards = static_cast<int>(state.range(0)),
+                                     .out = stderr});
+        g_scheduler->start();
+    }
+    int id = state.thread_index() * 100'000'000;
+    for (auto _ : state) {
+        g_scheduler->post({RequestKind::Start, id, 3600s, Message("bench")});
+        g_scheduler->post({RequestKind::Cancel, id, {}, {}});
+        ++id;
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+    if (state.thread_index() == 0) {
+        g_scheduler->drain();
+        delete g_scheduler;
+        g_scheduler = nullptr;
+    }
+}
+BENCHMARK(BM_SchedulerPostChurn)
+    ->ArgName("shards")
+    ->Arg(1)
+    ->Arg(16)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+// One View_Alarms snapshot of state.range(0) alarms spread over 4 shards,
+// either the whole list or a 50-alarm page from the middle.
+void BM_SchedulerSnapshot(benchmark::State& state) {
+    Scheduler scheduler({.display_threads = 1, .shards = 4, .out = stderr});
+    scheduler.start();
+    const auto n = static_cast<int>(state.range(0));
+    for (int id = 0; id < n; ++id) {
+        scheduler.start_alarm(id, std::chrono::seconds(3600 + id % 7919), "bench");
+    }
+    ViewFilter filter;
+    if (state.range(1) != 0) {
+        filter.offset = static_cast<std::size_t>(n / 2);
+        filter.limit = 50;
+    }
+    std::vector<AlarmView> page;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scheduler.snapshot(filter, page));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_SchedulerSnapshot)
+    ->ArgNames({"alarms", "paged"})
+    ->Args({100'000, 0})
+    ->Args({100'000, 1})
+    ->Args({1'000'000, 0})
+    ->Args({1'000'000, 1})
+    ->Unit(benchmark::kMillisecond);
+
+// Starting and cancelling state.range(0) alarms over 4 shards, one command
+// per alarm or (range(1) != 0) through the bulk forms.
+void BM_SchedulerBulk(benchmark::State& state) {
+    Scheduler scheduler({.display_threads = 1, .shards = 4, .out = stderr});
+    scheduler.start();
+    const auto n = static_cast<int>(state.range(0));
+    const bool bulk = state.range(1) != 0;
+    std::vector<AlarmRequest> entries;
+    for (auto _ : state) {
+        if (bulk) {
+            for (int id = 0; id < n; ++id) {
+                entries.push_back({RequestKind::Start, id, std::chrono::seconds(3600 + id % 7919),
+                                   Message("bench")});
+            }
+            scheduler.start_alarms(entries);
+            scheduler.cancel_alarms({{0, n - 1}});
+        } else {
+            for (int id = 0; id < n; ++id) {
+                scheduler.start_alarm(id, std::chrono::seconds(3600 + id % 7919), "bench");
+            }
+            for (int id = 0; id < n; ++id) {
+                scheduler.cancel_alarm(id);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * n * 2);
+}
+BENCHMARK(BM_SchedulerBulk)
+    ->ArgNames({"alarms", "bulk"})
+    ->Args({100'000, 0})
+    ->Args({100'000, 1})
+    ->Unit(benchmark::kMillisecond);
+
+// Bytes malloc has handed out, including its mmap'ed large blocks.
+std::size_t heap_bytes() {
+    const struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+// Heap bytes per pending alarm for state.range(0) alarms three days out,
+// as nodes or (range(1) != 0) in the cold tier, timing the inserts.
+void BM_SchedulerFarAlarms(benchmark::State& state) {
+    const auto n = static_cast<int>(state.range(0));
+    const bool cold = state.range(1) != 0;
+    double bytes = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        const std::size_t before = heap_bytes();
+        auto scheduler = std::make_unique<Scheduler>(SchedulerOptions{
+            .display_threads = 1, .shards = 4, .out = stderr,
+            .cold_horizon = cold ? std::chrono::microseconds(3600s) : 0us});
+        scheduler->start();
+        state.ResumeTiming();
+        for (int id = 0; id < n; ++id) {
+            scheduler->start_alarm(id, std::chrono::seconds(259'200 + id % 86'400), "wake up");
+        }
+        state.PauseTiming();
+        bytes = static_cast<double>(heap_bytes() - before) / n;
+        scheduler.reset();
+        state.ResumeTiming();
+    }
+    state.counters["bytes_per_alarm"] = bytes;
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_SchedulerFarAlarms)
+    ->ArgNames({"alarms", "cold"})
+    ->Args({1'000'000, 0})
+    ->Args({1'000'000, 1})
+    ->Unit(benchmark::kMillisecond)
+    ->Iterations(1);
+
+// Startup from a data directory holding a snapshot of state.range(0)
+// alarms over 16 shards plus a 10k-record log tail.
+void BM_SchedulerRecover(benchmark::State& state) {
+    char path[] = "/tmp/alarmd_bench_XXXXXX";
+    const std::string dir = mkdtemp(path);
+    const SchedulerOptions options{
+        .display_threads = 1, .shards = 16, .out = stderr, .data_dir = dir};
+    const auto n = static_cast<int>(state.range(0));
+    {
+        Scheduler scheduler(options);
+        scheduler.start();
+        for (int id = 0; id < n; ++id) {
+            scheduler.start_alarm(id, std::chrono::seconds(3600 + id % 7919), "bench");
+        }
+        scheduler.store()->checkpoint();
+        for (int id = 0; id < 10'000; ++id) {
+            scheduler.change_alarm(id, 7200s, "tail");
+        }
+    }
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto scheduler = std::make_unique<Scheduler>(options);
+        state.ResumeTiming();
+        scheduler->start();
+        state.PauseTiming();
+        benchmark::DoNotOptimize(scheduler->pending());
+        scheduler.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    std::filesystem::remove_all(dir);
+}
+BENCHMARK(BM_SchedulerRecover)
+    ->ArgName("alarms")
+    ->Arg(100'000)
+    ->Arg(1'000'000)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace alarmd
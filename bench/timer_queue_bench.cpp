@@ -0,0 +1,74 @@
+#include "alarmd/timer_queue.hpp"
+#include "alarmd/slab_pool.hpp"
+
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+namespace alarmd {
+namespace {
+
+constexpr Deadline kSecond = 1'000'000;
+
+// Push one alarm into a queue holding state.range(1) alarms, then erase it.
+void BM_QueueInsertErase(benchmark::State& state) {
+    SlabPool<Alarm> pool;
+    auto queue = make_timer_queue(static_cast<QueueKind>(state.range(0)));
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<Deadline> expiry(0, 1'000'000);
+    std::uint64_t seq = 0;
+    for (int i = 0; i < state.range(1); ++i) {
+        Alarm* a = pool.create();
+        a->id = i;
+        a->deadline = expiry(rng);
+        a->seq = seq++;
+        queue->push(a);
+    }
+    Alarm probe;
+    for (auto _ : state) {
+        probe.deadline = expiry(rng);
+        probe.seq = seq++;
+        queue->push(&probe);
+        queue->erase(&probe);
+    }
+    queue->clear([&](Alarm* a) { pool.destroy(a); });
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(queue_kind_name(static_cast<QueueKind>(state.range(0))));
+}
+BENCHMARK(BM_QueueInsertErase)
+    ->ArgsProduct({{static_cast<int>(QueueKind::Heap), static_cast<int>(QueueKind::Wheel)},
+                   {1'000, 10'000, 200'000}});
+
+// Pop every alarm from a queue of state.range(1) alarms spread over an hour,
+// polling once a second.
+void BM_QueueExpire(benchmark::State& state) {
+    SlabPool<Alarm> pool;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<Deadline> expiry(0, 3600 * kSecond);
+    std::uint64_t seq = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto queue = make_timer_queue(static_cast<QueueKind>(state.range(0)));
+        for (int i = 0; i < state.range(1); ++i) {
+            Alarm* a = pool.create();
+            a->id = i;
+            a->deadline = expiry(rng);
+            a->seq = seq++;
+            queue->push(a);
+        }
+        state.ResumeTiming();
+        for (Deadline now = 0; now <= 3600 * kSecond; now += kSecond) {
+            while (Alarm* a = queue->pop_due(now)) {
+                pool.destroy(a);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(1));
+    state.SetLabel(queue_kind_name(static_cast<QueueKind>(state.range(0))));
+}
+BENCHMARK(BM_QueueExpire)
+    ->ArgsProduct({{static_cast<int>(QueueKind::Heap), static_cast<int>(QueueKind::Wheel)},
+                   {10'000, 200'000}});
+
+}  // namespace
+}  // namespace alarmd
@@ -0,0 +1,47 @@
+#pragma once
+
+// Seeded workload generators for the scenario benchmarks. The same seed and
+// arguments always produce the same requests, so runs on different commits
+// measure identical work.
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "alarmd/shard.hpp"
+
+namespace alarmd::bench {
+
+inline constexpr std::uint32_t kSeed = 20240901;
+
+// Range a workload draws its delays from, uniformly.
+struct DelayProfile {
+    std::chrono::microseconds min{std::chrono::seconds(3600)};
+    std::chrono::microseconds max{std::chrono::seconds(7200)};
+};
+
+class Workload {
+public:
+    explicit Workload(std::uint32_t seed = kSeed, DelayProfile delays = {})
+        : rng_(seed), delay_(delays.min.count(), delays.max.count()) {}
+
+    std::chrono::microseconds delay() { return std::chrono::microseconds(delay_(rng_)); }
+    // Uniform in [0, n).
+    std::uint64_t below(std::uint64_t n) { return rng_() % n; }
+
+    // Start requests for ids [first, first + n), each with a delay from the
+    // profile; appended to `out`.
+    void starts(int first, int n, std::vector<AlarmRequest>& out) {
+        out.reserve(out.size() + static_cast<std::size_t>(n));
+        for (int id = first; id < first + n; ++id) {
+            out.push_back({RequestKind::Start, id, delay(), Message("bench")});
+        }
+    }
+
+private:
+    std::mt19937_64 rng_;
+    std::uniform_int_distribution<std::int64_t> delay_;
+};
+
+}  // namespace alarmd::bench
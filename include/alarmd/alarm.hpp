@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "alarmd/clock.hpp"
+#include "alarmd/message.hpp"
+
+namespace alarmd {
+
+// Longest group tag accepted by `group=`.
+inline constexpr std::size_t kMaxGroupTag = 32;
+
+// `repeats` value of a periodic alarm with no count or end time.
+inline constexpr std::uint32_t kRepeatForever = std::numeric_limits<std::uint32_t>::max();
+
+struct AlarmGroup;
+
+// A pending alarm. Nodes are owned by whichever timer queue holds them; the
+// link fields are reserved for that queue and the group fields for the
+// shard's GroupIndex. Fields are ordered to pack the node into 112 bytes.
+//
+// A periodic alarm (`every`) fires every `delay` and has `repeats` more
+// fires to go after the next one; a one-shot alarm has repeats == 0.
+struct Alarm {
+    Alarm* link = nullptr;       // next node (list queue, wheel slot)
+    Alarm* prev = nullptr;       // previous node (wheel slot)
+    AlarmGroup* group = nullptr; // group=TAG, or nullptr
+    Alarm* group_next = nullptr;
+    Alarm* group_prev = nullptr;
+    Deadline deadline = 0;       // absolute expiry, monotonic microseconds
+    std::uint64_t seq = 0;       // insertion order, breaks ties between equal expiries
+    Message message;
+    std::chrono::microseconds delay{0};  // requested delay
+    int id = 0;
+    std::uint32_t queue_pos = 0; // heap index or wheel slot
+    std::uint32_t owner = 0;     // client that started it (NetServer); 0 = local
+    std::uint32_t repeats = 0;   // fires left after the next one, or kRepeatForever
+    bool cancelled = false;      // tombstone: skipped and freed when it expires
+};
+
+static_assert(sizeof(Alarm) <= 2 * 64, "alarm nodes should fit in two cache lines");
+
+// What an alarm thread hands to the display threads when an alarm expires.
+// A one-shot alarm's message is moved out of the node, so firing never
+// copies the text; a periodic alarm keeps its text and hands over a copy.
+struct FiredAlarm {
+    int id = 0;
+    std::chrono::microseconds delay{0};
+    Message message;
+    std::uint32_t owner = 0;
+    std::int64_t fired_ns = 0;  // monotonic_ns() when the alarm thread took it
+    std::uint32_t coalesced = 0;  // further fires folded into this notice
+};
+
+// A copy of a live alarm's visible fields, taken for View_Alarms.
+struct AlarmView {
+    Deadline deadline = 0;
+    std::uint64_t seq = 0;
+    Message message;
+    std::chrono::microseconds delay{0};
+    int id = 0;
+    std::uint32_t repeats = 0;
+    Message group = {};  // the group tag, empty for none
+};
+
+// An inclusive range of alarm ids, as the bulk commands name them.
+struct IdRange {
+    int lo = 0;
+    int hi = 0;
+
+    std::uint64_t size() const { return static_cast<std::uint64_t>(hi - std::int64_t{lo}) + 1; }
+};
+
+// Optional restrictions for View_Alarms. The time range is measured from
+// the moment of the view; the page is taken after ordering by expiry.
+struct ViewFilter {
+    int id_min = 0;
+    int id_max = std::numeric_limits<int>::max();
+    std::chrono::microseconds due_min = std::chrono::microseconds::min();
+    std::chrono::microseconds due_max = std::chrono::microseconds::max();
+    std::size_t offset = 0;
+    std::size_t limit = std::numeric_limits<std::size_t>::max();
+
+    bool matches(int id, Deadline deadline, Deadline now) const {
+        const Deadline due = deadline - now;
+        return id >= id_min && id <= id_max && due >= due_min.count() && due <= due_max.count();
+    }
+    bool matches(const Alarm& a, Deadline now) const { return matches(a.id, a.deadline, now); }
+    bool paged() const { return offset != 0 || limit != std::numeric_limits<std::size_t>::max(); }
+};
+
+// Expiry order used by every timer queue: earlier deadline first, then FIFO.
+inline bool expires_before(const Alarm& a, const Alarm& b) {
+    return a.deadline != b.deadline ? a.deadline < b.deadline : a.seq < b.seq;
+}
+
+inline bool expires_before(const AlarmView& a, const AlarmView& b) {
+    return a.deadline != b.deadline ? a.deadline < b.deadline : a.seq < b.seq;
+}
+
+}  // namespace alarmd
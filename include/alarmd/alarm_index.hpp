@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "alarmd/alarm.hpp"
+
+namespace alarmd {
+
+// Open-addressing hash map from alarm id to the live node carrying it.
+// Linear probing over a power-of-two table kept at most 3/4 full; erase uses
+// backward-shift deletion so lookups never wade through index tombstones.
+// The index does not own nodes.
+class AlarmIndex {
+public:
+    explicit AlarmIndex(std::size_t capacity = 16);
+
+    // Returns the node indexed under `id`, or nullptr.
+    Alarm* find(int id) const;
+
+    // Indexes `alarm` under its id. Returns false if the id is taken.
+    bool insert(Alarm* alarm);
+
+    // Removes `id` and returns the node that was indexed, or nullptr.
+    Alarm* erase(int id);
+
+    std::size_t size() const { return size_; }
+    std::size_t capacity() const { return slots_.size(); }
+    // Grows the table so `n` ids fit without rehashing.
+    void reserve(std::size_t n);
+    void clear();
+
+private:
+    struct Slot {
+        int id = 0;
+        Alarm* alarm = nullptr;  // nullptr marks an empty slot
+    };
+
+    std::size_t home(int id) const;
+    void grow();
+    void rehash(std::size_t slots);
+
+    std::vector<Slot> slots_;
+    std::size_t mask_;
+    std::size_t size_ = 0;
+};
+
+}  // namespace alarmd
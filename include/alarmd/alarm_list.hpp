@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "alarmd/alarm.hpp"
+
+namespace alarmd {
+
+// Singly linked list of alarms kept sorted by expiry time. Alarms with equal
+// expiry keep their insertion order. The list links nodes but does not own
+// them.
+class AlarmList {
+public:
+    AlarmList() = default;
+
+    AlarmList(const AlarmList&) = delete;
+    AlarmList& operator=(const AlarmList&) = delete;
+
+    // Links `alarm` in expiry order; the caller keeps ownership.
+    void insert(Alarm* alarm);
+
+    // Sorts `alarms` and links them in one pass over the list, O(n + k log k)
+    // instead of one O(n) insert each. Equal expiries stay after the alarms
+    // already linked and keep their order in `alarms`.
+    void merge(std::vector<Alarm*>& alarms);
+
+    // Returns the alarm with `id`, or nullptr.
+    Alarm* find(int id) const;
+
+    // Unlinks the alarm with `id` and returns it to the caller, or nullptr.
+    Alarm* remove(int id);
+
+    // Unlinks `alarm`, which must be in the list.
+    void unlink(Alarm* alarm);
+
+    // Unlinks and returns the earliest alarm, or nullptr when empty.
+    Alarm* pop_front();
+
+    Alarm* front() { return head_; }
+    const Alarm* front() const { return head_; }
+    bool empty() const { return head_ == nullptr; }
+    std::size_t size() const { return size_; }
+
+    // Calls `fn(const Alarm&)` for each alarm in expiry order.
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (const Alarm* a = head_; a != nullptr; a = a->link) {
+            fn(*a);
+        }
+    }
+
+    // Unlinks every node marked `cancelled` and passes it to `release`;
+    // returns how many.
+    std::size_t purge_cancelled(const std::function<void(Alarm*)>& release);
+
+    // Unlinks every node and passes it to `release`.
+    void clear(const std::function<void(Alarm*)>& release);
+
+private:
+    Alarm* head_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+}  // namespace alarmd
@@ -0,0 +1,308 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "alarmd/alarm.hpp"
+#include "alarmd/alarm_index.hpp"
+#include "alarmd/heap_queue.hpp"
+#include "alarmd/list_queue.hpp"
+#include "alarmd/loop_policy.hpp"
+#include "alarmd/slab_pool.hpp"
+#include "alarmd/timer_queue.hpp"
+#include "alarmd/timing_wheel.hpp"
+
+namespace alarmd {
+
+// A scheduled alarm, as schedule() returns it; empty when nothing was
+// scheduled. A handle outlives its alarm harmlessly: cancel() then fails.
+struct AlarmHandle {
+    int id = 0;
+    std::uint64_t seq = 0;  // 0: empty
+
+    explicit operator bool() const { return seq != 0; }
+};
+
+// A coroutine that starts at once, runs until its first co_await that
+// suspends, and frees itself when it returns. Exceptions terminate.
+struct AlarmTask {
+    struct promise_type {
+        AlarmTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+struct LoopOptions {
+    // Picks the queue when the loop's Queue is TimerQueue; a concrete
+    // Queue ignores it.
+    QueueKind queue = QueueKind::Wheel;
+    // Receives each expired alarm's id, delay and payload, on the thread
+    // calling poll(). May schedule and cancel alarms.
+    std::function<void(FiredAlarm&)> on_fired = {};
+};
+
+// The scheduler's engine without its threads or its text protocol, for
+// services that link the alarm logic in: a timer queue, the node pool and
+// the id index, driven by the caller's own thread.
+//
+// schedule() and cancel() allocate nothing once the pool has grown, and
+// co_await sleep_until() parks the awaiting coroutine in the same queue as
+// the alarms. poll() fires whatever is due; run() sleeps until each
+// deadline and polls until nothing is left.
+//
+// The engine is fixed at compile time:
+//   Queue  ListQueue, HeapQueue or TimingWheel, held by value so every
+//          queue call binds statically; TimerQueue picks one at run time
+//          through LoopOptions::queue, at a virtual call per operation.
+//   Clock  MonotonicClock, or VirtualClock for simulated time.
+//   Lock   NullLock for a loop one thread owns; std::mutex or SpinLock let
+//          other threads schedule and cancel while one thread polls. The
+//          lock is never held while an alarm fires or a sleeper resumes.
+//          run() does not see deadlines other threads add while it sleeps
+//          that are earlier than the one it sleeps until.
+//
+// AlarmLoop, the runtime-queue single-threaded form, is compiled once in
+// alarm_loop.cpp; other configurations are instantiated where used.
+template <typename Queue, typename Clock = MonotonicClock, typename Lock = NullLock>
+class BasicAlarmLoop {
+    static_assert(std::is_base_of_v<TimerQueue, Queue>);
+
+public:
+    class SleepAwaiter {
+    public:
+        SleepAwaiter(BasicAlarmLoop& loop, Deadline deadline) : loop_(loop), deadline_(deadline) {}
+
+        bool await_ready() const { return deadline_ <= loop_.clock_.now(); }
+        void await_suspend(std::coroutine_handle<> waiter) { loop_.park(deadline_, waiter); }
+        void await_resume() const noexcept {}
+
+    private:
+        BasicAlarmLoop& loop_;
+        Deadline deadline_;
+    };
+
+    explicit BasicAlarmLoop(LoopOptions options = {});
+    // Frees the pending alarms and destroys the frames of coroutines still
+    // asleep, which poll() never resumes.
+    ~BasicAlarmLoop();
+
+    BasicAlarmLoop(const BasicAlarmLoop&) = delete;
+    BasicAlarmLoop& operator=(const BasicAlarmLoop&) = delete;
+
+    // Schedules alarm `id` for `deadline`; `payload` is truncated to
+    // kMaxMessage. Returns an empty handle if alarm `id` is pending. The
+    // fired alarm's delay is the one given here, or 0 for a deadline.
+    AlarmHandle schedule(int id, Deadline deadline, std::string_view payload) {
+        return add(id, deadline, std::chrono::microseconds{0}, payload);
+    }
+    AlarmHandle schedule(int id, std::chrono::microseconds delay, std::string_view payload) {
+        return add(id, clock_.now() + delay.count(), delay, payload);
+    }
+    // Returns false if the alarm already fired or was cancelled.
+    bool cancel(AlarmHandle handle);
+
+    // co_await resumes the coroutine from poll() once `deadline` has
+    // passed; a deadline already past does not suspend at all.
+    SleepAwaiter sleep_until(Deadline deadline) { return {*this, deadline}; }
+    SleepAwaiter sleep_for(std::chrono::microseconds delay) {
+        return {*this, clock_.now() + delay.count()};
+    }
+
+    // Fires every alarm and resumes every sleeper due at `now` (by default
+    // the clock's), earliest first, and returns how many. Alarms they add
+    // that are due by `now` run in the same call.
+    std::size_t poll(Deadline now);
+    std::size_t poll() { return poll(clock_.now()); }
+    // Sleeps on the clock until each next deadline and polls, until nothing
+    // is pending.
+    void run();
+
+    // Stores a time no later than the next deadline; false when empty.
+    bool next_expiry(Deadline& when) const {
+        std::lock_guard<Lock> guard(lock_);
+        return queue().next_expiry(when);
+    }
+    // Scheduled alarms plus sleeping coroutines.
+    std::size_t pending() const {
+        std::lock_guard<Lock> guard(lock_);
+        return queue().size();
+    }
+    std::size_t sleeping() const {
+        std::lock_guard<Lock> guard(lock_);
+        return sleeping_;
+    }
+    PoolStats pool_stats() const {
+        std::lock_guard<Lock> guard(lock_);
+        return pool_.stats();
+    }
+    Clock& clock() { return clock_; }
+
+private:
+    static constexpr bool kDynamicQueue = std::is_same_v<Queue, TimerQueue>;
+
+    // A queued node; sleepers carry the coroutine and are not indexed.
+    struct Node : Alarm {
+        std::coroutine_handle<> waiter = {};
+    };
+
+    Queue& queue() {
+        if constexpr (kDynamicQueue) {
+            return *queue_;
+        } else {
+            return queue_;
+        }
+    }
+    const Queue& queue() const { return const_cast<BasicAlarmLoop*>(this)->queue(); }
+
+    AlarmHandle add(int id, Deadline deadline, std::chrono::microseconds delay,
+                    std::string_view payload);
+    void park(Deadline deadline, std::coroutine_handle<> waiter);
+
+    LoopOptions options_;
+    Clock clock_;
+    mutable Lock lock_;  // guards everything below
+    std::conditional_t<kDynamicQueue, std::unique_ptr<TimerQueue>, Queue> queue_;
+    SlabPool<Node> pool_;
+    AlarmIndex index_;
+    std::uint64_t next_seq_ = 1;
+    std::size_t sleeping_ = 0;
+};
+
+using AlarmLoop = BasicAlarmLoop<TimerQueue>;
+
+template <typename Queue, typename Clock, typename Lock>
+BasicAlarmLoop<Queue, Clock, Lock>::BasicAlarmLoop(LoopOptions options)
+    : options_(std::move(options)) {
+    if constexpr (kDynamicQueue) {
+        queue_ = make_timer_queue(options_.queue);
+    }
+}
+
+template <typename Queue, typename Clock, typename Lock>
+BasicAlarmLoop<Queue, Clock, Lock>::~BasicAlarmLoop() {
+    // The frames go last: their destructors may still cancel alarms.
+    std::vector<std::coroutine_handle<>> waiters;
+    {
+        std::lock_guard<Lock> guard(lock_);
+        queue().clear([&](Alarm* alarm) {
+            Node* node = static_cast<Node*>(alarm);
+            if (node->waiter) {
+                waiters.push_back(node->waiter);
+            }
+            pool_.destroy(node);
+        });
+        index_.clear();
+        sleeping_ = 0;
+    }
+    for (const std::coroutine_handle<> waiter : waiters) {
+        waiter.destroy();
+    }
+}
+
+template <typename Queue, typename Clock, typename Lock>
+AlarmHandle BasicAlarmLoop<Queue, Clock, Lock>::add(int id, Deadline deadline,
+                                                    std::chrono::microseconds delay,
+                                                    std::string_view payload) {
+    Message message(payload);  // outside the lock
+    std::lock_guard<Lock> guard(lock_);
+    if (index_.find(id) != nullptr) {
+        return {};
+    }
+    Node* node = pool_.create();
+    node->id = id;
+    node->deadline = deadline;
+    node->seq = next_seq_++;
+    node->delay = delay;
+    node->message = std::move(message);
+    index_.insert(node);
+    queue().push(node);
+    return {id, node->seq};
+}
+
+template <typename Queue, typename Clock, typename Lock>
+bool BasicAlarmLoop<Queue, Clock, Lock>::cancel(AlarmHandle handle) {
+    std::lock_guard<Lock> guard(lock_);
+    Alarm* alarm = index_.find(handle.id);
+    // The id may have been scheduled again since: only the same alarm counts.
+    if (alarm == nullptr || alarm->seq != handle.seq) {
+        return false;
+    }
+    index_.erase(handle.id);
+    queue().erase(alarm);
+    pool_.destroy(static_cast<Node*>(alarm));
+    return true;
+}
+
+template <typename Queue, typename Clock, typename Lock>
+void BasicAlarmLoop<Queue, Clock, Lock>::park(Deadline deadline,
+                                              std::coroutine_handle<> waiter) {
+    std::lock_guard<Lock> guard(lock_);
+    Node* node = pool_.create();
+    node->deadline = deadline;
+    node->seq = next_seq_++;
+    node->waiter = waiter;
+    queue().push(node);
+    ++sleeping_;
+}
+
+template <typename Queue, typename Clock, typename Lock>
+std::size_t BasicAlarmLoop<Queue, Clock, Lock>::poll(Deadline now) {
+    std::size_t fired = 0;
+    // One node at a time: a callback or a resumed coroutine may change the
+    // queue before the next pop.
+    for (;;) {
+        std::unique_lock<Lock> lock(lock_);
+        Alarm* alarm = queue().pop_due(now);
+        if (alarm == nullptr) {
+            return fired;
+        }
+        Node* node = static_cast<Node*>(alarm);
+        ++fired;
+        if (node->waiter) {
+            const std::coroutine_handle<> waiter = node->waiter;
+            --sleeping_;
+            pool_.destroy(node);
+            lock.unlock();
+            waiter.resume();
+            continue;
+        }
+        index_.erase(node->id);
+        FiredAlarm f{.id = node->id,
+                     .delay = node->delay,
+                     .message = std::move(node->message),
+                     .fired_ns = now * 1000};
+        pool_.destroy(node);
+        lock.unlock();
+        if (options_.on_fired) {
+            options_.on_fired(f);
+        }
+    }
+}
+
+template <typename Queue, typename Clock, typename Lock>
+void BasicAlarmLoop<Queue, Clock, Lock>::run() {
+    Deadline when;
+    while (next_expiry(when)) {
+        if (when > clock_.now()) {
+            clock_.sleep_until(when);
+        }
+        poll();
+    }
+}
+
+extern template class BasicAlarmLoop<TimerQueue>;
+
+}  // namespace alarmd
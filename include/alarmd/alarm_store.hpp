@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "alarmd/alarm.hpp"
+#include "alarmd/cond_var.hpp"
+
+namespace alarmd {
+
+class LogShipper;
+
+// What one write-ahead log record does. Every record is absolute (Start and
+// Change install the alarm as recorded, Cancel and Fire remove it), so a
+// record replayed on a state that already reflects it changes nothing.
+enum class LogKind : std::uint8_t { Start = 1, Change, Cancel, Fire };
+
+struct StoreOptions {
+    std::string dir = {};  // created if missing
+    std::size_t slots = 1;  // one per shard; each slot's records stay in order
+    // Longest a logged record waits before the commit thread writes and
+    // fdatasyncs it, unless someone is blocked in wait_durable().
+    std::chrono::microseconds commit_interval{2000};
+    // Log bytes since the last snapshot that trigger a checkpoint; 0 leaves
+    // checkpoints to explicit checkpoint() calls.
+    std::size_t checkpoint_bytes = 64 << 20;
+    // HOST:PORT of a LogReplica to stream the log to (see LogShipper);
+    // empty ships nothing.
+    std::string replica = {};
+};
+
+struct RecoveryStats {
+    std::size_t snapshot_alarms = 0;
+    std::size_t log_records = 0;
+    std::size_t torn_logs = 0;  // log files that ended in a partial record
+};
+
+// Crash-recoverable alarm store: a write-ahead log plus periodic snapshots
+// in one directory.
+//
+//   wal.<generation>  records appended since the generation was opened
+//   snapshot          every live alarm as of the start of its generation
+//
+// Each record carries a checksum, so a write torn by a crash is detected
+// and replay stops there.
+//
+// Shards log each change under their own lock into their slot's buffer; a
+// commit thread writes every slot with one write and one fdatasync at most
+// `commit_interval` after the first record arrived (group commit), or as
+// soon as the previous sync finishes when a caller waits for durability.
+// Deadlines are logged as wall-clock time so they survive a reboot. With a
+// replica, each synced batch is also handed to a LogShipper.
+//
+// A checkpoint switches the log to a new generation, collects every live
+// alarm through the snapshot callback, writes them to snapshot.tmp, renames
+// it over the snapshot and deletes the older logs. Records that land in the
+// new generation before the collector reaches their shard are in both the
+// snapshot and the log; replay is idempotent, so that is harmless.
+//
+// Recovery: load_snapshot() maps the snapshot and hands out every alarm,
+// replay_log() then replays the logs from the snapshot's generation on,
+// each up to its first torn or corrupt record, and open() starts a new
+// generation and the background threads. Shutdown is finish_checkpoints(),
+// taken before the shards drop their alarms so no checkpoint or replica
+// dump sees them empty, then close() once nothing logs any more. The store
+// can be recovered and opened again after close().
+class AlarmStore {
+public:
+    // Receives recovered alarms with monotonic deadlines; may move from them.
+    using ReplayFn = std::function<void(LogKind, AlarmView&&)>;
+    // Called by checkpoints: passes every live alarm to `emit`.
+    using SnapshotFn = std::function<void(const std::function<void(const AlarmView&)>& emit)>;
+
+    // Throws std::system_error if the directory cannot be created or read.
+    AlarmStore(StoreOptions options, SnapshotFn snapshot);
+    // Calls close().
+    ~AlarmStore();
+
+    AlarmStore(const AlarmStore&) = delete;
+    AlarmStore& operator=(const AlarmStore&) = delete;
+
+    // Recovery, in this order and before open(). load_snapshot throws
+    // std::runtime_error if the snapshot is corrupt; recovery() already has
+    // the snapshot's alarm count when the first alarm is handed out.
+    void load_snapshot(const ReplayFn& replay);
+    void replay_log(const ReplayFn& replay);
+    void open();
+    const RecoveryStats& recovery() const { return recovery_; }
+
+    // Waits out a running checkpoint and starts no more until the next open().
+    void finish_checkpoints();
+    // Writes and syncs every logged record, then stops the commit thread.
+    void close();
+
+    // Logging; each call runs under the calling shard's lock.
+    void log_set(std::size_t slot, LogKind kind, const Alarm& alarm);
+    void log_set(std::size_t slot, LogKind kind, const AlarmView& alarm);
+    void log_cancel(std::size_t slot, int id);
+    // One Fire record per id: alarms that expired and left the queue. A
+    // periodic alarm's fire is logged as the Change that re-arms it.
+    void log_fired(std::size_t slot, const std::vector<int>& ids);
+
+    // Sequence number of the last record logged.
+    std::uint64_t appended() const { return lsn_.load(std::memory_order_acquire); }
+    // Returns once record `lsn` is on disk; false if the log failed to write.
+    bool wait_durable(std::uint64_t lsn);
+    // Writes a snapshot now and drops the logs it covers. Does nothing unless
+    // the store is open; throws std::system_error if the snapshot cannot be
+    // written.
+    void checkpoint();
+
+    std::uint64_t syncs() const;
+    std::uint64_t checkpoints() const;
+    // nullptr without a replica.
+    const LogShipper* shipper() const { return shipper_.get(); }
+
+private:
+    struct alignas(64) Slot {
+        std::mutex mutex;
+        std::string buf;
+    };
+
+    void append(std::size_t slot, const char* record, std::size_t size);
+    void commit_main();
+    void checkpoint_main();
+    void write_snapshot(std::uint64_t generation);
+    void remove_logs_before(std::uint64_t generation);
+    void sync_dir();
+
+    StoreOptions options_;
+    SnapshotFn snapshot_;
+    int dir_fd_ = -1;
+    std::vector<std::uint64_t> logs_;  // generations found on disk, ascending
+    std::uint64_t base_generation_ = 0;  // the snapshot's; older logs are stale
+    RecoveryStats recovery_;
+    std::vector<std::unique_ptr<Slot>> slots_;
+    std::unique_ptr<LogShipper> shipper_;
+    std::atomic<std::uint64_t> lsn_{0};
+    std::mutex checkpoint_mutex_;  // one checkpoint at a time
+
+    mutable std::mutex mutex_;
+    CondVar cond_;             // wakes the commit thread
+    CondVar done_cond_;        // wakes wait_durable() and rotation waiters
+    CondVar checkpoint_cond_;  // wakes the checkpoint thread
+    bool pending_ = false;     // some slot may hold records
+    Deadline since_ = 0;       // when pending_ was set
+    int waiters_ = 0;          // callers blocked in wait_durable()
+    std::uint64_t durable_ = 0;
+    int log_fd_ = -1;          // commit thread only once open
+    std::uint64_t generation_ = 0;
+    bool rotate_ = false;      // checkpoint wants a new generation
+    std::size_t log_bytes_ = 0;  // since the last checkpoint
+    bool checkpoint_wanted_ = false;
+    bool checkpoints_closed_ = true;
+    int error_ = 0;            // errno of the first failed log write
+    std::uint64_t syncs_ = 0;
+    std::uint64_t checkpoints_ = 0;
+    bool open_ = false;
+    bool stopping_ = false;
+    std::thread commit_thread_;
+    std::thread checkpoint_thread_;
+};
+
+}  // namespace alarmd
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "alarmd/parser.hpp"
+#include "alarmd/scheduler.hpp"
+
+namespace alarmd {
+
+// Calls `fn` for every line read from `fd` until EOF, without the trailing
+// '\n'; a final line without a newline is passed too. Regular files are
+// mmap'ed and scanned in place; pipes and sockets are read in `block`-byte
+// read() calls, with memchr splitting each block into lines, and only a
+// line that straddles two blocks is moved. Lines passed to `fn` are only
+// valid during the call. Throws std::system_error if reading fails.
+void for_each_line(int fd, const std::function<void(std::string_view)>& fn,
+                   std::size_t block = std::size_t{1} << 20);
+
+// Applies a parsed bulk or group command (Start_Alarms, Cancel_Alarms,
+// Cancel_Group, Change_Group) synchronously and
+// writes its summary line (format_bulk_result) to `buf`, which must hold
+// kMaxLine bytes; returns the line's length. Started alarms are tagged with
+// `owner`.
+std::size_t run_bulk_command(Scheduler& scheduler, const Command& cmd, std::uint32_t owner,
+                             char* buf);
+
+// Applies a parsed Config command (Scheduler::configure) and writes its
+// reply to `buf`, which must hold kMaxLine bytes: the resulting settings,
+// and whether the trace dump was written. Without `allow_dump` a command
+// with dump= is refused and nothing is changed. Returns the line's length.
+std::size_t run_config_command(Scheduler& scheduler, const Command& cmd, bool allow_dump,
+                               char* buf);
+
+struct BatchStats {
+    std::uint64_t lines = 0;     // non-blank lines seen
+    std::uint64_t commands = 0;  // lines that parsed
+    std::uint64_t invalid = 0;   // lines that did not
+};
+
+// Parses command lines and posts them to a Scheduler in batches of
+// `batch_size` requests (Scheduler::post_batch). View_Alarms, Config and the
+// bulk and group commands flush the pending batch first, so they see every
+// command before them; their summary line goes to Scheduler::write_line().
+class BatchSubmitter {
+public:
+    explicit BatchSubmitter(Scheduler& scheduler, std::size_t batch_size = 1024,
+                            std::FILE* view_out = stdout);
+    ~BatchSubmitter() { flush(); }
+
+    BatchSubmitter(const BatchSubmitter&) = delete;
+    BatchSubmitter& operator=(const BatchSubmitter&) = delete;
+
+    // Returns false for a line that is not a valid command; blank lines are
+    // ignored and return true.
+    bool submit(std::string_view line);
+    void flush();
+
+    const BatchStats& stats() const { return stats_; }
+
+private:
+    Scheduler& scheduler_;
+    std::size_t batch_size_;
+    std::FILE* view_out_;
+    std::vector<AlarmRequest> batch_;
+    BatchStats stats_;
+};
+
+}  // namespace alarmd
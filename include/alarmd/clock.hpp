@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <limits>
+#include <string_view>
+
+namespace alarmd {
+
+// Alarm deadlines are microseconds on CLOCK_MONOTONIC, which keeps counting
+// steadily when the wall clock is stepped (NTP, settimeofday).
+using Deadline = std::int64_t;
+
+// A deadline that never comes.
+inline constexpr Deadline kNoDeadline = std::numeric_limits<Deadline>::max();
+
+// Longest delay Start_Alarm / Change_Alarm accept.
+inline constexpr std::chrono::microseconds kMaxDelay = std::chrono::hours(24 * 366 * 10);
+
+inline std::int64_t clock_us(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return static_cast<std::int64_t>(ts.tv_sec) * 1'000'000 + ts.tv_nsec / 1'000;
+}
+
+inline Deadline monotonic_now() { return clock_us(CLOCK_MONOTONIC); }
+
+// CLOCK_MONOTONIC in nanoseconds, for latency measurements.
+inline std::int64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<std::int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+// Current CLOCK_REALTIME minus CLOCK_MONOTONIC, in microseconds: adding it
+// turns a deadline into wall-clock time, subtracting it turns back.
+inline std::int64_t wall_offset() { return clock_us(CLOCK_REALTIME) - monotonic_now(); }
+
+// Wall-clock time, in microseconds since the epoch, at which a monotonic
+// deadline falls given the current offset between the clocks. Used for
+// display and by the persistent store.
+inline std::int64_t wall_time_of(Deadline deadline) { return deadline + wall_offset(); }
+
+// Parses a delay: a non-negative decimal number with an optional `us`, `ms`
+// or `s` suffix (plain numbers are seconds), e.g. "30", "1.5s", "250ms".
+// Fractions finer than a microsecond are dropped. Consumes the delay from the
+// front of `text` on success; returns false, leaving `text` alone, on syntax
+// errors or delays above kMaxDelay.
+bool parse_duration(std::string_view& text, std::chrono::microseconds& out);
+
+// Writes the shortest exact form of `delay` ("30", "250ms", "1500us"), as
+// accepted by parse_duration, into `buf` and returns it.
+const char* format_duration(std::chrono::microseconds delay, char* buf, std::size_t size);
+
+}  // namespace alarmd
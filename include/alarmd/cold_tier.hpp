@@ -0,0 +1,153 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "alarmd/clock.hpp"
+
+namespace alarmd {
+
+// One alarm as the cold tier hands it out. `message` points into the tier's
+// arena and is only valid until the tier next changes.
+struct ColdAlarm {
+    int id = 0;
+    Deadline deadline = 0;
+    std::chrono::microseconds delay{0};
+    std::string_view message;
+    std::uint32_t owner = 0;
+};
+
+// Rows a scan keeps, bounds inclusive.
+struct ColdQuery {
+    int id_lo = 0;
+    int id_hi = std::numeric_limits<int>::max();
+    Deadline from = std::numeric_limits<Deadline>::min();
+    Deadline to = kNoDeadline;
+};
+
+struct ColdStats {
+    std::size_t alarms = 0;   // live rows
+    std::size_t buckets = 0;
+    std::size_t bytes = 0;    // columns, arenas and index, by capacity
+
+    ColdStats& operator+=(const ColdStats& other) {
+        alarms += other.alarms;
+        buckets += other.buckets;
+        bytes += other.bytes;
+        return *this;
+    }
+};
+
+// Compact store for one-shot, ungrouped alarms that are far from expiry.
+// Alarms are grouped into buckets of 2^32 us (about 71 minutes) of deadline;
+// each bucket keeps its rows as parallel 32-bit columns (deadline offset
+// from the bucket start, id, delay, owner) and its messages, length-prefixed
+// and in row order, in one string arena. Only every kTextStride-th row
+// records where its message starts; the rows in between are found by
+// stepping over the length bytes. Delays are stored as whole milliseconds
+// or seconds, whichever fits, and the rare one that is neither sits in a
+// side map. The owner column stays empty until a row with a non-zero owner
+// arrives.
+//
+// A row with a short message costs about 45 bytes, index included, against
+// about 155 for an Alarm node with its index and queue slots: no links, no
+// sequence number, no per-message allocation.
+//
+// The tier does not order rows inside a bucket; whoever promotes a bucket
+// queues its rows in a timer queue, in insertion order. Removing a row only
+// marks it dead; its space comes back when the bucket is promoted.
+//
+// An open-addressing index maps each live id to its bucket and row, so
+// lookups and removals are O(1). Not thread-safe: the owning shard locks.
+class ColdTier {
+public:
+    static constexpr int kBucketBits = 32;
+
+    static std::uint32_t bucket_of(Deadline deadline) {
+        return static_cast<std::uint32_t>(deadline >> kBucketBits);
+    }
+    static Deadline bucket_start(std::uint32_t bucket) {
+        return static_cast<Deadline>(bucket) << kBucketBits;
+    }
+
+    ColdTier();
+
+    // Adds an alarm, whose id must be new to the tier. Messages longer than
+    // kMaxMessage are truncated.
+    void insert(int id, Deadline deadline, std::chrono::microseconds delay,
+                std::string_view message, std::uint32_t owner);
+    bool contains(int id) const { return find_slot(id) != nullptr; }
+    // Copies the live row carrying `id` into `out`; false if there is none.
+    bool find(int id, ColdAlarm& out) const;
+    // Removes `id`'s row, first copying it into `out` if given; false if
+    // there is none.
+    bool erase(int id, ColdAlarm* out = nullptr);
+
+    // Start of the earliest bucket still holding rows; false when empty.
+    bool first_bucket(Deadline& start) const;
+    // Removes up to `max` rows from the earliest bucket, passing each to `fn`
+    // in insertion order, and returns how many it visited. The bucket goes
+    // once its last row has.
+    std::size_t promote(std::size_t max, const std::function<void(const ColdAlarm&)>& fn);
+
+    // Visits every live row in unspecified order.
+    void for_each(const std::function<void(const ColdAlarm&)>& fn) const;
+    // Visits the live rows `query` keeps, bucket by bucket. Buckets outside
+    // the deadline range are skipped whole; the rest are filtered on their
+    // offset, id and delay columns by the SIMD kernels in row_scan.hpp,
+    // which only touch 12 bytes a row.
+    void scan(const ColdQuery& query, const std::function<void(const ColdAlarm&)>& fn) const;
+
+    std::size_t size() const { return size_; }
+    ColdStats stats() const;
+    void clear();
+
+private:
+    static constexpr std::uint32_t kTextStride = 8;
+    // Delay column values: a removed row (also an empty index slot's row),
+    // and a delay kept in Bucket::odd_delay. Below them the top bit picks
+    // seconds over milliseconds.
+    static constexpr std::uint32_t kDead = 0xFFFFFFFF;
+    static constexpr std::uint32_t kOddDelay = 0xFFFFFFFE;
+    static constexpr std::uint32_t kSeconds = 0x80000000;
+
+    struct Bucket {
+        std::vector<std::uint32_t> offset;  // deadline - bucket start
+        std::vector<int> id;
+        std::vector<std::uint32_t> delay;   // encoded, see encode_delay()
+        std::vector<std::uint32_t> text;    // arena offset of every kTextStride-th row
+        std::vector<std::uint32_t> owner;   // empty while every owner is 0
+        std::string arena;                  // one length byte, then the text
+        std::map<std::uint32_t, std::int64_t> odd_delay;  // row -> microseconds
+        std::uint32_t next = 0;             // rows before it were promoted
+        std::uint32_t live = 0;
+    };
+    struct Slot {
+        int id = 0;
+        std::uint32_t bucket = 0;
+        std::uint32_t row = kDead;  // kDead marks an empty slot
+    };
+
+    static std::uint32_t encode_delay(std::chrono::microseconds delay);
+    static std::size_t text_of(const Bucket& b, std::uint32_t row);
+    ColdAlarm row_of(std::uint32_t key, const Bucket& b, std::uint32_t row) const;
+    std::size_t home(int id) const;
+    std::size_t next(std::size_t slot) const;
+    const Slot* find_slot(int id) const;
+    void index_insert(const Slot& slot);
+    void index_erase(int id);
+    void rehash(std::size_t slots);
+
+    std::map<std::uint32_t, Bucket> buckets_;
+    std::vector<Slot> slots_;
+    std::size_t size_ = 0;
+};
+
+}  // namespace alarmd
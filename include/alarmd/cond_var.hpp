@@ -0,0 +1,33 @@
+#pragma once
+
+#include <mutex>
+
+#include <pthread.h>
+
+#include "alarmd/clock.hpp"
+
+namespace alarmd {
+
+// Condition variable for a std::mutex whose timed waits are measured on
+// CLOCK_MONOTONIC (pthread_condattr_setclock), so a wall-clock step can
+// neither fire nor postpone a pending wait.
+class CondVar {
+public:
+    CondVar();
+    ~CondVar();
+
+    CondVar(const CondVar&) = delete;
+    CondVar& operator=(const CondVar&) = delete;
+
+    void wait(std::unique_lock<std::mutex>& lock);
+    // Returns false once `deadline` has passed.
+    bool wait_until(std::unique_lock<std::mutex>& lock, Deadline deadline);
+
+    void notify_one() noexcept { pthread_cond_signal(&cond_); }
+    void notify_all() noexcept { pthread_cond_broadcast(&cond_); }
+
+private:
+    pthread_cond_t cond_;
+};
+
+}  // namespace alarmd
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace alarmd {
+
+// Parses a CPU list in the kernel's format: comma-separated CPUs and
+// inclusive ranges, "0-3,8,10-11". Returns false on anything else,
+// including an empty list or a CPU past CPU_SETSIZE.
+bool parse_cpu_list(std::string_view text, std::vector<int>& cpus);
+
+// Throws std::invalid_argument if a CPU in `cpus` is outside the process's
+// affinity mask, so a bad list fails before any thread is pinned.
+void check_cpus(const std::vector<int>& cpus);
+
+// Pins the calling thread to `cpu`; false if the kernel refuses.
+bool pin_current_thread(int cpu);
+
+// NUMA node of `cpu` from sysfs, or -1 if the kernel does not say (no NUMA
+// support, or a single-node machine without the topology exposed).
+int numa_node_of_cpu(int cpu);
+
+// Sets a preferred-node policy on the pages of [addr, addr + size), so
+// they are placed on `node` when first touched. `addr` must be page
+// aligned. Returns false, leaving the default first-touch policy, if the
+// kernel has no NUMA policy support.
+bool prefer_numa_node(void* addr, std::size_t size, int node);
+
+}  // namespace alarmd
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "alarmd/alarm.hpp"
+
+namespace alarmd {
+
+// What submit() does with an alarm whose home deque is full.
+enum class OverflowPolicy {
+    Block,     // wait for the worker to make room; every alarm is printed
+    Shed,      // drop the alarm and count it
+    Coalesce,  // fold it into a queued notice of the same alarm and message,
+               // which then prints once with the count; shed if there is none
+};
+
+// Accepts "block", "shed" or "coalesce".
+bool parse_overflow_policy(const char* name, OverflowPolicy& policy);
+const char* overflow_policy_name(OverflowPolicy policy);
+
+// Most display workers a Scheduler runs, at start or after configure().
+inline constexpr int kMaxDisplayThreads = 1024;
+
+struct DisplayOptions {
+    std::size_t capacity = 0;  // alarms each worker's deque holds; 0 for no bound
+    OverflowPolicy overflow = OverflowPolicy::Block;
+    std::vector<int> cpus = {};  // worker N is pinned to cpus[(N - 1) % size]; empty: none
+};
+
+struct DisplayStats {
+    std::size_t queued = 0;
+    std::size_t capacity = 0;      // over all workers; 0 for no bound
+    std::uint64_t shed = 0;
+    std::uint64_t coalesced = 0;
+    std::uint64_t blocked = 0;     // times submit() waited for room
+};
+
+// Fixed pool of display workers with per-worker deques and work stealing.
+// Each expired alarm is queued on its home worker (`id % workers`), so an
+// idle pool keeps the old id-to-thread affinity; a worker whose own deque is
+// empty steals half of the fullest other deque, so one slow sink call only
+// delays the chunk it is printing, not everything queued behind it.
+//
+// Workers take at most kChunk alarms from their own deque at a time and
+// hand them to the sink as one chunk. Threads are created once, in the
+// constructor; submit() never creates threads.
+//
+// With a capacity, memory stays bounded when the sink falls behind: a full
+// deque blocks, sheds or coalesces as `overflow` says. Blocking stalls the
+// submitting alarm thread, which in turn leaves posted requests in its ring
+// until the display catches up.
+class DisplayPool {
+public:
+    // Called on a worker thread with its 1-based number and a chunk of
+    // alarms to print. Several workers may call it concurrently.
+    using Sink = std::function<void(int worker, std::vector<FiredAlarm>& chunk)>;
+
+    static constexpr std::size_t kChunk = 32;
+
+    DisplayPool(int workers, Sink sink, DisplayOptions options = {});
+    // Waits for every submitted alarm to reach the sink, then joins.
+    ~DisplayPool();
+
+    DisplayPool(const DisplayPool&) = delete;
+    DisplayPool& operator=(const DisplayPool&) = delete;
+
+    // Moves every alarm out of `batch` onto its home worker's deque; alarms
+    // shed or coalesced stay behind, moved from or not.
+    void submit(std::vector<FiredAlarm>& batch);
+
+    std::size_t workers() const { return workers_.size(); }
+    // Alarms waiting in worker deques (not counting chunks being printed).
+    std::size_t queued() const { return queued_.load(std::memory_order_relaxed); }
+    std::uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+    DisplayStats stats() const;
+
+private:
+    struct alignas(64) Worker {
+        int number = 0;
+        std::mutex mutex;
+        std::deque<FiredAlarm> queue;
+        std::thread thread;
+        std::condition_variable space;  // a blocked submit() waits here
+        int blocked = 0;
+        // Coalesce only: where an id was last queued, as a count of pushes;
+        // `popped` converts it to a deque index. Entries may be stale.
+        std::unordered_map<int, std::uint64_t> queued_at;
+        std::uint64_t popped = 0;
+    };
+
+    void worker_main(Worker& self);
+    bool take_own(Worker& self, std::vector<FiredAlarm>& chunk);
+    bool steal(Worker& self, std::vector<FiredAlarm>& chunk);
+    // With `self.mutex` held and its deque full: makes room or disposes of
+    // `alarm`; true if it should still be queued.
+    bool overflow(Worker& self, std::unique_lock<std::mutex>& lock, FiredAlarm& alarm,
+                  std::size_t& added);
+    void push(Worker& self, FiredAlarm&& alarm);
+    void wake_workers(std::size_t count);
+
+    Sink sink_;
+    DisplayOptions options_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<std::uint64_t> shed_{0};
+    std::atomic<std::uint64_t> coalesced_{0};
+    std::atomic<std::uint64_t> blocked_{0};
+
+    std::mutex idle_mutex_;
+    std::condition_variable idle_cond_;
+    std::atomic<std::size_t> queued_{0};
+    std::atomic<int> sleepers_{0};
+    std::atomic<std::uint64_t> steals_{0};
+    bool stopping_ = false;  // guarded by idle_mutex_
+};
+
+}  // namespace alarmd
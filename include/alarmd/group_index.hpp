@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "alarmd/alarm.hpp"
+
+namespace alarmd {
+
+// The live alarms tagged with one group, linked through
+// Alarm::group_next/group_prev. Nodes point back at their group.
+struct AlarmGroup {
+    std::string_view tag;  // the index's key
+    Alarm* head = nullptr;
+    std::size_t size = 0;
+};
+
+// Secondary index from group tag to the alarms carrying it, so group-wide
+// commands cost time proportional to the group rather than to every alarm
+// pending. Membership is intrusive: adding and removing an alarm is O(1)
+// once its group is found, and a group is dropped when its last alarm
+// leaves. Like AlarmIndex, it does not own nodes.
+class GroupIndex {
+public:
+    // Links `alarm`, which must not be in a group, into group `tag`.
+    void add(Alarm* alarm, std::string_view tag);
+
+    // Unlinks `alarm` from its group, if it is in one.
+    void remove(Alarm* alarm);
+
+    // Returns the group tagged `tag`, or nullptr when no alarm carries it.
+    AlarmGroup* find(std::string_view tag);
+
+    // Calls `fn(Alarm&)` for each member of `group`; `fn` must not change
+    // the group's membership.
+    template <typename Fn>
+    static void for_each(AlarmGroup& group, Fn&& fn) {
+        for (Alarm* a = group.head; a != nullptr; a = a->group_next) {
+            fn(*a);
+        }
+    }
+
+    std::size_t size() const { return groups_.size(); }
+    // Forgets every group without unlinking the nodes.
+    void clear() { groups_.clear(); }
+
+private:
+    struct TagHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view tag) const {
+            return std::hash<std::string_view>{}(tag);
+        }
+    };
+
+    std::unordered_map<std::string, AlarmGroup, TagHash, std::equal_to<>> groups_;
+};
+
+}  // namespace alarmd
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+#include "alarmd/timer_queue.hpp"
+
+namespace alarmd {
+
+// 4-ary implicit min-heap. Each node records its array index in
+// `Alarm::queue_pos` so that erase is O(log n) without a search. A wider
+// fan-out than binary halves the depth and keeps a node's children in one
+// cache line.
+class HeapQueue final : public TimerQueue {
+public:
+    static constexpr std::size_t kArity = 4;
+
+    void push(Alarm* alarm) override;
+    // Sifts a small batch up node by node; a batch of at least 1/8 of the
+    // resulting heap is appended and the heap rebuilt bottom-up in O(n).
+    void push_bulk(std::vector<Alarm*>& alarms) override;
+    void erase(Alarm* alarm) override;
+    Alarm* peek_due(Deadline now) override;
+    // Re-keys the node where it sits and sifts it, instead of unlinking it.
+    void reschedule(Alarm* alarm, Deadline deadline, std::uint64_t seq) override;
+    bool next_expiry(Deadline& when) const override;
+    std::size_t size() const override { return heap_.size(); }
+    void for_each(const std::function<void(const Alarm&)>& fn) const override;
+    std::size_t purge_cancelled(const ReleaseFn& release) override;
+    void clear(const ReleaseFn& release) override;
+
+    const Alarm* top() const { return heap_.empty() ? nullptr : heap_.front(); }
+
+private:
+    void place(std::size_t i, Alarm* alarm);
+    void sift_up(std::size_t i);
+    void sift_down(std::size_t i);
+    void heapify();
+
+    std::vector<Alarm*> heap_;
+};
+
+}  // namespace alarmd
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "alarmd/clock.hpp"
+
+namespace alarmd {
+
+// Hot-path stages with a latency histogram, in nanoseconds.
+enum class Metric : std::uint8_t {
+    Parse,           // parse_command, per command line
+    LockWait,        // waiting for a shard lock
+    LockHold,        // holding a shard lock
+    FireLateness,    // alarm thread reaching an alarm after its deadline
+    DisplayLatency,  // alarm thread handing an alarm over until it is printed
+};
+
+inline constexpr std::size_t kMetricCount = 5;
+
+const char* metric_name(Metric metric);
+
+// Log-linear (HDR-style) histogram of non-negative values: values below 16
+// get a bucket each, larger ones 16 buckets per power of two, so any
+// recorded value is known to within 1/16 (6.25%) of itself, up to 2^48.
+//
+// One thread records and any thread may read. Counters are atomics touched
+// with relaxed loads and stores only, so recording is a few plain memory
+// operations and readers see a slightly stale but never torn count.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 4;
+    static constexpr std::size_t kSub = std::size_t{1} << kSubBits;
+    static constexpr int kMaxExponent = 47;
+    static constexpr std::size_t kBuckets = (kMaxExponent - kSubBits + 2) * kSub;
+
+    static std::size_t bucket_of(std::uint64_t value) {
+        if (value < kSub) {
+            return static_cast<std::size_t>(value);
+        }
+        const int exponent = std::min(static_cast<int>(std::bit_width(value)) - 1, kMaxExponent);
+        const std::uint64_t sub = (value >> (exponent - kSubBits)) & (kSub - 1);
+        return static_cast<std::size_t>(exponent - kSubBits + 1) * kSub + sub;
+    }
+    // Smallest value that lands in `bucket`.
+    static std::uint64_t lowest_in(std::size_t bucket);
+
+    // Negative values count as zero.
+    void record(std::int64_t value) {
+        const std::uint64_t v = value > 0 ? static_cast<std::uint64_t>(value) : 0;
+        bump(counts_[bucket_of(v)], 1);
+        bump(count_, 1);
+        bump(sum_, v);
+        if (v > max_.load(std::memory_order_relaxed)) {
+            max_.store(v, std::memory_order_relaxed);
+        }
+    }
+
+    // Adds this histogram's counts to `into`; `into` must have one writer.
+    void add_to(LatencyHistogram& into) const;
+
+    std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    std::uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    std::uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const { return count() == 0 ? 0.0 : static_cast<double>(sum()) / count(); }
+    // Smallest value at or above fraction `q` of the recorded values, to
+    // within the bucket precision; 0 when empty.
+    std::uint64_t percentile(double q) const;
+
+private:
+    static void bump(std::atomic<std::uint64_t>& counter, std::uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<std::uint64_t>, kBuckets> counts_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> max_{0};
+};
+
+// Records `ns` into the calling thread's histogram for `metric`. Every
+// thread has its own set, created on first use, so recording never shares
+// a cache line with another thread; a thread's counts are folded into a
+// process-wide total when it exits.
+void record_latency(Metric metric, std::int64_t ns);
+
+// The process-wide histogram of `metric`: every live thread's plus those
+// of threads that have exited.
+void latency_snapshot(Metric metric, LatencyHistogram& out);
+
+// Output of the Stats command: a header and one line per metric with its
+// count, mean, p50, p90, p99, p99.9 and max.
+std::string render_stats(long now);
+// The same figures in the Prometheus text exposition format, as summaries
+// in seconds.
+std::string render_prometheus();
+
+// std::lock_guard for a shard lock that records how long the caller waited
+// for it (LockWait) and then held it (LockHold). An uncontended acquisition
+// costs one clock read and records a zero wait.
+class TimedLock {
+public:
+    explicit TimedLock(std::mutex& mutex) : mutex_(mutex) {
+        acquired_ = monotonic_ns();
+        if (mutex_.try_lock()) {
+            record_latency(Metric::LockWait, 0);
+            return;
+        }
+        mutex_.lock();
+        const std::int64_t waited_from = acquired_;
+        acquired_ = monotonic_ns();
+        record_latency(Metric::LockWait, acquired_ - waited_from);
+    }
+    ~TimedLock() {
+        record_latency(Metric::LockHold, monotonic_ns() - acquired_);
+        mutex_.unlock();
+    }
+
+    TimedLock(const TimedLock&) = delete;
+    TimedLock& operator=(const TimedLock&) = delete;
+
+private:
+    std::mutex& mutex_;
+    std::int64_t acquired_;
+};
+
+}  // namespace alarmd
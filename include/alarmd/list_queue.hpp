@@ -0,0 +1,29 @@
+#pragma once
+
+#include "alarmd/alarm_list.hpp"
+#include "alarmd/timer_queue.hpp"
+
+namespace alarmd {
+
+// The original sorted linked list behind the TimerQueue interface.
+class ListQueue final : public TimerQueue {
+public:
+    void push(Alarm* alarm) override { list_.insert(alarm); }
+    void push_bulk(std::vector<Alarm*>& alarms) override { list_.merge(alarms); }
+    void erase(Alarm* alarm) override { list_.unlink(alarm); }
+    Alarm* peek_due(Deadline now) override;
+    bool next_expiry(Deadline& when) const override;
+    std::size_t size() const override { return list_.size(); }
+    void for_each(const std::function<void(const Alarm&)>& fn) const override {
+        list_.for_each(fn);
+    }
+    std::size_t purge_cancelled(const ReleaseFn& release) override {
+        return list_.purge_cancelled(release);
+    }
+    void clear(const ReleaseFn& release) override { list_.clear(release); }
+
+private:
+    AlarmList list_;
+};
+
+}  // namespace alarmd
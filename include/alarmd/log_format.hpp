@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "alarmd/alarm.hpp"
+#include "alarmd/alarm_store.hpp"
+
+namespace alarmd {
+
+// On-disk format of the alarm store, shared by AlarmStore and the log
+// replica that writes a leader's stream into a directory of its own.
+
+// Fixed part of a log or snapshot record; `size` message bytes follow, then
+// `group_size` bytes of group tag. Records from before groups have a zero
+// there, so they still decode.
+struct RecordHeader {
+    std::uint32_t checksum;  // of everything after this field, message included
+    std::uint8_t kind;
+    std::uint8_t size;
+    std::uint8_t group_size;
+    std::uint8_t unused;
+    std::int32_t id;
+    std::uint32_t repeats;
+    std::uint64_t seq;
+    std::int64_t deadline;  // wall-clock microseconds
+    std::int64_t delay;     // microseconds
+};
+static_assert(sizeof(RecordHeader) == 40);
+
+inline constexpr std::size_t kMaxRecord =
+    sizeof(RecordHeader) + kMaxMessage + kMaxGroupTag;
+
+struct LogHeader {
+    char magic[8];
+    std::uint64_t generation;
+};
+
+// The snapshot is the header followed by `count` Start records, so it can
+// be mapped and decoded in place.
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t unused;
+    std::uint64_t count;
+    std::uint64_t generation;  // first log generation not covered
+};
+
+inline constexpr char kLogMagic[8] = {'A', 'L', 'R', 'M', 'W', 'A', 'L', '1'};
+inline constexpr char kSnapshotMagic[8] = {'A', 'L', 'R', 'M', 'S', 'N', 'P', '1'};
+inline constexpr std::uint32_t kSnapshotVersion = 1;
+
+struct LogRecord {
+    LogKind kind;
+    int id;
+    std::uint32_t repeats;
+    std::uint64_t seq;
+    std::int64_t deadline;
+    std::int64_t delay;
+    std::string_view message;
+    std::string_view group;
+};
+
+// Writes one record to `out`, which must hold kMaxRecord bytes; returns its size.
+std::size_t encode_record(char* out, LogKind kind, int id, std::uint32_t repeats,
+                          std::uint64_t seq, std::int64_t deadline, std::int64_t delay,
+                          std::string_view message, std::string_view group = {});
+// Decodes the record at `p`, advancing past it; false if it is short or
+// fails its checksum.
+bool decode_record(const char*& p, const char* end, LogRecord& r);
+
+// write(2) until all of `data` is out; false with errno set on failure.
+bool write_all(int fd, const char* data, std::size_t size);
+
+// "wal.<generation in hex>".
+std::string log_name(std::uint64_t generation);
+// Creates `dir`/log_name(generation) holding just its header, synced along
+// with `dir_fd`, `dir`'s descriptor; returns its fd, or -1 with errno set.
+int create_log(const std::string& dir, int dir_fd, std::uint64_t generation);
+// Log generations present in `dir`, ascending; throws std::system_error if
+// it cannot be read.
+std::vector<std::uint64_t> list_logs(const std::string& dir);
+
+}  // namespace alarmd
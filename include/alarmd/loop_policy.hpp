@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+#include "alarmd/clock.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace alarmd {
+
+// Clock policies for BasicAlarmLoop: now() in monotonic microseconds, and
+// sleep_until(), which run() waits on between deadlines.
+
+// CLOCK_MONOTONIC, the clock every deadline in the server is on.
+struct MonotonicClock {
+    static constexpr const char* kName = "monotonic";
+
+    Deadline now() const { return monotonic_now(); }
+    void sleep_until(Deadline when) const {
+        const timespec ts{static_cast<time_t>(when / 1'000'000),
+                          static_cast<long>(when % 1'000'000) * 1000};
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+    }
+};
+
+// Time that moves only when told to, for simulations and tests: run()
+// jumps straight to each deadline instead of sleeping.
+class VirtualClock {
+public:
+    static constexpr const char* kName = "virtual";
+
+    Deadline now() const { return now_.load(std::memory_order_relaxed); }
+    void set(Deadline now) { now_.store(now, std::memory_order_relaxed); }
+    void advance(std::chrono::microseconds by) {
+        now_.fetch_add(by.count(), std::memory_order_relaxed);
+    }
+    void sleep_until(Deadline when) {
+        if (when > now()) {
+            set(when);
+        }
+    }
+
+private:
+    std::atomic<Deadline> now_{0};
+};
+
+// Lock policies: any BasicLockable. std::mutex works as it is.
+
+// No locking, for a loop that one thread owns.
+struct NullLock {
+    static constexpr const char* kName = "null";
+
+    void lock() {}
+    void unlock() {}
+};
+
+// Test-and-test-and-set spin lock, for loops whose critical sections (one
+// queue operation each) are shorter than a futex round trip. A waiter that
+// has spun for a while yields, in case the holder was preempted.
+class SpinLock {
+public:
+    static constexpr const char* kName = "spin";
+
+    void lock() {
+        while (locked_.exchange(true, std::memory_order_acquire)) {
+            for (int spins = 0; locked_.load(std::memory_order_relaxed); ++spins) {
+                if (spins < 64) {
+#if defined(__x86_64__)
+                    _mm_pause();
+#elif defined(__aarch64__)
+                    asm volatile("yield");
+#endif
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+    void unlock() { locked_.store(false, std::memory_order_release); }
+
+private:
+    std::atomic<bool> locked_{false};
+};
+
+}  // namespace alarmd
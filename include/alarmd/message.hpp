@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace alarmd {
+
+// Longest message accepted by Start_Alarm / Change_Alarm, excluding the NUL.
+inline constexpr std::size_t kMaxMessage = 127;
+
+// Alarm message text with small-string optimisation. Messages of up to
+// kInline bytes live inside the 24-byte object; longer ones are stored in a
+// process-wide, size-classed block arena whose blocks are recycled, so
+// steady-state traffic does not reach malloc either.
+// The text is always NUL-terminated. Text longer than kMaxMessage is
+// truncated.
+//
+// Messages are meant to be moved: parse -> alarm node -> display thread.
+// Copies are deep and only used for View snapshots.
+class Message {
+public:
+    static constexpr std::size_t kInline = 22;
+
+    Message() noexcept { buf_[0] = '\0'; }
+    explicit Message(std::string_view text);
+    Message(const Message& other) : Message(other.view()) {}
+    Message(Message&& other) noexcept;
+    Message& operator=(const Message& other);
+    Message& operator=(Message&& other) noexcept;
+    ~Message() { release(); }
+
+    std::string_view view() const { return {c_str(), size()}; }
+    const char* c_str() const { return is_inline() ? buf_ : heap().data; }
+    std::size_t size() const { return is_inline() ? size_ : heap().size; }
+    bool empty() const { return size() == 0; }
+    bool is_inline() const { return size_ != kHeapTag; }
+
+private:
+    static constexpr std::uint8_t kHeapTag = 0xFF;
+
+    // Out-of-line representation, stored in the first bytes of `buf_`.
+    struct Heap {
+        char* data;
+        std::uint32_t size;
+    };
+
+    Heap heap() const {
+        Heap h;
+        std::memcpy(&h, buf_, sizeof h);
+        return h;
+    }
+    void set_heap(const Heap& h) { std::memcpy(buf_, &h, sizeof h); }
+    void release() noexcept;
+
+    alignas(8) char buf_[kInline + 1];
+    std::uint8_t size_ = 0;  // inline length, or kHeapTag
+};
+
+static_assert(sizeof(Message) == 24);
+
+}  // namespace alarmd
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace alarmd {
+
+// Bounded lock-free multi-producer single-consumer ring (Vyukov's bounded
+// queue with per-cell sequence numbers). Producers claim a cell with one CAS
+// on `head_` and publish it with a release store of the cell's sequence; no
+// producer ever waits for another to finish. `try_push` fails instead of
+// blocking when the ring is full.
+//
+// Only one thread may call the consumer side (`try_pop`, `empty`) at a time;
+// Shard guarantees that by consuming only under its lock.
+template <typename T>
+class MpscRing {
+public:
+    // `capacity` is rounded up to a power of two.
+    explicit MpscRing(std::size_t capacity) {
+        if (capacity == 0) {
+            throw std::invalid_argument("ring capacity must be positive");
+        }
+        std::size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        cells_ = std::make_unique<Cell[]>(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    bool try_push(T&& value) {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // full: the consumer has not freed this cell yet
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& out) {
+        Cell& cell = cells_[tail_ & mask_];
+        if (cell.seq.load(std::memory_order_acquire) != tail_ + 1) {
+            return false;
+        }
+        out = std::move(cell.value);
+        cell.seq.store(tail_ + mask_ + 1, std::memory_order_release);
+        ++tail_;
+        return true;
+    }
+
+    // True when no published element is waiting. A push that has claimed a
+    // cell but not yet published it is not visible.
+    bool empty() const {
+        return cells_[tail_ & mask_].seq.load(std::memory_order_acquire) != tail_ + 1;
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+private:
+    static constexpr std::size_t kLine = 64;
+
+    struct Cell {
+        std::atomic<std::size_t> seq{0};
+        T value{};
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t mask_ = 0;
+    alignas(kLine) std::atomic<std::size_t> head_{0};  // next cell producers claim
+    alignas(kLine) std::size_t tail_ = 0;              // next cell the consumer reads
+};
+
+}  // namespace alarmd
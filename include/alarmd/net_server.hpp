@@ -0,0 +1,197 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "alarmd/scheduler.hpp"
+
+namespace alarmd {
+
+// Alarm ids owned by another server, and where it listens (IPV4:PORT).
+struct Route {
+    IdRange ids;
+    std::string address;
+};
+
+// Parses "LO-HI=IPV4:PORT" (or "ID=IPV4:PORT"); false on anything else.
+bool parse_route(std::string_view text, Route& route);
+
+struct NetOptions {
+    int tcp_port = -1;                      // -1: no TCP listener; 0: any free port
+    std::string tcp_address = "0.0.0.0";    // IPv4 address to bind
+    std::string unix_path = {};             // empty: no Unix-socket listener
+    int backlog = 4096;
+    std::size_t max_connections = 65536;    // further clients are closed on accept
+    std::size_t max_output = 1 << 20;       // unsent bytes before a slow client is dropped
+    // Most alarms one View_Alarms lists; a longer listing is cut to this
+    // page, whose footer tells the client to ask for the next with offset=.
+    std::size_t max_view = 1000;
+    // Furthest offset= a View_Alarms may start at; every shard still copies
+    // offset + limit rows, so deeper pages are refused.
+    std::size_t max_view_offset = 100000;
+    int cpu = -1;                           // pin the event loop to this CPU; -1: don't
+    // Expire alarms on the event loop through one timerfd per shard, instead
+    // of running an alarm thread per shard.
+    bool timerfd = false;
+    // Ids served by other nodes. Start_Alarm, Change_Alarm and Cancel_Alarm
+    // for an id in a route go to that node instead of this scheduler.
+    std::vector<Route> routes = {};
+};
+
+// Network front end: accepts clients on TCP and/or a Unix socket and speaks
+// the same line protocol as the terminal, one command per line. Every
+// client's results, and the expiry notices of alarms it started, are written
+// back to that client only; View_Alarms lists every client's alarms, at
+// most `max_view` of them per command, starting no further in than
+// `max_view_offset`. A listing that would take the client's unsent output
+// past `max_output`, or starts too far in, is refused with a short line.
+//
+// One event-loop thread multiplexes all clients with edge-triggered epoll,
+// so idle connections cost a file descriptor and two empty strings, not a
+// thread. Shard and display threads never touch sockets: they format their
+// line into the outbox and wake the loop through an eventfd, and the loop
+// distributes it to the owning connection. Commands read from one client in
+// a single pass are posted with Scheduler::post_batch.
+//
+// When a client closes its side, the server applies what it sent and
+// writes back the results before closing. Its alarms stay scheduled, but
+// their expiry notices are dropped.
+//
+// A line starting with "GET " is taken as an HTTP request, so the port
+// doubles as a scrape endpoint: `GET /metrics` returns render_prometheus(),
+// `GET /trace` the Config trace=on events as render_chrome_trace() JSON,
+// cut to the latest that fit in `max_output`, anything else 404, and the
+// connection closes after the response.
+//
+// With `routes` the server is also a thin router. It opens one relay
+// connection per client and node on first use, writes each routed command
+// to it as received, and copies what the node writes back to the client:
+// that node's results, and the notices of alarms started through it. Bulk
+// and group commands, View_Alarms and Stats act on this node only. A client
+// that closes its side closes its relays the same way, and is closed once
+// every node has answered. A relay that fails is reported to its client as
+// "Node ADDRESS unavailable".
+//
+// With `timerfd` the loop also serves the timers: each shard arms its own
+// timerfd (CLOCK_MONOTONIC, absolute) for its next wakeup, so one thread
+// handles I/O and expiries and an idle server sleeps in epoll_wait alone.
+class NetServer {
+public:
+    // Creates the scheduler and binds the listeners; throws std::system_error
+    // if a listener cannot be set up. `scheduler_options.on_result` and
+    // `on_fired` are replaced by the server's routing.
+    NetServer(SchedulerOptions scheduler_options, NetOptions options);
+    ~NetServer();
+
+    NetServer(const NetServer&) = delete;
+    NetServer& operator=(const NetServer&) = delete;
+
+    // Starts the scheduler and the event loop.
+    void start();
+    // Stops the scheduler, delivers what it printed on its way down, then
+    // closes every connection.
+    void stop();
+
+    Scheduler& scheduler() { return scheduler_; }
+    // Port the TCP listener is bound to, or -1.
+    int tcp_port() const { return tcp_port_; }
+    std::size_t connections() const { return connection_count_.load(std::memory_order_relaxed); }
+
+private:
+    struct Connection {
+        int fd = -1;
+        std::string in;           // bytes read but not yet split into lines
+        std::string out;          // bytes queued for the client
+        std::size_t sent = 0;     // prefix of `out` already written
+        bool dirty = false;       // on dirty_, waiting for a flush
+        bool closing = false;     // close (a relay: half-close) once `out` is flushed
+        // A relay to routes[route] on behalf of client `client`.
+        std::uint32_t client = 0;
+        std::size_t route = 0;
+        // A client: its relay per route, 0 while there is none.
+        std::vector<std::uint32_t> relays = {};
+        std::size_t open_relays = 0;
+    };
+    // One line in the outbox: `size` bytes at `begin` of outbox_text_.
+    struct Pending {
+        std::uint32_t owner;
+        std::uint32_t begin;
+        std::uint32_t size;
+    };
+
+    static SchedulerOptions routed(SchedulerOptions options, NetServer* server, bool timerfd);
+    int listen_tcp();
+    int listen_unix();
+    void add_watch(int fd, std::uint64_t token, std::uint32_t events);
+    // Called by shard `shard` when its next wakeup moves to `when`.
+    void arm_timer(std::size_t shard, Deadline when);
+
+    void loop_main();
+    void accept_clients(int listener, bool tcp);
+    std::uint32_t new_owner();
+    void count_connections();
+    // These return false once the connection has been closed; `c` is then
+    // dangling.
+    bool read_client(std::uint32_t owner, Connection& c);
+    bool handle_line(std::uint32_t owner, Connection& c, std::string_view line);
+    // Sends a routed command line to `route`'s node.
+    bool forward(std::uint32_t owner, Connection& c, std::size_t route, std::string_view line);
+    // Connects a relay to `route`'s node for `client`; 0 if that fails at once.
+    std::uint32_t open_relay(std::uint32_t client, std::size_t route);
+    // Copies what the node sent to the relay's client; closes it at EOF.
+    void read_relay(std::uint32_t owner, Connection& r);
+    void close_relay(std::uint32_t owner, bool failed);
+    // Answers an HTTP request line (`request` follows "GET ") and closes.
+    bool serve_http(std::uint32_t owner, Connection& c, std::string_view request);
+    // Replies to the client's own commands (`reply`) may exceed max_output;
+    // notices may not.
+    bool queue_output(std::uint32_t owner, Connection& c, std::string_view text,
+                      bool reply = false);
+    void flush_dirty();
+    void flush_client(std::uint32_t owner, Connection& c);
+    void close_client(std::uint32_t owner);
+    void deliver_outbox();
+
+    // Called from shard and display threads.
+    void post_line(std::uint32_t owner, std::string_view line);
+    void post_lines(int worker, std::vector<FiredAlarm>& chunk);
+    void wake();
+
+    NetOptions options_;
+    Scheduler scheduler_;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    int tcp_fd_ = -1;
+    int unix_fd_ = -1;
+    int tcp_port_ = -1;
+    std::vector<int> timer_fds_;  // one per shard with `timerfd`
+    std::vector<std::pair<std::string, int>> route_hosts_;  // routes[i]'s host and port
+
+    // Event-loop thread only.
+    std::unordered_map<std::uint32_t, Connection> connections_;
+    std::vector<std::uint32_t> dirty_;
+    std::vector<AlarmRequest> batch_;
+    std::uint32_t next_owner_ = 1;
+    std::size_t relay_count_ = 0;
+    std::string outbox_text_work_;
+    std::vector<Pending> outbox_work_;
+
+    std::mutex outbox_mutex_;
+    std::string outbox_text_;      // guarded by outbox_mutex_
+    std::vector<Pending> outbox_;  // guarded by outbox_mutex_
+
+    std::atomic<std::size_t> connection_count_{0};
+    std::atomic<bool> stopping_{false};
+    bool running_ = false;
+    std::thread loop_thread_;
+};
+
+}  // namespace alarmd
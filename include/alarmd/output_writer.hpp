@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include "alarmd/cond_var.hpp"
+
+namespace alarmd {
+
+enum class OutputBackend : std::uint8_t {
+    Auto,    // io_uring when the kernel allows it, otherwise writev
+    Uring,   // io_uring only; construction throws if it is unavailable
+    Writev,
+};
+
+struct OutputOptions {
+    std::size_t slots = 1;
+    // Longest a written line waits before the writer flushes it; 0 flushes
+    // as soon as the writer thread gets to it.
+    std::chrono::microseconds flush_latency{1000};
+    // A slot holding this much is flushed without waiting out the latency.
+    std::size_t buffer_size = 64 * 1024;
+    OutputBackend backend = OutputBackend::Auto;
+};
+
+// Batched output stage for one file descriptor (stdout, a file, a socket).
+// Producers append to one of `slots` buffers, each behind its own mutex, so
+// threads that use different slots never contend; one writer thread swaps
+// every non-empty buffer out and writes them all with a single vectored
+// write (an io_uring WRITEV, or writev(2)), at most `flush_latency` after
+// the first byte arrived. Each slot's bytes reach the fd in order; within
+// one flush the slots are written in index order. The writer only sweeps
+// slots up to the highest one written so far.
+class OutputWriter {
+public:
+    OutputWriter(int fd, OutputOptions options);
+    // Flushes everything written so far, then joins the writer thread.
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    // Queues `text` on `slot` (taken modulo the slot count).
+    void write(std::size_t slot, std::string_view text);
+    // Returns once everything written before the call has reached the fd.
+    void flush();
+    // Takes effect at once, lines already waiting included.
+    void set_flush_latency(std::chrono::microseconds latency);
+
+    // False once the writer has fallen back to writev (or never used io_uring).
+    bool using_uring() const { return use_uring_.load(std::memory_order_relaxed); }
+    // Vectored writes issued, and bytes dropped because a write failed.
+    std::uint64_t writes() const;
+    std::uint64_t dropped() const;
+
+private:
+    class Uring;
+    struct alignas(64) Slot {
+        std::mutex mutex;
+        std::string buf;
+    };
+
+    void writer_main();
+    void write_out(std::vector<std::string>& bufs);
+    // One vectored write; returns bytes written or -errno.
+    long write_iov(const iovec* iov, int count);
+
+    int fd_;
+    OutputOptions options_;
+    std::unique_ptr<Uring> uring_;
+    std::atomic<bool> use_uring_{false};
+    std::vector<std::unique_ptr<Slot>> slots_;
+    // One past the highest slot ever written; the writer sweeps only these,
+    // so slots sized for a peak that is never reached cost nothing per flush.
+    std::atomic<std::size_t> used_{0};
+
+    mutable std::mutex mutex_;
+    CondVar cond_;       // wakes the writer
+    CondVar done_cond_;  // wakes flush() callers
+    bool pending_ = false;   // some slot may hold bytes
+    bool urgent_ = false;    // flush without waiting out the latency
+    Deadline since_ = 0;     // when pending_ was set
+    std::uint64_t flush_requested_ = 0;
+    std::uint64_t flushed_ = 0;
+    std::uint64_t writes_ = 0;
+    std::uint64_t dropped_ = 0;
+    bool stopping_ = false;
+    std::thread writer_thread_;
+};
+
+}  // namespace alarmd
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "alarmd/alarm.hpp"
+#include "alarmd/display_pool.hpp"
+#include "alarmd/message.hpp"
+
+namespace alarmd {
+
+enum class CommandType {
+    Invalid,
+    StartAlarm,   // Start_Alarm(id): SCHEDULE message
+    ChangeAlarm,  // Change_Alarm(id): SCHEDULE message
+    CancelAlarm,  // Cancel_Alarm(id)
+    StartAlarms,  // Start_Alarms(ids): SCHEDULE message
+    CancelAlarms, // Cancel_Alarms(ids)
+    CancelGroup,  // Cancel_Group(tag)
+    ChangeGroup,  // Change_Group(tag): [+|-]delta
+    ViewAlarms,   // View_Alarms [id=A-B] [due=T1-T2] [offset=N] [limit=N]
+    Stats,        // Stats
+    Config,       // Config [display=N] [capacity=N] [overflow=P] [slack=T] [flush=T]
+                  //        [trace=on|off|clear] [dump=PATH]
+};
+
+// What a Config command changes; fields left empty keep their value (see
+// Scheduler::configure). `dump` points into the parsed line.
+struct ConfigChange {
+    std::optional<int> display_threads = {};
+    std::optional<std::size_t> display_capacity = {};
+    std::optional<OverflowPolicy> display_overflow = {};
+    std::optional<std::chrono::microseconds> expiry_slack = {};
+    std::optional<std::chrono::microseconds> flush_latency = {};
+    std::optional<bool> tracing = {};
+    bool clear_trace = false;
+    std::string_view dump = {};  // write the trace recorded so far to this file
+
+    bool empty() const {
+        return !display_threads && !display_capacity && !display_overflow && !expiry_slack &&
+               !flush_latency && !tracing && !clear_trace && dump.empty();
+    }
+};
+
+struct Command {
+    CommandType type = CommandType::Invalid;
+    int id = 0;
+    std::chrono::microseconds delay{0};  // see parse_duration; Change_Group's may be negative
+    std::uint32_t repeats = 0;  // periodic alarms: fires after the first (see Alarm)
+    std::string_view message;  // points into the parsed line
+    std::string_view group;    // group=TAG, or the group commands' tag
+    std::string_view ids;      // Start_Alarms/Cancel_Alarms: the id list, see id_ranges()
+    std::uint64_t id_count = 0;  // how many ids `ids` names, counting repeats
+    ViewFilter view;           // View_Alarms only
+    ConfigChange config;       // Config only
+};
+
+// Parses one input line (with or without its trailing newline) in a single
+// pass, without allocating or copying. Returns false and sets `cmd.type` to
+// Invalid when the line does not match the grammar. `cmd.message` refers to
+// the line buffer and is only valid while it is.
+//
+// SCHEDULE is `delay [group=TAG]` or `every PERIOD [count=N|until=T]
+// [group=TAG]`. `every PERIOD` makes a Start or Change periodic: it fires
+// every PERIOD (which must not be zero) until cancelled, `count=N` times in
+// all, or for as long as the next fire is at most `until=T` from now. A tag
+// is 1 to kMaxGroupTag letters, digits and `_.:-`; on a Change it moves the
+// alarm to that group, and without one the alarm keeps its group.
+//
+// The bulk commands take a comma-separated list of ids and `A-B` ranges,
+// such as `1,5,1000-1999`. Start_Alarms starts every id with the same
+// schedule and message and may name at most kMaxBulkStart ids.
+//
+// View_Alarms takes optional blank-separated filters: `id=N` or `id=A-B`,
+// `due=T1-T2` (durations from now, as in the delay syntax), `offset=N` and
+// `limit=N`. Either end of a range may be left out: `id=100-`, `due=-30s`.
+bool parse_command(std::string_view line, Command& cmd);
+
+inline constexpr std::uint64_t kMaxBulkStart = 1 << 20;
+
+// The ranges of a parsed command's `ids`, in the order written.
+std::vector<IdRange> id_ranges(std::string_view ids);
+
+const char* command_name(CommandType type);
+
+}  // namespace alarmd
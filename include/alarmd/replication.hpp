@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "alarmd/alarm.hpp"
+#include "alarmd/cond_var.hpp"
+
+namespace alarmd {
+
+// Splits "HOST:PORT", HOST a dotted IPv4 address; false on anything else.
+bool parse_host_port(std::string_view text, std::string& host, int& port);
+
+struct ShipOptions {
+    std::string address = {};  // HOST:PORT of the follower's LogReplica
+    // Unsent bytes past which the backlog is dropped and the follower is
+    // sent a fresh dump instead.
+    std::size_t max_backlog = 64 << 20;
+    // Bytes streamed after which a fresh dump replaces them on the follower,
+    // so its log stays about as short as the leader's; 0: never.
+    std::size_t dump_bytes = 64 << 20;
+    std::chrono::milliseconds retry{200};  // between connection attempts
+};
+
+struct ShipStats {
+    bool connected = false;
+    std::uint64_t bytes = 0;  // log and dump bytes sent
+    std::uint64_t dumps = 0;  // completed dumps
+    std::size_t backlog = 0;  // committed bytes not yet sent
+};
+
+// Leader side of log shipping: streams the records an AlarmStore commits to
+// one LogReplica over TCP, asynchronously, so a slow or absent follower
+// never holds up a commit.
+//
+// Each connection starts with a dump of every live alarm, taken through
+// the state callback, after which the shipper sends each committed batch.
+// Batches committed while the dump runs are queued and follow it. As with
+// checkpoints, records that land in both are harmless because replay is
+// idempotent. A lost connection or an overflowing backlog costs a fresh
+// dump, never a gap. Records reach the follower only after they are
+// durable on the leader.
+class LogShipper {
+public:
+    using StateFn = std::function<void(const std::function<void(const AlarmView&)>& emit)>;
+
+    // Throws std::invalid_argument if the address does not parse.
+    LogShipper(ShipOptions options, StateFn state);
+    // Calls close().
+    ~LogShipper();
+
+    LogShipper(const LogShipper&) = delete;
+    LogShipper& operator=(const LogShipper&) = delete;
+
+    // Starts the sender thread; the shipper can be started again after close().
+    void start();
+    // Called by the commit thread with whole records it has just synced.
+    void ship(std::string_view records);
+    // Waits out a running dump and starts no more: the state is about to go.
+    void finish_dumps();
+    // Sends what is queued, giving up after about a second on a follower
+    // that does not read it, then disconnects and joins the thread.
+    void close();
+
+    ShipStats stats() const;
+
+private:
+    void ship_main();
+    int connect_follower();
+    // Both return false once the connection is unusable.
+    bool dump(int fd);
+    bool stream(int fd);
+
+    ShipOptions options_;
+    StateFn state_;
+    std::string host_;
+    int port_ = 0;
+
+    mutable std::mutex mutex_;
+    CondVar cond_;       // wakes the sender thread
+    CondVar done_cond_;  // wakes finish_dumps() and close()
+    std::string queue_;  // committed, not yet sent
+    bool streaming_ = false;  // the connection is past its dump's start
+    bool dumping_ = false;
+    bool dumps_closed_ = false;
+    bool stopping_ = false;
+    bool finished_ = true;    // the sender thread has returned
+    int fd_ = -1;             // the connection, for close() to shut down
+    std::size_t since_dump_ = 0;
+    ShipStats stats_;
+    std::thread thread_;
+};
+
+struct ReplicaOptions {
+    std::string dir = {};                // created if missing
+    int port = 0;                        // 0: any free port
+    std::string address = "0.0.0.0";
+};
+
+struct ReplicaStats {
+    bool connected = false;
+    std::uint64_t records = 0;  // log records written
+    std::uint64_t dumps = 0;    // dumps installed as the snapshot
+};
+
+// Follower side of log shipping: accepts one leader at a time and writes its
+// stream into `dir` in the store's own format. Each dump becomes the
+// snapshot, installed only once complete, with a fresh log generation for
+// the records that follow it. Every record is checked before it is
+// written, and each batch is fdatasync'ed.
+//
+// Failover is starting a server with the replica's directory as its
+// data_dir, once the replica has stopped: it recovers the leader's alarms as
+// of the last batch that arrived.
+class LogReplica {
+public:
+    // Creates the directory and binds the listener; throws std::system_error
+    // if either fails.
+    explicit LogReplica(ReplicaOptions options);
+    // Calls stop().
+    ~LogReplica();
+
+    LogReplica(const LogReplica&) = delete;
+    LogReplica& operator=(const LogReplica&) = delete;
+
+    void start();
+    // Drops the leader, if any, and joins the thread.
+    void stop();
+
+    int port() const { return port_; }
+    ReplicaStats stats() const;
+
+private:
+    struct Session;
+
+    void serve_main();
+    void serve(int fd);
+    bool install_dump(Session& s);
+
+    ReplicaOptions options_;
+    int listen_fd_ = -1;
+    int dir_fd_ = -1;
+    int port_ = -1;
+
+    mutable std::mutex mutex_;
+    int conn_fd_ = -1;  // guarded by mutex_, for stop() to shut down
+    ReplicaStats stats_;
+    std::atomic<bool> stopping_{false};
+    bool running_ = false;
+    std::thread thread_;
+};
+
+}  // namespace alarmd
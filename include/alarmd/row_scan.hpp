@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace alarmd {
+
+// Bounds for a scan over a cold bucket's columns, all inclusive. A row
+// matches when its deadline offset and id are in range and its delay is
+// not `dead`.
+struct RowFilter {
+    std::uint32_t offset_lo = 0;
+    std::uint32_t offset_hi = 0xFFFFFFFF;
+    int id_lo = 0;
+    int id_hi = 0;
+    std::uint32_t dead = 0xFFFFFFFF;
+};
+
+// Writes the index of every matching row of the first `rows` into `out`,
+// which must have room for `rows`, in ascending order; returns how many.
+using RowScanFn = std::size_t (*)(const std::uint32_t* offset, const int* id,
+                                  const std::uint32_t* delay, std::size_t rows,
+                                  const RowFilter& filter, std::uint32_t* out);
+
+enum class ScanIsa { Scalar, Avx2, Neon };
+
+const char* scan_isa_name(ScanIsa isa);
+
+// Instruction sets this build and CPU can run, Scalar first.
+std::vector<ScanIsa> supported_scan_isas();
+
+// The kernel for `isa`, or nullptr if it is not supported here.
+RowScanFn row_scan_kernel(ScanIsa isa);
+
+// The widest supported kernel, picked on first use from the CPU's
+// feature flags, so one binary runs on any x86-64 or AArch64 machine.
+ScanIsa scan_isa();
+std::size_t scan_rows(const std::uint32_t* offset, const int* id, const std::uint32_t* delay,
+                      std::size_t rows, const RowFilter& filter, std::uint32_t* out);
+
+}  // namespace alarmd
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "alarmd/alarm.hpp"
+#include "alarmd/alarm_store.hpp"
+#include "alarmd/display_pool.hpp"
+#include "alarmd/output_writer.hpp"
+#include "alarmd/parser.hpp"
+#include "alarmd/replication.hpp"
+#include "alarmd/shard.hpp"
+#include "alarmd/timer_queue.hpp"
+
+namespace alarmd {
+
+struct SchedulerOptions {
+    int display_threads = 2;
+    int shards = 1;
+    QueueKind queue = QueueKind::Heap;
+    std::FILE* out = stdout;  // where display threads print expired alarms
+    std::size_t ring_capacity = 4096;              // per-shard posted requests
+    std::chrono::microseconds expiry_slack{0};    // coalesce alarms due this close together
+    // Keep one-shot, ungrouped alarms due further out than about this in each
+    // shard's compact cold tier (see Shard, ColdTier); 0 turns it off.
+    std::chrono::microseconds cold_horizon{0};
+    Shard::ResultFn on_result = {};  // outcome of each posted request; may be empty
+    // Runs the shards without alarm threads: each shard reports through here
+    // when its next wakeup moves (see Shard::ArmFn), and the caller runs
+    // poll_shard() once that time is reached.
+    std::function<void(std::size_t shard, Deadline when)> on_arm = {};
+    // Replaces printing to `out`: display workers hand each chunk of expired
+    // alarms here instead. Called concurrently from every worker.
+    DisplayPool::Sink on_fired = {};
+    // Bound on each display worker's backlog and what happens past it (see
+    // DisplayPool); 0 leaves it unbounded.
+    std::size_t display_capacity = 1 << 16;
+    OverflowPolicy display_overflow = OverflowPolicy::Block;
+    // CPUs to pin threads to: shard i's alarm thread to shard_cpus[i % size],
+    // which also puts its alarm nodes on that CPU's NUMA node, and display
+    // worker N to display_cpus[(N - 1) % size]. Empty lists pin nothing.
+    std::vector<int> shard_cpus = {};
+    std::vector<int> display_cpus = {};
+    // Send display output, write_line() and view_alarms(out) through an
+    // OutputWriter on fileno(out): one slot per display worker, up to
+    // kMaxDisplayThreads, plus one shared slot, flushed together at most
+    // `flush_latency` after a line is written. `out` must then be backed by
+    // a file descriptor.
+    bool batch_output = false;
+    std::chrono::microseconds flush_latency{1000};
+    OutputBackend output_backend = OutputBackend::Auto;
+    // Directory for the write-ahead log and snapshots (see AlarmStore);
+    // empty keeps alarms in memory only. With one, start() first restores
+    // the alarms recorded there and stop() keeps them on disk.
+    std::string data_dir = {};
+    std::chrono::microseconds commit_interval{2000};
+    std::size_t checkpoint_bytes = 64 << 20;
+    // start_alarm, change_alarm and cancel_alarm return only once their
+    // record is on disk, and false if the log write failed. Posted requests
+    // are on disk within commit_interval of being applied either way.
+    bool sync_commit = false;
+    // HOST:PORT of a follower's LogReplica to stream the write-ahead log to
+    // (see LogShipper); needs a data_dir.
+    std::string replica = {};
+};
+
+// Longest line format_fired or format_result produce, including the '\n'.
+inline constexpr std::size_t kMaxLine = 256;
+
+// The server's output lines, '\n'-terminated. Both return the length
+// written to `buf`, which must hold kMaxLine bytes; `now` is wall seconds.
+std::size_t format_fired(const FiredAlarm& alarm, int worker, long now, char* buf);
+std::size_t format_result(const RequestResult& result, long now, char* buf);
+
+// What a bulk or group command did, for its summary line.
+struct BulkResult {
+    RequestKind kind = RequestKind::Start;  // Start, Cancel, or Change for Change_Group
+    std::string_view ids = {};  // the id list or group tag as the command wrote it
+    bool group = false;         // Cancel_Group/Change_Group; `requested` is unused
+    std::uint64_t requested = 0;
+    std::uint64_t applied = 0;
+    std::chrono::microseconds delay{0};  // Start; the shift for Change_Group
+    std::uint32_t repeats = 0;
+    std::string_view message = {};
+};
+
+// Same contract as format_result; a long id list is shortened.
+std::size_t format_bulk_result(const BulkResult& result, long now, char* buf);
+
+// The alarm server. Alarms are partitioned over `shards` independent Shards
+// by `shard_of(id)`, so commands and expiries for different shards never
+// contend on a lock. Expired alarms from every shard go to a work-stealing
+// DisplayPool of `display_threads` workers; alarm `id` is normally printed by
+// worker `id % display_threads + 1` but may be stolen by an idle one. Fired
+// alarms are moved, not copied, from the alarm node through the pool to the
+// printing thread.
+class Scheduler {
+public:
+    explicit Scheduler(SchedulerOptions options = {});
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // With a data_dir, restores the recorded alarms first; alarms that came
+    // due while the server was down fire right away. Throws if the store
+    // cannot be read.
+    void start();
+    // Stops the alarm threads, discards pending alarms (they stay in the
+    // store, if any) and waits for display threads to print whatever was
+    // already handed to them.
+    void stop();
+
+    // Returns false if an alarm with `id` already exists. With `repeats`
+    // the alarm is periodic: it fires every `delay`, repeats more times
+    // after the first (kRepeatForever: until cancelled). A `group` tag
+    // makes it a member of that group for the group commands.
+    bool start_alarm(int id, std::chrono::microseconds delay, std::string_view message,
+                     std::uint32_t repeats = 0, std::string_view group = {});
+    // Returns false if no alarm with `id` exists. Replaces the schedule, so
+    // a change without `repeats` makes the alarm one-shot; a change without
+    // `group` leaves the alarm in its group.
+    bool change_alarm(int id, std::chrono::microseconds delay, std::string_view message,
+                      std::uint32_t repeats = 0, std::string_view group = {});
+    bool cancel_alarm(int id);
+    // Bulk forms of start_alarm and cancel_alarm: the alarms are split by
+    // shard and each shard applies its share under one lock acquisition.
+    // Each returns how many alarms it started or cancelled. start_alarms()
+    // skips ids that are taken (entry kinds are ignored) and leaves
+    // `entries` empty.
+    std::size_t start_alarms(std::vector<AlarmRequest>& entries);
+    std::size_t cancel_alarms(const std::vector<IdRange>& ids);
+    // Group commands, in time proportional to the group's size: cancel
+    // every alarm tagged `tag`, or move each one's deadline by `delta`
+    // (negative is sooner). Both return how many alarms they applied to.
+    std::size_t cancel_group(std::string_view tag);
+    std::size_t shift_group(std::string_view tag, std::chrono::microseconds delta);
+    // Asynchronous form of the three commands above: queues the request on
+    // its shard and reports the outcome through `on_result`, usually from
+    // that shard's alarm thread. Requests for one id apply in post order.
+    void post(AlarmRequest&& request);
+    // Posts every request in `batch`, in order, checking each shard's alarm
+    // thread for a wakeup once per batch rather than once per request.
+    // Leaves `batch` empty.
+    void post_batch(std::vector<AlarmRequest>& batch);
+    // Applies every request posted so far.
+    void drain();
+    // Copies the live alarms matching `filter` into `out` in expiry order,
+    // keeping only the requested page, and returns how many matched before
+    // paging. Each shard's lock is held only while its matches are copied.
+    std::size_t snapshot(const ViewFilter& filter, std::vector<AlarmView>& out) const;
+    // Prints snapshot(filter) as the View_Alarms listing, with a
+    // "Showing A-B of N" footer when the filter asks for a page.
+    void view_alarms(std::FILE* out, const ViewFilter& filter = {}) const;
+    // Writes a line to `out`, through the batched output stage when it is on
+    // so it stays ordered with the alarm notices. Safe from any thread while
+    // the scheduler is running.
+    void write_line(std::string_view line);
+    // Returns once every line written so far has reached `out`.
+    void flush_output();
+
+    // Applies a Config command's changes (ConfigChange::dump is left to the
+    // caller) without losing alarms. A new display thread count, capacity
+    // or overflow policy starts a new DisplayPool and swaps it in: expired
+    // alarms go to the new pool from then on, and the call returns once the
+    // old one has printed what it held. Shard count and queue kind are
+    // fixed at construction. Throws
+    // std::invalid_argument, before changing anything, for a value the
+    // constructor would reject.
+    void configure(const ConfigChange& change);
+    // The settings configure() changes, as a Config command spells them:
+    // "display=2 capacity=65536 overflow=block slack=0 flush=1ms trace=off".
+    std::string config_summary() const;
+
+    std::size_t pending() const;
+    // Node pool statistics summed over every shard.
+    PoolStats pool_stats() const;
+    ColdStats cold_stats() const;
+    std::uint64_t fired() const { return fired_.load(std::memory_order_relaxed); }
+    // Chunks display workers took from another worker's deque.
+    std::uint64_t display_steals() const;
+    DisplayStats display_stats() const;
+    // The Stats command's output and the /metrics page: the latency
+    // histograms (see latency_stats.hpp) plus the display backlog.
+    std::string render_stats(long now) const;
+    std::string render_prometheus() const;
+    std::size_t shard_count() const { return shards_.size(); }
+    // With on_arm: expires shard `shard`'s due alarms and re-arms it.
+    void poll_shard(std::size_t shard) { shards_[shard]->poll(); }
+    // Alarm thread wakeups and polls, summed over every shard.
+    std::uint64_t wakeups() const;
+    // nullptr without a data_dir.
+    AlarmStore* store() { return store_.get(); }
+    // Log shipping to the replica; all zero without one.
+    ShipStats replication() const;
+
+private:
+    Shard& shard(int id) const { return *shards_[shard_of(id, shards_.size())]; }
+    std::unique_ptr<DisplayPool> make_display();
+    // With state_mutex_ held: swaps in a pool built from options_.
+    void replace_display();
+    void print(int worker, std::vector<FiredAlarm>& chunk);
+    void recover();
+    // Passes every live alarm to `emit`, one shard at a time.
+    void collect(const std::function<void(const AlarmView&)>& emit) const;
+    // Waits for the store when sync_commit asks for it; returns `ok`, or
+    // false if the record could not be made durable.
+    bool committed(bool ok);
+    std::size_t committed(std::size_t applied) { return committed(applied != 0) ? applied : 0; }
+    static void render_view(const std::vector<AlarmView>& alarms, const ViewFilter& filter,
+                            std::size_t total, const std::function<void(std::string_view)>& emit);
+
+    SchedulerOptions options_;
+    std::unique_ptr<AlarmStore> store_;  // outlives the shards that log into it
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    mutable std::mutex state_mutex_;  // guards start/stop, writer_ and display_
+    bool running_ = false;
+    std::unique_ptr<OutputWriter> writer_;  // created before display_, reset after it
+    std::unique_ptr<DisplayPool> display_;
+    // Held shared by shards handing over expired alarms and exclusively by
+    // replace_display(), so a pool is never swapped out under a submit().
+    std::shared_mutex display_swap_;
+    // Counters of the pools replace_display() retired; guarded by state_mutex_.
+    DisplayStats retired_display_;
+    std::uint64_t retired_steals_ = 0;
+    std::atomic<std::uint64_t> fired_{0};
+};
+
+}  // namespace alarmd
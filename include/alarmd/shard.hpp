@@ -0,0 +1,286 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "alarmd/alarm.hpp"
+#include "alarmd/alarm_index.hpp"
+#include "alarmd/alarm_store.hpp"
+#include "alarmd/cold_tier.hpp"
+#include "alarmd/cond_var.hpp"
+#include "alarmd/group_index.hpp"
+#include "alarmd/mpsc_ring.hpp"
+#include "alarmd/slab_pool.hpp"
+#include "alarmd/timer_queue.hpp"
+
+namespace alarmd {
+
+enum class RequestKind : std::uint8_t { Start, Change, Cancel };
+
+// A Start/Change/Cancel command queued for a shard's alarm thread.
+struct AlarmRequest {
+    RequestKind kind = RequestKind::Start;
+    int id = 0;
+    std::chrono::microseconds delay{0};
+    Message message;  // unused for Cancel
+    std::uint32_t owner = 0;  // client to report to; a Start also tags the alarm with it
+    std::uint32_t repeats = 0;  // Start/Change: periodic every `delay` (see Alarm)
+    Message group = {};  // Start/Change: group tag; a Change without one keeps its group
+};
+
+// Outcome of a posted request. `message` points into the alarm node and is
+// only valid for the duration of the callback.
+struct RequestResult {
+    RequestKind kind = RequestKind::Start;
+    int id = 0;
+    std::chrono::microseconds delay{0};
+    bool ok = false;  // false: duplicate id (Start) or unknown id (Change/Cancel)
+    std::string_view message;
+    std::uint32_t owner = 0;  // the request's owner
+    std::uint32_t repeats = 0;
+};
+
+struct ShardOptions {
+    QueueKind queue = QueueKind::Heap;
+    std::size_t ring_capacity = 4096;  // posted requests buffered before fallback
+    // Alarms due within this much of now expire together with the ones that
+    // are already due, so near-simultaneous timers cost one wakeup.
+    std::chrono::microseconds expiry_slack{0};
+    // Where Start/Change/Cancel and expiries are logged, into `store_slot`;
+    // nullptr keeps the shard in memory only.
+    AlarmStore* store = nullptr;
+    std::size_t store_slot = 0;
+    // Pins the alarm thread to this CPU and allocates alarm nodes on its
+    // NUMA node; -1 leaves both to the kernel.
+    int cpu = -1;
+    // One-shot, ungrouped alarms whose ColdTier bucket starts more than this
+    // far out are kept in the compact cold tier until it comes this close;
+    // 0 keeps every alarm in the timer queue.
+    std::chrono::microseconds cold_horizon{0};
+};
+
+// One partition of the alarm set: its own timer queue, id index, lock,
+// condition variable and alarm thread. The alarm thread waits on
+// `alarm_cond_`, a CLOCK_MONOTONIC condvar, for the earliest deadline, pops
+// every alarm due by then (plus the coalescing slack) in one critical section
+// and passes the batch to the expire callback outside the lock, moving the
+// messages out of the nodes.
+//
+// A periodic alarm stays queued when it fires: its message is copied into
+// the batch and the node is rescheduled in place to the next multiple of its
+// period after the original deadline, so late wakeups add no drift. Missed
+// occurrences fold into one fire and still count against its repeats.
+//
+// `index_` maps ids to live alarms, so Change and Cancel are O(1) lookups,
+// and `groups_` links each group tag's members, so group commands only visit
+// them. Cancel only marks the node as a tombstone; the alarm thread frees it
+// at the head of the queue, and compact() sweeps them if they dominate.
+//
+// Nodes come from a per-shard SlabPool and are only allocated and freed
+// under `alarm_mutex_`, so Start/Cancel churn never reaches the global
+// allocator.
+//
+// With a cold horizon, far-future alarms start in `cold_` instead of a node.
+// Once a cold bucket starts within the horizon the alarm thread promotes it
+// into the queue, a bounded number of rows per pass, so it is woken for
+// those alarms in time. Commands and views look in both tiers.
+//
+// With a store, every change is logged under `alarm_mutex_` as it is
+// applied, and each expiry batch before the lock is released, so the log
+// orders one id's records the way the shard applied them.
+//
+// `post` pushes requests into a lock-free MPSC ring and only takes the lock
+// to signal an alarm thread that is asleep, so a burst of commands costs one
+// wakeup. Whoever holds `alarm_mutex_` is the ring's single consumer; the
+// synchronous entry points drain it first so requests apply in order.
+//
+// The wait is tickless: `armed_` records the wakeup the alarm thread sleeps
+// until, and a command only signals it when its deadline comes before that,
+// so starts behind the head, cancels and an idle shard cause no wakeups.
+//
+// With an arm callback the shard has no alarm thread. The callback is told
+// each time the next wakeup moves earlier (kNoDeadline: none), and whoever
+// owns the timer, say a timerfd in an epoll loop, calls poll() once it is
+// reached.
+class Shard {
+public:
+    // Receives each batch of expired alarms; may move from the elements.
+    using ExpireFn = std::function<void(std::vector<FiredAlarm>&)>;
+    // Called with the shard lock held; must not call back into the shard.
+    using ResultFn = std::function<void(const RequestResult&)>;
+    // Called with the shard lock held, with the monotonic time poll() is
+    // next due; must not call back into the shard.
+    using ArmFn = std::function<void(Deadline)>;
+
+    Shard(const ShardOptions& options, ExpireFn on_expire, ResultFn on_result = {},
+          ArmFn on_arm = {});
+    ~Shard();
+
+    Shard(const Shard&) = delete;
+    Shard& operator=(const Shard&) = delete;
+
+    void start();
+    // Stops the alarm thread (or waits out a running poll()) and discards
+    // pending alarms.
+    void stop();
+    // With an arm callback: applies posted requests, fires every due alarm
+    // and re-arms. Safe to call early or spuriously; does nothing unless the
+    // shard is running.
+    void poll();
+
+    bool start_alarm(int id, std::chrono::microseconds delay, std::string_view message,
+                     std::uint32_t repeats = 0, std::string_view group = {});
+    bool change_alarm(int id, std::chrono::microseconds delay, std::string_view message,
+                      std::uint32_t repeats = 0, std::string_view group = {});
+    bool cancel_alarm(int id);
+
+    // Group commands; both return how many of the shard's alarms they
+    // applied to. shift_group() moves every deadline in the group by
+    // `delta`, keeping each alarm's delay and repeats.
+    std::size_t cancel_group(std::string_view tag);
+    std::size_t shift_group(std::string_view tag, std::chrono::microseconds delta);
+
+    // Bulk forms, applied in one pass under one lock acquisition; both
+    // return how many alarms they applied to. start_alarms() starts every
+    // entry whose id is free (their kind is not looked at) and queues the
+    // new nodes together, so a heap is rebuilt once rather than sifted per
+    // alarm. cancel_alarms() cancels each of `ids` plus every live alarm in
+    // one of `ranges`, which it finds by scanning the queue.
+    std::size_t start_alarms(std::vector<AlarmRequest>& entries);
+    std::size_t cancel_alarms(const std::vector<int>& ids, const std::vector<IdRange>& ranges);
+
+    // Queues `request` for the alarm thread; its outcome is reported through
+    // the result callback. Falls back to applying it under the lock when the
+    // ring is full.
+    void post(AlarmRequest&& request);
+    // post() in two halves, for submitting a batch with one wakeup check:
+    // enqueue() queues the request without waking the alarm thread (it returns
+    // false when it had to apply the request itself because the ring was
+    // full), and notify_posted() wakes the alarm thread if it is asleep.
+    bool enqueue(AlarmRequest&& request);
+    void notify_posted();
+    // Applies every request posted so far.
+    void drain();
+
+    // Applies posted requests, then appends to `out` a copy of the `keep`
+    // earliest live alarms that match `filter` (ignoring its page), in no
+    // particular order, and returns how many matched. Only the filtered copy
+    // runs under the shard lock; sorting is left to the caller.
+    std::size_t snapshot(const ViewFilter& filter, Deadline now, std::vector<AlarmView>& out,
+                         std::size_t keep = std::numeric_limits<std::size_t>::max());
+
+    // Recovery, before start(); neither logs. restore() installs the
+    // recovered alarms, whose ids must be new to the shard, in bulk;
+    // replay() applies one log record on top.
+    void restore(std::vector<AlarmView>& alarms);
+    void replay(LogKind kind, AlarmView&& alarm);
+
+    // Live alarms, not counting posted requests that are not yet applied.
+    std::size_t pending() const;
+    PoolStats pool_stats() const;
+    ColdStats cold_stats() const;
+    // Times the alarm thread woke up, or poll() ran.
+    std::uint64_t wakeups() const;
+
+    // Replaces the expiry slack; the alarm thread recomputes its wakeup.
+    void set_expiry_slack(std::chrono::microseconds slack);
+
+private:
+    // armed_ while nobody waits: the alarm thread is awake and recomputes its
+    // wakeup before it sleeps again.
+    static constexpr Deadline kAwake = std::numeric_limits<Deadline>::min();
+
+    void alarm_thread_main();
+    // One batch of the expiry loop: applies posted requests and fires due
+    // alarms, handing them to the expire callback with the lock released.
+    // Returns false once nothing was due.
+    bool expire_pass(std::unique_lock<std::mutex>& lock, std::int64_t& held_from);
+    // When the earliest live deadline (less the slack) or cold promotion is
+    // due, or kNoDeadline.
+    Deadline next_wakeup_locked() const;
+    // Wakes the alarm thread, or moves the armed timer, if `wakeup` comes
+    // before the wakeup it is armed for.
+    void rearm_locked(Deadline wakeup);
+    void drain_locked();
+    void apply(AlarmRequest& request);
+    bool start_locked(int id, std::chrono::microseconds delay, Message&& message,
+                      std::uint32_t owner, std::uint32_t repeats, std::string_view group);
+    bool change_locked(int id, std::chrono::microseconds delay, Message&& message,
+                       std::uint32_t repeats, std::string_view group);
+    // A new node for `id`, indexed, grouped, queued and logged as `kind`.
+    Alarm* create_locked(LogKind kind, int id, std::chrono::microseconds delay,
+                         Message&& message, std::uint32_t owner, std::uint32_t repeats,
+                         std::string_view group);
+    bool taken(int id) const { return index_.find(id) != nullptr || cold_contains(id); }
+    bool cold_contains(int id) const { return cold_.size() != 0 && cold_.contains(id); }
+    bool goes_cold(Deadline deadline, std::uint32_t repeats, std::string_view group,
+                   Deadline now) const;
+    // Puts a new alarm in the cold tier and logs it as `kind` if it belongs
+    // there; false (and `message` untouched) otherwise.
+    bool stash_cold_locked(LogKind kind, int id, std::chrono::microseconds delay,
+                           Message& message, std::uint32_t owner, std::uint32_t repeats,
+                           std::string_view group);
+    // Moves up to `max` rows of due cold buckets into the queue; returns how
+    // many rows it went through.
+    std::size_t promote_locked(Deadline now, std::size_t max);
+    // Unlinks and frees a live node.
+    void discard_locked(Alarm* alarm);
+    // Fires `alarm`, which is due, into batch_; false once it is done and
+    // must be unlinked and freed. `now_ns` is when this expiry pass began.
+    bool fire_locked(Alarm& alarm, Deadline horizon, std::int64_t now_ns);
+    bool cancel_locked(int id);
+    // Installs `view` under its id, replacing any alarm already there, and
+    // returns the node, unlinked: the caller queues it.
+    Alarm* install_locked(AlarmView&& view);
+    void wake();
+    void compact();
+    void release(Alarm* alarm) { pool_.destroy(alarm); }
+
+    ExpireFn on_expire_;
+    ArmFn on_arm_;
+    Deadline slack_us_;
+    Deadline cold_horizon_;
+    std::vector<FiredAlarm> batch_;  // alarm thread only
+    std::vector<int> expired_;       // ids of batch_'s finished alarms, for the store
+    std::vector<Alarm*> fresh_;      // start_alarms(), restore(): nodes to queue
+    ResultFn on_result_;
+    AlarmStore* store_;
+    std::size_t store_slot_;
+    int cpu_;
+    MpscRing<AlarmRequest> requests_;
+    std::atomic<bool> sleeping_{false};  // alarm thread is (about to be) waiting
+    std::mutex poll_mutex_;              // one poll() at a time; stop() waits on it
+
+    mutable std::mutex alarm_mutex_;
+    CondVar alarm_cond_;
+    Deadline armed_ = kAwake;  // wakeup the alarm thread or timer waits for
+    std::uint64_t wakeups_ = 0;
+    SlabPool<Alarm> pool_;
+    std::unique_ptr<TimerQueue> alarms_;
+    AlarmIndex index_;
+    GroupIndex groups_;
+    ColdTier cold_;
+    std::size_t tombstones_ = 0;
+    std::uint64_t next_seq_ = 0;
+    bool stopping_ = false;
+    bool running_ = false;
+    std::thread alarm_thread_;
+};
+
+// Maps an alarm id to one of `shards` partitions. Uses a different hash than
+// AlarmIndex so the ids landing in one shard still spread over its index.
+inline std::size_t shard_of(int id, std::size_t shards) {
+    const std::uint64_t h =
+        static_cast<std::uint64_t>(static_cast<std::uint32_t>(id)) * 0xD6E8FEB86659FD93ull;
+    return static_cast<std::size_t>(((h >> 32) * shards) >> 32);
+}
+
+}  // namespace alarmd
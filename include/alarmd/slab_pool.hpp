@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "alarmd/cpu_affinity.hpp"
+
+namespace alarmd {
+
+struct PoolStats {
+    std::size_t live = 0;        // objects currently allocated
+    std::size_t slabs = 0;       // slabs obtained from the heap
+    std::size_t capacity = 0;    // objects the slabs can hold
+    std::size_t high_water = 0;  // largest `live` seen
+
+    PoolStats& operator+=(const PoolStats& other) {
+        live += other.live;
+        slabs += other.slabs;
+        capacity += other.capacity;
+        high_water += other.high_water;
+        return *this;
+    }
+};
+
+// Fixed-size object pool. Memory is taken from the heap one slab of
+// `slab_objects` objects at a time and never returned until the pool is
+// destroyed; freed objects go on an intrusive LIFO free list, so once the
+// pool has grown to its working-set size `create` and `destroy` do no heap
+// allocation at all.
+//
+// Slabs are page aligned. With a `numa_node`, each new slab's pages are
+// placed on that node however remote the allocating thread is, so a shard
+// pinned to a node keeps its alarm nodes in local memory.
+//
+// Not thread-safe: each pool is owned by one Shard and only used under that
+// shard's lock.
+template <typename T>
+class SlabPool {
+public:
+    explicit SlabPool(std::size_t slab_objects = 1024, int numa_node = -1)
+        : slab_objects_(slab_objects), numa_node_(numa_node) {}
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (free_ == nullptr) {
+            grow();
+        }
+        Node* node = free_;
+        free_ = node->next;
+        T* object = ::new (static_cast<void*>(node->storage)) T(std::forward<Args>(args)...);
+        if (++live_ > high_water_) {
+            high_water_ = live_;
+        }
+        return object;
+    }
+
+    void destroy(T* object) {
+        object->~T();
+        Node* node = reinterpret_cast<Node*>(object);
+        node->next = free_;
+        free_ = node;
+        --live_;
+    }
+
+    PoolStats stats() const {
+        return {live_, slabs_.size(), slabs_.size() * slab_objects_, high_water_};
+    }
+
+private:
+    union Node {
+        Node* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static constexpr std::align_val_t kPage{4096};
+
+    struct SlabDeleter {
+        void operator()(Node* slab) const { ::operator delete(slab, kPage); }
+    };
+
+    void grow() {
+        const std::size_t bytes = slab_objects_ * sizeof(Node);
+        std::unique_ptr<Node, SlabDeleter> slab(static_cast<Node*>(::operator new(bytes, kPage)));
+        if (numa_node_ >= 0) {
+            // Before the free list below touches the pages.
+            prefer_numa_node(slab.get(), bytes, numa_node_);
+        }
+        Node* nodes = slab.get();
+        for (std::size_t i = slab_objects_; i-- > 0;) {
+            nodes[i].next = free_;
+            free_ = &nodes[i];
+        }
+        slabs_.push_back(std::move(slab));
+    }
+
+    std::size_t slab_objects_;
+    int numa_node_;
+    std::vector<std::unique_ptr<Node, SlabDeleter>> slabs_;
+    Node* free_ = nullptr;
+    std::size_t live_ = 0;
+    std::size_t high_water_ = 0;
+};
+
+}  // namespace alarmd
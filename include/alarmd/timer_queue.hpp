@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "alarmd/alarm.hpp"
+
+namespace alarmd {
+
+// Priority queue of pending alarms ordered by `expires_before`. Queues link
+// nodes through the fields Alarm reserves for them but never own them: the
+// caller allocates every node and frees it after erase or pop, and the bulk
+// operations hand removed nodes back through a release callback.
+class TimerQueue {
+public:
+    using ReleaseFn = std::function<void(Alarm*)>;
+
+    virtual ~TimerQueue() = default;
+
+    // Links `alarm`, which must not already be queued.
+    virtual void push(Alarm* alarm) = 0;
+
+    // Links every alarm in `alarms`, none of them already queued. Queues
+    // that can build their order faster in bulk than one push at a time
+    // override it; the order of `alarms` may change.
+    virtual void push_bulk(std::vector<Alarm*>& alarms) {
+        for (Alarm* alarm : alarms) {
+            push(alarm);
+        }
+    }
+
+    // Unlinks a queued alarm.
+    virtual void erase(Alarm* alarm) = 0;
+
+    // Returns the earliest alarm expiring at or before `now`, still linked,
+    // or nullptr if none is due.
+    virtual Alarm* peek_due(Deadline now) = 0;
+
+    // Unlinks and returns what peek_due(now) would return.
+    Alarm* pop_due(Deadline now) {
+        Alarm* alarm = peek_due(now);
+        if (alarm != nullptr) {
+            erase(alarm);
+        }
+        return alarm;
+    }
+
+    // Moves a queued alarm to a new deadline and sequence number without
+    // handing it back to the caller: periodic alarms re-arm this way. The
+    // node's other fields may already have changed.
+    virtual void reschedule(Alarm* alarm, Deadline deadline, std::uint64_t seq) {
+        erase(alarm);
+        alarm->deadline = deadline;
+        alarm->seq = seq;
+        push(alarm);
+    }
+
+    // Stores a deadline no later than the earliest expiry in `when`; the
+    // alarm thread may wake early but never late. Returns false when empty.
+    virtual bool next_expiry(Deadline& when) const = 0;
+
+    virtual std::size_t size() const = 0;
+    bool empty() const { return size() == 0; }
+
+    // Visits every queued alarm in unspecified order.
+    virtual void for_each(const std::function<void(const Alarm&)>& fn) const = 0;
+
+    // Unlinks every alarm marked `cancelled` and passes it to `release`;
+    // returns how many.
+    virtual std::size_t purge_cancelled(const ReleaseFn& release) = 0;
+
+    // Unlinks every alarm and passes it to `release`.
+    virtual void clear(const ReleaseFn& release) = 0;
+};
+
+enum class QueueKind {
+    List,   // sorted linked list: O(n) insert, O(1) expire
+    Heap,   // 4-ary min-heap: O(log n) insert and expire
+    Wheel,  // hierarchical timing wheel: O(1) insert and expire
+};
+
+std::unique_ptr<TimerQueue> make_timer_queue(QueueKind kind);
+
+// Accepts "list", "heap" or "wheel".
+bool parse_queue_kind(const char* name, QueueKind& kind);
+const char* queue_kind_name(QueueKind kind);
+
+}  // namespace alarmd
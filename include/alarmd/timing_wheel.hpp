@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "alarmd/timer_queue.hpp"
+
+namespace alarmd {
+
+// Hashed hierarchical timing wheel with kLevels levels of kSlots slots. Level
+// L slots each span kSlots^L ticks of kTickUs microseconds, so the wheel
+// covers about 12 days at millisecond granularity.
+// Alarms further out than the top level are parked on an overflow list and
+// re-placed each time the top level wraps. Insert and erase are O(1); an
+// alarm is cascaded at most once per level on its way to level 0.
+//
+// Due alarms are moved to a ready list sorted by `expires_before`, so alarms
+// sharing a tick still pop in deadline and then FIFO order, and pop_due
+// never returns an alarm before its exact deadline. Empty stretches of the
+// wheel are skipped using per-level occupancy bitmaps.
+class TimingWheel final : public TimerQueue {
+public:
+    static constexpr int kSlotBits = 6;
+    static constexpr int kSlots = 1 << kSlotBits;
+    static constexpr int kLevels = 5;
+    static constexpr Deadline kTickUs = 1'000;
+
+    void push(Alarm* alarm) override;
+    void erase(Alarm* alarm) override;
+    Alarm* peek_due(Deadline now) override;
+    bool next_expiry(Deadline& when) const override;
+    std::size_t size() const override { return size_; }
+    void for_each(const std::function<void(const Alarm&)>& fn) const override;
+    std::size_t purge_cancelled(const ReleaseFn& release) override;
+    void clear(const ReleaseFn& release) override;
+
+private:
+    struct List {
+        Alarm* head = nullptr;
+        Alarm* tail = nullptr;
+    };
+
+    static constexpr std::uint32_t kReady = kLevels * kSlots;
+    static constexpr std::uint32_t kOverflow = kReady + 1;
+    static constexpr std::uint32_t kLists = kOverflow + 1;
+
+    void place(Alarm* alarm);
+    void insert_ready(Alarm* alarm);
+    void append(std::uint32_t pos, Alarm* alarm);
+    void unlink(Alarm* alarm);
+    List take(std::uint32_t pos);
+    bool next_event(std::int64_t& tick, int& level) const;
+    void advance(std::int64_t now);
+    void cascade(std::int64_t tick);
+    void expire_slot(std::int64_t tick);
+
+    List lists_[kLists];
+    std::uint64_t occupied_[kLevels] = {};
+    std::int64_t current_ = 0;  // every tick before this has been processed
+    std::size_t size_ = 0;
+    std::vector<Alarm*> scratch_;
+};
+
+}  // namespace alarmd
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace alarmd {
+
+// Alarm lifecycle events the trace records.
+enum class TraceKind : std::uint8_t {
+    Start,   // a shard applied a Start
+    Change,  // ... a Change
+    Cancel,  // ... a Cancel
+    Fire,    // the alarm thread took the alarm off its queue
+    Print,   // a display worker printed it, a span from when it fired
+};
+
+const char* trace_kind_name(TraceKind kind);
+
+// Events each thread's ring keeps; older ones are overwritten.
+inline constexpr std::size_t kTraceRing = 1 << 15;
+// Most JSON one event takes in render_chrome_trace().
+inline constexpr std::size_t kTraceEventBytes = 256;
+
+// Whether trace() records. Off, a trace point costs one relaxed load and
+// a branch.
+inline std::atomic<bool> g_tracing{false};
+
+inline bool tracing() { return g_tracing.load(std::memory_order_relaxed); }
+void set_tracing(bool on);
+
+void record_trace(TraceKind kind, int id, std::int64_t since_ns);
+
+// Appends an event for alarm `id` to the calling thread's ring, created on
+// the thread's first event; `since_ns` (monotonic_ns) starts a Print span.
+// As with the latency histograms, one thread writes each ring with relaxed
+// stores and a reader may see the event being written torn.
+inline void trace(TraceKind kind, int id, std::int64_t since_ns = 0) {
+    if (tracing()) {
+        record_trace(kind, id, since_ns);
+    }
+}
+
+// Drops every event recorded so far.
+void clear_trace();
+
+// The recorded events in the Chrome trace event format, which Perfetto and
+// chrome://tracing load: one JSON object, instant events per thread and a
+// complete event for each Print. Threads that have exited keep their
+// events until clear_trace(). With `max_events`, only the latest of each
+// ring are rendered, the limit shared evenly with what a quieter ring
+// leaves over going to the others.
+std::string render_chrome_trace(std::size_t max_events = std::numeric_limits<std::size_t>::max());
+
+// Writes render_chrome_trace() to the file at `path`, replacing it; false
+// with errno set if it could not be written.
+bool write_chrome_trace(std::string_view path);
+
+}  // namespace alarmd
@@ -0,0 +1,111 @@
+#include "alarmd/alarm_index.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <utility>
+
+namespace alarmd {
+
+AlarmIndex::AlarmIndex(std::size_t capacity)
+    : slots_(std::bit_ceil(capacity < 16 ? std::size_t{16} : capacity)),
+      mask_(slots_.size() - 1) {}
+
+// Fibonacci hashing: sequential ids spread evenly over the table.
+std::size_t AlarmIndex::home(int id) const {
+    const std::uint64_t h =
+        static_cast<std::uint64_t>(static_cast<std::uint32_t>(id)) * 0x9E3779B97F4A7C15ull;
+    return static_cast<std::size_t>(h >> 32) & mask_;
+}
+
+Alarm* AlarmIndex::find(int id) const {
+    for (std::size_t i = home(id);; i = (i + 1) & mask_) {
+        const Slot& slot = slots_[i];
+        if (slot.alarm == nullptr) {
+            return nullptr;
+        }
+        if (slot.id == id) {
+            return slot.alarm;
+        }
+    }
+}
+
+bool AlarmIndex::insert(Alarm* alarm) {
+    if ((size_ + 1) * 4 > slots_.size() * 3) {
+        grow();
+    }
+    for (std::size_t i = home(alarm->id);; i = (i + 1) & mask_) {
+        Slot& slot = slots_[i];
+        if (slot.alarm == nullptr) {
+            slot.id = alarm->id;
+            slot.alarm = alarm;
+            ++size_;
+            return true;
+        }
+        if (slot.id == alarm->id) {
+            return false;
+        }
+    }
+}
+
+Alarm* AlarmIndex::erase(int id) {
+    std::size_t i = home(id);
+    for (;; i = (i + 1) & mask_) {
+        if (slots_[i].alarm == nullptr) {
+            return nullptr;
+        }
+        if (slots_[i].id == id) {
+            break;
+        }
+    }
+    Alarm* removed = slots_[i].alarm;
+    // Shift later members of the probe run back into the hole unless that
+    // would move them before their home slot.
+    for (std::size_t j = (i + 1) & mask_;; j = (j + 1) & mask_) {
+        Slot& next = slots_[j];
+        if (next.alarm == nullptr) {
+            break;
+        }
+        const std::size_t h = home(next.id);
+        const bool between = i <= j ? (i < h && h <= j) : (i < h || h <= j);
+        if (!between) {
+            slots_[i] = next;
+            i = j;
+        }
+    }
+    slots_[i] = Slot{};
+    --size_;
+    return removed;
+}
+
+void AlarmIndex::clear() {
+    for (Slot& slot : slots_) {
+        slot = Slot{};
+    }
+    size_ = 0;
+}
+
+void AlarmIndex::reserve(std::size_t n) {
+    std::size_t slots = slots_.size();
+    while (n * 4 > slots * 3) {
+        slots *= 2;
+    }
+    if (slots != slots_.size()) {
+        rehash(slots);
+    }
+}
+
+void AlarmIndex::grow() { rehash(slots_.size() * 2); }
+
+void AlarmIndex::rehash(std::size_t slots) {
+    std::vector<Slot> old(slots);
+    old.swap(slots_);
+    mask_ = slots_.size() - 1;
+    size_ = 0;
+    for (const Slot& slot : old) {
+        if (slot.alarm != nullptr) {
+            insert(slot.alarm);
+        }
+    }
+}
+
+}  // namespace alarmd
@@ -0,0 +1,102 @@
+#include "alarmd/alarm_list.hpp"
+
+#include <algorithm>
+
+namespace alarmd {
+
+void AlarmList::insert(Alarm* alarm) {
+    Alarm** last = &head_;
+    Alarm* next = head_;
+    while (next != nullptr) {
+        if (next->deadline > alarm->deadline) {
+            break;
+        }
+        last = &next->link;
+        next = next->link;
+    }
+    alarm->link = next;
+    *last = alarm;
+    ++size_;
+}
+
+void AlarmList::merge(std::vector<Alarm*>& alarms) {
+    std::stable_sort(alarms.begin(), alarms.end(),
+                     [](const Alarm* a, const Alarm* b) { return a->deadline < b->deadline; });
+    Alarm** last = &head_;
+    for (Alarm* alarm : alarms) {
+        while (*last != nullptr && (*last)->deadline <= alarm->deadline) {
+            last = &(*last)->link;
+        }
+        alarm->link = *last;
+        *last = alarm;
+        last = &alarm->link;
+    }
+    size_ += alarms.size();
+}
+
+Alarm* AlarmList::find(int id) const {
+    for (Alarm* a = head_; a != nullptr; a = a->link) {
+        if (a->id == id) {
+            return a;
+        }
+    }
+    return nullptr;
+}
+
+Alarm* AlarmList::remove(int id) {
+    for (Alarm** last = &head_; *last != nullptr; last = &(*last)->link) {
+        Alarm* a = *last;
+        if (a->id == id) {
+            *last = a->link;
+            a->link = nullptr;
+            --size_;
+            return a;
+        }
+    }
+    return nullptr;
+}
+
+void AlarmList::unlink(Alarm* alarm) {
+    Alarm** last = &head_;
+    while (*last != alarm) {
+        last = &(*last)->link;
+    }
+    *last = alarm->link;
+    alarm->link = nullptr;
+    --size_;
+}
+
+Alarm* AlarmList::pop_front() {
+    Alarm* a = head_;
+    if (a != nullptr) {
+        head_ = a->link;
+        a->link = nullptr;
+        --size_;
+    }
+    return a;
+}
+
+std::size_t AlarmList::purge_cancelled(const std::function<void(Alarm*)>& release) {
+    std::size_t purged = 0;
+    for (Alarm** last = &head_; *last != nullptr;) {
+        Alarm* a = *last;
+        if (a->cancelled) {
+            *last = a->link;
+            a->link = nullptr;
+            release(a);
+            ++purged;
+        } else {
+            last = &a->link;
+        }
+    }
+    size_ -= purged;
+    return purged;
+}
+
+void AlarmList::clear(const std::function<void(Alarm*)>& release) {
+    while (Alarm* a = pop_front()) {
+        release(a);
+    }
+}
+
+}  // namespace alarmd
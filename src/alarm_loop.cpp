@@ -0,0 +1,7 @@
+#include "alarmd/alarm_loop.hpp"
+
+namespace alarmd {
+
+template class BasicAlarmLoop<TimerQueue>;
+
+}  // namespace alarmd
@@ -0,0 +1,521 @@
+#include "alarmd/alarm_store.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alarmd/group_index.hpp"
+#include "alarmd/log_format.hpp"
+#include "alarmd/replication.hpp"
+
+namespace alarmd {
+
+namespace {
+
+// Snapshot writes go out in pieces of about this size.
+constexpr std::size_t kWriteChunk = 1 << 20;
+
+AlarmView to_view(const LogRecord& r, std::int64_t offset) {
+    return {r.deadline - offset, r.seq, Message(r.message), std::chrono::microseconds(r.delay),
+            r.id, r.repeats, Message(r.group)};
+}
+
+// Read-only mapping of a whole file; empty if the file does not exist.
+class Mapping {
+public:
+    explicit Mapping(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            if (errno != ENOENT) {
+                throw std::system_error(errno, std::generic_category(), path);
+            }
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            size_ = static_cast<std::size_t>(st.st_size);
+            void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                const int error = errno;
+                close(fd);
+                throw std::system_error(error, std::generic_category(), path);
+            }
+            data_ = static_cast<const char*>(addr);
+            madvise(addr, size_, MADV_SEQUENTIAL);
+        }
+        close(fd);
+        exists_ = true;
+    }
+    ~Mapping() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    bool exists() const { return exists_; }
+    const char* begin() const { return data_; }
+    const char* end() const { return data_ + size_; }
+    std::size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool exists_ = false;
+};
+
+}  // namespace
+
+AlarmStore::AlarmStore(StoreOptions options, SnapshotFn snapshot)
+    : options_(std::move(options)), snapshot_(std::move(snapshot)) {
+    if (options_.dir.empty()) {
+        throw std::invalid_argument("alarm store needs a directory");
+    }
+    if (options_.slots < 1) {
+        throw std::invalid_argument("alarm store needs at least one slot");
+    }
+    if (options_.commit_interval.count() < 0) {
+        throw std::invalid_argument("commit_interval must not be negative");
+    }
+    if (mkdir(options_.dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::system_error(errno, std::generic_category(), options_.dir);
+    }
+    dir_fd_ = ::open(options_.dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), options_.dir);
+    }
+    for (std::size_t i = 0; i < options_.slots; ++i) {
+        slots_.push_back(std::make_unique<Slot>());
+    }
+    if (!options_.replica.empty()) {
+        shipper_ = std::make_unique<LogShipper>(
+            ShipOptions{.address = options_.replica, .dump_bytes = options_.checkpoint_bytes},
+            snapshot_);
+    }
+}
+
+AlarmStore::~AlarmStore() {
+    close();
+    ::close(dir_fd_);
+}
+
+void AlarmStore::load_snapshot(const ReplayFn& replay) {
+    logs_ = list_logs(options_.dir);
+    base_generation_ = 0;
+    recovery_ = {};
+    const std::string path = options_.dir + "/snapshot";
+    const Mapping file(path);
+    if (!file.exists()) {
+        return;
+    }
+    SnapshotHeader header;
+    if (file.size() < sizeof header) {
+        throw std::runtime_error(path + ": snapshot is truncated");
+    }
+    std::memcpy(&header, file.begin(), sizeof header);
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof header.magic) != 0 ||
+        header.version != kSnapshotVersion) {
+        throw std::runtime_error(path + ": not an alarm snapshot");
+    }
+    recovery_.snapshot_alarms = header.count;
+    const std::int64_t offset = wall_offset();
+    const char* p = file.begin() + sizeof header;
+    LogRecord r;
+    for (std::uint64_t i = 0; i < header.count; ++i) {
+        if (!decode_record(p, file.end(), r)) {
+            throw std::runtime_error(path + ": snapshot is corrupt");
+        }
+        replay(LogKind::Start, to_view(r, offset));
+    }
+    base_generation_ = header.generation;
+}
+
+void AlarmStore::replay_log(const ReplayFn& replay) {
+    const std::int64_t offset = wall_offset();
+    for (const std::uint64_t generation : logs_) {
+        if (generation < base_generation_) {
+            continue;
+        }
+        const Mapping file(options_.dir + "/" + log_name(generation));
+        // A crash between creating a log and syncing its header leaves it
+        // short; it holds no records.
+        if (file.size() < sizeof(LogHeader) ||
+            std::memcmp(file.begin(), kLogMagic, sizeof kLogMagic) != 0) {
+            ++recovery_.torn_logs;
+            continue;
+        }
+        const char* p = file.begin() + sizeof(LogHeader);
+        LogRecord r;
+        while (decode_record(p, file.end(), r)) {
+            replay(r.kind, to_view(r, offset));
+            ++recovery_.log_records;
+        }
+        if (p != file.end()) {
+            ++recovery_.torn_logs;
+        }
+    }
+}
+
+void AlarmStore::open() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (open_) {
+        return;
+    }
+    const std::uint64_t generation =
+        std::max(logs_.empty() ? 0 : logs_.back(), base_generation_) + 1;
+    // Logs older than the snapshot are left over from a crash mid-checkpoint.
+    remove_logs_before(base_generation_);
+    log_fd_ = create_log(options_.dir, dir_fd_, generation);
+    if (log_fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), log_name(generation));
+    }
+    generation_ = generation;
+    durable_ = lsn_.load(std::memory_order_relaxed);
+    log_bytes_ = 0;
+    error_ = 0;
+    rotate_ = false;
+    checkpoint_wanted_ = false;
+    checkpoints_closed_ = false;
+    stopping_ = false;
+    open_ = true;
+    commit_thread_ = std::thread(&AlarmStore::commit_main, this);
+    checkpoint_thread_ = std::thread(&AlarmStore::checkpoint_main, this);
+    if (shipper_) {
+        shipper_->start();
+    }
+}
+
+void AlarmStore::finish_checkpoints() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (checkpoints_closed_) {
+            return;
+        }
+        checkpoints_closed_ = true;
+    }
+    checkpoint_cond_.notify_one();
+    checkpoint_thread_.join();
+    // The follower's dumps read the same state as checkpoints.
+    if (shipper_) {
+        shipper_->finish_dumps();
+    }
+    // An explicit checkpoint() may still be running on another thread.
+    std::lock_guard<std::mutex> wait(checkpoint_mutex_);
+}
+
+void AlarmStore::close() {
+    finish_checkpoints();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!open_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    cond_.notify_one();
+    commit_thread_.join();
+    if (shipper_) {
+        shipper_->close();  // after the last commit, so the follower gets it too
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    ::close(log_fd_);
+    log_fd_ = -1;
+    open_ = false;
+    done_cond_.notify_all();
+}
+
+void AlarmStore::log_set(std::size_t slot, LogKind kind, const Alarm& alarm) {
+    char record[kMaxRecord];
+    append(slot, record,
+           encode_record(record, kind, alarm.id, alarm.repeats, alarm.seq,
+                         wall_time_of(alarm.deadline), alarm.delay.count(), alarm.message.view(),
+                         alarm.group != nullptr ? alarm.group->tag : std::string_view()));
+}
+
+void AlarmStore::log_set(std::size_t slot, LogKind kind, const AlarmView& alarm) {
+    char record[kMaxRecord];
+    append(slot, record,
+           encode_record(record, kind, alarm.id, alarm.repeats, alarm.seq,
+                         wall_time_of(alarm.deadline), alarm.delay.count(), alarm.message.view(),
+                         alarm.group.view()));
+}
+
+void AlarmStore::log_cancel(std::size_t slot, int id) {
+    char record[kMaxRecord];
+    append(slot, record, encode_record(record, LogKind::Cancel, id, 0, 0, 0, 0, {}));
+}
+
+void AlarmStore::log_fired(std::size_t slot, const std::vector<int>& ids) {
+    if (ids.empty()) {
+        return;
+    }
+    Slot& s = *slots_[slot % slots_.size()];
+    bool first;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        first = s.buf.empty();
+        std::size_t used = s.buf.size();
+        s.buf.resize(used + ids.size() * sizeof(RecordHeader));
+        for (const int id : ids) {
+            used += encode_record(s.buf.data() + used, LogKind::Fire, id, 0, 0, 0, 0, {});
+        }
+        lsn_.fetch_add(ids.size(), std::memory_order_release);
+    }
+    if (first) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!pending_) {
+            pending_ = true;
+            since_ = monotonic_now();
+            cond_.notify_one();
+        }
+    }
+}
+
+void AlarmStore::append(std::size_t slot, const char* record, std::size_t size) {
+    Slot& s = *slots_[slot % slots_.size()];
+    bool first;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        first = s.buf.empty();
+        s.buf.append(record, size);
+        lsn_.fetch_add(1, std::memory_order_release);
+    }
+    // Only the first record after a commit starts the interval; later ones
+    // ride along.
+    if (first) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!pending_) {
+            pending_ = true;
+            since_ = monotonic_now();
+            cond_.notify_one();
+        }
+    }
+}
+
+bool AlarmStore::wait_durable(std::uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (durable_ < lsn && error_ == 0 && open_) {
+        ++waiters_;
+        cond_.notify_one();  // skip the rest of the interval
+        while (durable_ < lsn && error_ == 0 && open_) {
+            done_cond_.wait(lock);
+        }
+        --waiters_;
+    }
+    return durable_ >= lsn;
+}
+
+void AlarmStore::checkpoint() {
+    std::lock_guard<std::mutex> one(checkpoint_mutex_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!open_ || checkpoints_closed_) {
+        return;
+    }
+    const std::uint64_t before = generation_;
+    rotate_ = true;
+    cond_.notify_one();
+    while (rotate_) {
+        done_cond_.wait(lock);
+    }
+    if (generation_ == before) {
+        throw std::system_error(error_, std::generic_category(), "rotating the write-ahead log");
+    }
+    const std::uint64_t generation = generation_;
+    lock.unlock();
+    // Everything logged before the rotation is in the state the callback
+    // reads, so the snapshot covers every older generation.
+    write_snapshot(generation);
+    remove_logs_before(generation);
+    lock.lock();
+    ++checkpoints_;
+}
+
+std::uint64_t AlarmStore::syncs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return syncs_;
+}
+
+std::uint64_t AlarmStore::checkpoints() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return checkpoints_;
+}
+
+void AlarmStore::commit_main() {
+    std::vector<std::string> bufs(slots_.size());
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        if (!pending_ && !rotate_) {
+            if (stopping_) {
+                return;
+            }
+            cond_.wait(lock);
+            continue;
+        }
+        if (!rotate_ && waiters_ == 0 && !stopping_ &&
+            cond_.wait_until(lock, since_ + options_.commit_interval.count())) {
+            continue;  // woken early: re-check what changed
+        }
+        pending_ = false;
+        const bool rotate = rotate_;
+        lock.unlock();
+        // Records are numbered and buffered under one slot lock, so every
+        // record up to `target` is in a buffer by the time the swap below
+        // takes that buffer's lock.
+        const std::uint64_t target = lsn_.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < slots_.size(); ++i) {
+            std::lock_guard<std::mutex> slot_lock(slots_[i]->mutex);
+            bufs[i].swap(slots_[i]->buf);
+        }
+        int error = 0;
+        std::size_t bytes = 0;
+        for (const std::string& buf : bufs) {
+            if (!buf.empty() && error == 0 && !write_all(log_fd_, buf.data(), buf.size())) {
+                error = errno;
+            }
+            bytes += buf.size();
+        }
+        if (bytes > 0 && error == 0 && fdatasync(log_fd_) != 0) {
+            error = errno;
+        }
+        for (std::string& buf : bufs) {
+            if (shipper_ && error == 0 && !buf.empty()) {
+                shipper_->ship(buf);  // only what is durable here goes to the follower
+            }
+            buf.clear();
+        }
+        const int fresh =
+            rotate && error == 0 ? create_log(options_.dir, dir_fd_, generation_ + 1) : -1;
+        if (rotate && fresh < 0 && error == 0) {
+            error = errno;
+        }
+
+        lock.lock();
+        if (rotate) {
+            if (fresh >= 0) {
+                ::close(log_fd_);
+                log_fd_ = fresh;
+                ++generation_;
+                log_bytes_ = 0;
+            }
+            rotate_ = false;
+        } else {
+            log_bytes_ += bytes;
+        }
+        if (error != 0 && error_ == 0) {
+            error_ = error;
+            std::fprintf(stderr, "alarm store: write-ahead log: %s\n", std::strerror(error));
+        }
+        if (error_ == 0) {
+            durable_ = target;
+        }
+        syncs_ += bytes > 0 ? 1 : 0;
+        if (options_.checkpoint_bytes > 0 && log_bytes_ >= options_.checkpoint_bytes &&
+            !checkpoint_wanted_) {
+            checkpoint_wanted_ = true;
+            checkpoint_cond_.notify_one();
+        }
+        done_cond_.notify_all();
+    }
+}
+
+void AlarmStore::checkpoint_main() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        while (!checkpoint_wanted_ && !checkpoints_closed_) {
+            checkpoint_cond_.wait(lock);
+        }
+        if (checkpoints_closed_) {
+            return;
+        }
+        lock.unlock();
+        try {
+            checkpoint();
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "alarm store: checkpoint failed: %s\n", e.what());
+        }
+        lock.lock();
+        checkpoint_wanted_ = false;
+    }
+}
+
+void AlarmStore::write_snapshot(std::uint64_t generation) {
+    const std::string tmp = options_.dir + "/snapshot.tmp";
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), tmp);
+    }
+    const auto fail = [&](int error) {
+        ::close(fd);
+        unlink(tmp.c_str());
+        throw std::system_error(error, std::generic_category(), tmp);
+    };
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof header.magic);
+    header.version = kSnapshotVersion;
+    header.generation = generation;
+    std::string buf(reinterpret_cast<const char*>(&header), sizeof header);
+    buf.reserve(kWriteChunk + kMaxRecord);
+    const std::int64_t offset = wall_offset();
+    int error = 0;
+    snapshot_([&](const AlarmView& a) {
+        const std::size_t used = buf.size();
+        buf.resize(used + kMaxRecord);
+        buf.resize(used + encode_record(buf.data() + used, LogKind::Start, a.id, a.repeats,
+                                        a.seq, a.deadline + offset, a.delay.count(),
+                                        a.message.view(), a.group.view()));
+        ++header.count;
+        if (buf.size() >= kWriteChunk) {
+            if (error == 0 && !write_all(fd, buf.data(), buf.size())) {
+                error = errno;
+            }
+            buf.clear();
+        }
+    });
+    if (error == 0 && !write_all(fd, buf.data(), buf.size())) {
+        error = errno;
+    }
+    if (error == 0 &&
+        pwrite(fd, &header, sizeof header, 0) != static_cast<ssize_t>(sizeof header)) {
+        error = errno;
+    }
+    if (error != 0 || fsync(fd) != 0) {
+        fail(error != 0 ? error : errno);
+    }
+    ::close(fd);
+    if (rename(tmp.c_str(), (options_.dir + "/snapshot").c_str()) != 0) {
+        throw std::system_error(errno, std::generic_category(), tmp);
+    }
+    sync_dir();
+}
+
+void AlarmStore::remove_logs_before(std::uint64_t generation) {
+    bool removed = false;
+    for (const std::uint64_t old : list_logs(options_.dir)) {
+        if (old < generation) {
+            removed |= unlink((options_.dir + "/" + log_name(old)).c_str()) == 0;
+        }
+    }
+    if (removed) {
+        sync_dir();
+    }
+}
+
+void AlarmStore::sync_dir() {
+    if (fsync(dir_fd_) != 0) {
+        throw std::system_error(errno, std::generic_category(), options_.dir);
+    }
+}
+
+}  // namespace alarmd
@@ -0,0 +1,247 @@
+#include "alarmd/batch_input.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <system_error>
+#include <utility>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alarmd/latency_stats.hpp"
+#include "alarmd/trace.hpp"
+
+namespace alarmd {
+
+namespace {
+
+// Splits `data` into lines, returning the number of bytes consumed (up to
+// and including the last newline).
+std::size_t split_lines(const char* data, std::size_t size,
+                        const std::function<void(std::string_view)>& fn) {
+    std::size_t start = 0;
+    while (start < size) {
+        const void* nl = std::memchr(data + start, '\n', size - start);
+        if (nl == nullptr) {
+            break;
+        }
+        const auto end = static_cast<std::size_t>(static_cast<const char*>(nl) - data);
+        fn(std::string_view(data + start, end - start));
+        start = end + 1;
+    }
+    return start;
+}
+
+bool for_each_mapped_line(int fd, const std::function<void(std::string_view)>& fn) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        return false;
+    }
+    // Start from the current offset so a partly consumed stdin still works.
+    const off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (offset < 0 || offset >= st.st_size) {
+        return false;
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    const char* data = static_cast<const char*>(map) + offset;
+    const std::size_t length = size - static_cast<std::size_t>(offset);
+    const std::size_t used = split_lines(data, length, fn);
+    if (used < length) {
+        fn(std::string_view(data + used, length - used));
+    }
+    munmap(map, size);
+    lseek(fd, 0, SEEK_END);
+    return true;
+}
+
+}  // namespace
+
+void for_each_line(int fd, const std::function<void(std::string_view)>& fn, std::size_t block) {
+    if (for_each_mapped_line(fd, fn)) {
+        return;
+    }
+    std::size_t capacity = block;
+    auto buf = std::make_unique_for_overwrite<char[]>(capacity);
+    std::size_t filled = 0;
+    for (;;) {
+        if (filled == capacity) {
+            // One line longer than the buffer: grow rather than split it.
+            auto bigger = std::make_unique_for_overwrite<char[]>(capacity * 2);
+            std::memcpy(bigger.get(), buf.get(), filled);
+            buf = std::move(bigger);
+            capacity *= 2;
+        }
+        const ssize_t n = read(fd, buf.get() + filled, capacity - filled);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno, std::generic_category(), "read");
+        }
+        if (n == 0) {
+            break;
+        }
+        filled += static_cast<std::size_t>(n);
+        const std::size_t used = split_lines(buf.get(), filled, fn);
+        std::memmove(buf.get(), buf.get() + used, filled - used);
+        filled -= used;
+    }
+    if (filled > 0) {
+        fn(std::string_view(buf.get(), filled));
+    }
+}
+
+std::size_t run_bulk_command(Scheduler& scheduler, const Command& cmd, std::uint32_t owner,
+                             char* buf) {
+    BulkResult result{.ids = cmd.ids, .requested = cmd.id_count};
+    const std::vector<IdRange> ranges = id_ranges(cmd.ids);
+    if (cmd.type == CommandType::CancelGroup || cmd.type == CommandType::ChangeGroup) {
+        result.ids = cmd.group;
+        result.group = true;
+        if (cmd.type == CommandType::CancelGroup) {
+            result.kind = RequestKind::Cancel;
+            result.applied = scheduler.cancel_group(cmd.group);
+        } else {
+            result.kind = RequestKind::Change;
+            result.delay = cmd.delay;
+            result.applied = scheduler.shift_group(cmd.group, cmd.delay);
+        }
+    } else if (cmd.type == CommandType::StartAlarms) {
+        std::vector<AlarmRequest> entries;
+        entries.reserve(cmd.id_count);
+        for (const IdRange& range : ranges) {
+            for (std::int64_t id = range.lo; id <= range.hi; ++id) {
+                entries.push_back({RequestKind::Start, static_cast<int>(id), cmd.delay,
+                                   Message(cmd.message), owner, cmd.repeats,
+                                   Message(cmd.group)});
+            }
+        }
+        result.applied = scheduler.start_alarms(entries);
+        result.delay = cmd.delay;
+        result.repeats = cmd.repeats;
+        result.message = cmd.message;
+    } else {
+        result.kind = RequestKind::Cancel;
+        result.applied = scheduler.cancel_alarms(ranges);
+    }
+    return format_bulk_result(result, static_cast<long>(std::time(nullptr)), buf);
+}
+
+std::size_t run_config_command(Scheduler& scheduler, const Command& cmd, bool allow_dump,
+                               char* buf) {
+    const long now = static_cast<long>(std::time(nullptr));
+    const std::string_view dump = cmd.config.dump;
+    int n;
+    if (!dump.empty() && !allow_dump) {
+        n = std::snprintf(buf, kMaxLine - 1, "Config at %ld: use GET /trace for the trace", now);
+    } else {
+        // Commands posted before this one apply under the old settings, and
+        // a dump sees them.
+        scheduler.drain();
+        scheduler.configure(cmd.config);
+        char note[kMaxLine] = "";
+        const int dump_len = static_cast<int>(dump.size());
+        if (!dump.empty()) {
+            if (write_chrome_trace(dump)) {
+                std::snprintf(note, sizeof note, " (trace written to %.*s)", dump_len,
+                              dump.data());
+            } else {
+                std::snprintf(note, sizeof note, " (trace not written to %.*s: %s)", dump_len,
+                              dump.data(), std::strerror(errno));
+            }
+        }
+        n = std::snprintf(buf, kMaxLine - 1, "Config at %ld: %s%s", now,
+                          scheduler.config_summary().c_str(), note);
+    }
+    // Keep the line terminated even when a long path ran past kMaxLine.
+    std::size_t len = n < 0 ? 0 : std::min(static_cast<std::size_t>(n), kMaxLine - 2);
+    buf[len++] = '\n';
+    buf[len] = '\0';
+    return len;
+}
+
+BatchSubmitter::BatchSubmitter(Scheduler& scheduler, std::size_t batch_size, std::FILE* view_out)
+    : scheduler_(scheduler), batch_size_(batch_size > 0 ? batch_size : 1), view_out_(view_out) {
+    batch_.reserve(batch_size_);
+}
+
+bool BatchSubmitter::submit(std::string_view line) {
+    std::size_t i = 0;
+    while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) {
+        ++i;
+    }
+    if (i == line.size()) {
+        return true;
+    }
+    ++stats_.lines;
+    Command cmd;
+    const std::int64_t parse_start = monotonic_ns();
+    const bool parsed = parse_command(line, cmd);
+    record_latency(Metric::Parse, monotonic_ns() - parse_start);
+    if (!parsed) {
+        ++stats_.invalid;
+        return false;
+    }
+    ++stats_.commands;
+    switch (cmd.type) {
+        case CommandType::StartAlarm:
+            batch_.push_back({RequestKind::Start, cmd.id, cmd.delay, Message(cmd.message), 0,
+                              cmd.repeats, Message(cmd.group)});
+            break;
+        case CommandType::ChangeAlarm:
+            batch_.push_back({RequestKind::Change, cmd.id, cmd.delay, Message(cmd.message), 0,
+                              cmd.repeats, Message(cmd.group)});
+            break;
+        case CommandType::CancelAlarm:
+            batch_.push_back({RequestKind::Cancel, cmd.id, {}, {}});
+            break;
+        case CommandType::StartAlarms:
+        case CommandType::CancelAlarms:
+        case CommandType::CancelGroup:
+        case CommandType::ChangeGroup: {
+            flush();
+            char line[kMaxLine];
+            scheduler_.write_line(
+                std::string_view(line, run_bulk_command(scheduler_, cmd, 0, line)));
+            return true;
+        }
+        case CommandType::ViewAlarms:
+            flush();
+            scheduler_.view_alarms(view_out_, cmd.view);
+            return true;
+        case CommandType::Stats:
+            flush();
+            scheduler_.write_line(scheduler_.render_stats(static_cast<long>(std::time(nullptr))));
+            return true;
+        case CommandType::Config: {
+            flush();
+            char text[kMaxLine];
+            scheduler_.write_line(
+                std::string_view(text, run_config_command(scheduler_, cmd, true, text)));
+            return true;
+        }
+        case CommandType::Invalid:
+            break;
+    }
+    if (batch_.size() >= batch_size_) {
+        flush();
+    }
+    return true;
+}
+
+void BatchSubmitter::flush() {
+    if (!batch_.empty()) {
+        scheduler_.post_batch(batch_);
+    }
+}
+
+}  // namespace alarmd
@@ -0,0 +1,72 @@
+#include "alarmd/clock.hpp"
+
+#include <cstdio>
+
+namespace alarmd {
+
+namespace {
+
+bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+}  // namespace
+
+bool parse_duration(std::string_view& text, std::chrono::microseconds& out) {
+    const std::size_t n = text.size();
+    std::size_t i = 0;
+    if (i == n || !is_digit(text[i])) {
+        return false;
+    }
+    constexpr std::int64_t kLimit = kMaxDelay.count();
+    std::int64_t whole = 0;
+    for (; i < n && is_digit(text[i]); ++i) {
+        whole = whole * 10 + (text[i] - '0');
+        if (whole > kLimit) {
+            return false;
+        }
+    }
+    // Fraction scaled to millionths of the unit; digits past six are dropped.
+    std::int64_t frac = 0;
+    if (i < n && text[i] == '.') {
+        ++i;
+        if (i == n || !is_digit(text[i])) {
+            return false;
+        }
+        for (std::int64_t scale = 100'000; i < n && is_digit(text[i]); ++i, scale /= 10) {
+            frac += (text[i] - '0') * scale;
+        }
+    }
+    std::int64_t unit = 1'000'000;
+    if (i + 1 < n && text[i] == 'u' && text[i + 1] == 's') {
+        unit = 1;
+        i += 2;
+    } else if (i + 1 < n && text[i] == 'm' && text[i + 1] == 's') {
+        unit = 1'000;
+        i += 2;
+    } else if (i < n && text[i] == 's') {
+        i += 1;
+    }
+    if (whole > kLimit / unit) {
+        return false;
+    }
+    const std::int64_t us = whole * unit + frac * unit / 1'000'000;
+    if (us > kLimit) {
+        return false;
+    }
+    out = std::chrono::microseconds(us);
+    text.remove_prefix(i);
+    return true;
+}
+
+const char* format_duration(std::chrono::microseconds delay, char* buf, std::size_t size) {
+    const auto us = static_cast<long long>(delay.count());
+    if (us % 1'000'000 == 0) {
+        std::snprintf(buf, size, "%lld", us / 1'000'000);
+    } else if (us % 1'000 == 0) {
+        std::snprintf(buf, size, "%lldms", us / 1'000);
+    } else {
+        std::snprintf(buf, size, "%lldus", us);
+    }
+    return buf;
+}
+
+}  // namespace alarmd
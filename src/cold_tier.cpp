@@ -0,0 +1,296 @@
+#include "alarmd/cold_tier.hpp"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "alarmd/message.hpp"
+#include "alarmd/row_scan.hpp"
+
+namespace alarmd {
+
+namespace {
+
+constexpr std::size_t kMinSlots = 16;
+// Rows a scan filters before visiting the matches: 4 KiB of row numbers
+// on the stack, and the columns stay in cache until they are read back.
+constexpr std::size_t kScanChunk = 1024;
+
+// Columns and arenas grow by an eighth rather than doubling: buckets hold
+// up to millions of rows, and doubling's slack would be most of what a row
+// saves. Growth stays amortised O(1).
+template <typename Column>
+void make_room(Column& column, std::size_t extra) {
+    if (column.size() + extra > column.capacity()) {
+        column.reserve(column.size() + extra + column.size() / 8 + 16);
+    }
+}
+
+template <typename T>
+void append(std::vector<T>& column, T value) {
+    make_room(column, 1);
+    column.push_back(value);
+}
+
+}  // namespace
+
+ColdTier::ColdTier() : slots_(kMinSlots) {}
+
+void ColdTier::insert(int id, Deadline deadline, std::chrono::microseconds delay,
+                      std::string_view message, std::uint32_t owner) {
+    const std::uint32_t key = bucket_of(deadline);
+    Bucket& b = buckets_[key];
+    const auto row = static_cast<std::uint32_t>(b.id.size());
+    append(b.offset, static_cast<std::uint32_t>(deadline - bucket_start(key)));
+    append(b.id, id);
+    const std::uint32_t code = encode_delay(delay);
+    append(b.delay, code);
+    if (code == kOddDelay) {
+        b.odd_delay.emplace(row, delay.count());
+    }
+    if (row % kTextStride == 0) {
+        append(b.text, static_cast<std::uint32_t>(b.arena.size()));
+    }
+    if (owner != 0 || !b.owner.empty()) {
+        b.owner.resize(row);  // zeros for the rows before the first owner
+        append(b.owner, owner);
+    }
+    message = message.substr(0, kMaxMessage);
+    make_room(b.arena, message.size() + 1);
+    b.arena.push_back(static_cast<char>(message.size()));
+    b.arena.append(message);
+    ++b.live;
+    index_insert({id, key, row});
+}
+
+std::uint32_t ColdTier::encode_delay(std::chrono::microseconds delay) {
+    const std::int64_t us = delay.count();
+    if (us >= 0 && us % 1000 == 0 && us / 1000 < kSeconds) {
+        return static_cast<std::uint32_t>(us / 1000);
+    }
+    if (us >= 0 && us % 1'000'000 == 0 && us / 1'000'000 < kOddDelay - kSeconds) {
+        return kSeconds | static_cast<std::uint32_t>(us / 1'000'000);
+    }
+    return kOddDelay;
+}
+
+std::size_t ColdTier::text_of(const Bucket& b, std::uint32_t row) {
+    std::size_t at = b.text[row / kTextStride];
+    for (std::uint32_t r = row - row % kTextStride; r < row; ++r) {
+        at += 1 + static_cast<unsigned char>(b.arena[at]);
+    }
+    return at;
+}
+
+ColdAlarm ColdTier::row_of(std::uint32_t key, const Bucket& b, std::uint32_t row) const {
+    const char* text = b.arena.data() + text_of(b, row);
+    const std::uint32_t code = b.delay[row];
+    std::int64_t delay;
+    if (code == kOddDelay) {
+        delay = b.odd_delay.at(row);
+    } else if (code & kSeconds) {
+        delay = static_cast<std::int64_t>(code & ~kSeconds) * 1'000'000;
+    } else {
+        delay = static_cast<std::int64_t>(code) * 1000;
+    }
+    return {b.id[row], bucket_start(key) + b.offset[row], std::chrono::microseconds(delay),
+            std::string_view(text + 1, static_cast<unsigned char>(text[0])),
+            b.owner.empty() ? 0 : b.owner[row]};
+}
+
+bool ColdTier::find(int id, ColdAlarm& out) const {
+    const Slot* slot = find_slot(id);
+    if (slot == nullptr) {
+        return false;
+    }
+    out = row_of(slot->bucket, buckets_.find(slot->bucket)->second, slot->row);
+    return true;
+}
+
+bool ColdTier::erase(int id, ColdAlarm* out) {
+    const Slot* slot = find_slot(id);
+    if (slot == nullptr) {
+        return false;
+    }
+    const auto it = buckets_.find(slot->bucket);
+    Bucket& b = it->second;
+    if (out != nullptr) {
+        *out = row_of(slot->bucket, b, slot->row);
+    }
+    b.delay[slot->row] = kDead;  // an odd delay stays mapped until the bucket goes
+    index_erase(id);
+    --size_;
+    if (--b.live == 0) {
+        buckets_.erase(it);  // only dead rows left
+    }
+    return true;
+}
+
+bool ColdTier::first_bucket(Deadline& start) const {
+    if (buckets_.empty()) {
+        return false;
+    }
+    start = bucket_start(buckets_.begin()->first);
+    return true;
+}
+
+std::size_t ColdTier::promote(std::size_t max,
+                              const std::function<void(const ColdAlarm&)>& fn) {
+    if (buckets_.empty()) {
+        return 0;
+    }
+    const auto it = buckets_.begin();
+    Bucket& b = it->second;
+    const auto rows = static_cast<std::uint32_t>(b.id.size());
+    std::size_t visited = 0;
+    for (; b.next < rows && visited < max; ++b.next, ++visited) {
+        if (b.delay[b.next] == kDead) {
+            continue;
+        }
+        fn(row_of(it->first, b, b.next));
+        index_erase(b.id[b.next]);
+        --b.live;
+        --size_;
+    }
+    if (b.next == rows || b.live == 0) {
+        buckets_.erase(it);
+    }
+    return visited;
+}
+
+void ColdTier::for_each(const std::function<void(const ColdAlarm&)>& fn) const {
+    for (const auto& [key, b] : buckets_) {
+        for (std::uint32_t row = b.next; row < b.id.size(); ++row) {
+            if (b.delay[row] != kDead) {
+                fn(row_of(key, b, row));
+            }
+        }
+    }
+}
+
+void ColdTier::scan(const ColdQuery& query,
+                    const std::function<void(const ColdAlarm&)>& fn) const {
+    if (query.id_lo > query.id_hi || query.from > query.to) {
+        return;
+    }
+    constexpr Deadline kSpan = Deadline{1} << kBucketBits;
+    const auto first = buckets_.lower_bound(bucket_of(std::max<Deadline>(query.from, 0)));
+    std::array<std::uint32_t, kScanChunk> rows;
+    for (auto it = first; it != buckets_.end(); ++it) {
+        const auto& [key, b] = *it;
+        const Deadline start = bucket_start(key);
+        if (start > query.to) {
+            break;
+        }
+        // Both differences are taken only where they cannot overflow.
+        const Deadline lo = query.from > start ? query.from - start : 0;
+        const Deadline hi = std::min(query.to - start, kSpan - 1);
+        const RowFilter filter{
+            .offset_lo = static_cast<std::uint32_t>(lo),
+            .offset_hi = static_cast<std::uint32_t>(hi),
+            .id_lo = query.id_lo,
+            .id_hi = query.id_hi,
+            .dead = kDead};
+        for (std::size_t at = b.next; at < b.id.size(); at += kScanChunk) {
+            const std::size_t count = std::min(kScanChunk, b.id.size() - at);
+            const std::size_t kept = scan_rows(b.offset.data() + at, b.id.data() + at,
+                                               b.delay.data() + at, count, filter, rows.data());
+            for (std::size_t k = 0; k < kept; ++k) {
+                fn(row_of(key, b, static_cast<std::uint32_t>(at + rows[k])));
+            }
+        }
+    }
+}
+
+ColdStats ColdTier::stats() const {
+    ColdStats stats{size_, buckets_.size(), slots_.capacity() * sizeof(Slot)};
+    for (const auto& [key, b] : buckets_) {
+        stats.bytes += sizeof(key) + sizeof(b) + 4 * sizeof(void*);  // the map node
+        stats.bytes += b.offset.capacity() * sizeof(std::uint32_t) +
+                       b.id.capacity() * sizeof(int) + b.delay.capacity() * sizeof(std::uint32_t) +
+                       b.text.capacity() * sizeof(std::uint32_t) +
+                       b.owner.capacity() * sizeof(std::uint32_t) + b.arena.capacity() +
+                       b.odd_delay.size() * (sizeof(std::uint32_t) + sizeof(std::int64_t) +
+                                             4 * sizeof(void*));
+    }
+    return stats;
+}
+
+void ColdTier::clear() {
+    buckets_.clear();
+    slots_.assign(kMinSlots, Slot{});
+    size_ = 0;
+}
+
+// Fibonacci hashing as in AlarmIndex, reduced to the table size with a
+// multiply rather than a mask, so the table need not be a power of two.
+std::size_t ColdTier::home(int id) const {
+    const std::uint64_t h =
+        (static_cast<std::uint64_t>(static_cast<std::uint32_t>(id)) * 0x9E3779B97F4A7C15ull) >> 32;
+    return static_cast<std::size_t>((h * slots_.size()) >> 32);
+}
+
+std::size_t ColdTier::next(std::size_t i) const { return i + 1 == slots_.size() ? 0 : i + 1; }
+
+const ColdTier::Slot* ColdTier::find_slot(int id) const {
+    for (std::size_t i = home(id);; i = next(i)) {
+        const Slot& slot = slots_[i];
+        if (slot.row == kDead) {
+            return nullptr;
+        }
+        if (slot.id == id) {
+            return &slot;
+        }
+    }
+}
+
+void ColdTier::index_insert(const Slot& slot) {
+    // At most 7/8 full, growing by half: the index is a third of a row, so
+    // it runs fuller than AlarmIndex.
+    if ((size_ + 1) * 8 > slots_.size() * 7) {
+        rehash(slots_.size() + slots_.size() / 2);
+    }
+    std::size_t i = home(slot.id);
+    while (slots_[i].row != kDead) {
+        i = next(i);
+    }
+    slots_[i] = slot;
+    ++size_;
+}
+
+void ColdTier::index_erase(int id) {
+    std::size_t i = home(id);
+    while (slots_[i].id != id || slots_[i].row == kDead) {
+        i = next(i);
+    }
+    // Backward-shift deletion, as in AlarmIndex::erase.
+    for (std::size_t j = next(i);; j = next(j)) {
+        Slot& slot = slots_[j];
+        if (slot.row == kDead) {
+            break;
+        }
+        const std::size_t h = home(slot.id);
+        const bool between = i <= j ? (i < h && h <= j) : (i < h || h <= j);
+        if (!between) {
+            slots_[i] = slot;
+            i = j;
+        }
+    }
+    slots_[i] = Slot{};
+}
+
+void ColdTier::rehash(std::size_t slots) {
+    std::vector<Slot> old(slots);
+    old.swap(slots_);
+    for (const Slot& slot : old) {
+        if (slot.row != kDead) {
+            std::size_t i = home(slot.id);
+            while (slots_[i].row != kDead) {
+                i = next(i);
+            }
+            slots_[i] = slot;
+        }
+    }
+}
+
+}  // namespace alarmd
@@ -0,0 +1,37 @@
+#include "alarmd/cond_var.hpp"
+
+#include <cerrno>
+#include <system_error>
+
+namespace alarmd {
+
+CondVar::CondVar() {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    int err = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (err == 0) {
+        err = pthread_cond_init(&cond_, &attr);
+    }
+    pthread_condattr_destroy(&attr);
+    if (err != 0) {
+        throw std::system_error(err, std::generic_category(), "pthread_cond_init");
+    }
+}
+
+CondVar::~CondVar() { pthread_cond_destroy(&cond_); }
+
+void CondVar::wait(std::unique_lock<std::mutex>& lock) {
+    pthread_cond_wait(&cond_, lock.mutex()->native_handle());
+}
+
+bool CondVar::wait_until(std::unique_lock<std::mutex>& lock, Deadline deadline) {
+    if (deadline < 0) {
+        deadline = 0;
+    }
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(deadline / 1'000'000);
+    ts.tv_nsec = static_cast<long>(deadline % 1'000'000) * 1'000;
+    return pthread_cond_timedwait(&cond_, lock.mutex()->native_handle(), &ts) != ETIMEDOUT;
+}
+
+}  // namespace alarmd
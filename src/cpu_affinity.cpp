@@ -0,0 +1,108 @@
+#include "alarmd/cpu_affinity.hpp"
+
+#include <charconv>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace alarmd {
+
+namespace {
+
+bool parse_cpu(std::string_view text, int& cpu) {
+    const char* end = text.data() + text.size();
+    auto [ptr, ec] = std::from_chars(text.data(), end, cpu);
+    return ec == std::errc() && ptr == end && cpu >= 0 && cpu < CPU_SETSIZE;
+}
+
+}  // namespace
+
+bool parse_cpu_list(std::string_view text, std::vector<int>& cpus) {
+    std::vector<int> parsed;
+    while (!text.empty()) {
+        const std::size_t comma = text.find(',');
+        const std::string_view item = text.substr(0, comma);
+        const std::size_t dash = item.find('-');
+        int lo = 0;
+        int hi = 0;
+        if (!parse_cpu(item.substr(0, dash), lo) ||
+            !parse_cpu(dash == std::string_view::npos ? item : item.substr(dash + 1), hi) ||
+            hi < lo) {
+            return false;
+        }
+        for (int cpu = lo; cpu <= hi; ++cpu) {
+            parsed.push_back(cpu);
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        text.remove_prefix(comma + 1);
+        if (text.empty()) {
+            return false;  // trailing comma
+        }
+    }
+    if (parsed.empty()) {
+        return false;
+    }
+    cpus = std::move(parsed);
+    return true;
+}
+
+void check_cpus(const std::vector<int>& cpus) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof allowed, &allowed) != 0) {
+        return;  // nothing to check against; pinning will report it
+    }
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)) {
+            throw std::invalid_argument("cpu " + std::to_string(cpu) + " is not available");
+        }
+    }
+}
+
+bool pin_current_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+}
+
+int numa_node_of_cpu(int cpu) {
+    const std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        return -1;
+    }
+    int node = -1;
+    while (const dirent* entry = readdir(dir)) {
+        const std::string_view name = entry->d_name;
+        if (name.starts_with("node") && parse_cpu(name.substr(4), node)) {
+            break;
+        }
+        node = -1;
+    }
+    closedir(dir);
+    return node;
+}
+
+bool prefer_numa_node(void* addr, std::size_t size, int node) {
+    // One word of mask; the kernel reads one bit fewer than maxnode says.
+    constexpr int kMaxNodes = sizeof(unsigned long) * 8;
+    if (node < 0 || node >= kMaxNodes - 1) {
+        return false;
+    }
+    const unsigned long mask = 1UL << node;
+    // The raw system call, so the build does not depend on libnuma.
+    return syscall(SYS_mbind, addr, size, MPOL_PREFERRED, &mask, kMaxNodes, 0) == 0;
+}
+
+}  // namespace alarmd
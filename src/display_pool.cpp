@@ -0,0 +1,234 @@
+#include "alarmd/display_pool.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "alarmd/cpu_affinity.hpp"
+
+namespace alarmd {
+
+bool parse_overflow_policy(const char* name, OverflowPolicy& policy) {
+    for (OverflowPolicy p :
+         {OverflowPolicy::Block, OverflowPolicy::Shed, OverflowPolicy::Coalesce}) {
+        if (std::strcmp(name, overflow_policy_name(p)) == 0) {
+            policy = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* overflow_policy_name(OverflowPolicy policy) {
+    switch (policy) {
+        case OverflowPolicy::Block: return "block";
+        case OverflowPolicy::Shed: return "shed";
+        case OverflowPolicy::Coalesce: return "coalesce";
+    }
+    return "unknown";
+}
+
+DisplayPool::DisplayPool(int workers, Sink sink, DisplayOptions options)
+    : sink_(std::move(sink)), options_(options) {
+    if (workers < 1) {
+        throw std::invalid_argument("display pool needs at least one worker");
+    }
+    for (int i = 0; i < workers; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+        workers_.back()->number = i + 1;
+    }
+    for (auto& worker : workers_) {
+        worker->thread = std::thread(&DisplayPool::worker_main, this, std::ref(*worker));
+    }
+}
+
+DisplayPool::~DisplayPool() {
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex_);
+        stopping_ = true;
+    }
+    idle_cond_.notify_all();
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+void DisplayPool::submit(std::vector<FiredAlarm>& batch) {
+    const std::size_t n = workers_.size();
+    std::size_t total = 0;
+    for (std::size_t w = 0; w < n; ++w) {
+        Worker& worker = *workers_[w];
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        std::size_t added = 0;
+        for (FiredAlarm& alarm : batch) {
+            if (static_cast<std::size_t>(alarm.id) % n != w) {
+                continue;
+            }
+            if (options_.capacity != 0 && worker.queue.size() >= options_.capacity &&
+                !overflow(worker, lock, alarm, added)) {
+                continue;
+            }
+            push(worker, std::move(alarm));
+            ++added;
+        }
+        // Counted before the lock is released, so a worker that takes these
+        // alarms never drives queued_ below 0.
+        queued_.fetch_add(added, std::memory_order_seq_cst);
+        total += added;
+    }
+    wake_workers(total);
+}
+
+bool DisplayPool::overflow(Worker& self, std::unique_lock<std::mutex>& lock, FiredAlarm& alarm,
+                           std::size_t& added) {
+    switch (options_.overflow) {
+        case OverflowPolicy::Block:
+            // Publish what is queued so far and make sure someone prints it.
+            queued_.fetch_add(added, std::memory_order_seq_cst);
+            added = 0;
+            wake_workers(options_.capacity);
+            blocked_.fetch_add(1, std::memory_order_relaxed);
+            ++self.blocked;
+            self.space.wait(lock, [&] { return self.queue.size() < options_.capacity; });
+            --self.blocked;
+            return true;
+        case OverflowPolicy::Coalesce: {
+            auto it = self.queued_at.find(alarm.id);
+            if (it != self.queued_at.end() && it->second >= self.popped &&
+                it->second - self.popped < self.queue.size()) {
+                FiredAlarm& queued = self.queue[it->second - self.popped];
+                if (queued.id == alarm.id && queued.message.view() == alarm.message.view()) {
+                    queued.coalesced += 1 + alarm.coalesced;
+                    coalesced_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+            break;
+        }
+        case OverflowPolicy::Shed:
+            break;
+    }
+    shed_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void DisplayPool::push(Worker& self, FiredAlarm&& alarm) {
+    if (options_.overflow == OverflowPolicy::Coalesce && options_.capacity != 0) {
+        if (self.queued_at.size() > 2 * options_.capacity) {
+            // Mostly stale by now: rebuild from what is actually queued.
+            self.queued_at.clear();
+            for (std::size_t i = 0; i < self.queue.size(); ++i) {
+                self.queued_at[self.queue[i].id] = self.popped + i;
+            }
+        }
+        self.queued_at[alarm.id] = self.popped + self.queue.size();
+    }
+    self.queue.push_back(std::move(alarm));
+}
+
+void DisplayPool::wake_workers(std::size_t count) {
+    // Pairs with the sleepers_ increment in worker_main: either a worker
+    // about to sleep sees the new count, or this thread sees the sleeper.
+    if (count == 0 || sleepers_.load(std::memory_order_seq_cst) == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex_);
+    }
+    if (count > 1) {
+        idle_cond_.notify_all();
+    } else {
+        idle_cond_.notify_one();
+    }
+}
+
+DisplayStats DisplayPool::stats() const {
+    return {queued(), options_.capacity * workers_.size(),
+            shed_.load(std::memory_order_relaxed), coalesced_.load(std::memory_order_relaxed),
+            blocked_.load(std::memory_order_relaxed)};
+}
+
+bool DisplayPool::take_own(Worker& self, std::vector<FiredAlarm>& chunk) {
+    std::lock_guard<std::mutex> lock(self.mutex);
+    while (!self.queue.empty() && chunk.size() < kChunk) {
+        chunk.push_back(std::move(self.queue.front()));
+        self.queue.pop_front();
+    }
+    self.popped += chunk.size();
+    if (self.queue.empty()) {
+        self.queued_at.clear();
+    }
+    queued_.fetch_sub(chunk.size(), std::memory_order_relaxed);
+    if (self.blocked != 0 && !chunk.empty()) {
+        self.space.notify_all();
+    }
+    return !chunk.empty();
+}
+
+bool DisplayPool::steal(Worker& self, std::vector<FiredAlarm>& chunk) {
+    // Pick the fullest victim; it may have drained by the time we relock it.
+    Worker* victim = nullptr;
+    std::size_t most = 0;
+    for (auto& worker : workers_) {
+        if (worker.get() == &self) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        if (worker->queue.size() > most) {
+            most = worker->queue.size();
+            victim = worker.get();
+        }
+    }
+    if (victim == nullptr) {
+        return false;
+    }
+    {
+        // Take the back half: the owner keeps the oldest alarms at the front.
+        std::lock_guard<std::mutex> lock(victim->mutex);
+        std::size_t take = (victim->queue.size() + 1) / 2;
+        if (take > kChunk) {
+            take = kChunk;
+        }
+        const auto first = victim->queue.end() - static_cast<std::ptrdiff_t>(take);
+        for (auto it = first; it != victim->queue.end(); ++it) {
+            chunk.push_back(std::move(*it));
+        }
+        victim->queue.erase(first, victim->queue.end());
+        queued_.fetch_sub(take, std::memory_order_relaxed);
+        if (victim->blocked != 0 && take != 0) {
+            victim->space.notify_all();
+        }
+    }
+    if (chunk.empty()) {
+        return false;
+    }
+    steals_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void DisplayPool::worker_main(Worker& self) {
+    if (!options_.cpus.empty()) {
+        const auto slot = static_cast<std::size_t>(self.number - 1) % options_.cpus.size();
+        pin_current_thread(options_.cpus[slot]);
+    }
+    std::vector<FiredAlarm> chunk;
+    chunk.reserve(kChunk);
+    for (;;) {
+        if (take_own(self, chunk) || steal(self, chunk)) {
+            sink_(self.number, chunk);
+            chunk.clear();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(idle_mutex_);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        idle_cond_.wait(lock, [&] {
+            return stopping_ || queued_.load(std::memory_order_seq_cst) > 0;
+        });
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        if (stopping_ && queued_.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+    }
+}
+
+}  // namespace alarmd
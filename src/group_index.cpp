@@ -0,0 +1,47 @@
+#include "alarmd/group_index.hpp"
+
+namespace alarmd {
+
+void GroupIndex::add(Alarm* alarm, std::string_view tag) {
+    auto it = groups_.find(tag);
+    if (it == groups_.end()) {
+        it = groups_.emplace(std::string(tag), AlarmGroup{}).first;
+        it->second.tag = it->first;
+    }
+    AlarmGroup& group = it->second;
+    alarm->group = &group;
+    alarm->group_prev = nullptr;
+    alarm->group_next = group.head;
+    if (group.head != nullptr) {
+        group.head->group_prev = alarm;
+    }
+    group.head = alarm;
+    ++group.size;
+}
+
+void GroupIndex::remove(Alarm* alarm) {
+    AlarmGroup* group = alarm->group;
+    if (group == nullptr) {
+        return;
+    }
+    if (alarm->group_prev != nullptr) {
+        alarm->group_prev->group_next = alarm->group_next;
+    } else {
+        group->head = alarm->group_next;
+    }
+    if (alarm->group_next != nullptr) {
+        alarm->group_next->group_prev = alarm->group_prev;
+    }
+    alarm->group = nullptr;
+    alarm->group_next = alarm->group_prev = nullptr;
+    if (--group->size == 0) {
+        groups_.erase(groups_.find(group->tag));
+    }
+}
+
+AlarmGroup* GroupIndex::find(std::string_view tag) {
+    const auto it = groups_.find(tag);
+    return it == groups_.end() ? nullptr : &it->second;
+}
+
+}  // namespace alarmd
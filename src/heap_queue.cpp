@@ -0,0 +1,143 @@
+#include "alarmd/heap_queue.hpp"
+
+namespace alarmd {
+
+void HeapQueue::place(std::size_t i, Alarm* alarm) {
+    heap_[i] = alarm;
+    alarm->queue_pos = static_cast<std::uint32_t>(i);
+}
+
+void HeapQueue::sift_up(std::size_t i) {
+    Alarm* alarm = heap_[i];
+    while (i > 0) {
+        std::size_t parent = (i - 1) / kArity;
+        if (!expires_before(*alarm, *heap_[parent])) {
+            break;
+        }
+        place(i, heap_[parent]);
+        i = parent;
+    }
+    place(i, alarm);
+}
+
+void HeapQueue::sift_down(std::size_t i) {
+    Alarm* alarm = heap_[i];
+    const std::size_t n = heap_.size();
+    for (;;) {
+        std::size_t first = i * kArity + 1;
+        if (first >= n) {
+            break;
+        }
+        std::size_t last = first + kArity < n ? first + kArity : n;
+        std::size_t best = first;
+        for (std::size_t c = first + 1; c < last; ++c) {
+            if (expires_before(*heap_[c], *heap_[best])) {
+                best = c;
+            }
+        }
+        if (!expires_before(*heap_[best], *alarm)) {
+            break;
+        }
+        place(i, heap_[best]);
+        i = best;
+    }
+    place(i, alarm);
+}
+
+void HeapQueue::push(Alarm* alarm) {
+    heap_.push_back(alarm);
+    sift_up(heap_.size() - 1);
+}
+
+void HeapQueue::push_bulk(std::vector<Alarm*>& alarms) {
+    const std::size_t first = heap_.size();
+    heap_.insert(heap_.end(), alarms.begin(), alarms.end());
+    if (alarms.size() * 8 < heap_.size()) {
+        for (std::size_t i = first; i < heap_.size(); ++i) {
+            sift_up(i);
+        }
+    } else {
+        heapify();
+    }
+}
+
+void HeapQueue::erase(Alarm* alarm) {
+    std::size_t i = alarm->queue_pos;
+    Alarm* last = heap_.back();
+    heap_.pop_back();
+    if (last != alarm) {
+        place(i, last);
+        sift_up(i);
+        sift_down(last->queue_pos);
+    }
+}
+
+Alarm* HeapQueue::peek_due(Deadline now) {
+    if (heap_.empty() || heap_.front()->deadline > now) {
+        return nullptr;
+    }
+    return heap_.front();
+}
+
+void HeapQueue::reschedule(Alarm* alarm, Deadline deadline, std::uint64_t seq) {
+    alarm->deadline = deadline;
+    alarm->seq = seq;
+    // At most one of the two moves the node.
+    sift_up(alarm->queue_pos);
+    sift_down(alarm->queue_pos);
+}
+
+bool HeapQueue::next_expiry(Deadline& when) const {
+    if (heap_.empty()) {
+        return false;
+    }
+    when = heap_.front()->deadline;
+    return true;
+}
+
+void HeapQueue::for_each(const std::function<void(const Alarm&)>& fn) const {
+    for (const Alarm* a : heap_) {
+        fn(*a);
+    }
+}
+
+// Filters the array in place and re-heapifies bottom-up, which is O(n)
+// instead of one O(log n) erase per tombstone.
+std::size_t HeapQueue::purge_cancelled(const ReleaseFn& release) {
+    const std::size_t before = heap_.size();
+    std::size_t kept = 0;
+    for (Alarm* a : heap_) {
+        if (a->cancelled) {
+            release(a);
+        } else {
+            heap_[kept++] = a;
+        }
+    }
+    heap_.resize(kept);
+    heapify();
+    return before - kept;
+}
+
+// Floyd's bottom-up construction: sifting every parent down, last first,
+// costs O(n) in total.
+void HeapQueue::heapify() {
+    const std::size_t n = heap_.size();
+    for (std::size_t i = 0; i < n; ++i) {
+        heap_[i]->queue_pos = static_cast<std::uint32_t>(i);
+    }
+    if (n > 1) {
+        for (std::size_t i = (n - 2) / kArity + 1; i-- > 0;) {
+            sift_down(i);
+        }
+    }
+}
+
+void HeapQueue::clear(const ReleaseFn& release) {
+    std::vector<Alarm*> heap;
+    heap.swap(heap_);
+    for (Alarm* a : heap) {
+        release(a);
+    }
+}
+
+}  // namespace alarmd
@@ -0,0 +1,186 @@
+#include "alarmd/latency_stats.hpp"
+
+#include <cstdio>
+#include <vector>
+
+namespace alarmd {
+
+namespace {
+
+constexpr const char* kNames[kMetricCount] = {
+    "parse", "lock_wait", "lock_hold", "fire_lateness", "display_latency",
+};
+
+using HistogramSet = std::array<LatencyHistogram, kMetricCount>;
+
+// Every live thread's histograms plus the totals of threads that exited.
+// Never destroyed: threads may still record while static objects go away.
+class LatencyRegistry {
+public:
+    static LatencyRegistry& instance() {
+        static LatencyRegistry* registry = new LatencyRegistry;
+        return *registry;
+    }
+
+    void add(const HistogramSet* set) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        live_.push_back(set);
+    }
+
+    void retire(const HistogramSet* set) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (std::size_t m = 0; m < kMetricCount; ++m) {
+            (*set)[m].add_to(retired_[m]);
+        }
+        std::erase(live_, set);
+    }
+
+    void collect(Metric metric, LatencyHistogram& out) {
+        const auto m = static_cast<std::size_t>(metric);
+        std::lock_guard<std::mutex> lock(mutex_);
+        retired_[m].add_to(out);
+        for (const HistogramSet* set : live_) {
+            (*set)[m].add_to(out);
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<const HistogramSet*> live_;
+    HistogramSet retired_;
+};
+
+struct ThreadLatencies {
+    ThreadLatencies() { LatencyRegistry::instance().add(&set); }
+    ~ThreadLatencies() { LatencyRegistry::instance().retire(&set); }
+
+    HistogramSet set;
+};
+
+HistogramSet& thread_latencies() {
+    thread_local ThreadLatencies latencies;
+    return latencies.set;
+}
+
+// Prints `ns` with a unit that leaves at most four significant digits.
+void format_duration(char* buf, std::size_t size, double ns) {
+    if (ns < 1e3) {
+        std::snprintf(buf, size, "%.0fns", ns);
+    } else if (ns < 1e6) {
+        std::snprintf(buf, size, "%.1fus", ns / 1e3);
+    } else if (ns < 1e9) {
+        std::snprintf(buf, size, "%.1fms", ns / 1e6);
+    } else {
+        std::snprintf(buf, size, "%.2fs", ns / 1e9);
+    }
+}
+
+constexpr double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+}  // namespace
+
+const char* metric_name(Metric metric) { return kNames[static_cast<std::size_t>(metric)]; }
+
+std::uint64_t LatencyHistogram::lowest_in(std::size_t bucket) {
+    if (bucket < kSub) {
+        return bucket;
+    }
+    const int exponent = static_cast<int>(bucket / kSub) + kSubBits - 1;
+    return (kSub + bucket % kSub) << (exponent - kSubBits);
+}
+
+void LatencyHistogram::add_to(LatencyHistogram& into) const {
+    for (std::size_t b = 0; b < kBuckets; ++b) {
+        const std::uint64_t n = counts_[b].load(std::memory_order_relaxed);
+        if (n != 0) {
+            bump(into.counts_[b], n);
+        }
+    }
+    bump(into.count_, count());
+    bump(into.sum_, sum());
+    if (max() > into.max()) {
+        into.max_.store(max(), std::memory_order_relaxed);
+    }
+}
+
+std::uint64_t LatencyHistogram::percentile(double q) const {
+    // Summed from the buckets rather than count_, which a reader may see
+    // out of step with them.
+    std::uint64_t total = 0;
+    for (const auto& n : counts_) {
+        total += n.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(q * total + 0.5));
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < kBuckets; ++b) {
+        seen += counts_[b].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            // The bucket's midpoint, but never past the largest value seen.
+            const std::uint64_t lo = lowest_in(b);
+            const std::uint64_t hi = b + 1 < kBuckets ? lowest_in(b + 1) - 1 : lo;
+            return std::min(lo + (hi - lo) / 2, std::max(max(), lo));
+        }
+    }
+    return max();
+}
+
+void record_latency(Metric metric, std::int64_t ns) {
+    thread_latencies()[static_cast<std::size_t>(metric)].record(ns);
+}
+
+void latency_snapshot(Metric metric, LatencyHistogram& out) {
+    LatencyRegistry::instance().collect(metric, out);
+}
+
+std::string render_stats(long now) {
+    std::string out;
+    char line[256];
+    std::snprintf(line, sizeof line, "Stats at %ld:\n", now);
+    out += line;
+    for (std::size_t m = 0; m < kMetricCount; ++m) {
+        LatencyHistogram h;
+        latency_snapshot(static_cast<Metric>(m), h);
+        char mean[16];
+        char p[4][16];
+        char max[16];
+        format_duration(mean, sizeof mean, h.mean());
+        for (std::size_t i = 0; i < 4; ++i) {
+            format_duration(p[i], sizeof p[i], static_cast<double>(h.percentile(kQuantiles[i])));
+        }
+        format_duration(max, sizeof max, static_cast<double>(h.max()));
+        std::snprintf(line, sizeof line,
+                      "  %-16s count=%llu mean=%s p50=%s p90=%s p99=%s p99.9=%s max=%s\n",
+                      kNames[m], static_cast<unsigned long long>(h.count()), mean, p[0], p[1],
+                      p[2], p[3], max);
+        out += line;
+    }
+    return out;
+}
+
+std::string render_prometheus() {
+    std::string out;
+    char line[256];
+    for (std::size_t m = 0; m < kMetricCount; ++m) {
+        LatencyHistogram h;
+        latency_snapshot(static_cast<Metric>(m), h);
+        std::snprintf(line, sizeof line, "# TYPE alarmd_%s_seconds summary\n", kNames[m]);
+        out += line;
+        for (const double q : kQuantiles) {
+            std::snprintf(line, sizeof line, "alarmd_%s_seconds{quantile=\"%g\"} %.9f\n",
+                          kNames[m], q, static_cast<double>(h.percentile(q)) / 1e9);
+            out += line;
+        }
+        std::snprintf(line, sizeof line, "alarmd_%s_seconds_sum %.9f\n", kNames[m],
+                      static_cast<double>(h.sum()) / 1e9);
+        out += line;
+        std::snprintf(line, sizeof line, "alarmd_%s_seconds_count %llu\n", kNames[m],
+                      static_cast<unsigned long long>(h.count()));
+        out += line;
+    }
+    return out;
+}
+
+}  // namespace alarmd
@@ -0,0 +1,142 @@
+#include "alarmd/log_format.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace alarmd {
+
+namespace {
+
+// Word-at-a-time multiplicative hash; catches torn and zero-filled records,
+// not adversarial ones.
+std::uint32_t checksum(const char* p, std::size_t n) {
+    std::uint64_t h = 0x9E3779B97F4A7C15ull ^ n;
+    for (; n >= 8; p += 8, n -= 8) {
+        std::uint64_t w;
+        std::memcpy(&w, p, sizeof w);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    for (; n > 0; ++p, --n) {
+        h = (h ^ static_cast<unsigned char>(*p)) * 0x100000001B3ull;
+    }
+    h ^= h >> 29;
+    return static_cast<std::uint32_t>(h);
+}
+
+}  // namespace
+
+std::size_t encode_record(char* out, LogKind kind, int id, std::uint32_t repeats,
+                          std::uint64_t seq, std::int64_t deadline, std::int64_t delay,
+                          std::string_view message, std::string_view group) {
+    RecordHeader h{};
+    h.kind = static_cast<std::uint8_t>(kind);
+    h.size = static_cast<std::uint8_t>(std::min(message.size(), kMaxMessage));
+    h.group_size = static_cast<std::uint8_t>(std::min(group.size(), kMaxGroupTag));
+    h.id = id;
+    h.repeats = repeats;
+    h.seq = seq;
+    h.deadline = deadline;
+    h.delay = delay;
+    std::memcpy(out, &h, sizeof h);
+    std::memcpy(out + sizeof h, message.data(), h.size);
+    std::memcpy(out + sizeof h + h.size, group.data(), h.group_size);
+    const std::size_t size = sizeof h + h.size + h.group_size;
+    h.checksum = checksum(out + sizeof h.checksum, size - sizeof h.checksum);
+    std::memcpy(out, &h.checksum, sizeof h.checksum);
+    return size;
+}
+
+bool decode_record(const char*& p, const char* end, LogRecord& r) {
+    RecordHeader h;
+    if (static_cast<std::size_t>(end - p) < sizeof h) {
+        return false;
+    }
+    std::memcpy(&h, p, sizeof h);
+    const std::size_t size = sizeof h + h.size + h.group_size;
+    if (h.kind < static_cast<std::uint8_t>(LogKind::Start) ||
+        h.kind > static_cast<std::uint8_t>(LogKind::Fire) || h.size > kMaxMessage ||
+        h.group_size > kMaxGroupTag ||
+        static_cast<std::size_t>(end - p) < size ||
+        checksum(p + sizeof h.checksum, size - sizeof h.checksum) != h.checksum) {
+        return false;
+    }
+    r = {static_cast<LogKind>(h.kind), h.id, h.repeats, h.seq, h.deadline, h.delay,
+         std::string_view(p + sizeof h, h.size),
+         std::string_view(p + sizeof h + h.size, h.group_size)};
+    p += size;
+    return true;
+}
+
+bool write_all(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+std::string log_name(std::uint64_t generation) {
+    char name[32];
+    std::snprintf(name, sizeof name, "wal.%016" PRIx64, generation);
+    return name;
+}
+
+int create_log(const std::string& dir, int dir_fd, std::uint64_t generation) {
+    const std::string path = dir + "/" + log_name(generation);
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    LogHeader header{};
+    std::memcpy(header.magic, kLogMagic, sizeof header.magic);
+    header.generation = generation;
+    if (!write_all(fd, reinterpret_cast<const char*>(&header), sizeof header) ||
+        fdatasync(fd) != 0 || fsync(dir_fd) != 0) {
+        const int error = errno;
+        ::close(fd);
+        unlink(path.c_str());
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+std::vector<std::uint64_t> list_logs(const std::string& dir) {
+    DIR* d = opendir(dir.c_str());
+    if (d == nullptr) {
+        throw std::system_error(errno, std::generic_category(), dir);
+    }
+    std::vector<std::uint64_t> logs;
+    while (const dirent* entry = readdir(d)) {
+        const std::string_view name = entry->d_name;
+        if (name.size() == 20 && name.starts_with("wal.")) {
+            char* end = nullptr;
+            const std::uint64_t generation = std::strtoull(entry->d_name + 4, &end, 16);
+            if (*end == '\0') {
+                logs.push_back(generation);
+            }
+        }
+    }
+    closedir(d);
+    std::sort(logs.begin(), logs.end());
+    return logs;
+}
+
+}  // namespace alarmd
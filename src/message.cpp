@@ -0,0 +1,132 @@
+#include "alarmd/message.hpp"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace alarmd {
+
+namespace {
+
+// Out-of-line storage for long messages: one free list of fixed-size blocks
+// per size class, refilled a slab at a time. Blocks are allocated by the
+// parsing thread and freed by whichever display thread printed the alarm,
+// so each class has its own lock.
+class MessageArena {
+public:
+    static constexpr std::size_t kClasses = 3;
+    static constexpr std::size_t kBlockSize[kClasses] = {32, 64, kMaxMessage + 1};
+    static constexpr std::size_t kSlabBytes = 64 * 1024;
+
+    static MessageArena& instance() {
+        // Never destroyed: messages in static objects may outlive main().
+        static MessageArena* arena = new MessageArena;
+        return *arena;
+    }
+
+    static std::size_t size_class(std::size_t size) {
+        std::size_t c = 0;
+        while (kBlockSize[c] < size + 1) {
+            ++c;
+        }
+        return c;
+    }
+
+    char* allocate(std::size_t size) {
+        SizeClass& sc = classes_[size_class(size)];
+        std::lock_guard<std::mutex> lock(sc.mutex);
+        if (sc.free == nullptr) {
+            refill(sc, kBlockSize[&sc - classes_]);
+        }
+        Block* block = sc.free;
+        sc.free = block->next;
+        return reinterpret_cast<char*>(block);
+    }
+
+    void deallocate(char* data, std::size_t size) {
+        SizeClass& sc = classes_[size_class(size)];
+        auto* block = reinterpret_cast<Block*>(data);
+        std::lock_guard<std::mutex> lock(sc.mutex);
+        block->next = sc.free;
+        sc.free = block;
+    }
+
+private:
+    struct Block {
+        Block* next;
+    };
+
+    struct SizeClass {
+        std::mutex mutex;
+        Block* free = nullptr;
+        std::vector<std::unique_ptr<char[]>> slabs;
+    };
+
+    static void refill(SizeClass& sc, std::size_t block_size) {
+        sc.slabs.push_back(std::make_unique_for_overwrite<char[]>(kSlabBytes));
+        char* slab = sc.slabs.back().get();
+        for (std::size_t off = kSlabBytes / block_size * block_size; off >= block_size;) {
+            off -= block_size;
+            auto* block = reinterpret_cast<Block*>(slab + off);
+            block->next = sc.free;
+            sc.free = block;
+        }
+    }
+
+    SizeClass classes_[kClasses];
+};
+
+}  // namespace
+
+Message::Message(std::string_view text) {
+    if (text.size() > kMaxMessage) {
+        text = text.substr(0, kMaxMessage);
+    }
+    char* data = buf_;
+    if (text.size() <= kInline) {
+        size_ = static_cast<std::uint8_t>(text.size());
+    } else {
+        data = MessageArena::instance().allocate(text.size());
+        set_heap({data, static_cast<std::uint32_t>(text.size())});
+        size_ = kHeapTag;
+    }
+    std::memcpy(data, text.data(), text.size());
+    data[text.size()] = '\0';
+}
+
+Message::Message(Message&& other) noexcept : size_(other.size_) {
+    std::memcpy(buf_, other.buf_, sizeof buf_);
+    other.size_ = 0;
+    other.buf_[0] = '\0';
+}
+
+Message& Message::operator=(const Message& other) {
+    if (this != &other) {
+        *this = Message(other.view());
+    }
+    return *this;
+}
+
+Message& Message::operator=(Message&& other) noexcept {
+    if (this != &other) {
+        release();
+        std::memcpy(buf_, other.buf_, sizeof buf_);
+        size_ = other.size_;
+        other.size_ = 0;
+        other.buf_[0] = '\0';
+    }
+    return *this;
+}
+
+void Message::release() noexcept {
+    if (!is_inline()) {
+        const Heap h = heap();
+        MessageArena::instance().deallocate(h.data, h.size);
+        size_ = 0;
+        buf_[0] = '\0';
+    }
+}
+
+}  // namespace alarmd
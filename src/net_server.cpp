@@ -0,0 +1,797 @@
+#include "alarmd/net_server.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <system_error>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "alarmd/batch_input.hpp"
+#include "alarmd/cpu_affinity.hpp"
+#include "alarmd/latency_stats.hpp"
+#include "alarmd/replication.hpp"
+#include "alarmd/trace.hpp"
+
+namespace alarmd {
+
+namespace {
+
+// epoll tokens for the non-client descriptors; clients use their owner id.
+constexpr std::uint64_t kWakeToken = std::numeric_limits<std::uint64_t>::max();
+constexpr std::uint64_t kTcpToken = kWakeToken - 1;
+constexpr std::uint64_t kUnixToken = kWakeToken - 2;
+// Shard i's timerfd is kTimerToken + i, above every owner id.
+constexpr std::uint64_t kTimerToken = std::uint64_t{1} << 32;
+
+constexpr int kMaxEvents = 256;
+// A client sending this much without a newline is not speaking the protocol.
+constexpr std::size_t kMaxInput = 4096;
+
+[[noreturn]] void throw_errno(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+long now() { return static_cast<long>(std::time(nullptr)); }
+
+bool parse_int(std::string_view text, int& value) {
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc() && end == text.data() + text.size() && value >= 0;
+}
+
+}  // namespace
+
+bool parse_route(std::string_view text, Route& route) {
+    const std::size_t eq = text.find('=');
+    if (eq == std::string_view::npos) {
+        return false;
+    }
+    const std::string_view ids = text.substr(0, eq);
+    const std::size_t dash = ids.find('-');
+    Route r;
+    r.address = std::string(text.substr(eq + 1));
+    std::string host;
+    int port;
+    if (!parse_int(ids.substr(0, dash), r.ids.lo) ||
+        !parse_int(dash == std::string_view::npos ? ids : ids.substr(dash + 1), r.ids.hi) ||
+        r.ids.lo > r.ids.hi || !parse_host_port(r.address, host, port)) {
+        return false;
+    }
+    route = std::move(r);
+    return true;
+}
+
+SchedulerOptions NetServer::routed(SchedulerOptions options, NetServer* server, bool timerfd) {
+    options.on_result = [server](const RequestResult& r) {
+        char line[kMaxLine];
+        server->post_line(r.owner, std::string_view(line, format_result(r, now(), line)));
+    };
+    options.on_fired = [server](int worker, std::vector<FiredAlarm>& chunk) {
+        server->post_lines(worker, chunk);
+    };
+    options.batch_output = false;  // nothing is printed to `out`
+    if (timerfd) {
+        options.on_arm = [server](std::size_t shard, Deadline when) {
+            server->arm_timer(shard, when);
+        };
+    }
+    return options;
+}
+
+NetServer::NetServer(SchedulerOptions scheduler_options, NetOptions options)
+    : options_(std::move(options)),
+      scheduler_(routed(std::move(scheduler_options), this, options_.timerfd)) {
+    if (options_.cpu >= 0) {
+        check_cpus({options_.cpu});
+    }
+    for (const Route& route : options_.routes) {
+        auto& [host, port] = route_hosts_.emplace_back();
+        if (!parse_host_port(route.address, host, port)) {
+            throw std::invalid_argument("route address must be IPV4:PORT: " + route.address);
+        }
+    }
+    try {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            throw_errno("epoll_create1");
+        }
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd_ < 0) {
+            throw_errno("eventfd");
+        }
+        add_watch(wake_fd_, kWakeToken, EPOLLIN | EPOLLET);
+        if (options_.tcp_port >= 0) {
+            tcp_fd_ = listen_tcp();
+            add_watch(tcp_fd_, kTcpToken, EPOLLIN | EPOLLET);
+        }
+        if (!options_.unix_path.empty()) {
+            unix_fd_ = listen_unix();
+            add_watch(unix_fd_, kUnixToken, EPOLLIN | EPOLLET);
+        }
+        if (options_.timerfd) {
+            for (std::size_t i = 0; i < scheduler_.shard_count(); ++i) {
+                const int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+                if (fd < 0) {
+                    throw_errno("timerfd_create");
+                }
+                timer_fds_.push_back(fd);
+                add_watch(fd, kTimerToken + i, EPOLLIN);
+            }
+        }
+    } catch (...) {
+        for (int fd : {epoll_fd_, wake_fd_, tcp_fd_, unix_fd_}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        for (int fd : timer_fds_) {
+            close(fd);
+        }
+        throw;
+    }
+}
+
+NetServer::~NetServer() {
+    stop();
+    for (int fd : {epoll_fd_, wake_fd_, tcp_fd_, unix_fd_}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    for (int fd : timer_fds_) {
+        close(fd);
+    }
+    if (unix_fd_ >= 0) {
+        unlink(options_.unix_path.c_str());
+    }
+}
+
+int NetServer::listen_tcp() {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw_errno("socket");
+    }
+    const int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<std::uint16_t>(options_.tcp_port));
+    if (inet_pton(AF_INET, options_.tcp_address.c_str(), &addr.sin_addr) != 1) {
+        close(fd);
+        throw std::system_error(EINVAL, std::generic_category(), "tcp address");
+    }
+    socklen_t len = sizeof addr;
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0 ||
+        listen(fd, options_.backlog) != 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        const int err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), "tcp listen");
+    }
+    tcp_port_ = ntohs(addr.sin_port);
+    return fd;
+}
+
+int NetServer::listen_unix() {
+    sockaddr_un addr{};
+    if (options_.unix_path.size() >= sizeof addr.sun_path) {
+        throw std::system_error(ENAMETOOLONG, std::generic_category(), "unix socket path");
+    }
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw_errno("socket");
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, options_.unix_path.c_str(), options_.unix_path.size() + 1);
+    unlink(addr.sun_path);  // a stale socket from an earlier run
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0 ||
+        listen(fd, options_.backlog) != 0) {
+        const int err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), "unix listen");
+    }
+    return fd;
+}
+
+void NetServer::add_watch(int fd, std::uint64_t token, std::uint32_t events) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.u64 = token;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        throw_errno("epoll_ctl");
+    }
+}
+
+void NetServer::arm_timer(std::size_t shard, Deadline when) {
+    itimerspec spec{};  // all zero disarms
+    if (when != kNoDeadline) {
+        // A zero it_value would disarm rather than fire at once.
+        const Deadline us = std::max<Deadline>(when, 1);
+        spec.it_value.tv_sec = static_cast<time_t>(us / 1'000'000);
+        spec.it_value.tv_nsec = static_cast<long>(us % 1'000'000) * 1'000;
+    }
+    timerfd_settime(timer_fds_[shard], TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+void NetServer::start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    stopping_.store(false, std::memory_order_relaxed);
+    scheduler_.start();
+    loop_thread_ = std::thread(&NetServer::loop_main, this);
+}
+
+void NetServer::stop() {
+    if (!running_) {
+        return;
+    }
+    // The scheduler goes first so the notices it flushes on the way down are
+    // still in the outbox when the loop makes its last pass.
+    scheduler_.stop();
+    stopping_.store(true, std::memory_order_relaxed);
+    wake();
+    loop_thread_.join();
+    running_ = false;
+}
+
+void NetServer::wake() {
+    const std::uint64_t one = 1;
+    [[maybe_unused]] const ssize_t n = write(wake_fd_, &one, sizeof one);
+}
+
+void NetServer::post_line(std::uint32_t owner, std::string_view line) {
+    bool was_empty;
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        was_empty = outbox_.empty();
+        outbox_.push_back({owner, static_cast<std::uint32_t>(outbox_text_.size()),
+                           static_cast<std::uint32_t>(line.size())});
+        outbox_text_.append(line);
+    }
+    // The loop swaps the whole outbox out, so only the first line after a
+    // swap needs to wake it.
+    if (was_empty) {
+        wake();
+    }
+}
+
+void NetServer::post_lines(int worker, std::vector<FiredAlarm>& chunk) {
+    const long t = now();
+    char line[kMaxLine];
+    bool was_empty;
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        was_empty = outbox_.empty();
+        for (const FiredAlarm& alarm : chunk) {
+            const std::size_t n = format_fired(alarm, worker, t, line);
+            outbox_.push_back({alarm.owner, static_cast<std::uint32_t>(outbox_text_.size()),
+                               static_cast<std::uint32_t>(n)});
+            outbox_text_.append(line, n);
+        }
+    }
+    if (was_empty && !chunk.empty()) {
+        wake();
+    }
+}
+
+void NetServer::deliver_outbox() {
+    {
+        std::lock_guard<std::mutex> lock(outbox_mutex_);
+        outbox_work_.swap(outbox_);
+        outbox_text_work_.swap(outbox_text_);
+    }
+    for (const Pending& p : outbox_work_) {
+        auto it = connections_.find(p.owner);
+        if (it != connections_.end()) {
+            queue_output(p.owner, it->second,
+                         std::string_view(outbox_text_work_).substr(p.begin, p.size));
+        }
+    }
+    outbox_work_.clear();
+    outbox_text_work_.clear();
+}
+
+void NetServer::loop_main() {
+    if (options_.cpu >= 0) {
+        pin_current_thread(options_.cpu);
+    }
+    epoll_event events[kMaxEvents];
+    while (!stopping_.load(std::memory_order_relaxed)) {
+        const int n = epoll_wait(epoll_fd_, events, kMaxEvents, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::perror("alarm_server: epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            const std::uint64_t token = events[i].data.u64;
+            if (token == kWakeToken) {
+                std::uint64_t count;
+                [[maybe_unused]] const ssize_t r = read(wake_fd_, &count, sizeof count);
+                deliver_outbox();
+            } else if (token == kTcpToken) {
+                accept_clients(tcp_fd_, true);
+            } else if (token == kUnixToken) {
+                accept_clients(unix_fd_, false);
+            } else if (token >= kTimerToken) {
+                const std::size_t shard = token - kTimerToken;
+                std::uint64_t expirations;
+                [[maybe_unused]] const ssize_t r =
+                    read(timer_fds_[shard], &expirations, sizeof expirations);
+                scheduler_.poll_shard(shard);
+            } else {
+                const auto owner = static_cast<std::uint32_t>(token);
+                auto it = connections_.find(owner);
+                if (it == connections_.end()) {
+                    continue;  // closed earlier in this batch
+                }
+                Connection& c = it->second;
+                if (c.client != 0) {
+                    if (events[i].events & EPOLLOUT) {
+                        queue_output(owner, c, {}, true);  // connected, or room to send
+                    }
+                    if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) {
+                        read_relay(owner, c);
+                    }
+                    continue;
+                }
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    close_client(owner);
+                    continue;
+                }
+                if ((events[i].events & (EPOLLIN | EPOLLRDHUP)) && !read_client(owner, c)) {
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT) {
+                    queue_output(owner, c, {});
+                }
+            }
+        }
+        flush_dirty();
+    }
+    // Last pass: whatever the stopping scheduler printed, without blocking.
+    deliver_outbox();
+    flush_dirty();
+    for (auto& [owner, c] : connections_) {
+        close(c.fd);
+    }
+    connections_.clear();
+    relay_count_ = 0;
+    connection_count_.store(0, std::memory_order_relaxed);
+}
+
+void NetServer::accept_clients(int listener, bool tcp) {
+    // Edge-triggered: accept until the backlog is empty. On EMFILE the rest
+    // wait in the backlog until the next connection attempt re-arms the edge.
+    for (;;) {
+        const int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+        if (connections_.size() - relay_count_ >= options_.max_connections) {
+            close(fd);
+            continue;
+        }
+        if (tcp) {
+            const int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        }
+        const std::uint32_t owner = new_owner();
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.u64 = owner;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            continue;
+        }
+        connections_[owner].fd = fd;
+        count_connections();
+    }
+}
+
+std::uint32_t NetServer::new_owner() {
+    std::uint32_t owner = next_owner_++;
+    while (owner == 0 || connections_.count(owner) != 0) {
+        owner = next_owner_++;  // skip 0 (local) after wrap-around
+    }
+    return owner;
+}
+
+void NetServer::count_connections() {
+    connection_count_.store(connections_.size() - relay_count_, std::memory_order_relaxed);
+}
+
+bool NetServer::read_client(std::uint32_t owner, Connection& c) {
+    char buf[16384];
+    bool eof = false;
+    for (;;) {
+        const ssize_t n = read(c.fd, buf, sizeof buf);
+        if (n > 0) {
+            c.in.append(buf, static_cast<std::size_t>(n));
+            continue;
+        }
+        if (n == 0) {
+            eof = true;
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            close_client(owner);
+            return false;
+        }
+        break;
+    }
+
+    std::size_t start = 0;
+    bool open = true;
+    for (std::size_t nl; open && (nl = c.in.find('\n', start)) != std::string::npos;) {
+        open = handle_line(owner, c, std::string_view(c.in).substr(start, nl - start));
+        start = nl + 1;
+    }
+    if (open && eof && start < c.in.size()) {
+        open = handle_line(owner, c, std::string_view(c.in).substr(start));
+        start = c.in.size();
+    }
+    if (!batch_.empty()) {
+        scheduler_.post_batch(batch_);
+    }
+    if (!open) {
+        return false;
+    }
+    c.in.erase(0, start);
+    if (c.in.size() > kMaxInput) {
+        if (!queue_output(owner, c, "Bad command\n")) {
+            return false;
+        }
+        eof = true;
+    }
+    if (eof) {
+        // Apply what the client sent so its results are in the outbox before
+        // the connection goes; notices of alarms that fire later are dropped.
+        scheduler_.drain();
+        c.closing = true;
+        // Each node applies what it was sent and answers before closing
+        // its end; the client closes after the last one has.
+        for (const std::uint32_t relay : c.relays) {
+            auto it = connections_.find(relay);
+            if (relay != 0 && it != connections_.end()) {
+                it->second.closing = true;
+                queue_output(relay, it->second, {}, true);
+            }
+        }
+        if (!queue_output(owner, c, {})) {
+            return false;
+        }
+        deliver_outbox();
+        return connections_.count(owner) != 0;
+    }
+    return true;
+}
+
+bool NetServer::handle_line(std::uint32_t owner, Connection& c, std::string_view line) {
+    if (c.closing || line.find_first_not_of(" \t\r") == std::string_view::npos) {
+        return true;
+    }
+    if (line.starts_with("GET ")) {
+        return serve_http(owner, c, line.substr(4));
+    }
+    Command cmd;
+    const std::int64_t parse_start = monotonic_ns();
+    const bool parsed = parse_command(line, cmd);
+    record_latency(Metric::Parse, monotonic_ns() - parse_start);
+    if (!parsed) {
+        return queue_output(owner, c, "Bad command\n");
+    }
+    if (!options_.routes.empty() &&
+        (cmd.type == CommandType::StartAlarm || cmd.type == CommandType::ChangeAlarm ||
+         cmd.type == CommandType::CancelAlarm)) {
+        for (std::size_t i = 0; i < options_.routes.size(); ++i) {
+            const IdRange& ids = options_.routes[i].ids;
+            if (cmd.id >= ids.lo && cmd.id <= ids.hi) {
+                return forward(owner, c, i, line);
+            }
+        }
+    }
+    switch (cmd.type) {
+        case CommandType::StartAlarm:
+            batch_.push_back({RequestKind::Start, cmd.id, cmd.delay, Message(cmd.message), owner,
+                              cmd.repeats, Message(cmd.group)});
+            break;
+        case CommandType::ChangeAlarm:
+            batch_.push_back({RequestKind::Change, cmd.id, cmd.delay, Message(cmd.message), owner,
+                              cmd.repeats, Message(cmd.group)});
+            break;
+        case CommandType::CancelAlarm:
+            batch_.push_back({RequestKind::Cancel, cmd.id, {}, {}, owner});
+            break;
+        case CommandType::StartAlarms:
+        case CommandType::CancelAlarms:
+        case CommandType::CancelGroup:
+        case CommandType::ChangeGroup: {
+            if (!batch_.empty()) {
+                scheduler_.post_batch(batch_);
+            }
+            char text[kMaxLine];
+            return queue_output(
+                owner, c, std::string_view(text, run_bulk_command(scheduler_, cmd, owner, text)),
+                true);
+        }
+        case CommandType::ViewAlarms: {
+            if (!batch_.empty()) {
+                scheduler_.post_batch(batch_);
+            }
+            // The listing is built on the event loop, so keep it to one page.
+            if (cmd.view.offset > options_.max_view_offset) {
+                return queue_output(owner, c,
+                                    "View_Alarms offset too large; narrow it with id= or due=\n",
+                                    true);
+            }
+            ViewFilter filter = cmd.view;
+            filter.limit = std::min(filter.limit, options_.max_view);
+            char* text = nullptr;
+            std::size_t size = 0;
+            std::FILE* out = open_memstream(&text, &size);
+            if (out == nullptr) {
+                return true;
+            }
+            scheduler_.view_alarms(out, filter);
+            std::fclose(out);
+            bool open;
+            if (c.out.size() - c.sent + size > options_.max_output) {
+                open = queue_output(owner, c, "View_Alarms too large; ask for less with limit=\n",
+                                    true);
+            } else {
+                open = queue_output(owner, c, std::string_view(text, size), true);
+            }
+            std::free(text);
+            return open;
+        }
+        case CommandType::Stats:
+            return queue_output(owner, c, scheduler_.render_stats(now()), true);
+        case CommandType::Config: {
+            if (!batch_.empty()) {
+                scheduler_.post_batch(batch_);
+            }
+            // A client must not make the server write files; it fetches the
+            // trace with GET /trace.
+            char text[kMaxLine];
+            return queue_output(
+                owner, c,
+                std::string_view(text, run_config_command(scheduler_, cmd, false, text)), true);
+        }
+        case CommandType::Invalid:
+            break;
+    }
+    return true;
+}
+
+bool NetServer::forward(std::uint32_t owner, Connection& c, std::size_t route,
+                        std::string_view line) {
+    if (c.relays.empty()) {
+        c.relays.assign(options_.routes.size(), 0);
+    }
+    if (c.relays[route] == 0) {
+        c.relays[route] = open_relay(owner, route);
+        if (c.relays[route] == 0) {
+            const std::string text = "Node " + options_.routes[route].address + " unavailable\n";
+            return queue_output(owner, c, text, true);
+        }
+        ++c.open_relays;
+    }
+    Connection& r = connections_.at(c.relays[route]);
+    r.out.append(line);
+    r.out.push_back('\n');
+    return queue_output(c.relays[route], r, {}, true);
+}
+
+std::uint32_t NetServer::open_relay(std::uint32_t client, std::size_t route) {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    const int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<std::uint16_t>(route_hosts_[route].second));
+    inet_pton(AF_INET, route_hosts_[route].first.c_str(), &addr.sin_addr);
+    // Sends queue in `out` until EPOLLOUT says the connect finished.
+    const std::uint32_t owner = new_owner();
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.u64 = owner;
+    if ((connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0 &&
+         errno != EINPROGRESS) ||
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        close(fd);
+        return 0;
+    }
+    Connection& r = connections_[owner];
+    r.fd = fd;
+    r.client = client;
+    r.route = route;
+    ++relay_count_;
+    count_connections();
+    return owner;
+}
+
+void NetServer::read_relay(std::uint32_t owner, Connection& r) {
+    auto client = connections_.find(r.client);
+    char buf[16384];
+    for (;;) {
+        const ssize_t n = read(r.fd, buf, sizeof buf);
+        if (n > 0) {
+            // A client too slow for its notices is dropped, relays and all.
+            if (client != connections_.end() &&
+                !queue_output(r.client, client->second,
+                              std::string_view(buf, static_cast<std::size_t>(n)))) {
+                return;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        // EOF is the node's answer to our half-close; anything else is a
+        // failure the client hears about.
+        close_relay(owner, !(n == 0 && r.closing));
+        return;
+    }
+}
+
+void NetServer::close_relay(std::uint32_t owner, bool failed) {
+    auto it = connections_.find(owner);
+    if (it == connections_.end()) {
+        return;
+    }
+    const Connection r = std::move(it->second);
+    close(r.fd);
+    connections_.erase(it);
+    --relay_count_;
+    count_connections();
+    auto client = connections_.find(r.client);
+    if (client == connections_.end()) {
+        return;
+    }
+    Connection& c = client->second;
+    c.relays[r.route] = 0;
+    --c.open_relays;
+    if (failed) {
+        queue_output(r.client, c, "Node " + options_.routes[r.route].address + " unavailable\n",
+                     true);
+    } else {
+        queue_output(r.client, c, {});  // a closing client may be done now
+    }
+}
+
+bool NetServer::serve_http(std::uint32_t owner, Connection& c, std::string_view request) {
+    const std::string_view path = request.substr(0, request.find_first_of(" \r"));
+    const char* status = "200 OK";
+    const char* type = "text/plain; version=0.0.4";
+    std::string body;
+    char header[160];
+    if (path == "/metrics") {
+        body = scheduler_.render_prometheus();
+    } else if (path == "/trace") {
+        // Rendered on the event loop and as large as the rings allow, so it
+        // gets only as many events as fit in what is left of max_output.
+        const std::size_t used = c.out.size() - c.sent + sizeof header;
+        const std::size_t room = options_.max_output > used ? options_.max_output - used : 0;
+        body = render_chrome_trace(room / kTraceEventBytes);
+        type = "application/json";
+    } else {
+        status = "404 Not Found";
+        body = "not found\n";
+    }
+    std::snprintf(header, sizeof header,
+                  "HTTP/1.0 %s\r\nContent-Type: %s\r\n"
+                  "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                  status, type, body.size());
+    // The rest of the request is ignored; the connection closes once the
+    // response is out.
+    c.closing = true;
+    return queue_output(owner, c, header, true) && queue_output(owner, c, body, true);
+}
+
+bool NetServer::queue_output(std::uint32_t owner, Connection& c, std::string_view text,
+                             bool reply) {
+    c.out.append(text);
+    if (!reply && c.out.size() - c.sent > options_.max_output) {
+        close_client(owner);  // not reading what it is sent
+        return false;
+    }
+    if (!c.dirty) {
+        c.dirty = true;
+        dirty_.push_back(owner);
+    }
+    return true;
+}
+
+void NetServer::flush_dirty() {
+    // close_client() may run inside the loop, so iterate by index over a
+    // list that is only appended to.
+    for (std::size_t i = 0; i < dirty_.size(); ++i) {
+        auto it = connections_.find(dirty_[i]);
+        if (it != connections_.end()) {
+            it->second.dirty = false;
+            flush_client(dirty_[i], it->second);
+        }
+    }
+    dirty_.clear();
+}
+
+void NetServer::flush_client(std::uint32_t owner, Connection& c) {
+    while (c.sent < c.out.size()) {
+        const ssize_t n = send(c.fd, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            c.sent += static_cast<std::size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;  // EPOLLOUT marks the connection dirty again
+        }
+        close_client(owner);
+        return;
+    }
+    c.out.clear();
+    c.sent = 0;
+    if (c.closing && c.client != 0) {
+        shutdown(c.fd, SHUT_WR);  // the node sees EOF, answers, and closes
+    } else if (c.closing && c.open_relays == 0) {
+        close_client(owner);
+    }
+}
+
+void NetServer::close_client(std::uint32_t owner) {
+    auto it = connections_.find(owner);
+    if (it == connections_.end()) {
+        return;
+    }
+    if (it->second.client != 0) {
+        close_relay(owner, true);
+        return;
+    }
+    const std::vector<std::uint32_t> relays = std::move(it->second.relays);
+    close(it->second.fd);  // also removes it from the epoll set
+    connections_.erase(it);
+    for (const std::uint32_t relay : relays) {
+        auto r = connections_.find(relay);
+        if (relay != 0 && r != connections_.end()) {
+            close(r->second.fd);
+            connections_.erase(r);
+            --relay_count_;
+        }
+    }
+    count_connections();
+}
+
+}  // namespace alarmd
@@ -0,0 +1,337 @@
+#include "alarmd/output_writer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace alarmd {
+
+namespace {
+
+// Largest iovec count one vectored write takes (IOV_MAX on Linux).
+constexpr std::size_t kMaxIov = 1024;
+
+}  // namespace
+
+// Minimal io_uring through the raw syscalls (liburing is not a dependency):
+// one ring, one WRITEV in flight at a time. The writer thread is the only
+// user, so the ring needs no locking.
+class OutputWriter::Uring {
+public:
+    // Returns nullptr if the kernel refuses io_uring (old kernel, seccomp).
+    static std::unique_ptr<Uring> open() {
+        io_uring_params params{};
+        const int fd = static_cast<int>(syscall(__NR_io_uring_setup, 4, &params));
+        if (fd < 0) {
+            return nullptr;
+        }
+        auto ring = std::unique_ptr<Uring>(new Uring(fd));
+        return ring->map(params) ? std::move(ring) : nullptr;
+    }
+
+    ~Uring() {
+        if (sqes_ != MAP_FAILED) {
+            munmap(sqes_, sqes_len_);
+        }
+        if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) {
+            munmap(cq_ptr_, cq_len_);
+        }
+        if (sq_ptr_ != MAP_FAILED) {
+            munmap(sq_ptr_, sq_len_);
+        }
+        close(fd_);
+    }
+
+    // Writes at the fd's current position; returns bytes written or -errno.
+    long writev(int fd, const iovec* iov, int count) {
+        const unsigned tail = *sq_tail_;
+        const unsigned index = tail & *sq_mask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof sqe);
+        sqe.opcode = IORING_OP_WRITEV;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>(iov);
+        sqe.len = static_cast<std::uint32_t>(count);
+        sqe.off = static_cast<std::uint64_t>(-1);
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+        unsigned to_submit = 1;
+        for (;;) {
+            const unsigned head = *cq_head_;
+            if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+                const long res = cqes_[head & *cq_mask_].res;
+                __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+                return res;
+            }
+            const long r = syscall(__NR_io_uring_enter, fd_, to_submit, 1,
+                                   IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (r >= 0) {
+                to_submit = 0;
+            } else if (errno != EINTR) {
+                return -errno;
+            } else if (__atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) == tail + 1) {
+                to_submit = 0;  // interrupted after the kernel took the entry
+            }
+        }
+    }
+
+private:
+    explicit Uring(int fd) : fd_(fd) {}
+
+    bool map(const io_uring_params& p) {
+        sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+        }
+        sq_ptr_ = mmap(nullptr, sq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                       IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) {
+            return false;
+        }
+        cq_ptr_ = single ? sq_ptr_
+                         : mmap(nullptr, cq_len_, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        if (cq_ptr_ == MAP_FAILED) {
+            return false;
+        }
+        sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+        char* sq = static_cast<char*>(sq_ptr_);
+        char* cq = static_cast<char*>(cq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sq_mask_ = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cq_mask_ = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        return true;
+    }
+
+    int fd_;
+    void* sq_ptr_ = MAP_FAILED;
+    void* cq_ptr_ = MAP_FAILED;
+    io_uring_sqe* sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+    std::size_t sq_len_ = 0;
+    std::size_t cq_len_ = 0;
+    std::size_t sqes_len_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+OutputWriter::OutputWriter(int fd, OutputOptions options) : fd_(fd), options_(options) {
+    if (fd < 0) {
+        throw std::invalid_argument("output writer needs a file descriptor");
+    }
+    if (options_.slots < 1) {
+        throw std::invalid_argument("output writer needs at least one slot");
+    }
+    if (options_.flush_latency.count() < 0) {
+        throw std::invalid_argument("flush_latency must not be negative");
+    }
+    if (options_.backend != OutputBackend::Writev) {
+        uring_ = Uring::open();
+        if (uring_ == nullptr && options_.backend == OutputBackend::Uring) {
+            throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+        }
+        use_uring_.store(uring_ != nullptr, std::memory_order_relaxed);
+    }
+    for (std::size_t i = 0; i < options_.slots; ++i) {
+        slots_.push_back(std::make_unique<Slot>());
+    }
+    writer_thread_ = std::thread(&OutputWriter::writer_main, this);
+}
+
+OutputWriter::~OutputWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cond_.notify_one();
+    writer_thread_.join();
+}
+
+void OutputWriter::write(std::size_t slot, std::string_view text) {
+    if (text.empty()) {
+        return;
+    }
+    slot %= slots_.size();
+    // Raised before the slot's first bytes take mutex_ below, so the writer
+    // sweeps this slot by the time it sees pending_.
+    std::size_t used = used_.load(std::memory_order_relaxed);
+    while (slot >= used && !used_.compare_exchange_weak(used, slot + 1)) {
+    }
+    Slot& s = *slots_[slot];
+    bool first;
+    bool full;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        first = s.buf.empty();
+        s.buf.append(text);
+        full = s.buf.size() >= options_.buffer_size;
+    }
+    // Only the first bytes after a flush start the latency clock; later
+    // appends ride along unless they fill the slot.
+    if (first || full) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!pending_) {
+            pending_ = true;
+            since_ = monotonic_now();
+        }
+        urgent_ = urgent_ || full || options_.flush_latency.count() == 0;
+        cond_.notify_one();
+    }
+}
+
+void OutputWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const std::uint64_t target = ++flush_requested_;
+    cond_.notify_one();
+    while (flushed_ < target) {
+        done_cond_.wait(lock);
+    }
+}
+
+void OutputWriter::set_flush_latency(std::chrono::microseconds latency) {
+    if (latency.count() < 0) {
+        throw std::invalid_argument("flush_latency must not be negative");
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    options_.flush_latency = latency;
+    urgent_ = urgent_ || (pending_ && latency.count() == 0);
+    cond_.notify_one();  // the writer re-reads the latency before it waits again
+}
+
+std::uint64_t OutputWriter::writes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return writes_;
+}
+
+std::uint64_t OutputWriter::dropped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+}
+
+void OutputWriter::writer_main() {
+    std::vector<std::string> bufs(slots_.size());
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        const bool requested = flush_requested_ != flushed_;
+        if (!pending_ && !requested) {
+            if (stopping_) {
+                return;
+            }
+            cond_.wait(lock);
+            continue;
+        }
+        if (!urgent_ && !requested && !stopping_ &&
+            cond_.wait_until(lock, since_ + options_.flush_latency.count())) {
+            continue;  // woken early: re-check what changed
+        }
+        pending_ = false;
+        urgent_ = false;
+        const std::uint64_t target = flush_requested_;
+        lock.unlock();
+        // A write that races with the swap below either lands in this flush
+        // or finds its slot empty and sets pending_ again.
+        const std::size_t used = used_.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < used; ++i) {
+            std::lock_guard<std::mutex> slot_lock(slots_[i]->mutex);
+            bufs[i].swap(slots_[i]->buf);
+        }
+        write_out(bufs);
+        lock.lock();
+        flushed_ = target;
+        done_cond_.notify_all();
+    }
+}
+
+void OutputWriter::write_out(std::vector<std::string>& bufs) {
+    iovec iov[kMaxIov];
+    std::size_t next = 0;  // first buffer not yet in iov
+    std::uint64_t writes = 0;
+    std::uint64_t dropped = 0;
+    while (next < bufs.size()) {
+        int count = 0;
+        std::size_t total = 0;
+        for (; next < bufs.size() && count < static_cast<int>(kMaxIov); ++next) {
+            if (!bufs[next].empty()) {
+                iov[count++] = {bufs[next].data(), bufs[next].size()};
+                total += bufs[next].size();
+            }
+        }
+        int first = 0;
+        while (first < count) {
+            const long n = write_iov(iov + first, count - first);
+            ++writes;
+            if (n == -EINTR) {
+                continue;
+            }
+            if (n == -EAGAIN || n == -EWOULDBLOCK) {
+                pollfd pfd{fd_, POLLOUT, 0};
+                poll(&pfd, 1, -1);
+                continue;
+            }
+            if (n <= 0) {
+                dropped += total;
+                break;
+            }
+            // Short write: skip the iovecs it covered and trim the next one.
+            total -= static_cast<std::size_t>(n);
+            auto left = static_cast<std::size_t>(n);
+            while (first < count && left >= iov[first].iov_len) {
+                left -= iov[first].iov_len;
+                ++first;
+            }
+            if (first < count) {
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + left;
+                iov[first].iov_len -= left;
+            }
+        }
+    }
+    for (std::string& buf : bufs) {
+        buf.clear();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    writes_ += writes;
+    dropped_ += dropped;
+}
+
+long OutputWriter::write_iov(const iovec* iov, int count) {
+    if (use_uring_.load(std::memory_order_relaxed)) {
+        const long n = uring_->writev(fd_, iov, count);
+        if (n != -EINVAL && n != -EOPNOTSUPP && n != -ESPIPE) {
+            return n;
+        }
+        // The kernel cannot do this fd type through the ring: stay on writev.
+        use_uring_.store(false, std::memory_order_relaxed);
+    }
+    const ssize_t n = ::writev(fd_, iov, count);
+    return n < 0 ? -errno : static_cast<long>(n);
+}
+
+}  // namespace alarmd
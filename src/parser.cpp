@@ -0,0 +1,505 @@
+#include "alarmd/parser.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <string_view>
+
+#include "alarmd/clock.hpp"
+
+namespace alarmd {
+
+namespace {
+
+// Whitespace skipped before the command and inside the id, as scanf's
+// conversions do in the C locale.
+bool is_space(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+bool is_tag_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '_' || c == '.' || c == ':' || c == '-';
+}
+
+// Whitespace allowed after a complete command.
+bool is_trailing_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+// Single forward pass over the line. Every method consumes from the front of
+// `rest_` and fails without side effects on the parsed fields.
+class Cursor {
+public:
+    explicit Cursor(std::string_view line) : rest_(line) {}
+
+    void skip_space() {
+        std::size_t i = 0;
+        while (i < rest_.size() && is_space(rest_[i])) {
+            ++i;
+        }
+        rest_.remove_prefix(i);
+    }
+
+    // Returns whether anything was skipped.
+    bool skip_blanks() {
+        std::size_t i = 0;
+        while (i < rest_.size() && (rest_[i] == ' ' || rest_[i] == '\t')) {
+            ++i;
+        }
+        rest_.remove_prefix(i);
+        return i != 0;
+    }
+
+    const char* position() const { return rest_.data(); }
+
+    bool literal(std::string_view word) {
+        if (!rest_.starts_with(word)) {
+            return false;
+        }
+        rest_.remove_prefix(word.size());
+        return true;
+    }
+
+    // A non-negative id: optional whitespace and sign, then digits ("-0" is
+    // zero, as with %d). Larger than INT_MAX is rejected.
+    bool id(int& out) {
+        skip_space();
+        std::size_t i = 0;
+        bool negative = false;
+        if (i < rest_.size() && (rest_[i] == '+' || rest_[i] == '-')) {
+            negative = rest_[i] == '-';
+            ++i;
+        }
+        const std::size_t first = i;
+        long long value = 0;
+        for (; i < rest_.size() && rest_[i] >= '0' && rest_[i] <= '9'; ++i) {
+            value = value * 10 + (rest_[i] - '0');
+            if (value > std::numeric_limits<int>::max()) {
+                return false;
+            }
+        }
+        if (i == first || (negative && value != 0)) {
+            return false;
+        }
+        out = static_cast<int>(value);
+        rest_.remove_prefix(i);
+        return true;
+    }
+
+    // Plain digits, no sign or whitespace, at most `max`.
+    bool number(unsigned long long& out, unsigned long long max) {
+        std::size_t i = 0;
+        unsigned long long value = 0;
+        for (; i < rest_.size() && rest_[i] >= '0' && rest_[i] <= '9'; ++i) {
+            const auto digit = static_cast<unsigned>(rest_[i] - '0');
+            if (value > (max - digit) / 10) {
+                return false;
+            }
+            value = value * 10 + digit;
+        }
+        if (i == 0) {
+            return false;
+        }
+        out = value;
+        rest_.remove_prefix(i);
+        return true;
+    }
+
+    // `N`, `A-B`, `A-` or `-B`; the ends left out keep their defaults.
+    bool id_range(int& lo, int& hi) {
+        constexpr auto kMax = static_cast<unsigned long long>(std::numeric_limits<int>::max());
+        unsigned long long a = 0;
+        unsigned long long b = 0;
+        const bool has_a = number(a, kMax);
+        if (!literal("-")) {
+            lo = hi = static_cast<int>(a);
+            return has_a;
+        }
+        const bool has_b = number(b, kMax);
+        if (has_a) {
+            lo = static_cast<int>(a);
+        }
+        if (has_b) {
+            hi = static_cast<int>(b);
+        }
+        return (has_a || has_b) && lo <= hi;
+    }
+
+    // `ITEM[,ITEM]...` with blanks allowed around the commas, where ITEM is
+    // `N` or `A-B` with A <= B; calls fn(lo, hi) for each.
+    template <typename Fn>
+    bool id_list(Fn&& fn) {
+        constexpr auto kMax = static_cast<unsigned long long>(std::numeric_limits<int>::max());
+        for (;;) {
+            skip_blanks();
+            unsigned long long a = 0;
+            if (!number(a, kMax)) {
+                return false;
+            }
+            unsigned long long b = a;
+            if (literal("-") && (!number(b, kMax) || b < a)) {
+                return false;
+            }
+            fn(static_cast<int>(a), static_cast<int>(b));
+            const Cursor item_end = *this;
+            skip_blanks();
+            if (!literal(",")) {
+                *this = item_end;
+                return true;
+            }
+        }
+    }
+
+    // `T1-T2`, `T1-` or `-T2`.
+    bool due_range(std::chrono::microseconds& lo, std::chrono::microseconds& hi) {
+        std::chrono::microseconds a{0};
+        std::chrono::microseconds b{0};
+        const bool has_a = parse_duration(rest_, a);
+        if (!literal("-")) {
+            return false;
+        }
+        const bool has_b = parse_duration(rest_, b);
+        if (has_a) {
+            lo = a;
+        }
+        if (has_b) {
+            hi = b;
+        }
+        return (has_a || has_b) && lo <= hi;
+    }
+
+    // A group tag: 1 to kMaxGroupTag of [A-Za-z0-9_.:-].
+    bool tag(std::string_view& out) {
+        std::size_t i = 0;
+        while (i < rest_.size() && i <= kMaxGroupTag && is_tag_char(rest_[i])) {
+            ++i;
+        }
+        if (i == 0 || i > kMaxGroupTag) {
+            return false;
+        }
+        out = rest_.substr(0, i);
+        rest_.remove_prefix(i);
+        return true;
+    }
+
+    bool duration(std::chrono::microseconds& out) { return parse_duration(rest_, out); }
+
+    // A run of characters up to the next whitespace; not empty.
+    bool word(std::string_view& out) {
+        std::size_t i = 0;
+        while (i < rest_.size() && !is_space(rest_[i])) {
+            ++i;
+        }
+        if (i == 0) {
+            return false;
+        }
+        out = rest_.substr(0, i);
+        rest_.remove_prefix(i);
+        return true;
+    }
+
+    // A duration followed by a blank.
+    bool delay(std::chrono::microseconds& out) {
+        return parse_duration(rest_, out) && !rest_.empty() &&
+               (rest_.front() == ' ' || rest_.front() == '\t');
+    }
+
+    // The message runs to the end of the line, minus trailing whitespace;
+    // anything after the newline must be whitespace.
+    bool message(std::string_view& out) {
+        const std::size_t end = std::min(rest_.find('\n'), rest_.size());
+        std::string_view text = rest_.substr(0, end);
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+            text.remove_suffix(1);
+        }
+        if (text.empty() || text.size() > kMaxMessage) {
+            return false;
+        }
+        rest_.remove_prefix(end);
+        out = text;
+        return true;
+    }
+
+    bool at_end() const {
+        for (char c : rest_) {
+            if (!is_trailing_space(c)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::string_view rest_;
+};
+
+// `every PERIOD [count=N|until=T]`, after the "every".
+bool parse_every(Cursor& in, Command& cmd) {
+    if (!in.skip_blanks() || !in.delay(cmd.delay) || cmd.delay.count() == 0) {
+        return false;
+    }
+    in.skip_blanks();
+    cmd.repeats = kRepeatForever;
+    unsigned long long count = 0;
+    std::chrono::microseconds until{0};
+    if (in.literal("count=")) {
+        if (!in.number(count, kRepeatForever) || count == 0) {
+            return false;
+        }
+        cmd.repeats = static_cast<std::uint32_t>(count - 1);
+    } else if (in.literal("until=")) {
+        if (!in.delay(until) || until < cmd.delay) {
+            return false;
+        }
+        cmd.repeats = static_cast<std::uint32_t>(
+            std::min<long long>((until - cmd.delay) / cmd.delay, kRepeatForever - 1));
+    } else {
+        return true;
+    }
+    return in.skip_blanks();
+}
+
+// The delay or `every` schedule and the message, after the "):".
+bool parse_schedule(Cursor& in, Command& cmd) {
+    in.skip_blanks();
+    if (in.literal("every")) {
+        if (!parse_every(in, cmd)) {
+            return false;
+        }
+    } else if (!in.delay(cmd.delay)) {
+        return false;
+    }
+    in.skip_blanks();
+    if (in.literal("group=") && !(in.tag(cmd.group) && in.skip_blanks())) {
+        return false;
+    }
+    return in.message(cmd.message) && in.at_end();
+}
+
+bool parse_timed(Cursor& in, Command& cmd) {
+    return in.id(cmd.id) && in.literal("):") && parse_schedule(in, cmd);
+}
+
+bool parse_cancel(Cursor& in, Command& cmd) {
+    return in.id(cmd.id) && in.literal(")") && in.at_end();
+}
+
+bool parse_ids(Cursor& in, Command& cmd) {
+    in.skip_blanks();
+    const char* begin = in.position();
+    if (!in.id_list([&cmd](int lo, int hi) { cmd.id_count += IdRange{lo, hi}.size(); })) {
+        return false;
+    }
+    cmd.ids = std::string_view(begin, static_cast<std::size_t>(in.position() - begin));
+    in.skip_blanks();
+    return true;
+}
+
+bool parse_bulk_start(Cursor& in, Command& cmd) {
+    return parse_ids(in, cmd) && cmd.id_count <= kMaxBulkStart && in.literal("):") &&
+           parse_schedule(in, cmd);
+}
+
+bool parse_bulk_cancel(Cursor& in, Command& cmd) {
+    return parse_ids(in, cmd) && in.literal(")") && in.at_end();
+}
+
+bool parse_group_cancel(Cursor& in, Command& cmd) {
+    in.skip_blanks();
+    if (!in.tag(cmd.group)) {
+        return false;
+    }
+    in.skip_blanks();
+    return in.literal(")") && in.at_end();
+}
+
+// `(TAG): [+|-]DELTA`, after the "(".
+bool parse_group_change(Cursor& in, Command& cmd) {
+    in.skip_blanks();
+    if (!in.tag(cmd.group)) {
+        return false;
+    }
+    in.skip_blanks();
+    if (!in.literal("):")) {
+        return false;
+    }
+    in.skip_blanks();
+    const bool sooner = in.literal("-");
+    if (!sooner) {
+        in.literal("+");
+    }
+    if (!in.duration(cmd.delay) || !in.at_end()) {
+        return false;
+    }
+    if (sooner) {
+        cmd.delay = -cmd.delay;
+    }
+    return true;
+}
+
+bool parse_view(Cursor& in, Command& cmd) {
+    ViewFilter& f = cmd.view;
+    for (;;) {
+        const bool separated = in.skip_blanks();
+        if (in.at_end()) {
+            return true;
+        }
+        if (!separated) {
+            return false;
+        }
+        unsigned long long n = 0;
+        bool ok;
+        if (in.literal("id=")) {
+            ok = in.id_range(f.id_min, f.id_max);
+        } else if (in.literal("due=")) {
+            ok = in.due_range(f.due_min, f.due_max);
+        } else if (in.literal("offset=")) {
+            ok = in.number(n, std::numeric_limits<std::size_t>::max());
+            f.offset = static_cast<std::size_t>(n);
+        } else if (in.literal("limit=")) {
+            ok = in.number(n, std::numeric_limits<std::size_t>::max());
+            f.limit = static_cast<std::size_t>(n);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+}
+
+// An `overflow=` value, compared in place rather than through
+// parse_overflow_policy so the line is not copied.
+bool parse_overflow(std::string_view name, ConfigChange& c) {
+    for (OverflowPolicy policy :
+         {OverflowPolicy::Block, OverflowPolicy::Shed, OverflowPolicy::Coalesce}) {
+        if (name == overflow_policy_name(policy)) {
+            c.display_overflow = policy;
+            return true;
+        }
+    }
+    return false;
+}
+
+// A `trace=` value.
+bool parse_trace(Cursor& in, ConfigChange& c) {
+    if (in.literal("on")) {
+        c.tracing = true;
+    } else if (in.literal("off")) {
+        c.tracing = false;
+    } else if (in.literal("clear")) {
+        c.clear_trace = true;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parse_config(Cursor& in, Command& cmd) {
+    ConfigChange& c = cmd.config;
+    for (;;) {
+        const bool separated = in.skip_blanks();
+        if (in.at_end()) {
+            return !c.empty();
+        }
+        if (!separated) {
+            return false;
+        }
+        unsigned long long n = 0;
+        std::chrono::microseconds t{0};
+        std::string_view word;
+        bool ok;
+        if (in.literal("display=")) {
+            ok = in.number(n, kMaxDisplayThreads) && n != 0;
+            c.display_threads = static_cast<int>(n);
+        } else if (in.literal("capacity=")) {
+            ok = in.number(n, std::numeric_limits<std::size_t>::max());
+            c.display_capacity = static_cast<std::size_t>(n);
+        } else if (in.literal("overflow=")) {
+            ok = in.word(word) && parse_overflow(word, c);
+        } else if (in.literal("slack=")) {
+            ok = in.duration(t);
+            c.expiry_slack = t;
+        } else if (in.literal("flush=")) {
+            ok = in.duration(t);
+            c.flush_latency = t;
+        } else if (in.literal("trace=")) {
+            ok = parse_trace(in, c);
+        } else if (in.literal("dump=")) {
+            ok = in.word(c.dump);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+}
+
+}  // namespace
+
+bool parse_command(std::string_view line, Command& cmd) {
+    cmd = Command{};
+    Cursor in(line);
+    in.skip_space();
+
+    bool ok = false;
+    if (in.literal("Start_Alarm(")) {
+        cmd.type = CommandType::StartAlarm;
+        ok = parse_timed(in, cmd);
+    } else if (in.literal("Change_Alarm(")) {
+        cmd.type = CommandType::ChangeAlarm;
+        ok = parse_timed(in, cmd);
+    } else if (in.literal("Cancel_Alarm(")) {
+        cmd.type = CommandType::CancelAlarm;
+        ok = parse_cancel(in, cmd);
+    } else if (in.literal("Start_Alarms(")) {
+        cmd.type = CommandType::StartAlarms;
+        ok = parse_bulk_start(in, cmd);
+    } else if (in.literal("Cancel_Alarms(")) {
+        cmd.type = CommandType::CancelAlarms;
+        ok = parse_bulk_cancel(in, cmd);
+    } else if (in.literal("Cancel_Group(")) {
+        cmd.type = CommandType::CancelGroup;
+        ok = parse_group_cancel(in, cmd);
+    } else if (in.literal("Change_Group(")) {
+        cmd.type = CommandType::ChangeGroup;
+        ok = parse_group_change(in, cmd);
+    } else if (in.literal("View_Alarms")) {
+        cmd.type = CommandType::ViewAlarms;
+        ok = parse_view(in, cmd);
+    } else if (in.literal("Stats")) {
+        cmd.type = CommandType::Stats;
+        in.skip_blanks();
+        ok = in.at_end();
+    } else if (in.literal("Config")) {
+        cmd.type = CommandType::Config;
+        ok = parse_config(in, cmd);
+    }
+    if (!ok) {
+        cmd = Command{};
+    }
+    return ok;
+}
+
+std::vector<IdRange> id_ranges(std::string_view ids) {
+    std::vector<IdRange> ranges;
+    Cursor in(ids);
+    in.id_list([&ranges](int lo, int hi) { ranges.push_back({lo, hi}); });
+    return ranges;
+}
+
+const char* command_name(CommandType type) {
+    switch (type) {
+        case CommandType::StartAlarm: return "Start_Alarm";
+        case CommandType::ChangeAlarm: return "Change_Alarm";
+        case CommandType::CancelAlarm: return "Cancel_Alarm";
+        case CommandType::StartAlarms: return "Start_Alarms";
+        case CommandType::CancelAlarms: return "Cancel_Alarms";
+        case CommandType::CancelGroup: return "Cancel_Group";
+        case CommandType::ChangeGroup: return "Change_Group";
+        case CommandType::ViewAlarms: return "View_Alarms";
+        case CommandType::Stats: return "Stats";
+        case CommandType::Config: return "Config";
+        case CommandType::Invalid: break;
+    }
+    return "Invalid";
+}
+
+}  // namespace alarmd
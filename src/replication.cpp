@@ -0,0 +1,602 @@
+#include "alarmd/replication.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "alarmd/log_format.hpp"
+
+namespace alarmd {
+
+namespace {
+
+// The stream is a sequence of frames: this header, then `size` bytes.
+//
+//   Hello    kStreamMagic, once per connection
+//   Dump     Start records, part of a dump of every live alarm
+//   DumpEnd  the dump's record count, as a uint64
+//   Records  records the leader committed, in commit order
+struct FrameHeader {
+    std::uint32_t size;
+    std::uint8_t type;
+    std::uint8_t unused[3];
+};
+static_assert(sizeof(FrameHeader) == 8);
+
+enum FrameType : std::uint8_t { kHello = 1, kDump, kDumpEnd, kRecords };
+
+constexpr char kStreamMagic[8] = {'A', 'L', 'R', 'M', 'R', 'E', 'P', '1'};
+
+// Frames carry whole records and are cut once they pass kFrameChunk.
+constexpr std::size_t kFrameChunk = 1 << 20;
+constexpr std::size_t kMaxFrame = kFrameChunk + kMaxRecord;
+
+constexpr int kConnectTimeoutMs = 1000;
+
+// Appends a header for a frame whose payload follows; seal_frame() fills in
+// its size once the payload is in.
+std::size_t open_frame(std::string& buf, FrameType type) {
+    const std::size_t at = buf.size();
+    FrameHeader h{};
+    h.type = type;
+    buf.append(reinterpret_cast<const char*>(&h), sizeof h);
+    return at;
+}
+
+void seal_frame(std::string& buf, std::size_t at) {
+    const auto size = static_cast<std::uint32_t>(buf.size() - at - sizeof(FrameHeader));
+    std::memcpy(buf.data() + at, &size, sizeof size);
+}
+
+std::size_t record_size(const char* p) {
+    RecordHeader h;
+    std::memcpy(&h, p, sizeof h);
+    return sizeof h + h.size + h.group_size;
+}
+
+bool send_all(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool peer_closed(int fd) {
+    char byte;
+    const ssize_t n = recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR);
+}
+
+bool recv_all(int fd, char* data, std::size_t size) {
+    while (size > 0) {
+        const ssize_t n = recv(fd, data, size, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool read_frame(int fd, FrameHeader& h, std::string& payload) {
+    if (!recv_all(fd, reinterpret_cast<char*>(&h), sizeof h) || h.size > kMaxFrame) {
+        return false;
+    }
+    payload.resize(h.size);
+    return recv_all(fd, payload.data(), payload.size());
+}
+
+// True if `payload` is whole, valid records; counts them.
+bool valid_records(const std::string& payload, std::uint64_t& count) {
+    const char* p = payload.data();
+    const char* end = p + payload.size();
+    LogRecord r;
+    count = 0;
+    while (p != end) {
+        if (!decode_record(p, end, r)) {
+            return false;
+        }
+        ++count;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool parse_host_port(std::string_view text, std::string& host, int& port) {
+    const std::size_t colon = text.rfind(':');
+    if (colon == std::string_view::npos) {
+        return false;
+    }
+    host = std::string(text.substr(0, colon));
+    const std::string_view digits = text.substr(colon + 1);
+    const auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), port);
+    in_addr addr;
+    return ec == std::errc() && end == digits.data() + digits.size() && port > 0 &&
+           port < 65536 && inet_pton(AF_INET, host.c_str(), &addr) == 1;
+}
+
+LogShipper::LogShipper(ShipOptions options, StateFn state)
+    : options_(std::move(options)), state_(std::move(state)) {
+    if (!parse_host_port(options_.address, host_, port_)) {
+        throw std::invalid_argument("replica address must be IPV4:PORT: " + options_.address);
+    }
+}
+
+LogShipper::~LogShipper() { close(); }
+
+void LogShipper::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable()) {
+        return;
+    }
+    stopping_ = false;
+    dumps_closed_ = false;
+    finished_ = false;
+    thread_ = std::thread(&LogShipper::ship_main, this);
+}
+
+void LogShipper::ship(std::string_view records) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!streaming_) {
+        return;  // the next dump covers them
+    }
+    if (queue_.size() + records.size() > options_.max_backlog) {
+        // The follower fell too far behind: drop the backlog and send it a
+        // fresh dump rather than hold the records.
+        streaming_ = false;
+        std::string().swap(queue_);
+        cond_.notify_one();
+        return;
+    }
+    const bool was_empty = queue_.empty();
+    while (!records.empty()) {
+        std::size_t n = 0;
+        while (n < records.size() && n < kFrameChunk) {
+            n += record_size(records.data() + n);
+        }
+        const std::size_t at = open_frame(queue_, kRecords);
+        queue_.append(records.substr(0, n));
+        seal_frame(queue_, at);
+        records.remove_prefix(n);
+    }
+    if (was_empty) {
+        cond_.notify_one();
+    }
+}
+
+void LogShipper::finish_dumps() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    dumps_closed_ = true;
+    cond_.notify_one();
+    // A dump to a follower that stopped reading would otherwise hold up
+    // shutdown.
+    const Deadline give_up = monotonic_now() + 1'000'000;
+    while (dumping_ && done_cond_.wait_until(lock, give_up)) {
+    }
+    if (dumping_ && fd_ >= 0) {
+        shutdown(fd_, SHUT_RDWR);
+    }
+    while (dumping_) {
+        done_cond_.wait(lock);
+    }
+}
+
+void LogShipper::close() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!thread_.joinable()) {
+            return;
+        }
+        stopping_ = true;
+        dumps_closed_ = true;
+        cond_.notify_one();
+        const Deadline give_up = monotonic_now() + 1'000'000;
+        while (!finished_ && done_cond_.wait_until(lock, give_up)) {
+        }
+        if (!finished_ && fd_ >= 0) {
+            shutdown(fd_, SHUT_RDWR);  // unblocks a send the follower is not reading
+        }
+    }
+    thread_.join();
+}
+
+ShipStats LogShipper::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ShipStats stats = stats_;
+    stats.backlog = queue_.size();
+    return stats;
+}
+
+void LogShipper::ship_main() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (dumps_closed_) {
+            cond_.wait(lock);  // no dump can start a connection until the next start()
+            continue;
+        }
+        lock.unlock();
+        const int fd = connect_follower();
+        lock.lock();
+        if (fd < 0) {
+            if (!stopping_) {
+                cond_.wait_until(lock, monotonic_now() + options_.retry.count() * 1000);
+            }
+            continue;
+        }
+        fd_ = fd;
+        stats_.connected = true;
+        lock.unlock();
+        while (dump(fd) && stream(fd)) {
+        }
+        lock.lock();
+        fd_ = -1;
+        stats_.connected = false;
+        streaming_ = false;
+        queue_.clear();
+        ::close(fd);
+    }
+    finished_ = true;
+    done_cond_.notify_all();
+}
+
+int LogShipper::connect_follower() {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<std::uint16_t>(port_));
+    inet_pton(AF_INET, host_.c_str(), &addr.sin_addr);
+    // Non-blocking only for the connect, so an unreachable follower costs a
+    // bounded wait rather than the kernel's SYN timeout.
+    int error = 0;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) {
+        error = errno;
+        if (error == EINPROGRESS) {
+            pollfd p{fd, POLLOUT, 0};
+            socklen_t len = sizeof error;
+            error = poll(&p, 1, kConnectTimeoutMs) != 1 ? ETIMEDOUT
+                    : getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 ? errno
+                                                                                : error;
+        }
+    }
+    std::string hello;
+    const std::size_t at = open_frame(hello, kHello);
+    hello.append(kStreamMagic, sizeof kStreamMagic);
+    seal_frame(hello, at);
+    if (error != 0 || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK) != 0 ||
+        !send_all(fd, hello.data(), hello.size())) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool LogShipper::dump(int fd) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (dumps_closed_) {
+            return false;
+        }
+        // From here on every commit is queued, so whatever the state
+        // callback misses follows the dump.
+        queue_.clear();
+        streaming_ = true;
+        dumping_ = true;
+        since_dump_ = 0;
+    }
+    std::string buf;
+    buf.reserve(sizeof(FrameHeader) + kFrameChunk + kMaxRecord);
+    std::size_t at = open_frame(buf, kDump);
+    std::uint64_t count = 0;
+    std::uint64_t sent = 0;
+    bool ok = true;
+    const auto flush = [&] {
+        seal_frame(buf, at);
+        ok = ok && send_all(fd, buf.data(), buf.size());
+        sent += buf.size();
+        buf.clear();
+        at = open_frame(buf, kDump);
+    };
+    const std::int64_t offset = wall_offset();
+    state_([&](const AlarmView& a) {
+        if (!ok) {
+            return;
+        }
+        const std::size_t used = buf.size();
+        buf.resize(used + kMaxRecord);
+        buf.resize(used + encode_record(buf.data() + used, LogKind::Start, a.id, a.repeats,
+                                        a.seq, a.deadline + offset, a.delay.count(),
+                                        a.message.view(), a.group.view()));
+        ++count;
+        if (buf.size() - at - sizeof(FrameHeader) >= kFrameChunk) {
+            flush();
+        }
+    });
+    if (buf.size() > sizeof(FrameHeader)) {
+        flush();
+    }
+    buf.clear();
+    at = open_frame(buf, kDumpEnd);
+    buf.append(reinterpret_cast<const char*>(&count), sizeof count);
+    seal_frame(buf, at);
+    ok = ok && send_all(fd, buf.data(), buf.size());
+    sent += buf.size();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    dumping_ = false;
+    stats_.bytes += sent;
+    stats_.dumps += ok ? 1 : 0;
+    done_cond_.notify_all();
+    return ok;
+}
+
+bool LogShipper::stream(int fd) {
+    std::string batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        const auto redump = [this] {
+            return !dumps_closed_ && options_.dump_bytes > 0 && since_dump_ >= options_.dump_bytes;
+        };
+        while (queue_.empty() && streaming_ && !stopping_ && !redump()) {
+            // The follower never writes, so a readable socket means it has
+            // gone; notice that while idle rather than at the next send.
+            if (!cond_.wait_until(lock, monotonic_now() + options_.retry.count() * 1000) &&
+                peer_closed(fd)) {
+                return false;
+            }
+        }
+        if (!streaming_) {
+            return !dumps_closed_;  // the backlog overflowed
+        }
+        if (redump()) {
+            return true;  // the dump clears the queue: its records are in the state
+        }
+        if (queue_.empty()) {
+            return false;  // stopping, and everything is sent
+        }
+        batch.swap(queue_);
+        lock.unlock();
+        const bool ok = send_all(fd, batch.data(), batch.size());
+        lock.lock();
+        if (!ok) {
+            return false;
+        }
+        stats_.bytes += batch.size();
+        since_dump_ += batch.size();
+        batch.clear();
+    }
+}
+
+struct LogReplica::Session {
+    int snapshot_fd = -1;       // snapshot.tmp while a dump arrives
+    std::uint64_t dumped = 0;   // its records so far
+    int log_fd = -1;            // the generation records go to, once dumped
+    std::uint64_t generation = 0;
+};
+
+LogReplica::LogReplica(ReplicaOptions options) : options_(std::move(options)) {
+    if (options_.dir.empty()) {
+        throw std::invalid_argument("log replica needs a directory");
+    }
+    if (mkdir(options_.dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::system_error(errno, std::generic_category(), options_.dir);
+    }
+    dir_fd_ = ::open(options_.dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), options_.dir);
+    }
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<std::uint16_t>(options_.port));
+    socklen_t len = sizeof addr;
+    const int one = 1;
+    if (listen_fd_ < 0 ||
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one) != 0 ||
+        inet_pton(AF_INET, options_.address.c_str(), &addr.sin_addr) != 1 ||
+        bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0 ||
+        listen(listen_fd_, 4) != 0 ||
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        const int error = errno != 0 ? errno : EINVAL;
+        if (listen_fd_ >= 0) {
+            ::close(listen_fd_);
+        }
+        ::close(dir_fd_);
+        throw std::system_error(error, std::generic_category(), "log replica listen");
+    }
+    port_ = ntohs(addr.sin_port);
+}
+
+LogReplica::~LogReplica() {
+    stop();
+    ::close(listen_fd_);
+    ::close(dir_fd_);
+}
+
+void LogReplica::start() {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = std::thread(&LogReplica::serve_main, this);
+}
+
+void LogReplica::stop() {
+    if (!running_) {
+        return;
+    }
+    stopping_.store(true, std::memory_order_relaxed);
+    shutdown(listen_fd_, SHUT_RDWR);  // wakes accept()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (conn_fd_ >= 0) {
+            shutdown(conn_fd_, SHUT_RDWR);
+        }
+    }
+    thread_.join();
+    running_ = false;
+}
+
+ReplicaStats LogReplica::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void LogReplica::serve_main() {
+    while (!stopping_.load(std::memory_order_relaxed)) {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;  // shut down by stop()
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_.load(std::memory_order_relaxed)) {
+                ::close(fd);
+                break;
+            }
+            conn_fd_ = fd;
+            stats_.connected = true;
+        }
+        try {
+            serve(fd);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "log replica: %s\n", e.what());
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        conn_fd_ = -1;
+        stats_.connected = false;
+        ::close(fd);
+    }
+}
+
+void LogReplica::serve(int fd) {
+    Session s;
+    FrameHeader h;
+    std::string payload;
+    const std::string tmp = options_.dir + "/snapshot.tmp";
+    bool ok = read_frame(fd, h, payload) && h.type == kHello &&
+              payload == std::string_view(kStreamMagic, sizeof kStreamMagic);
+    while (ok && read_frame(fd, h, payload)) {
+        std::uint64_t count = 0;
+        switch (h.type) {
+            case kDump:
+                if (s.snapshot_fd < 0) {
+                    s.snapshot_fd =
+                        ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                    const SnapshotHeader placeholder{};
+                    ok = s.snapshot_fd >= 0 &&
+                         write_all(s.snapshot_fd, reinterpret_cast<const char*>(&placeholder),
+                                   sizeof placeholder);
+                }
+                ok = ok && valid_records(payload, count) &&
+                     write_all(s.snapshot_fd, payload.data(), payload.size());
+                s.dumped += count;
+                break;
+            case kDumpEnd:
+                ok = payload.size() == sizeof count;
+                if (ok) {
+                    std::memcpy(&count, payload.data(), sizeof count);
+                    ok = count == s.dumped && install_dump(s);
+                }
+                break;
+            case kRecords:
+                ok = s.log_fd >= 0 && valid_records(payload, count) &&
+                     write_all(s.log_fd, payload.data(), payload.size()) &&
+                     fdatasync(s.log_fd) == 0;
+                if (ok) {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    stats_.records += count;
+                }
+                break;
+            default:
+                ok = false;
+        }
+    }
+    // A dump cut short leaves the previous snapshot and log in place.
+    if (s.snapshot_fd >= 0) {
+        ::close(s.snapshot_fd);
+        unlink(tmp.c_str());
+    }
+    if (s.log_fd >= 0) {
+        ::close(s.log_fd);
+    }
+}
+
+bool LogReplica::install_dump(Session& s) {
+    const std::string tmp = options_.dir + "/snapshot.tmp";
+    if (s.snapshot_fd < 0) {  // an empty dump
+        s.snapshot_fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (s.snapshot_fd < 0) {
+            return false;
+        }
+    }
+    const std::vector<std::uint64_t> logs = list_logs(options_.dir);
+    const std::uint64_t generation = std::max(logs.empty() ? 0 : logs.back(), s.generation) + 1;
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof header.magic);
+    header.version = kSnapshotVersion;
+    header.count = s.dumped;
+    header.generation = generation;
+    const bool written =
+        pwrite(s.snapshot_fd, &header, sizeof header, 0) == static_cast<ssize_t>(sizeof header) &&
+        fsync(s.snapshot_fd) == 0;
+    ::close(s.snapshot_fd);
+    s.snapshot_fd = -1;
+    // The new generation exists before the snapshot pointing at it, so a
+    // crash in between leaves the old snapshot with an empty log after it.
+    const int log_fd = written ? create_log(options_.dir, dir_fd_, generation) : -1;
+    if (log_fd < 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    if (rename(tmp.c_str(), (options_.dir + "/snapshot").c_str()) != 0 || fsync(dir_fd_) != 0) {
+        ::close(log_fd);
+        return false;
+    }
+    for (const std::uint64_t old : logs) {
+        unlink((options_.dir + "/" + log_name(old)).c_str());
+    }
+    fsync(dir_fd_);
+    if (s.log_fd >= 0) {
+        ::close(s.log_fd);
+    }
+    s.log_fd = log_fd;
+    s.generation = generation;
+    s.dumped = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.dumps;
+    return true;
+}
+
+}  // namespace alarmd
@@ -0,0 +1,160 @@
+#include "alarmd/row_scan.hpp"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace alarmd {
+
+namespace {
+
+bool matches(std::uint32_t offset, int id, std::uint32_t delay, const RowFilter& f) {
+    return offset >= f.offset_lo && offset <= f.offset_hi && id >= f.id_lo && id <= f.id_hi &&
+           delay != f.dead;
+}
+
+// Rows [first, rows); the vector kernels finish their tails here.
+std::size_t scan_from(std::size_t first, const std::uint32_t* offset, const int* id,
+                      const std::uint32_t* delay, std::size_t rows, const RowFilter& filter,
+                      std::uint32_t* out) {
+    std::size_t n = 0;
+    for (std::size_t row = first; row < rows; ++row) {
+        // Branch-free: most scans keep few rows, so a store per row beats
+        // a mispredicted branch per kept one.
+        out[n] = static_cast<std::uint32_t>(row);
+        n += matches(offset[row], id[row], delay[row], filter) ? 1 : 0;
+    }
+    return n;
+}
+
+std::size_t scan_scalar(const std::uint32_t* offset, const int* id, const std::uint32_t* delay,
+                        std::size_t rows, const RowFilter& filter, std::uint32_t* out) {
+    return scan_from(0, offset, id, delay, rows, filter, out);
+}
+
+// Turns a lane mask into row indices, lowest lane first.
+std::size_t emit(unsigned mask, std::size_t base, std::uint32_t* out) {
+    std::size_t n = 0;
+    for (; mask != 0; mask &= mask - 1) {
+        out[n++] = static_cast<std::uint32_t>(base + __builtin_ctz(mask));
+    }
+    return n;
+}
+
+#if defined(__x86_64__)
+
+// AVX2 has only signed compares; flipping the top bit orders unsigned
+// offsets the same way as signed ones.
+__attribute__((target("avx2"))) std::size_t scan_avx2(const std::uint32_t* offset,
+                                                      const int* id, const std::uint32_t* delay,
+                                                      std::size_t rows, const RowFilter& filter,
+                                                      std::uint32_t* out) {
+    const __m256i bias = _mm256_set1_epi32(static_cast<int>(0x80000000u));
+    const __m256i off_lo = _mm256_set1_epi32(static_cast<int>(filter.offset_lo ^ 0x80000000u));
+    const __m256i off_hi = _mm256_set1_epi32(static_cast<int>(filter.offset_hi ^ 0x80000000u));
+    const __m256i id_lo = _mm256_set1_epi32(filter.id_lo);
+    const __m256i id_hi = _mm256_set1_epi32(filter.id_hi);
+    const __m256i dead = _mm256_set1_epi32(static_cast<int>(filter.dead));
+    std::size_t n = 0;
+    std::size_t row = 0;
+    for (; row + 8 <= rows; row += 8) {
+        const __m256i o = _mm256_xor_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offset + row)), bias);
+        const __m256i i = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(id + row));
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(delay + row));
+        // Lanes that fail any bound.
+        __m256i reject =
+            _mm256_or_si256(_mm256_cmpgt_epi32(off_lo, o), _mm256_cmpgt_epi32(o, off_hi));
+        reject = _mm256_or_si256(reject, _mm256_cmpgt_epi32(id_lo, i));
+        reject = _mm256_or_si256(reject, _mm256_cmpgt_epi32(i, id_hi));
+        reject = _mm256_or_si256(reject, _mm256_cmpeq_epi32(d, dead));
+        const auto mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(reject)));
+        n += emit(~mask & 0xFF, row, out + n);
+    }
+    return n + scan_from(row, offset, id, delay, rows, filter, out + n);
+}
+
+#elif defined(__aarch64__)
+
+std::size_t scan_neon(const std::uint32_t* offset, const int* id, const std::uint32_t* delay,
+                      std::size_t rows, const RowFilter& filter, std::uint32_t* out) {
+    const uint32x4_t off_lo = vdupq_n_u32(filter.offset_lo);
+    const uint32x4_t off_hi = vdupq_n_u32(filter.offset_hi);
+    const int32x4_t id_lo = vdupq_n_s32(filter.id_lo);
+    const int32x4_t id_hi = vdupq_n_s32(filter.id_hi);
+    const uint32x4_t dead = vdupq_n_u32(filter.dead);
+    const uint32x4_t lane_bits = {1, 2, 4, 8};
+    std::size_t n = 0;
+    std::size_t row = 0;
+    for (; row + 4 <= rows; row += 4) {
+        const uint32x4_t o = vld1q_u32(offset + row);
+        const int32x4_t i = vld1q_s32(id + row);
+        const uint32x4_t d = vld1q_u32(delay + row);
+        uint32x4_t keep = vandq_u32(vcgeq_u32(o, off_lo), vcleq_u32(o, off_hi));
+        keep = vandq_u32(keep, vandq_u32(vcgeq_s32(i, id_lo), vcleq_s32(i, id_hi)));
+        keep = vbicq_u32(keep, vceqq_u32(d, dead));
+        n += emit(vaddvq_u32(vandq_u32(keep, lane_bits)), row, out + n);
+    }
+    return n + scan_from(row, offset, id, delay, rows, filter, out + n);
+}
+
+#endif
+
+}  // namespace
+
+const char* scan_isa_name(ScanIsa isa) {
+    switch (isa) {
+    case ScanIsa::Scalar:
+        return "scalar";
+    case ScanIsa::Avx2:
+        return "avx2";
+    case ScanIsa::Neon:
+        return "neon";
+    }
+    return "?";
+}
+
+RowScanFn row_scan_kernel(ScanIsa isa) {
+    switch (isa) {
+    case ScanIsa::Scalar:
+        return scan_scalar;
+    case ScanIsa::Avx2:
+#if defined(__x86_64__)
+        return __builtin_cpu_supports("avx2") ? scan_avx2 : nullptr;
+#else
+        return nullptr;
+#endif
+    case ScanIsa::Neon:
+#if defined(__aarch64__)
+        return scan_neon;  // Advanced SIMD is part of every AArch64 core
+#else
+        return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+std::vector<ScanIsa> supported_scan_isas() {
+    std::vector<ScanIsa> isas;
+    for (ScanIsa isa : {ScanIsa::Scalar, ScanIsa::Avx2, ScanIsa::Neon}) {
+        if (row_scan_kernel(isa) != nullptr) {
+            isas.push_back(isa);
+        }
+    }
+    return isas;
+}
+
+ScanIsa scan_isa() {
+    static const ScanIsa isa = supported_scan_isas().back();
+    return isa;
+}
+
+std::size_t scan_rows(const std::uint32_t* offset, const int* id, const std::uint32_t* delay,
+                      std::size_t rows, const RowFilter& filter, std::uint32_t* out) {
+    static const RowScanFn kernel = row_scan_kernel(scan_isa());
+    return kernel(offset, id, delay, rows, filter, out);
+}
+
+}  // namespace alarmd
@@ -0,0 +1,697 @@
+#include "alarmd/scheduler.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <limits>
+#include <string>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "alarmd/cpu_affinity.hpp"
+#include "alarmd/latency_stats.hpp"
+#include "alarmd/trace.hpp"
+
+namespace alarmd {
+
+namespace {
+
+std::size_t finish_line(int n, char* buf) {
+    // Messages are at most kMaxMessage bytes, so a line only overflows if a
+    // caller passes a shorter buffer; keep it terminated either way.
+    std::size_t len = n < 0 ? 0 : std::min(static_cast<std::size_t>(n), kMaxLine - 2);
+    buf[len++] = '\n';
+    buf[len] = '\0';
+    return len;
+}
+
+// "30" for a one-shot alarm, "every 30" or "every 30 count=5" for a
+// periodic one, as the commands spell it; the count includes the next fire.
+const char* format_schedule(std::chrono::microseconds delay, std::uint32_t repeats, char* buf,
+                            std::size_t size) {
+    char period[32];
+    format_duration(delay, period, sizeof period);
+    if (repeats == 0) {
+        std::snprintf(buf, size, "%s", period);
+    } else if (repeats == kRepeatForever) {
+        std::snprintf(buf, size, "every %s", period);
+    } else {
+        std::snprintf(buf, size, "every %s count=%llu", period,
+                      static_cast<unsigned long long>(repeats) + 1);
+    }
+    return buf;
+}
+
+}  // namespace
+
+std::size_t format_fired(const FiredAlarm& alarm, int worker, long now, char* buf) {
+    char delay[32];
+    char folded[32] = "";
+    if (alarm.coalesced != 0) {
+        std::snprintf(folded, sizeof folded, " (+%u coalesced)", alarm.coalesced);
+    }
+    return finish_line(std::snprintf(buf, kMaxLine - 1,
+                                     "Alarm(%d) Printed by Display Thread %d at %ld: %s %s%s",
+                                     alarm.id, worker, now,
+                                     format_duration(alarm.delay, delay, sizeof delay),
+                                     alarm.message.c_str(), folded),
+                       buf);
+}
+
+std::size_t format_result(const RequestResult& r, long now, char* buf) {
+    const int len = static_cast<int>(r.message.size());
+    char delay[64];
+    format_schedule(r.delay, r.repeats, delay, sizeof delay);
+    int n;
+    if (!r.ok) {
+        n = std::snprintf(buf, kMaxLine - 1,
+                          r.kind == RequestKind::Start ? "Alarm(%d) already exists"
+                                                       : "Alarm(%d) not found",
+                          r.id);
+    } else if (r.kind == RequestKind::Start) {
+        n = std::snprintf(buf, kMaxLine - 1, "Alarm(%d) Inserted into Alarm List at %ld: %s %.*s",
+                          r.id, now, delay, len, r.message.data());
+    } else if (r.kind == RequestKind::Change) {
+        n = std::snprintf(buf, kMaxLine - 1, "Alarm(%d) Changed at %ld: %s %.*s", r.id, now, delay,
+                          len, r.message.data());
+    } else {
+        n = std::snprintf(buf, kMaxLine - 1, "Alarm(%d) Cancelled at %ld", r.id, now);
+    }
+    return finish_line(n, buf);
+}
+
+std::size_t format_bulk_result(const BulkResult& r, long now, char* buf) {
+    constexpr std::size_t kMaxIds = 64;
+    const int ids_len = static_cast<int>(std::min(r.ids.size(), kMaxIds));
+    const char* more = r.ids.size() > kMaxIds ? "..." : "";
+    const auto applied = static_cast<unsigned long long>(r.applied);
+    const auto requested = static_cast<unsigned long long>(r.requested);
+    int n;
+    if (r.group) {
+        char delta[32];
+        format_duration(std::chrono::abs(r.delay), delta, sizeof delta);
+        n = r.kind == RequestKind::Cancel
+                ? std::snprintf(buf, kMaxLine - 1, "Group(%.*s) %llu Cancelled at %ld", ids_len,
+                                r.ids.data(), applied, now)
+                : std::snprintf(buf, kMaxLine - 1, "Group(%.*s) %llu Changed at %ld: %c%s",
+                                ids_len, r.ids.data(), applied, now,
+                                r.delay.count() < 0 ? '-' : '+', delta);
+    } else if (r.kind == RequestKind::Start) {
+        char delay[64];
+        format_schedule(r.delay, r.repeats, delay, sizeof delay);
+        n = std::snprintf(buf, kMaxLine - 1,
+                          "Alarms(%.*s%s) %llu of %llu Inserted into Alarm List at %ld: %s %.*s",
+                          ids_len, r.ids.data(), more, applied, requested, now, delay,
+                          static_cast<int>(r.message.size()), r.message.data());
+    } else {
+        n = std::snprintf(buf, kMaxLine - 1, "Alarms(%.*s%s) %llu of %llu Cancelled at %ld",
+                          ids_len, r.ids.data(), more, applied, requested, now);
+    }
+    return finish_line(n, buf);
+}
+
+Scheduler::Scheduler(SchedulerOptions options) : options_(options) {
+    if (options_.display_threads < 1 || options_.display_threads > kMaxDisplayThreads) {
+        throw std::invalid_argument("display_threads must be between 1 and " +
+                                    std::to_string(kMaxDisplayThreads));
+    }
+    if (options_.shards < 1) {
+        throw std::invalid_argument("shards must be at least 1");
+    }
+    if (options_.out == nullptr) {
+        throw std::invalid_argument("output stream must not be null");
+    }
+    if (options_.ring_capacity < 1) {
+        throw std::invalid_argument("ring_capacity must be at least 1");
+    }
+    if (options_.expiry_slack.count() < 0) {
+        throw std::invalid_argument("expiry_slack must not be negative");
+    }
+    if (options_.cold_horizon.count() < 0) {
+        throw std::invalid_argument("cold_horizon must not be negative");
+    }
+    check_cpus(options_.shard_cpus);
+    check_cpus(options_.display_cpus);
+    if (options_.batch_output && fileno(options_.out) < 0) {
+        throw std::invalid_argument("batch_output needs an output stream with a file descriptor");
+    }
+    if (options_.flush_latency.count() < 0) {
+        throw std::invalid_argument("flush_latency must not be negative");
+    }
+    if (!options_.replica.empty() && options_.data_dir.empty()) {
+        throw std::invalid_argument("replica needs a data_dir");
+    }
+    if (!options_.data_dir.empty()) {
+        store_ = std::make_unique<AlarmStore>(
+            StoreOptions{.dir = options_.data_dir,
+                         .slots = static_cast<std::size_t>(options_.shards),
+                         .commit_interval = options_.commit_interval,
+                         .checkpoint_bytes = options_.checkpoint_bytes,
+                         .replica = options_.replica},
+            [this](const std::function<void(const AlarmView&)>& emit) { collect(emit); });
+    }
+    ShardOptions shard_options{options_.queue, options_.ring_capacity, options_.expiry_slack,
+                               store_.get()};
+    shard_options.cold_horizon = options_.cold_horizon;
+    for (int i = 0; i < options_.shards; ++i) {
+        shard_options.store_slot = static_cast<std::size_t>(i);
+        if (!options_.shard_cpus.empty()) {
+            shard_options.cpu =
+                options_.shard_cpus[static_cast<std::size_t>(i) % options_.shard_cpus.size()];
+        }
+        Shard::ArmFn on_arm;
+        if (options_.on_arm) {
+            on_arm = [this, i](Deadline when) {
+                options_.on_arm(static_cast<std::size_t>(i), when);
+            };
+        }
+        shards_.push_back(std::make_unique<Shard>(
+            shard_options,
+            [this](std::vector<FiredAlarm>& batch) {
+                std::shared_lock<std::shared_mutex> swap(display_swap_);
+                display_->submit(batch);
+            },
+            options_.on_result, std::move(on_arm)));
+    }
+}
+
+Scheduler::~Scheduler() { stop(); }
+
+void Scheduler::start() {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (running_) {
+        return;
+    }
+    if (store_) {
+        recover();
+    }
+    running_ = true;
+    if (options_.batch_output) {
+        std::fflush(options_.out);  // whatever stdio holds goes first
+        writer_ = std::make_unique<OutputWriter>(
+            fileno(options_.out),
+            // A slot for every worker Config display=N can add, so a grown
+            // pool never shares slot 0 with command output.
+            OutputOptions{.slots = static_cast<std::size_t>(kMaxDisplayThreads) + 1,
+                          .flush_latency = options_.flush_latency,
+                          .backend = options_.output_backend});
+    }
+    display_ = make_display();
+    for (auto& shard : shards_) {
+        shard->start();
+    }
+}
+
+std::unique_ptr<DisplayPool> Scheduler::make_display() {
+    return std::make_unique<DisplayPool>(
+        options_.display_threads,
+        [this](int worker, std::vector<FiredAlarm>& chunk) { print(worker, chunk); },
+        DisplayOptions{options_.display_capacity, options_.display_overflow,
+                       options_.display_cpus});
+}
+
+void Scheduler::replace_display() {
+    std::unique_ptr<DisplayPool> old = make_display();
+    {
+        std::unique_lock<std::shared_mutex> swap(display_swap_);
+        display_.swap(old);
+    }
+    // Nothing submits to the old pool any more, so its shed, coalesced and
+    // blocked counts are final; steals it makes while draining go uncounted.
+    const DisplayStats d = old->stats();
+    retired_display_.shed += d.shed;
+    retired_display_.coalesced += d.coalesced;
+    retired_display_.blocked += d.blocked;
+    retired_steals_ += old->steals();
+    old.reset();  // prints what the old pool holds, then joins its workers
+}
+
+void Scheduler::configure(const ConfigChange& change) {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (change.display_threads &&
+        (*change.display_threads < 1 || *change.display_threads > kMaxDisplayThreads)) {
+        throw std::invalid_argument("display_threads must be between 1 and " +
+                                    std::to_string(kMaxDisplayThreads));
+    }
+    if (change.expiry_slack && change.expiry_slack->count() < 0) {
+        throw std::invalid_argument("expiry_slack must not be negative");
+    }
+    if (change.flush_latency && change.flush_latency->count() < 0) {
+        throw std::invalid_argument("flush_latency must not be negative");
+    }
+    if (change.expiry_slack) {
+        options_.expiry_slack = *change.expiry_slack;
+        for (auto& shard : shards_) {
+            shard->set_expiry_slack(options_.expiry_slack);
+        }
+    }
+    if (change.flush_latency) {
+        options_.flush_latency = *change.flush_latency;
+        if (writer_) {
+            writer_->set_flush_latency(options_.flush_latency);
+        }
+    }
+    if (change.display_threads || change.display_capacity || change.display_overflow) {
+        options_.display_threads = change.display_threads.value_or(options_.display_threads);
+        options_.display_capacity = change.display_capacity.value_or(options_.display_capacity);
+        options_.display_overflow = change.display_overflow.value_or(options_.display_overflow);
+        if (display_) {
+            replace_display();
+        }
+    }
+    if (change.tracing) {
+        set_tracing(*change.tracing);
+    }
+    if (change.clear_trace) {
+        clear_trace();
+    }
+}
+
+std::string Scheduler::config_summary() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    char slack[32];
+    char flush[32];
+    char text[160];
+    std::snprintf(text, sizeof text,
+                  "display=%d capacity=%zu overflow=%s slack=%s flush=%s trace=%s",
+                  options_.display_threads, options_.display_capacity,
+                  overflow_policy_name(options_.display_overflow),
+                  format_duration(options_.expiry_slack, slack, sizeof slack),
+                  format_duration(options_.flush_latency, flush, sizeof flush),
+                  tracing() ? "on" : "off");
+    return text;
+}
+
+void Scheduler::stop() {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (!running_) {
+        return;
+    }
+    if (store_) {
+        // A checkpoint taken once the shards have dropped their alarms would
+        // record an empty set.
+        store_->finish_checkpoints();
+    }
+    for (auto& shard : shards_) {
+        shard->stop();
+    }
+    display_.reset();
+    writer_.reset();
+    if (store_) {
+        store_->close();
+    }
+    running_ = false;
+}
+
+void Scheduler::recover() {
+    // Bulk-load the snapshot into every shard in parallel, then replay the
+    // log tail on top in order.
+    std::vector<std::vector<AlarmView>> parts(shards_.size());
+    store_->load_snapshot([this, &parts](LogKind, AlarmView&& alarm) {
+        if (parts[0].capacity() == 0) {
+            const std::size_t share = store_->recovery().snapshot_alarms / parts.size();
+            for (auto& part : parts) {
+                part.reserve(share + share / 8 + 16);
+            }
+        }
+        parts[shard_of(alarm.id, parts.size())].push_back(std::move(alarm));
+    });
+    std::vector<std::thread> loaders;
+    for (std::size_t i = 1; i < shards_.size(); ++i) {
+        loaders.emplace_back([this, &parts, i] { shards_[i]->restore(parts[i]); });
+    }
+    shards_[0]->restore(parts[0]);
+    for (std::thread& loader : loaders) {
+        loader.join();
+    }
+    store_->replay_log([this](LogKind kind, AlarmView&& alarm) {
+        shard(alarm.id).replay(kind, std::move(alarm));
+    });
+    store_->open();
+}
+
+void Scheduler::collect(const std::function<void(const AlarmView&)>& emit) const {
+    const Deadline now = monotonic_now();
+    std::vector<AlarmView> alarms;
+    for (const auto& shard : shards_) {
+        shard->snapshot(ViewFilter{}, now, alarms);
+        for (const AlarmView& alarm : alarms) {
+            emit(alarm);
+        }
+        alarms.clear();
+    }
+}
+
+bool Scheduler::committed(bool ok) {
+    // A record that never reached the disk is not a success under sync_commit.
+    return ok && (!store_ || !options_.sync_commit || store_->wait_durable(store_->appended()));
+}
+
+bool Scheduler::start_alarm(int id, std::chrono::microseconds delay, std::string_view message,
+                            std::uint32_t repeats, std::string_view group) {
+    return committed(shard(id).start_alarm(id, delay, message, repeats, group));
+}
+
+bool Scheduler::change_alarm(int id, std::chrono::microseconds delay, std::string_view message,
+                             std::uint32_t repeats, std::string_view group) {
+    return committed(shard(id).change_alarm(id, delay, message, repeats, group));
+}
+
+bool Scheduler::cancel_alarm(int id) { return committed(shard(id).cancel_alarm(id)); }
+
+std::size_t Scheduler::start_alarms(std::vector<AlarmRequest>& entries) {
+    std::vector<std::vector<AlarmRequest>> parts(shards_.size());
+    for (auto& part : parts) {
+        part.reserve(entries.size() / parts.size() + entries.size() / parts.size() / 8 + 16);
+    }
+    for (AlarmRequest& entry : entries) {
+        parts[shard_of(entry.id, parts.size())].push_back(std::move(entry));
+    }
+    entries.clear();
+    std::size_t started = 0;
+    for (std::size_t s = 0; s < shards_.size(); ++s) {
+        if (!parts[s].empty()) {
+            started += shards_[s]->start_alarms(parts[s]);
+        }
+    }
+    return committed(started);
+}
+
+std::size_t Scheduler::cancel_alarms(const std::vector<IdRange>& ids) {
+    // Ranges no wider than the alarm count are spelled out id by id and sent
+    // to the owning shard; wider ones are cheaper to match against the
+    // alarms every shard holds.
+    const std::uint64_t live = pending();
+    std::vector<std::vector<int>> parts(shards_.size());
+    std::vector<IdRange> wide;
+    for (const IdRange& range : ids) {
+        if (range.size() > live) {
+            wide.push_back(range);
+            continue;
+        }
+        for (std::int64_t id = range.lo; id <= range.hi; ++id) {
+            parts[shard_of(static_cast<int>(id), parts.size())].push_back(static_cast<int>(id));
+        }
+    }
+    std::size_t cancelled = 0;
+    for (std::size_t s = 0; s < shards_.size(); ++s) {
+        if (!parts[s].empty() || !wide.empty()) {
+            cancelled += shards_[s]->cancel_alarms(parts[s], wide);
+        }
+    }
+    return committed(cancelled);
+}
+
+std::size_t Scheduler::cancel_group(std::string_view tag) {
+    std::size_t cancelled = 0;
+    for (auto& shard : shards_) {
+        cancelled += shard->cancel_group(tag);
+    }
+    return committed(cancelled);
+}
+
+std::size_t Scheduler::shift_group(std::string_view tag, std::chrono::microseconds delta) {
+    std::size_t shifted = 0;
+    for (auto& shard : shards_) {
+        shifted += shard->shift_group(tag, delta);
+    }
+    return committed(shifted);
+}
+
+void Scheduler::post(AlarmRequest&& request) {
+    Shard& target = shard(request.id);
+    target.post(std::move(request));
+}
+
+void Scheduler::post_batch(std::vector<AlarmRequest>& batch) {
+    std::vector<bool> queued(shards_.size());
+    for (AlarmRequest& request : batch) {
+        const std::size_t s = shard_of(request.id, shards_.size());
+        if (shards_[s]->enqueue(std::move(request))) {
+            queued[s] = true;
+        }
+    }
+    for (std::size_t s = 0; s < shards_.size(); ++s) {
+        if (queued[s]) {
+            shards_[s]->notify_posted();
+        }
+    }
+    batch.clear();
+}
+
+void Scheduler::write_line(std::string_view line) {
+    if (writer_) {
+        writer_->write(0, line);
+    } else {
+        std::fwrite(line.data(), 1, line.size(), options_.out);
+        std::fflush(options_.out);
+    }
+}
+
+void Scheduler::flush_output() {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (writer_) {
+        writer_->flush();
+    } else {
+        std::fflush(options_.out);
+    }
+}
+
+void Scheduler::drain() {
+    for (auto& shard : shards_) {
+        shard->drain();
+    }
+}
+
+std::size_t Scheduler::snapshot(const ViewFilter& filter, std::vector<AlarmView>& out) const {
+    // Each shard is copied under its own lock, one at a time, so at most one
+    // shard's alarm thread waits at any moment and only for the copy. Sorting,
+    // merging and paging below run with no lock held.
+    const Deadline now = monotonic_now();
+    const auto before = [](const AlarmView& a, const AlarmView& b) { return expires_before(a, b); };
+    // Only the first offset + limit alarms of a shard can reach the page, so
+    // no shard copies more than that.
+    const std::size_t keep = filter.limit > std::numeric_limits<std::size_t>::max() - filter.offset
+                                 ? std::numeric_limits<std::size_t>::max()
+                                 : filter.offset + filter.limit;
+    out.clear();
+    std::size_t total = 0;
+    std::vector<std::size_t> runs{0};
+    for (const auto& shard : shards_) {
+        const std::size_t first = out.size();
+        total += shard->snapshot(filter, now, out, keep);
+        std::sort(out.begin() + static_cast<std::ptrdiff_t>(first), out.end(), before);
+        runs.push_back(out.size());
+    }
+    // Merge the sorted runs pairwise, O(n log shards).
+    while (runs.size() > 2) {
+        std::vector<std::size_t> merged{0};
+        for (std::size_t i = 0; i + 1 < runs.size(); i += 2) {
+            const std::size_t last = i + 2 < runs.size() ? runs[i + 2] : runs[i + 1];
+            std::inplace_merge(out.begin() + static_cast<std::ptrdiff_t>(runs[i]),
+                               out.begin() + static_cast<std::ptrdiff_t>(runs[i + 1]),
+                               out.begin() + static_cast<std::ptrdiff_t>(last), before);
+            merged.push_back(last);
+        }
+        runs.swap(merged);
+    }
+    const std::size_t skip = std::min(filter.offset, out.size());
+    out.erase(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(skip));
+    if (out.size() > filter.limit) {
+        out.resize(filter.limit);
+    }
+    return total;
+}
+
+void Scheduler::view_alarms(std::FILE* out, const ViewFilter& filter) const {
+    std::vector<AlarmView> alarms;
+    const std::size_t total = snapshot(filter, alarms);
+    // Output to our own stream goes through the writer in pieces, so a large
+    // listing neither waits behind a full copy nor reorders with the lines
+    // written before it.
+    if (writer_ && out == options_.out) {
+        render_view(alarms, filter, total,
+                    [this](std::string_view piece) { writer_->write(0, piece); });
+        return;
+    }
+    render_view(alarms, filter, total,
+                [out](std::string_view piece) { std::fwrite(piece.data(), 1, piece.size(), out); });
+    std::fflush(out);
+}
+
+void Scheduler::render_view(const std::vector<AlarmView>& alarms, const ViewFilter& filter,
+                            std::size_t total,
+                            const std::function<void(std::string_view)>& emit) {
+    constexpr std::size_t kPiece = 64 * 1024;
+    std::string text;
+    text.reserve(kPiece + kMaxLine);
+    char line[kMaxLine];
+    char delay[64];
+    text.append(line, static_cast<std::size_t>(std::snprintf(
+                          line, sizeof line, "View Alarms at %ld:\n",
+                          static_cast<long>(std::time(nullptr)))));
+    std::size_t n = filter.offset;
+    for (const AlarmView& a : alarms) {
+        const std::int64_t wall_ms = wall_time_of(a.deadline) / 1'000;
+        const int len = std::snprintf(line, sizeof line,
+                                      "%zu. Alarm(%d): Expiry = %lld.%03lld %s %s%s%s%s\n", ++n,
+                                      a.id, static_cast<long long>(wall_ms / 1'000),
+                                      static_cast<long long>(wall_ms % 1'000),
+                                      format_schedule(a.delay, a.repeats, delay, sizeof delay),
+                                      a.group.empty() ? "" : "group=", a.group.c_str(),
+                                      a.group.empty() ? "" : " ", a.message.c_str());
+        text.append(line, std::min(static_cast<std::size_t>(len), sizeof line - 1));
+        if (text.size() >= kPiece) {
+            emit(text);
+            text.clear();
+        }
+    }
+    if (filter.paged()) {
+        const int len = alarms.empty()
+                            ? std::snprintf(line, sizeof line, "Showing 0 of %zu alarms\n", total)
+                            : std::snprintf(line, sizeof line, "Showing %zu-%zu of %zu alarms\n",
+                                            filter.offset + 1, n, total);
+        text.append(line, static_cast<std::size_t>(len));
+    }
+    emit(text);
+}
+
+std::size_t Scheduler::pending() const {
+    std::size_t n = 0;
+    for (const auto& shard : shards_) {
+        n += shard->pending();
+    }
+    return n;
+}
+
+PoolStats Scheduler::pool_stats() const {
+    PoolStats stats;
+    for (const auto& shard : shards_) {
+        stats += shard->pool_stats();
+    }
+    return stats;
+}
+
+ColdStats Scheduler::cold_stats() const {
+    ColdStats stats;
+    for (const auto& shard : shards_) {
+        stats += shard->cold_stats();
+    }
+    return stats;
+}
+
+std::uint64_t Scheduler::wakeups() const {
+    std::uint64_t n = 0;
+    for (const auto& shard : shards_) {
+        n += shard->wakeups();
+    }
+    return n;
+}
+
+std::uint64_t Scheduler::display_steals() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    return retired_steals_ + (display_ ? display_->steals() : 0);
+}
+
+DisplayStats Scheduler::display_stats() const {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    DisplayStats d = display_ ? display_->stats() : DisplayStats{};
+    d.shed += retired_display_.shed;
+    d.coalesced += retired_display_.coalesced;
+    d.blocked += retired_display_.blocked;
+    return d;
+}
+
+ShipStats Scheduler::replication() const {
+    const LogShipper* shipper = store_ ? store_->shipper() : nullptr;
+    return shipper != nullptr ? shipper->stats() : ShipStats{};
+}
+
+std::string Scheduler::render_stats(long now) const {
+    const DisplayStats d = display_stats();
+    const ColdStats c = cold_stats();
+    char line[320];
+    std::snprintf(line, sizeof line,
+                  "  %-16s queued=%zu capacity=%zu shed=%llu coalesced=%llu blocked=%llu\n"
+                  "  %-16s alarms=%zu buckets=%zu bytes=%zu\n",
+                  "display_queue", d.queued, d.capacity, static_cast<unsigned long long>(d.shed),
+                  static_cast<unsigned long long>(d.coalesced),
+                  static_cast<unsigned long long>(d.blocked), "cold_tier", c.alarms, c.buckets,
+                  c.bytes);
+    std::string text = alarmd::render_stats(now) + line;
+    if (!options_.replica.empty()) {
+        const ShipStats r = replication();
+        std::snprintf(line, sizeof line,
+                      "  %-16s connected=%d bytes=%llu dumps=%llu backlog=%zu\n", "replication",
+                      r.connected ? 1 : 0, static_cast<unsigned long long>(r.bytes),
+                      static_cast<unsigned long long>(r.dumps), r.backlog);
+        text += line;
+    }
+    return text;
+}
+
+std::string Scheduler::render_prometheus() const {
+    const DisplayStats d = display_stats();
+    const ColdStats c = cold_stats();
+    char text[768];
+    std::snprintf(text, sizeof text,
+                  "# TYPE alarmd_display_queued gauge\nalarmd_display_queued %zu\n"
+                  "# TYPE alarmd_display_capacity gauge\nalarmd_display_capacity %zu\n"
+                  "# TYPE alarmd_display_shed_total counter\nalarmd_display_shed_total %llu\n"
+                  "# TYPE alarmd_display_coalesced_total counter\n"
+                  "alarmd_display_coalesced_total %llu\n"
+                  "# TYPE alarmd_display_blocked_total counter\n"
+                  "alarmd_display_blocked_total %llu\n"
+                  "# TYPE alarmd_cold_alarms gauge\nalarmd_cold_alarms %zu\n"
+                  "# TYPE alarmd_cold_bytes gauge\nalarmd_cold_bytes %zu\n",
+                  d.queued, d.capacity, static_cast<unsigned long long>(d.shed),
+                  static_cast<unsigned long long>(d.coalesced),
+                  static_cast<unsigned long long>(d.blocked), c.alarms, c.bytes);
+    std::string page = alarmd::render_prometheus() + text;
+    if (!options_.replica.empty()) {
+        const ShipStats r = replication();
+        std::snprintf(text, sizeof text,
+                      "# TYPE alarmd_replica_connected gauge\nalarmd_replica_connected %d\n"
+                      "# TYPE alarmd_replica_sent_bytes_total counter\n"
+                      "alarmd_replica_sent_bytes_total %llu\n"
+                      "# TYPE alarmd_replica_backlog_bytes gauge\n"
+                      "alarmd_replica_backlog_bytes %zu\n",
+                      r.connected ? 1 : 0, static_cast<unsigned long long>(r.bytes), r.backlog);
+        page += text;
+    }
+    return page;
+}
+
+void Scheduler::print(int worker, std::vector<FiredAlarm>& chunk) {
+    const std::size_t n = chunk.size();
+    if (options_.on_fired) {
+        options_.on_fired(worker, chunk);
+    } else if (writer_) {
+        const long now = static_cast<long>(std::time(nullptr));
+        std::string text;
+        text.reserve(chunk.size() * 64);
+        char line[kMaxLine];
+        for (const FiredAlarm& alarm : chunk) {
+            text.append(line, format_fired(alarm, worker, now, line));
+        }
+        writer_->write(static_cast<std::size_t>(worker), text);
+    } else {
+        const long now = static_cast<long>(std::time(nullptr));
+        char line[kMaxLine];
+        for (const FiredAlarm& alarm : chunk) {
+            std::fwrite(line, 1, format_fired(alarm, worker, now, line), options_.out);
+        }
+        std::fflush(options_.out);
+    }
+    const std::int64_t printed_ns = monotonic_ns();
+    for (const FiredAlarm& alarm : chunk) {
+        if (alarm.fired_ns != 0) {
+            record_latency(Metric::DisplayLatency, printed_ns - alarm.fired_ns);
+        }
+        trace(TraceKind::Print, alarm.id, alarm.fired_ns);
+    }
+    fired_.fetch_add(n, std::memory_order_relaxed);
+}
+
+}  // namespace alarmd
@@ -0,0 +1,767 @@
+#include "alarmd/shard.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <utility>
+
+#include "alarmd/cpu_affinity.hpp"
+#include "alarmd/latency_stats.hpp"
+#include "alarmd/trace.hpp"
+
+namespace alarmd {
+
+namespace {
+
+// Tombstones are swept once they outnumber live alarms (and this floor), so
+// the sweep's cost is amortised over at least as many cancels.
+constexpr std::size_t kMinCompact = 1024;
+
+// Upper bound on one expiry batch, so a huge backlog of due alarms does not
+// hold the shard lock for the whole sweep.
+constexpr std::size_t kMaxBatch = 4096;
+
+void set_alarm(Alarm& alarm, std::chrono::microseconds delay, Message&& message,
+               std::uint32_t repeats) {
+    alarm.delay = delay;
+    alarm.deadline = monotonic_now() + delay.count();
+    alarm.message = std::move(message);
+    // A zero period would fire forever without leaving the queue.
+    alarm.repeats = delay.count() > 0 ? repeats : 0;
+}
+
+// now + due, pinned to the representable range: the filter's open ends
+// are the duration's min and max.
+Deadline due_at(Deadline now, std::chrono::microseconds due) {
+    Deadline at;
+    if (__builtin_add_overflow(now, due.count(), &at)) {
+        return due.count() < 0 ? std::numeric_limits<Deadline>::min() : kNoDeadline;
+    }
+    return at;
+}
+
+}  // namespace
+
+Shard::Shard(const ShardOptions& options, ExpireFn on_expire, ResultFn on_result, ArmFn on_arm)
+    : on_expire_(std::move(on_expire)),
+      on_arm_(std::move(on_arm)),
+      slack_us_(options.expiry_slack.count()),
+      cold_horizon_(options.cold_horizon.count()),
+      on_result_(std::move(on_result)),
+      store_(options.store),
+      store_slot_(options.store_slot),
+      cpu_(options.cpu),
+      requests_(options.ring_capacity),
+      pool_(1024, options.cpu >= 0 ? numa_node_of_cpu(options.cpu) : -1),
+      alarms_(make_timer_queue(options.queue)) {}
+
+Shard::~Shard() {
+    stop();
+    alarms_->clear([this](Alarm* a) { release(a); });
+}
+
+void Shard::start() {
+    std::lock_guard<std::mutex> lock(alarm_mutex_);
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    stopping_ = false;
+    if (on_arm_) {
+        // The first poll() fires whatever was restored and arms the real wakeup.
+        armed_ = kNoDeadline;
+        rearm_locked(monotonic_now());
+        return;
+    }
+    alarm_thread_ = std::thread(&Shard::alarm_thread_main, this);
+}
+
+void Shard::stop() {
+    {
+        std::lock_guard<std::mutex> lock(alarm_mutex_);
+        if (!running_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    if (on_arm_) {
+        std::lock_guard<std::mutex> polling(poll_mutex_);  // waits out a running poll()
+    } else {
+        alarm_cond_.notify_all();
+        alarm_thread_.join();
+    }
+
+    std::lock_guard<std::mutex> lock(alarm_mutex_);
+    AlarmRequest discarded;
+    while (requests_.try_pop(discarded)) {
+    }
+    alarms_->clear([this](Alarm* a) { release(a); });
+    index_.clear();
+    groups_.clear();
+    cold_.clear();
+    tombstones_ = 0;
+    if (on_arm_) {
+        armed_ = kAwake;  // never arms again until start()
+        on_arm_(kNoDeadline);
+    }
+    running_ = false;
+}
+
+bool Shard::start_alarm(int id, std::chrono::microseconds delay, std::string_view message,
+                        std::uint32_t repeats, std::string_view group) {
+    TimedLock lock(alarm_mutex_);
+    drain_locked();
+    return start_locked(id, delay, Message(message), 0, repeats, group);
+}
+
+bool Shard::change_alarm(int id, std::chrono::microseconds delay, std::string_view message,
+                         std::uint32_t repeats, std::string_view group) {
+    TimedLock lock(alarm_mutex_);
+    drain_locked();
+    return change_locked(id, delay, Message(message), repeats, group);
+}
+
+bool Shard::cancel_alarm(int id) {
+    TimedLock lock(alarm_mutex_);
+    drain_locked();
+    return cancel_locked(id);
+}
+
+std::size_t Shard::start_alarms(std::vector<AlarmRequest>& entries) {
+    TimedLock lock(alarm_mutex_);
+    drain_locked();
+    index_.reserve(index_.size() + entries.size());
+    Deadline earliest = kNoDeadline;
+    std::size_t stashed = 0;
+    for (AlarmRequest& entry : entries) {
+        if (taken(entry.id)) {
+            continue;
+        }
+        trace(TraceKind::Start, entry.id);
+        if (stash_cold_locked(LogKind::Start, entry.id, entry.delay, entry.message, entry.owner,
+                              entry.repeats, entry.group.view())) {
+            ++stashed;
+            continue;
+        }
+        Alarm* alarm = pool_.create();
+        alarm->id = entry.id;
+        alarm->owner = entry.owner;
+        alarm->seq = next_seq_++;
+        set_alarm(*alarm, entry.delay, std::move(entry.message), entry.repeats);
+        index_.insert(alarm);
+        if (!entry.group.empty()) {
+            groups_.add(alarm, entry.group.view());
+        }
+        earliest = std::min(earliest, alarm->deadline);
+        fresh_.push_back(alarm);
+        if (store_ != nullptr) {
+            store_->log_set(store_slot_, LogKind::Start, *alarm);
+        }
+    }
+    const std::size_t queued = fresh_.size();
+    alarms_->push_bulk(fresh_);
+    fresh_.clear();
+    if (queued != 0) {
+        rearm_locked(earliest - slack_us_);
+    }
+    return queued + stashed;
+}
+
+std::size_t Shard::cancel_alarms(const std::vector<int>& ids, const std::vector<IdRange>& ranges) {
+    TimedLock lock(alarm_mutex_);
+    drain_locked();
+    std::size_t cancelled = 0;
+    for (int id : ids) {
+        cancelled += cancel_locked(id) ? 1 : 0;
+    }
+    if (ranges.empty()) {
+        return cancelled;
+    }
+    const auto in_ranges = [&ranges](int id) {
+        return std::any_of(ranges.begin(), ranges.end(),
+                           [id](const IdRange& r) { return id >= r.lo && id <= r.hi; });
+    };
+    // Collect first: cancelling may compact the queue under the scan.
+    std::vector<int> matched;
+    alarms_->for_each([&](const Alarm& a) {
+        if (!a.cancelled && in_ranges(a.id)) {
+            matched.push_back(a.id);
+        }
+    });
+    for (const IdRange& r : ranges) {
+        cold_.scan({.id_lo = r.lo, .id_hi = r.hi},
+                   [&matched](const ColdAlarm& c) { matched.push_back(c.id); });
+    }
+    for (int id : matched) {
+        cancelled += cancel_locked(id) ? 1 : 0;
+    }
+    return cancelled;
+}
+
+std::size_t Shard::cancel_group(std::string_view tag) {
+    TimedLock lock(alarm_mutex_);
+    drain_locked();
+    AlarmGroup* group = groups_.find(tag);
+    if (group == nullptr) {
+        return 0;
+    }
+    // Each cancel unlinks a member, so collect their ids first.
+    std::vector<int> ids;
+    ids.reserve(group->size);
+    GroupIndex::for_each(*group, [&ids](const Alarm& a) { ids.push_back(a.id); });
+    for (int id : ids) {
+        cancel_locked(id);
+    }
+    return ids.size();
+}
+
+std::size_t Shard::shift_group(std::string_view tag, std::chrono::microseconds delta) {
+    TimedLock lock(alarm_mutex_);
+    drain_locked();
+    AlarmGroup* group = groups_.find(tag);
+    if (group == nullptr) {
+        return 0;
+    }
+    Deadline earliest = kNoDeadline;
+    GroupIndex::for_each(*group, [&](Alarm& a) {
+        alarms_->reschedule(&a, a.deadline + delta.count(), next_seq_++);
+        earliest = std::min(earliest, a.deadline);
+        if (store_ != nullptr) {
+            store_->log_set(store_slot_, LogKind::Change, a);
+        }
+    });
+    if (group->size != 0) {
+        rearm_locked(earliest - slack_us_);
+    }
+    return group->size;
+}
+
+void Shard::post(AlarmRequest&& request) {
+    if (enqueue(std::move(request))) {
+        notify_posted();
+    }
+}
+
+bool Shard::enqueue(AlarmRequest&& request) {
+    if (requests_.try_push(std::move(request))) {
+        return true;
+    }
+    TimedLock lock(alarm_mutex_);
+    drain_locked();
+    apply(request);
+    return false;
+}
+
+void Shard::notify_posted() {
+    // Pairs with the fence in alarm_thread_main: either the alarm thread sees
+    // the request before it sleeps, or this thread sees it sleeping.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) {
+        wake();
+    }
+}
+
+void Shard::drain() {
+    TimedLock lock(alarm_mutex_);
+    drain_locked();
+}
+
+void Shard::wake() {
+    if (on_arm_) {
+        std::lock_guard<std::mutex> lock(alarm_mutex_);
+        rearm_locked(monotonic_now());
+        return;
+    }
+    // Taking the lock ensures the alarm thread is either still checking the
+    // ring or already inside wait(), so the notify cannot be lost.
+    {
+        std::lock_guard<std::mutex> lock(alarm_mutex_);
+    }
+    alarm_cond_.notify_one();
+}
+
+void Shard::rearm_locked(Deadline wakeup) {
+    if (wakeup >= armed_) {
+        return;
+    }
+    if (on_arm_) {
+        armed_ = wakeup;
+        on_arm_(wakeup);
+    } else {
+        // One signal is enough: the alarm thread recomputes its wakeup
+        // before it sleeps again.
+        armed_ = kAwake;
+        alarm_cond_.notify_one();
+    }
+}
+
+Deadline Shard::next_wakeup_locked() const {
+    Deadline wakeup = kNoDeadline;
+    Deadline when;
+    if (alarms_->next_expiry(when)) {
+        wakeup = when - slack_us_;
+    }
+    if (cold_.first_bucket(when)) {
+        wakeup = std::min(wakeup, when - cold_horizon_);
+    }
+    return wakeup;
+}
+
+void Shard::drain_locked() {
+    AlarmRequest request;
+    while (requests_.try_pop(request)) {
+        apply(request);
+    }
+}
+
+void Shard::apply(AlarmRequest& request) {
+    bool ok = false;
+    switch (request.kind) {
+        case RequestKind::Start:
+            ok = start_locked(request.id, request.delay, std::move(request.message),
+                              request.owner, request.repeats, request.group.view());
+            break;
+        case RequestKind::Change:
+            ok = change_locked(request.id, request.delay, std::move(request.message),
+                               request.repeats, request.group.view());
+            break;
+        case RequestKind::Cancel:
+            ok = cancel_locked(request.id);
+            break;
+    }
+    if (on_result_) {
+        RequestResult result{request.kind, request.id, request.delay, ok, {}, request.owner,
+                             request.repeats};
+        if (ok && request.kind != RequestKind::Cancel) {
+            if (const Alarm* alarm = index_.find(request.id)) {
+                result.message = alarm->message.view();
+            } else {
+                ColdAlarm cold;
+                cold_.find(request.id, cold);
+                result.message = cold.message;
+            }
+        } else if (!ok) {
+            result.message = request.message.view();
+        }
+        on_result_(result);
+    }
+}
+
+bool Shard::start_locked(int id, std::chrono::microseconds delay, Message&& message,
+                         std::uint32_t owner, std::uint32_t repeats, std::string_view group) {
+    if (taken(id)) {
+        return false;
+    }
+    trace(TraceKind::Start, id);
+    if (!stash_cold_locked(LogKind::Start, id, delay, message, owner, repeats, group)) {
+        create_locked(LogKind::Start, id, delay, std::move(message), owner, repeats, group);
+    }
+    return true;
+}
+
+bool Shard::change_locked(int id, std::chrono::microseconds delay, Message&& message,
+                          std::uint32_t repeats, std::string_view group) {
+    Alarm* alarm = index_.find(id);
+    if (alarm == nullptr) {
+        // A cold alarm leaves its row and is placed again as a new one is.
+        ColdAlarm old;
+        if (cold_.size() == 0 || !cold_.erase(id, &old)) {
+            return false;
+        }
+        trace(TraceKind::Change, id);
+        if (!stash_cold_locked(LogKind::Change, id, delay, message, old.owner, repeats, group)) {
+            create_locked(LogKind::Change, id, delay, std::move(message), old.owner, repeats,
+                          group);
+        }
+        return true;
+    }
+    trace(TraceKind::Change, id);
+    if (group.empty() && alarm->group == nullptr &&
+        stash_cold_locked(LogKind::Change, id, delay, message, alarm->owner, repeats, {})) {
+        discard_locked(alarm);
+        return true;
+    }
+    if (!group.empty() && (alarm->group == nullptr || alarm->group->tag != group)) {
+        groups_.remove(alarm);
+        groups_.add(alarm, group);
+    }
+    set_alarm(*alarm, delay, std::move(message), repeats);
+    alarms_->reschedule(alarm, alarm->deadline, next_seq_++);
+    if (store_ != nullptr) {
+        store_->log_set(store_slot_, LogKind::Change, *alarm);
+    }
+    rearm_locked(alarm->deadline - slack_us_);
+    return true;
+}
+
+Alarm* Shard::create_locked(LogKind kind, int id, std::chrono::microseconds delay,
+                            Message&& message, std::uint32_t owner, std::uint32_t repeats,
+                            std::string_view group) {
+    Alarm* alarm = pool_.create();
+    alarm->id = id;
+    alarm->owner = owner;
+    alarm->seq = next_seq_++;
+    set_alarm(*alarm, delay, std::move(message), repeats);
+    index_.insert(alarm);
+    if (!group.empty()) {
+        groups_.add(alarm, group);
+    }
+    alarms_->push(alarm);
+    if (store_ != nullptr) {
+        store_->log_set(store_slot_, kind, *alarm);
+    }
+    rearm_locked(alarm->deadline - slack_us_);
+    return alarm;
+}
+
+bool Shard::goes_cold(Deadline deadline, std::uint32_t repeats, std::string_view group,
+                      Deadline now) const {
+    return cold_horizon_ > 0 && repeats == 0 && group.empty() &&
+           ColdTier::bucket_start(ColdTier::bucket_of(deadline)) - cold_horizon_ > now;
+}
+
+bool Shard::stash_cold_locked(LogKind kind, int id, std::chrono::microseconds delay,
+                              Message& message, std::uint32_t owner, std::uint32_t repeats,
+                              std::string_view group) {
+    if (cold_horizon_ == 0) {
+        return false;
+    }
+    const Deadline now = monotonic_now();
+    const Deadline deadline = now + delay.count();
+    if (!goes_cold(deadline, repeats, group, now)) {
+        return false;
+    }
+    cold_.insert(id, deadline, delay, message.view(), owner);
+    if (store_ != nullptr) {
+        store_->log_set(store_slot_, kind,
+                        AlarmView{deadline, 0, std::move(message), delay, id, 0, {}});
+    }
+    rearm_locked(ColdTier::bucket_start(ColdTier::bucket_of(deadline)) - cold_horizon_);
+    return true;
+}
+
+std::size_t Shard::promote_locked(Deadline now, std::size_t max) {
+    std::size_t visited = 0;
+    Deadline start;
+    while (visited < max && cold_.first_bucket(start) && start - cold_horizon_ <= now) {
+        visited += cold_.promote(max - visited, [this](const ColdAlarm& c) {
+            Alarm* alarm = pool_.create();
+            alarm->id = c.id;
+            alarm->owner = c.owner;
+            alarm->seq = next_seq_++;
+            alarm->deadline = c.deadline;
+            alarm->delay = c.delay;
+            alarm->message = Message(c.message);
+            index_.insert(alarm);
+            fresh_.push_back(alarm);
+        });
+    }
+    if (!fresh_.empty()) {
+        alarms_->push_bulk(fresh_);
+        fresh_.clear();
+    }
+    return visited;
+}
+
+void Shard::discard_locked(Alarm* alarm) {
+    index_.erase(alarm->id);
+    groups_.remove(alarm);
+    alarms_->erase(alarm);
+    release(alarm);
+}
+
+bool Shard::cancel_locked(int id) {
+    Alarm* alarm = index_.erase(id);
+    if (alarm == nullptr) {
+        if (cold_.size() == 0 || !cold_.erase(id)) {
+            return false;
+        }
+        trace(TraceKind::Cancel, id);
+        if (store_ != nullptr) {
+            store_->log_cancel(store_slot_, id);
+        }
+        return true;
+    }
+    trace(TraceKind::Cancel, id);
+    groups_.remove(alarm);
+    alarm->cancelled = true;
+    if (store_ != nullptr) {
+        store_->log_cancel(store_slot_, id);
+    }
+    if (++tombstones_ > kMinCompact && tombstones_ > index_.size()) {
+        compact();
+    }
+    return true;
+}
+
+void Shard::compact() {
+    alarms_->purge_cancelled([this](Alarm* a) { release(a); });
+    tombstones_ = 0;
+}
+
+void Shard::restore(std::vector<AlarmView>& alarms) {
+    std::lock_guard<std::mutex> lock(alarm_mutex_);
+    index_.reserve(index_.size() + alarms.size());
+    const Deadline now = monotonic_now();
+    for (AlarmView& view : alarms) {
+        if (goes_cold(view.deadline, view.repeats, view.group.view(), now)) {
+            cold_.insert(view.id, view.deadline, view.delay, view.message.view(), 0);
+        } else {
+            fresh_.push_back(install_locked(std::move(view)));
+        }
+    }
+    alarms_->push_bulk(fresh_);
+    fresh_.clear();
+    alarms.clear();
+}
+
+void Shard::replay(LogKind kind, AlarmView&& alarm) {
+    std::lock_guard<std::mutex> lock(alarm_mutex_);
+    if (cold_contains(alarm.id)) {
+        cold_.erase(alarm.id);
+    }
+    if (kind == LogKind::Start || kind == LogKind::Change) {
+        if (!goes_cold(alarm.deadline, alarm.repeats, alarm.group.view(), monotonic_now())) {
+            alarms_->push(install_locked(std::move(alarm)));
+            return;
+        }
+        if (Alarm* node = index_.find(alarm.id)) {
+            discard_locked(node);
+        }
+        cold_.insert(alarm.id, alarm.deadline, alarm.delay, alarm.message.view(), 0);
+    } else if (Alarm* node = index_.erase(alarm.id)) {
+        groups_.remove(node);
+        alarms_->erase(node);
+        release(node);
+    }
+}
+
+Alarm* Shard::install_locked(AlarmView&& view) {
+    Alarm* alarm = index_.find(view.id);
+    if (alarm != nullptr) {
+        alarms_->erase(alarm);
+    } else {
+        alarm = pool_.create();
+        alarm->id = view.id;
+        index_.insert(alarm);
+    }
+    alarm->deadline = view.deadline;
+    alarm->seq = view.seq;
+    alarm->delay = view.delay;
+    alarm->message = std::move(view.message);
+    alarm->repeats = view.delay.count() > 0 ? view.repeats : 0;
+    groups_.remove(alarm);
+    if (!view.group.empty()) {
+        groups_.add(alarm, view.group.view());
+    }
+    next_seq_ = std::max(next_seq_, view.seq + 1);
+    return alarm;
+}
+
+std::size_t Shard::snapshot(const ViewFilter& filter, Deadline now, std::vector<AlarmView>& out,
+                            std::size_t keep) {
+    // Grow the buffer before taking the lock so the copy never reallocates
+    // while the alarm thread waits; a few alarms started in between only
+    // cost one growth.
+    const std::size_t first = out.size();
+    out.reserve(first + std::min(pending(), keep));
+    const auto before = [](const AlarmView& a, const AlarmView& b) { return expires_before(a, b); };
+    std::size_t matched = 0;
+    // Once `keep` rows are copied they form a max-heap, and a later row only
+    // replaces the latest of them; rows that come after it are not copied.
+    const auto offer = [&](Deadline deadline, std::uint64_t seq, auto&& make) {
+        ++matched;
+        const auto begin = out.begin() + static_cast<std::ptrdiff_t>(first);
+        if (out.size() - first < keep) {
+            out.push_back(make());
+            if (out.size() - first == keep) {
+                std::make_heap(begin, out.end(), before);
+            }
+        } else if (keep != 0 && (deadline != begin->deadline ? deadline < begin->deadline
+                                                             : seq < begin->seq)) {
+            std::pop_heap(begin, out.end(), before);
+            out.back() = make();
+            std::push_heap(begin, out.end(), before);
+        }
+    };
+    TimedLock lock(alarm_mutex_);
+    drain_locked();
+    alarms_->for_each([&](const Alarm& a) {
+        if (!a.cancelled && filter.matches(a, now)) {
+            offer(a.deadline, a.seq, [&a] {
+                return AlarmView{a.deadline, a.seq, a.message, a.delay, a.id, a.repeats,
+                                 a.group != nullptr ? Message(a.group->tag) : Message()};
+            });
+        }
+    });
+    const ColdQuery query{.id_lo = filter.id_min, .id_hi = filter.id_max,
+                          .from = due_at(now, filter.due_min), .to = due_at(now, filter.due_max)};
+    cold_.scan(query, [&](const ColdAlarm& c) {
+        offer(c.deadline, 0, [&c] {
+            return AlarmView{c.deadline, 0, Message(c.message), c.delay, c.id, 0, {}};
+        });
+    });
+    return matched;
+}
+
+std::size_t Shard::pending() const {
+    std::lock_guard<std::mutex> lock(alarm_mutex_);
+    return index_.size() + cold_.size();
+}
+
+PoolStats Shard::pool_stats() const {
+    std::lock_guard<std::mutex> lock(alarm_mutex_);
+    return pool_.stats();
+}
+
+ColdStats Shard::cold_stats() const {
+    std::lock_guard<std::mutex> lock(alarm_mutex_);
+    return cold_.stats();
+}
+
+std::uint64_t Shard::wakeups() const {
+    std::lock_guard<std::mutex> lock(alarm_mutex_);
+    return wakeups_;
+}
+
+void Shard::set_expiry_slack(std::chrono::microseconds slack) {
+    std::lock_guard<std::mutex> lock(alarm_mutex_);
+    slack_us_ = slack.count();
+    // A larger slack moves the wakeup earlier; a smaller one only costs the
+    // alarm thread one early wakeup.
+    rearm_locked(next_wakeup_locked());
+}
+
+bool Shard::fire_locked(Alarm& alarm, Deadline horizon, std::int64_t now_ns) {
+    record_latency(Metric::FireLateness, now_ns - alarm.deadline * 1000);
+    trace(TraceKind::Fire, alarm.id);
+    if (alarm.repeats != 0) {
+        // The next occurrence after `horizon` on the original grid; the ones
+        // in between were missed and fold into this fire.
+        const Deadline period = alarm.delay.count();
+        const auto steps = static_cast<std::uint64_t>((horizon - alarm.deadline) / period) + 1;
+        if (alarm.repeats == kRepeatForever || steps <= alarm.repeats) {
+            batch_.push_back({alarm.id, alarm.delay, alarm.message, alarm.owner, now_ns});
+            if (alarm.repeats != kRepeatForever) {
+                alarm.repeats -= static_cast<std::uint32_t>(steps);
+            }
+            alarms_->reschedule(&alarm, alarm.deadline + static_cast<Deadline>(steps) * period,
+                                next_seq_++);
+            if (store_ != nullptr) {
+                store_->log_set(store_slot_, LogKind::Change, alarm);
+            }
+            return true;
+        }
+    }
+    batch_.push_back({alarm.id, alarm.delay, std::move(alarm.message), alarm.owner, now_ns});
+    if (store_ != nullptr) {
+        expired_.push_back(alarm.id);
+    }
+    return false;
+}
+
+bool Shard::expire_pass(std::unique_lock<std::mutex>& lock, std::int64_t& held_from) {
+    drain_locked();
+    const std::int64_t now_ns = monotonic_ns();
+    const Deadline horizon = now_ns / 1000 + slack_us_;
+    const std::size_t promoted = promote_locked(now_ns / 1000, kMaxBatch);
+    while (batch_.size() < kMaxBatch) {
+        Alarm* alarm = alarms_->peek_due(horizon);
+        if (alarm == nullptr) {
+            break;
+        }
+        if (alarm->cancelled) {
+            --tombstones_;
+        } else if (fire_locked(*alarm, horizon, now_ns)) {
+            continue;
+        } else {
+            index_.erase(alarm->id);
+            groups_.remove(alarm);
+        }
+        alarms_->erase(alarm);
+        release(alarm);
+    }
+    if (batch_.empty()) {
+        if (promoted < kMaxBatch) {
+            return false;
+        }
+        // More of a cold bucket to promote: let waiting commands in first.
+        record_latency(Metric::LockHold, monotonic_ns() - held_from);
+        lock.unlock();
+        std::this_thread::yield();
+        lock.lock();
+        held_from = monotonic_ns();
+        return true;
+    }
+    if (store_ != nullptr) {
+        store_->log_fired(store_slot_, expired_);
+        expired_.clear();
+    }
+    record_latency(Metric::LockHold, monotonic_ns() - held_from);
+    lock.unlock();
+    on_expire_(batch_);
+    batch_.clear();
+    lock.lock();
+    held_from = monotonic_ns();
+    return true;
+}
+
+void Shard::alarm_thread_main() {
+    if (cpu_ >= 0) {
+        pin_current_thread(cpu_);  // checked when the options were
+    }
+    std::unique_lock<std::mutex> lock(alarm_mutex_);
+    std::int64_t held_from = monotonic_ns();
+    while (!stopping_) {
+        if (expire_pass(lock, held_from)) {
+            continue;
+        }
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (requests_.empty()) {
+            record_latency(Metric::LockHold, monotonic_ns() - held_from);
+            armed_ = next_wakeup_locked();
+            if (armed_ == kNoDeadline) {
+                alarm_cond_.wait(lock);
+            } else {
+                alarm_cond_.wait_until(lock, armed_);
+            }
+            armed_ = kAwake;
+            ++wakeups_;
+            held_from = monotonic_ns();
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+}
+
+void Shard::poll() {
+    std::lock_guard<std::mutex> polling(poll_mutex_);
+    std::unique_lock<std::mutex> lock(alarm_mutex_);
+    if (!running_ || stopping_) {
+        return;
+    }
+    ++wakeups_;
+    armed_ = kAwake;
+    sleeping_.store(false, std::memory_order_relaxed);
+    std::int64_t held_from = monotonic_ns();
+    for (;;) {
+        while (expire_pass(lock, held_from)) {
+            if (stopping_) {
+                return;  // stop() disarms once this returns
+            }
+        }
+        // Same handshake as the alarm thread's: a request posted after this
+        // check sees sleeping_ and re-arms the timer to now.
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (requests_.empty()) {
+            break;
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+    record_latency(Metric::LockHold, monotonic_ns() - held_from);
+    armed_ = next_wakeup_locked();
+    on_arm_(armed_);
+}
+
+}  // namespace alarmd
@@ -0,0 +1,53 @@
+#include "alarmd/timer_queue.hpp"
+
+#include <cstring>
+
+#include "alarmd/heap_queue.hpp"
+#include "alarmd/list_queue.hpp"
+#include "alarmd/timing_wheel.hpp"
+
+namespace alarmd {
+
+Alarm* ListQueue::peek_due(Deadline now) {
+    Alarm* head = list_.front();
+    return head != nullptr && head->deadline <= now ? head : nullptr;
+}
+
+bool ListQueue::next_expiry(Deadline& when) const {
+    const Alarm* head = list_.front();
+    if (head == nullptr) {
+        return false;
+    }
+    when = head->deadline;
+    return true;
+}
+
+std::unique_ptr<TimerQueue> make_timer_queue(QueueKind kind) {
+    switch (kind) {
+        case QueueKind::List: return std::make_unique<ListQueue>();
+        case QueueKind::Heap: return std::make_unique<HeapQueue>();
+        case QueueKind::Wheel: return std::make_unique<TimingWheel>();
+    }
+    return nullptr;
+}
+
+bool parse_queue_kind(const char* name, QueueKind& kind) {
+    for (QueueKind k : {QueueKind::List, QueueKind::Heap, QueueKind::Wheel}) {
+        if (std::strcmp(name, queue_kind_name(k)) == 0) {
+            kind = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* queue_kind_name(QueueKind kind) {
+    switch (kind) {
+        case QueueKind::List: return "list";
+        case QueueKind::Heap: return "heap";
+        case QueueKind::Wheel: return "wheel";
+    }
+    return "unknown";
+}
+
+}  // namespace alarmd
@@ -0,0 +1,235 @@
+#include "alarmd/timing_wheel.hpp"
+
+#include <algorithm>
+
+namespace alarmd {
+
+namespace {
+
+constexpr std::uint32_t kSlotMask = TimingWheel::kSlots - 1;
+
+constexpr int shift(int level) { return TimingWheel::kSlotBits * level; }
+
+constexpr std::int64_t tick_of(Deadline deadline) { return deadline / TimingWheel::kTickUs; }
+
+}  // namespace
+
+void TimingWheel::append(std::uint32_t pos, Alarm* alarm) {
+    List& list = lists_[pos];
+    alarm->queue_pos = pos;
+    alarm->link = nullptr;
+    alarm->prev = list.tail;
+    if (list.tail != nullptr) {
+        list.tail->link = alarm;
+    } else {
+        list.head = alarm;
+    }
+    list.tail = alarm;
+    if (pos < kReady) {
+        occupied_[pos / kSlots] |= std::uint64_t{1} << (pos % kSlots);
+    }
+}
+
+void TimingWheel::unlink(Alarm* alarm) {
+    const std::uint32_t pos = alarm->queue_pos;
+    List& list = lists_[pos];
+    (alarm->prev != nullptr ? alarm->prev->link : list.head) = alarm->link;
+    (alarm->link != nullptr ? alarm->link->prev : list.tail) = alarm->prev;
+    alarm->link = nullptr;
+    alarm->prev = nullptr;
+    if (pos < kReady && list.head == nullptr) {
+        occupied_[pos / kSlots] &= ~(std::uint64_t{1} << (pos % kSlots));
+    }
+}
+
+TimingWheel::List TimingWheel::take(std::uint32_t pos) {
+    List list = lists_[pos];
+    lists_[pos] = List{};
+    if (pos < kReady) {
+        occupied_[pos / kSlots] &= ~(std::uint64_t{1} << (pos % kSlots));
+    }
+    return list;
+}
+
+// Level L holds alarms that share every bit above level L+1 with current_,
+// so the slot an alarm lands in is always ahead of the wheel's position.
+void TimingWheel::place(Alarm* alarm) {
+    const std::int64_t t = tick_of(alarm->deadline);
+    if (t < current_) {
+        insert_ready(alarm);
+        return;
+    }
+    for (int level = 0; level < kLevels; ++level) {
+        if ((t >> shift(level + 1)) == (current_ >> shift(level + 1))) {
+            const auto slot = static_cast<std::uint32_t>(t >> shift(level)) & kSlotMask;
+            append(static_cast<std::uint32_t>(level) * kSlots + slot, alarm);
+            return;
+        }
+    }
+    append(kOverflow, alarm);
+}
+
+void TimingWheel::insert_ready(Alarm* alarm) {
+    List& ready = lists_[kReady];
+    Alarm* after = ready.tail;
+    while (after != nullptr && expires_before(*alarm, *after)) {
+        after = after->prev;
+    }
+    alarm->queue_pos = kReady;
+    alarm->prev = after;
+    alarm->link = after != nullptr ? after->link : ready.head;
+    (alarm->link != nullptr ? alarm->link->prev : ready.tail) = alarm;
+    (after != nullptr ? after->link : ready.head) = alarm;
+}
+
+void TimingWheel::push(Alarm* alarm) {
+    ++size_;
+    place(alarm);
+}
+
+void TimingWheel::erase(Alarm* alarm) {
+    unlink(alarm);
+    --size_;
+}
+
+// Finds the start tick of the earliest occupied slot. Lower levels always
+// hold earlier alarms than higher ones, so the first hit is the answer.
+bool TimingWheel::next_event(std::int64_t& tick, int& level) const {
+    for (int l = 0; l < kLevels; ++l) {
+        const auto idx = static_cast<std::uint32_t>(current_ >> shift(l)) & kSlotMask;
+        std::uint64_t mask;
+        if (l == 0) {
+            mask = ~std::uint64_t{0} << idx;
+        } else {
+            mask = idx == kSlotMask ? 0 : ~std::uint64_t{0} << (idx + 1);
+        }
+        const std::uint64_t bits = occupied_[l] & mask;
+        if (bits != 0) {
+            const auto slot = static_cast<std::int64_t>(__builtin_ctzll(bits));
+            tick = ((current_ >> shift(l + 1)) << shift(l + 1)) + (slot << shift(l));
+            level = l;
+            return true;
+        }
+    }
+    if (lists_[kOverflow].head != nullptr) {
+        tick = ((current_ >> shift(kLevels)) + 1) << shift(kLevels);
+        level = kLevels;
+        return true;
+    }
+    return false;
+}
+
+void TimingWheel::cascade(std::int64_t tick) {
+    for (int level = kLevels; level >= 1; --level) {
+        if ((tick & ((std::int64_t{1} << shift(level)) - 1)) != 0) {
+            continue;
+        }
+        const std::uint32_t pos =
+            level == kLevels
+                ? kOverflow
+                : static_cast<std::uint32_t>(level) * kSlots +
+                      (static_cast<std::uint32_t>(tick >> shift(level)) & kSlotMask);
+        List list = take(pos);
+        for (Alarm* a = list.head; a != nullptr;) {
+            Alarm* next = a->link;
+            place(a);
+            a = next;
+        }
+    }
+}
+
+void TimingWheel::expire_slot(std::int64_t tick) {
+    List list = take(static_cast<std::uint32_t>(tick) & kSlotMask);
+    scratch_.clear();
+    for (Alarm* a = list.head; a != nullptr; a = a->link) {
+        scratch_.push_back(a);
+    }
+    // Alarms cascaded from higher levels and alarms inserted directly into
+    // this slot arrive interleaved; restore FIFO order before releasing them.
+    std::sort(scratch_.begin(), scratch_.end(),
+              [](const Alarm* a, const Alarm* b) { return expires_before(*a, *b); });
+    for (Alarm* a : scratch_) {
+        append(kReady, a);
+    }
+}
+
+void TimingWheel::advance(std::int64_t now) {
+    if (size_ == 0) {
+        // Nothing pending: catch up with `now` so the next push lands on the
+        // lowest level it can instead of cascading down from the top.
+        current_ = std::max(current_, now + 1);
+        return;
+    }
+    std::int64_t tick;
+    int level;
+    while (next_event(tick, level) && tick <= now) {
+        if (level == 0) {
+            expire_slot(tick);
+            current_ = tick + 1;
+        } else {
+            current_ = tick;
+        }
+        cascade(current_);
+    }
+}
+
+Alarm* TimingWheel::peek_due(Deadline now) {
+    advance(tick_of(now));
+    Alarm* head = lists_[kReady].head;
+    return head != nullptr && head->deadline <= now ? head : nullptr;
+}
+
+bool TimingWheel::next_expiry(Deadline& when) const {
+    std::int64_t tick;
+    int level;
+    const bool wheel = next_event(tick, level);
+    const Alarm* ready = lists_[kReady].head;
+    if (ready != nullptr && (!wheel || ready->deadline < tick * kTickUs)) {
+        when = ready->deadline;
+        return true;
+    }
+    if (wheel) {
+        when = tick * kTickUs;
+    }
+    return wheel;
+}
+
+void TimingWheel::for_each(const std::function<void(const Alarm&)>& fn) const {
+    for (const List& list : lists_) {
+        for (const Alarm* a = list.head; a != nullptr; a = a->link) {
+            fn(*a);
+        }
+    }
+}
+
+std::size_t TimingWheel::purge_cancelled(const ReleaseFn& release) {
+    std::size_t purged = 0;
+    for (const List& list : lists_) {
+        for (Alarm* a = list.head; a != nullptr;) {
+            Alarm* next = a->link;
+            if (a->cancelled) {
+                erase(a);
+                release(a);
+                ++purged;
+            }
+            a = next;
+        }
+    }
+    return purged;
+}
+
+void TimingWheel::clear(const ReleaseFn& release) {
+    for (std::uint32_t pos = 0; pos < kLists; ++pos) {
+        List list = take(pos);
+        for (Alarm* a = list.head; a != nullptr;) {
+            Alarm* next = a->link;
+            a->link = nullptr;
+            a->prev = nullptr;
+            release(a);
+            a = next;
+        }
+    }
+    size_ = 0;
+}
+
+}  // namespace alarmd
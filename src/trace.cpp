@@ -0,0 +1,218 @@
+#include "alarmd/trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "alarmd/clock.hpp"
+
+namespace alarmd {
+
+namespace {
+
+constexpr const char* kNames[] = {"start", "change", "cancel", "fire", "print"};
+
+// Rings of exited threads kept for the next dump; a display pool resized
+// over and over must not grow the trace without bound.
+constexpr std::size_t kMaxRetired = 64;
+
+struct TraceRing {
+    struct Entry {
+        std::atomic<std::int64_t> ns{0};
+        std::atomic<std::int64_t> since_ns{0};
+        std::atomic<std::uint64_t> what{0};  // id << 8 | kind
+    };
+
+    int tid = 0;
+    std::atomic<std::uint64_t> written{0};
+    std::array<Entry, kTraceRing> entries;
+};
+
+// Every live thread's ring plus the last kMaxRetired of exited threads.
+// Never destroyed: threads may still record while static objects go away.
+class TraceRegistry {
+public:
+    static TraceRegistry& instance() {
+        static TraceRegistry* registry = new TraceRegistry;
+        return *registry;
+    }
+
+    std::shared_ptr<TraceRing> add() {
+        auto ring = std::make_shared<TraceRing>();
+        std::lock_guard<std::mutex> lock(mutex_);
+        ring->tid = ++next_tid_;
+        live_.push_back(ring);
+        return ring;
+    }
+
+    void retire(const std::shared_ptr<TraceRing>& ring) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::erase(live_, ring);
+        retired_.push_back(ring);
+        if (retired_.size() > kMaxRetired) {
+            retired_.erase(retired_.begin());
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retired_.clear();
+        cleared_ns_ = monotonic_ns();
+    }
+
+    // The rings to dump and the time before which events were cleared.
+    std::vector<std::shared_ptr<TraceRing>> rings(std::int64_t& cleared_ns) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cleared_ns = cleared_ns_;
+        std::vector<std::shared_ptr<TraceRing>> all = retired_;
+        all.insert(all.end(), live_.begin(), live_.end());
+        return all;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::shared_ptr<TraceRing>> live_;
+    std::vector<std::shared_ptr<TraceRing>> retired_;
+    int next_tid_ = 0;
+    std::int64_t cleared_ns_ = 0;
+};
+
+struct ThreadTrace {
+    ~ThreadTrace() {
+        if (ring) {
+            TraceRegistry::instance().retire(ring);
+        }
+    }
+
+    std::shared_ptr<TraceRing> ring;
+};
+
+TraceRing& thread_ring() {
+    thread_local ThreadTrace trace;
+    if (!trace.ring) {
+        trace.ring = TraceRegistry::instance().add();
+    }
+    return *trace.ring;
+}
+
+}  // namespace
+
+const char* trace_kind_name(TraceKind kind) { return kNames[static_cast<std::size_t>(kind)]; }
+
+void set_tracing(bool on) { g_tracing.store(on, std::memory_order_relaxed); }
+
+void record_trace(TraceKind kind, int id, std::int64_t since_ns) {
+    TraceRing& ring = thread_ring();
+    const std::uint64_t n = ring.written.load(std::memory_order_relaxed);
+    TraceRing::Entry& e = ring.entries[n % kTraceRing];
+    e.ns.store(monotonic_ns(), std::memory_order_relaxed);
+    e.since_ns.store(since_ns, std::memory_order_relaxed);
+    e.what.store(static_cast<std::uint64_t>(static_cast<std::uint32_t>(id)) << 8 |
+                     static_cast<std::uint64_t>(kind),
+                 std::memory_order_relaxed);
+    ring.written.store(n + 1, std::memory_order_release);
+}
+
+void clear_trace() { TraceRegistry::instance().clear(); }
+
+std::string render_chrome_trace(std::size_t max_events) {
+    std::int64_t cleared_ns;
+    const auto rings = TraceRegistry::instance().rings(cleared_ns);
+    // Each ring's events since the last clear, [from, written); a ring is
+    // written in time order, so the first one is found by bisection.
+    std::vector<std::uint64_t> from(rings.size());
+    std::vector<std::uint64_t> written(rings.size());
+    std::vector<std::size_t> by_size(rings.size());
+    for (std::size_t r = 0; r < rings.size(); ++r) {
+        written[r] = rings[r]->written.load(std::memory_order_acquire);
+        std::uint64_t lo = written[r] > kTraceRing ? written[r] - kTraceRing : 0;
+        std::uint64_t hi = written[r];
+        while (lo < hi) {
+            const std::uint64_t mid = lo + (hi - lo) / 2;
+            if (rings[r]->entries[mid % kTraceRing].ns.load(std::memory_order_relaxed) <
+                cleared_ns) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        from[r] = lo;
+        by_size[r] = r;
+    }
+    const auto held = [&](std::size_t r) { return static_cast<std::size_t>(written[r] - from[r]); };
+    // Smallest rings first, so each takes at most an even share of what is
+    // left and leaves the rest to the larger ones.
+    std::sort(by_size.begin(), by_size.end(),
+              [&held](std::size_t a, std::size_t b) { return held(a) < held(b); });
+    std::vector<std::size_t> take(rings.size());
+    std::size_t left = max_events;
+    for (std::size_t k = 0; k < by_size.size(); ++k) {
+        const std::size_t r = by_size[k];
+        take[r] = std::min(held(r), left / (by_size.size() - k));
+        left -= take[r];
+    }
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    char line[kTraceEventBytes];
+    for (std::size_t r = 0; r < rings.size(); ++r) {
+        const TraceRing* ring = rings[r].get();
+        for (std::uint64_t i = written[r] - take[r]; i < written[r]; ++i) {
+            const TraceRing::Entry& e = ring->entries[i % kTraceRing];
+            const std::int64_t ns = e.ns.load(std::memory_order_relaxed);
+            if (ns < cleared_ns) {
+                continue;
+            }
+            const std::uint64_t what = e.what.load(std::memory_order_relaxed);
+            const auto kind = static_cast<std::size_t>(what & 0xFF);
+            const auto id = static_cast<int>(static_cast<std::uint32_t>(what >> 8));
+            const std::int64_t since_ns = e.since_ns.load(std::memory_order_relaxed);
+            if (kind >= std::size(kNames)) {
+                continue;  // torn by a concurrent write
+            }
+            // Timestamps are microseconds; Print spans from fire to print.
+            int n;
+            if (static_cast<TraceKind>(kind) == TraceKind::Print && since_ns != 0) {
+                n = std::snprintf(line, sizeof line,
+                                  "%s\n{\"name\":\"print\",\"cat\":\"alarm\",\"ph\":\"X\","
+                                  "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,"
+                                  "\"args\":{\"id\":%d}}",
+                                  first ? "" : ",", since_ns / 1e3, (ns - since_ns) / 1e3,
+                                  ring->tid, id);
+            } else {
+                n = std::snprintf(line, sizeof line,
+                                  "%s\n{\"name\":\"%s\",\"cat\":\"alarm\",\"ph\":\"i\","
+                                  "\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+                                  "\"args\":{\"id\":%d}}",
+                                  first ? "" : ",", kNames[kind], ns / 1e3, ring->tid, id);
+            }
+            out.append(line, static_cast<std::size_t>(n));
+            first = false;
+        }
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+bool write_chrome_trace(std::string_view path) {
+    const std::string text = render_chrome_trace();
+    std::FILE* out = std::fopen(std::string(path).c_str(), "w");
+    if (out == nullptr) {
+        return false;
+    }
+    const bool written = std::fwrite(text.data(), 1, text.size(), out) == text.size();
+    const int error = errno;
+    if (std::fclose(out) != 0 || !written) {
+        if (!written) {
+            errno = error;
+        }
+        return false;
+    }
+    return true;
+}
+
+}  // namespace alarmd
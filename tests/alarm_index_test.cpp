@@ -0,0 +1,72 @@
+#include "alarmd/alarm_index.hpp"
+
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+TEST(AlarmIndex, InsertFindErase) {
+    AlarmIndex index;
+    Alarm a;
+    a.id = 42;
+    EXPECT_EQ(index.find(42), nullptr);
+    EXPECT_TRUE(index.insert(&a));
+    EXPECT_FALSE(index.insert(&a));
+    EXPECT_EQ(index.find(42), &a);
+    EXPECT_EQ(index.size(), 1u);
+    EXPECT_EQ(index.erase(42), &a);
+    EXPECT_EQ(index.erase(42), nullptr);
+    EXPECT_EQ(index.find(42), nullptr);
+    EXPECT_EQ(index.size(), 0u);
+}
+
+TEST(AlarmIndex, GrowsAndKeepsEntries) {
+    AlarmIndex index;
+    std::vector<Alarm> alarms(10'000);
+    for (int i = 0; i < 10'000; ++i) {
+        alarms[i].id = i * 16;  // stride that collides under a naive modulo
+        ASSERT_TRUE(index.insert(&alarms[i]));
+    }
+    EXPECT_GE(index.capacity() * 3, index.size() * 4);
+    for (int i = 0; i < 10'000; ++i) {
+        ASSERT_EQ(index.find(i * 16), &alarms[i]);
+    }
+}
+
+// Random inserts and erases against std::unordered_map; erase must keep
+// every probe run reachable after backward shifting.
+TEST(AlarmIndex, MatchesReference) {
+    AlarmIndex index;
+    std::unordered_map<int, Alarm*> ref;
+    std::vector<std::unique_ptr<Alarm>> pool;
+    std::mt19937 rng(3);
+    for (int step = 0; step < 100'000; ++step) {
+        int id = static_cast<int>(rng() % 4096);
+        if (rng() % 2 == 0) {
+            pool.push_back(std::make_unique<Alarm>());
+            pool.back()->id = id;
+            bool fresh = ref.emplace(id, pool.back().get()).second;
+            ASSERT_EQ(index.insert(pool.back().get()), fresh);
+        } else {
+            auto it = ref.find(id);
+            Alarm* expected = it == ref.end() ? nullptr : it->second;
+            ASSERT_EQ(index.erase(id), expected);
+            if (it != ref.end()) {
+                ref.erase(it);
+            }
+        }
+        ASSERT_EQ(index.size(), ref.size());
+    }
+    for (int id = 0; id < 4096; ++id) {
+        auto it = ref.find(id);
+        ASSERT_EQ(index.find(id), it == ref.end() ? nullptr : it->second);
+    }
+}
+
+}  // namespace
+}  // namespace alarmd
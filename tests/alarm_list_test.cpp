@@ -0,0 +1,97 @@
+#include "alarmd/alarm_list.hpp"
+
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+// Owns the nodes a test links into its list.
+class Nodes {
+public:
+    Alarm* make(int id, Deadline deadline) {
+        nodes_.push_back(std::make_unique<Alarm>());
+        nodes_.back()->id = id;
+        nodes_.back()->deadline = deadline;
+        return nodes_.back().get();
+    }
+
+private:
+    std::vector<std::unique_ptr<Alarm>> nodes_;
+};
+
+std::vector<int> ids(const AlarmList& list) {
+    std::vector<int> out;
+    list.for_each([&](const Alarm& a) { out.push_back(a.id); });
+    return out;
+}
+
+TEST(AlarmList, KeepsExpiryOrder) {
+    Nodes nodes;
+    AlarmList list;
+    list.insert(nodes.make(1, 30));
+    list.insert(nodes.make(2, 10));
+    list.insert(nodes.make(3, 20));
+    EXPECT_EQ(ids(list), (std::vector<int>{2, 3, 1}));
+    EXPECT_EQ(list.size(), 3u);
+}
+
+TEST(AlarmList, EqualExpiryIsFifo) {
+    Nodes nodes;
+    AlarmList list;
+    list.insert(nodes.make(1, 10));
+    list.insert(nodes.make(2, 10));
+    list.insert(nodes.make(3, 10));
+    EXPECT_EQ(ids(list), (std::vector<int>{1, 2, 3}));
+}
+
+TEST(AlarmList, FindAndRemove) {
+    Nodes nodes;
+    AlarmList list;
+    list.insert(nodes.make(1, 10));
+    list.insert(nodes.make(2, 20));
+    EXPECT_NE(list.find(2), nullptr);
+    EXPECT_EQ(list.find(5), nullptr);
+
+    Alarm* removed = list.remove(1);
+    ASSERT_NE(removed, nullptr);
+    EXPECT_EQ(removed->id, 1);
+    EXPECT_EQ(list.remove(1), nullptr);
+    EXPECT_EQ(ids(list), (std::vector<int>{2}));
+}
+
+TEST(AlarmList, PopFront) {
+    Nodes nodes;
+    AlarmList list;
+    EXPECT_EQ(list.pop_front(), nullptr);
+    list.insert(nodes.make(1, 20));
+    list.insert(nodes.make(2, 10));
+    Alarm* a = list.pop_front();
+    ASSERT_NE(a, nullptr);
+    EXPECT_EQ(a->id, 2);
+    EXPECT_EQ(list.front()->id, 1);
+    EXPECT_EQ(list.size(), 1u);
+}
+
+TEST(AlarmList, PurgeAndClearRelease) {
+    Nodes nodes;
+    AlarmList list;
+    for (int id = 0; id < 6; ++id) {
+        Alarm* a = nodes.make(id, id);
+        a->cancelled = id % 2 == 0;
+        list.insert(a);
+    }
+    std::vector<int> released;
+    auto release = [&](Alarm* a) { released.push_back(a->id); };
+    EXPECT_EQ(list.purge_cancelled(release), 3u);
+    EXPECT_EQ(released, (std::vector<int>{0, 2, 4}));
+    EXPECT_EQ(ids(list), (std::vector<int>{1, 3, 5}));
+    list.clear(release);
+    EXPECT_TRUE(list.empty());
+    EXPECT_EQ(released.size(), 6u);
+}
+
+}  // namespace
+}  // namespace alarmd
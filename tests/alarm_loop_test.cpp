@@ -0,0 +1,239 @@
+#include "alarmd/alarm_loop.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+using namespace std::chrono_literals;
+
+// Fired alarms as "id:payload", in firing order.
+struct Recorder {
+    std::vector<std::string> fired;
+
+    LoopOptions options(QueueKind queue = QueueKind::Wheel) {
+        return {.queue = queue, .on_fired = [this](FiredAlarm& a) {
+                    fired.push_back(std::to_string(a.id) + ":" + std::string(a.message.view()));
+                }};
+    }
+};
+
+TEST(AlarmLoop, FiresInDeadlineOrderAndCancels) {
+    for (QueueKind queue : {QueueKind::List, QueueKind::Heap, QueueKind::Wheel}) {
+        Recorder r;
+        AlarmLoop loop(r.options(queue));
+        const Deadline t = monotonic_now();
+        ASSERT_TRUE(loop.schedule(1, t + 30'000, "third"));
+        const AlarmHandle gone = loop.schedule(2, t + 20'000, "cancelled");
+        ASSERT_TRUE(loop.schedule(3, t + 10'000, "first"));
+        ASSERT_TRUE(loop.schedule(4, t + 10'000, "second"));  // same deadline: FIFO
+        EXPECT_FALSE(loop.schedule(1, t, "taken"));
+        EXPECT_TRUE(loop.cancel(gone));
+        EXPECT_FALSE(loop.cancel(gone));
+        EXPECT_EQ(loop.pending(), 3u);
+
+        EXPECT_EQ(loop.poll(t + 5'000), 0u);
+        EXPECT_EQ(loop.poll(t + 40'000), 3u);
+        EXPECT_EQ(r.fired, (std::vector<std::string>{"3:first", "4:second", "1:third"}))
+            << queue_kind_name(queue);
+        EXPECT_EQ(loop.pending(), 0u);
+    }
+}
+
+// A handle names one alarm, not its id: once the id is reused the old
+// handle cancels nothing.
+TEST(AlarmLoop, StaleHandlesCancelNothing) {
+    Recorder r;
+    AlarmLoop loop(r.options());
+    const Deadline t = monotonic_now();
+    const AlarmHandle first = loop.schedule(7, t, "first");
+    EXPECT_EQ(loop.poll(t), 1u);
+    const AlarmHandle second = loop.schedule(7, t + 1000, "second");
+    EXPECT_FALSE(loop.cancel(first));
+    EXPECT_FALSE(loop.cancel(AlarmHandle{}));
+    EXPECT_EQ(loop.pending(), 1u);
+    EXPECT_TRUE(loop.cancel(second));
+}
+
+AlarmTask sleeper(AlarmLoop& loop, Deadline until, std::vector<std::string>& log, std::string name) {
+    log.push_back(name + " sleeps");
+    co_await loop.sleep_until(until);
+    log.push_back(name + " wakes");
+    co_await loop.sleep_until(until + 1000);
+    log.push_back(name + " done");
+}
+
+TEST(AlarmLoop, ResumesSleepersInOrderWithAlarms) {
+    std::vector<std::string> log;
+    AlarmLoop loop({.on_fired = [&log](FiredAlarm& a) {
+        log.push_back("alarm " + std::string(a.message.view()));
+    }});
+    const Deadline t = monotonic_now() + 1'000'000;
+    sleeper(loop, t + 2000, log, "b");
+    sleeper(loop, t, log, "a");
+    loop.schedule(1, t + 1500, "x");
+    EXPECT_EQ(loop.sleeping(), 2u);
+    EXPECT_EQ(log, (std::vector<std::string>{"b sleeps", "a sleeps"}));
+
+    EXPECT_EQ(loop.poll(t + 2500), 4u);  // b's second sleep is not due until t + 3000
+    EXPECT_EQ(log, (std::vector<std::string>{"b sleeps", "a sleeps", "a wakes", "a done",
+                                             "alarm x", "b wakes"}));
+    EXPECT_EQ(loop.sleeping(), 1u);
+    EXPECT_EQ(loop.poll(t + 3000), 1u);
+    EXPECT_EQ(log.back(), "b done");
+    EXPECT_EQ(loop.pending(), 0u);
+}
+
+AlarmTask watchdog(AlarmLoop& loop, AlarmHandle& timeout, bool& done) {
+    // Arms a timeout, does some work, and disarms it when the work is done.
+    timeout = loop.schedule(1, 50ms, "timed out");
+    co_await loop.sleep_for(1ms);
+    done = loop.cancel(timeout);
+}
+
+TEST(AlarmLoop, RunSleepsUntilNothingIsPending) {
+    Recorder r;
+    AlarmLoop loop(r.options());
+    AlarmHandle timeout;
+    bool done = false;
+    const Deadline start = monotonic_now();
+    watchdog(loop, timeout, done);
+    loop.schedule(2, 5ms, "late");
+    loop.run();
+    EXPECT_TRUE(done);
+    EXPECT_EQ(r.fired, (std::vector<std::string>{"2:late"}));
+    EXPECT_GE(monotonic_now() - start, 5'000);
+    EXPECT_LT(monotonic_now() - start, 50'000);  // the cancelled timeout was never waited for
+}
+
+// A coroutine still asleep when the loop goes is destroyed, locals and all.
+TEST(AlarmLoop, DestroysSleepingFrames) {
+    struct Guard {
+        bool* destroyed;
+        ~Guard() { *destroyed = true; }
+    };
+    bool destroyed = false;
+    {
+        AlarmLoop loop;
+        [](AlarmLoop& loop, bool* flag) -> AlarmTask {
+            Guard guard{flag};
+            co_await loop.sleep_for(1h);
+        }(loop, &destroyed);
+        EXPECT_FALSE(destroyed);
+    }
+    EXPECT_TRUE(destroyed);
+}
+
+TEST(AlarmLoop, ReusesNodes) {
+    AlarmLoop loop;
+    const Deadline t = monotonic_now() + 1'000'000;
+    for (int round = 0; round < 10; ++round) {
+        for (int id = 0; id < 1000; ++id) {
+            loop.schedule(id, t + id, "payload");
+        }
+        EXPECT_EQ(loop.poll(t + 1000), 1000u);
+    }
+    EXPECT_EQ(loop.pool_stats().slabs, 1u);
+    EXPECT_EQ(loop.pool_stats().live, 0u);
+}
+
+// Every compile-time configuration behaves like the runtime-queue loop.
+template <typename Loop>
+class AlarmLoopConfig : public ::testing::Test {};
+
+using Configs = ::testing::Types<BasicAlarmLoop<ListQueue, VirtualClock, NullLock>,
+                                 BasicAlarmLoop<HeapQueue, MonotonicClock, std::mutex>,
+                                 BasicAlarmLoop<TimingWheel, VirtualClock, SpinLock>,
+                                 BasicAlarmLoop<TimingWheel, MonotonicClock, NullLock>>;
+TYPED_TEST_SUITE(AlarmLoopConfig, Configs);
+
+TYPED_TEST(AlarmLoopConfig, FiresInDeadlineOrderAndCancels) {
+    Recorder r;
+    TypeParam loop(r.options());
+    const Deadline t = loop.clock().now();
+    ASSERT_TRUE(loop.schedule(1, t + 30'000, "third"));
+    const AlarmHandle gone = loop.schedule(2, t + 20'000, "cancelled");
+    ASSERT_TRUE(loop.schedule(3, t + 10'000, "first"));
+    ASSERT_TRUE(loop.schedule(4, t + 10'000, "second"));
+    EXPECT_TRUE(loop.cancel(gone));
+    EXPECT_EQ(loop.poll(t + 5'000), 0u);
+    EXPECT_EQ(loop.poll(t + 40'000), 3u);
+    EXPECT_EQ(r.fired, (std::vector<std::string>{"3:first", "4:second", "1:third"}));
+}
+
+AlarmTask ticker(BasicAlarmLoop<TimingWheel, VirtualClock>& loop, int ticks,
+                 std::vector<Deadline>& woke) {
+    for (int i = 0; i < ticks; ++i) {
+        co_await loop.sleep_for(std::chrono::hours(1));
+        woke.push_back(loop.clock().now());
+    }
+}
+
+// On a virtual clock run() jumps from deadline to deadline: a day of
+// hourly ticks passes at once.
+TEST(AlarmLoop, RunsVirtualTimeWithoutSleeping) {
+    BasicAlarmLoop<TimingWheel, VirtualClock> loop;
+    loop.clock().set(1'000'000);
+    std::vector<Deadline> woke;
+    ticker(loop, 24, woke);
+    const Deadline start = monotonic_now();
+    loop.run();
+    EXPECT_LT(monotonic_now() - start, 1'000'000);
+    ASSERT_EQ(woke.size(), 24u);
+    for (std::size_t i = 0; i < woke.size(); ++i) {
+        EXPECT_EQ(woke[i], 1'000'000 + static_cast<Deadline>(i + 1) * 3'600'000'000);
+    }
+}
+
+// With a lock, threads schedule and cancel while another polls; every
+// alarm left standing fires exactly once.
+template <typename Lock>
+void schedule_from_threads() {
+    std::atomic<int> fired{0};
+    BasicAlarmLoop<TimingWheel, VirtualClock, Lock> loop(
+        {.on_fired = [&fired](FiredAlarm&) { fired.fetch_add(1, std::memory_order_relaxed); }});
+    constexpr int kThreads = 4;
+    constexpr int kPerThread = 20'000;
+    std::atomic<bool> done{false};
+    std::thread poller([&] {
+        while (!done.load(std::memory_order_acquire)) {
+            loop.clock().advance(std::chrono::microseconds(100));
+            loop.poll();
+        }
+    });
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&loop, t] {
+            for (int i = 0; i < kPerThread; ++i) {
+                const int id = t * kPerThread + i;
+                const AlarmHandle h = loop.schedule(id, std::chrono::microseconds(i % 500), "x");
+                ASSERT_TRUE(h);
+                if (i % 2 == 1) {
+                    loop.cancel(h);  // may already have fired
+                }
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    done.store(true, std::memory_order_release);
+    poller.join();
+    loop.clock().advance(std::chrono::seconds(1));
+    loop.poll();
+    EXPECT_EQ(loop.pending(), 0u);
+    EXPECT_GE(fired.load(), kThreads * kPerThread / 2);
+    EXPECT_LE(fired.load(), kThreads * kPerThread);
+}
+
+TEST(AlarmLoop, SchedulesFromThreadsWithAMutex) { schedule_from_threads<std::mutex>(); }
+TEST(AlarmLoop, SchedulesFromThreadsWithASpinLock) { schedule_from_threads<SpinLock>(); }
+
+}  // namespace
+}  // namespace alarmd
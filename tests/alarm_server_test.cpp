@@ -0,0 +1,60 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// Runs alarm_server interactively with `input` on a pipe and returns what it
+// printed to stdout.
+std::string run_server(const std::string& input, const std::string& args) {
+    const std::string command =
+        "printf '" + input + "' | " + ALARMD_SERVER + " " + args + " 2>/dev/null";
+    std::FILE* out = popen(command.c_str(), "r");
+    if (out == nullptr) {
+        return {};
+    }
+    std::string text;
+    char buf[4096];
+    for (std::size_t n; (n = std::fread(buf, 1, sizeof buf, out)) > 0;) {
+        text.append(buf, n);
+    }
+    pclose(out);
+    return text;
+}
+
+TEST(AlarmServer, InteractiveResultsComeBeforeTheNextPrompt) {
+    // Posted commands are reported from their shard's thread; a result that
+    // lost the race with the prompt would land in the next prompt's chunk.
+    const std::vector<std::string> expected = {
+        "",
+        "Alarm(1) Inserted into Alarm List at ",
+        "Alarm(2) Inserted into Alarm List at ",
+        "Alarm(1) Cancelled at ",
+        "Bad command\n",
+        "View Alarms at ",
+        "",
+    };
+    for (int run = 0; run < 20; ++run) {
+        const std::string got =
+            run_server("Start_Alarm(1): 10 hi\\nStart_Alarm(2): 10 ho\\nCancel_Alarm(1)\\n"
+                       "bogus\\nView_Alarms\\n",
+                       "-s 2 -d 2");
+        std::vector<std::string> chunks;
+        std::size_t from = 0;
+        for (std::size_t at; (at = got.find("alarm> ", from)) != std::string::npos;) {
+            chunks.push_back(got.substr(from, at - from));
+            from = at + 7;
+        }
+        chunks.push_back(got.substr(from));
+        ASSERT_EQ(chunks.size(), expected.size()) << got;
+        for (std::size_t i = 0; i < chunks.size(); ++i) {
+            EXPECT_EQ(chunks[i].rfind(expected[i], 0), 0u) << got;
+            EXPECT_EQ(chunks[i].empty(), expected[i].empty()) << got;
+        }
+        EXPECT_NE(chunks[5].find("1. Alarm(2): Expiry = "), std::string::npos) << got;
+    }
+}
+
+}  // namespace
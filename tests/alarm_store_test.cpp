@@ -0,0 +1,269 @@
+#include "alarmd/alarm_store.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "alarmd/scheduler.hpp"
+#include "test_util.hpp"
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+using namespace std::chrono_literals;
+namespace fs = std::filesystem;
+
+SchedulerOptions persistent(const TempDir& dir, int shards = 2) {
+    return {.display_threads = 1, .shards = shards, .out = stderr, .data_dir = dir.path()};
+}
+
+std::vector<AlarmView> view(const Scheduler& s) {
+    std::vector<AlarmView> alarms;
+    s.snapshot({}, alarms);
+    return alarms;
+}
+
+TEST(AlarmStore, RestoresAlarmsAfterRestart) {
+    TempDir dir;
+    {
+        Scheduler s(persistent(dir));
+        s.start();
+        ASSERT_TRUE(s.start_alarm(1, 3600s, "one"));
+        ASSERT_TRUE(s.start_alarm(2, 3600s, "two"));
+        ASSERT_TRUE(s.start_alarm(3, 3600s, "three"));
+        ASSERT_TRUE(s.change_alarm(2, 7200s, "changed"));
+        ASSERT_TRUE(s.cancel_alarm(3));
+        s.post({RequestKind::Start, 4, 1800s, Message("posted")});
+    }
+    Scheduler s(persistent(dir, 3));  // a different shard count still restores
+    s.start();
+    const std::vector<AlarmView> alarms = view(s);
+    ASSERT_EQ(alarms.size(), 3u);
+    EXPECT_EQ(alarms[0].id, 4);
+    EXPECT_EQ(alarms[1].id, 1);
+    EXPECT_EQ(alarms[1].message.view(), "one");
+    EXPECT_EQ(alarms[2].id, 2);
+    EXPECT_EQ(alarms[2].message.view(), "changed");
+    EXPECT_EQ(alarms[2].delay, 7200s);
+    EXPECT_GT(alarms[2].deadline - monotonic_now(), std::chrono::microseconds(7100s).count());
+    EXPECT_EQ(s.store()->recovery().log_records, 6u);
+    // Restored ids are taken; new commands apply on top.
+    EXPECT_FALSE(s.start_alarm(1, 1s, "dup"));
+    EXPECT_TRUE(s.cancel_alarm(1));
+}
+
+TEST(AlarmStore, FiredAlarmsStayFired) {
+    TempDir dir;
+    {
+        Scheduler s(persistent(dir));
+        s.start();
+        ASSERT_TRUE(s.start_alarm(1, 0s, "now"));
+        ASSERT_TRUE(s.start_alarm(2, 3600s, "later"));
+        ASSERT_TRUE(wait_for_fired(s, 1));
+    }
+    Scheduler s(persistent(dir));
+    s.start();
+    const std::vector<AlarmView> alarms = view(s);
+    ASSERT_EQ(alarms.size(), 1u);
+    EXPECT_EQ(alarms[0].id, 2);
+}
+
+TEST(AlarmStore, PeriodicAlarmsKeepTheirSchedule) {
+    TempDir dir;
+    {
+        Scheduler s(persistent(dir));
+        s.start();
+        ASSERT_TRUE(s.start_alarm(1, 10ms, "tick", 5));
+        ASSERT_TRUE(wait_for_fired(s, 2));
+    }
+    Scheduler s(persistent(dir));
+    s.start();
+    const std::vector<AlarmView> alarms = view(s);
+    if (!alarms.empty()) {  // all six fires may be overdue by now
+        EXPECT_EQ(alarms[0].delay, 10ms);
+        EXPECT_LE(alarms[0].repeats, 3u);
+    }
+    // The fires left run out instead of starting over.
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (s.pending() != 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(s.pending(), 0u);
+}
+
+TEST(AlarmStore, GroupsSurviveRestart) {
+    TempDir dir;
+    {
+        Scheduler s(persistent(dir));
+        s.start();
+        ASSERT_TRUE(s.start_alarm(1, 3600s, "one", 0, "tenant"));
+        ASSERT_TRUE(s.start_alarm(2, 3600s, "two", 0, "tenant"));
+        ASSERT_TRUE(s.start_alarm(3, 3600s, "three"));
+        s.store()->checkpoint();
+        ASSERT_TRUE(s.change_alarm(3, 3600s, "joined", 0, "tenant"));
+    }
+    Scheduler s(persistent(dir));
+    s.start();
+    EXPECT_EQ(view(s)[0].group.view(), "tenant");
+    EXPECT_EQ(s.cancel_group("tenant"), 3u);
+    EXPECT_EQ(s.pending(), 0u);
+}
+
+TEST(AlarmStore, ColdAlarmsSurviveRestart) {
+    TempDir dir;
+    SchedulerOptions options = persistent(dir);
+    options.cold_horizon = 3600s;
+    {
+        Scheduler s(options);
+        s.start();
+        ASSERT_TRUE(s.start_alarm(1, 72h, "one"));
+        ASSERT_TRUE(s.start_alarm(2, 72h, "two"));
+        s.store()->checkpoint();
+        ASSERT_TRUE(s.start_alarm(3, 72h, "three"));
+        ASSERT_TRUE(s.change_alarm(2, 96h, "changed"));
+        ASSERT_TRUE(s.cancel_alarm(1));
+        EXPECT_EQ(s.cold_stats().alarms, 2u);
+    }
+    Scheduler s(options);
+    s.start();
+    EXPECT_EQ(s.cold_stats().alarms, 2u);
+    const std::vector<AlarmView> alarms = view(s);
+    ASSERT_EQ(alarms.size(), 2u);
+    EXPECT_EQ(alarms[0].id, 3);
+    EXPECT_EQ(alarms[1].id, 2);
+    EXPECT_EQ(alarms[1].message.view(), "changed");
+    EXPECT_EQ(alarms[1].delay, 96h);
+}
+
+TEST(AlarmStore, AlarmsDueWhileDownFireOnStart) {
+    TempDir dir;
+    {
+        Scheduler s(persistent(dir));
+        s.start();
+        ASSERT_TRUE(s.start_alarm(7, 20ms, "overdue"));
+        s.stop();
+    }
+    std::this_thread::sleep_for(40ms);
+    Scheduler s(persistent(dir));
+    s.start();
+    EXPECT_TRUE(wait_for_fired(s, 1));
+}
+
+TEST(AlarmStore, CheckpointReplacesOldLogs) {
+    TempDir dir;
+    {
+        Scheduler s(persistent(dir));
+        s.start();
+        for (int id = 0; id < 100; ++id) {
+            ASSERT_TRUE(s.start_alarm(id, 3600s, "bulk"));
+        }
+        s.store()->checkpoint();
+        EXPECT_EQ(s.store()->checkpoints(), 1u);
+        EXPECT_EQ(dir.logs().size(), 1u);
+        ASSERT_TRUE(s.cancel_alarm(0));
+    }
+    Scheduler s(persistent(dir));
+    s.start();
+    EXPECT_EQ(s.pending(), 99u);
+    EXPECT_EQ(s.store()->recovery().snapshot_alarms, 100u);
+    EXPECT_EQ(s.store()->recovery().log_records, 1u);
+}
+
+TEST(AlarmStore, LogSizeTriggersCheckpoint) {
+    TempDir dir;
+    SchedulerOptions options = persistent(dir);
+    options.commit_interval = 0us;
+    options.checkpoint_bytes = 4096;
+    Scheduler s(options);
+    s.start();
+    for (int id = 0; id < 1000; ++id) {
+        ASSERT_TRUE(s.start_alarm(id, 3600s, "fill the log"));
+    }
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (s.store()->checkpoints() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_GE(s.store()->checkpoints(), 1u);
+    EXPECT_TRUE(fs::exists(dir.path() + "/snapshot"));
+}
+
+TEST(AlarmStore, TornTailIsDropped) {
+    TempDir dir;
+    {
+        Scheduler s(persistent(dir));
+        s.start();
+        ASSERT_TRUE(s.start_alarm(1, 3600s, "kept"));
+        ASSERT_TRUE(s.start_alarm(2, 3600s, "kept"));
+    }
+    // Half a record, as a crash in the middle of a write leaves it.
+    const std::vector<std::string> logs = dir.logs();
+    ASSERT_FALSE(logs.empty());
+    const int fd = open(logs.back().c_str(), O_WRONLY | O_APPEND);
+    ASSERT_GE(fd, 0);
+    const char partial[20] = {1, 2, 3};
+    ASSERT_EQ(write(fd, partial, sizeof partial), static_cast<ssize_t>(sizeof partial));
+    close(fd);
+
+    Scheduler s(persistent(dir));
+    s.start();
+    EXPECT_EQ(s.pending(), 2u);
+    EXPECT_EQ(s.store()->recovery().torn_logs, 1u);
+}
+
+TEST(AlarmStore, SyncCommitReturnsAfterTheSync) {
+    TempDir dir;
+    SchedulerOptions options = persistent(dir);
+    options.sync_commit = true;
+    options.commit_interval = 10s;  // only a waiter can make the commit thread sync
+    Scheduler s(options);
+    s.start();
+    ASSERT_TRUE(s.start_alarm(1, 3600s, "durable"));
+    EXPECT_GE(s.store()->syncs(), 1u);
+}
+
+TEST(AlarmStore, SyncCommitReportsAFailedLogWrite) {
+    TempDir dir;
+    SchedulerOptions options = persistent(dir);
+    options.sync_commit = true;
+    Scheduler s(options);
+    s.start();
+    ASSERT_TRUE(s.start_alarm(1, 3600s, "durable"));
+    // Put a full disk under the open write-ahead log.
+    const int full = ::open("/dev/full", O_WRONLY | O_CLOEXEC);
+    ASSERT_GE(full, 0);
+    bool swapped = false;
+    for (const auto& entry : fs::directory_iterator("/proc/self/fd")) {
+        std::error_code ec;
+        const fs::path target = fs::read_symlink(entry.path(), ec);
+        if (!ec && target.parent_path() == fs::path(dir.path()) &&
+            target.filename().string().starts_with("wal.")) {
+            ASSERT_GE(dup2(full, std::stoi(entry.path().filename().string())), 0);
+            swapped = true;
+        }
+    }
+    ::close(full);
+    ASSERT_TRUE(swapped);
+    EXPECT_FALSE(s.start_alarm(2, 3600s, "lost"));
+    EXPECT_FALSE(s.cancel_alarm(1));
+}
+
+TEST(AlarmStore, CorruptSnapshotIsAnError) {
+    TempDir dir;
+    std::FILE* f = std::fopen((dir.path() + "/snapshot").c_str(), "w");
+    ASSERT_NE(f, nullptr);
+    std::fputs("not a snapshot at all, definitely", f);
+    std::fclose(f);
+    Scheduler s(persistent(dir));
+    EXPECT_THROW(s.start(), std::runtime_error);
+}
+
+}  // namespace
+}  // namespace alarmd
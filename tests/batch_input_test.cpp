@@ -0,0 +1,134 @@
+#include "alarmd/batch_input.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+std::vector<std::string> lines_of(int fd, std::size_t block) {
+    std::vector<std::string> lines;
+    for_each_line(fd, [&](std::string_view line) { lines.emplace_back(line); }, block);
+    return lines;
+}
+
+// Writes `text` into a pipe from another thread and splits the read end.
+std::vector<std::string> lines_from_pipe(const std::string& text, std::size_t block) {
+    int fds[2];
+    EXPECT_EQ(pipe(fds), 0);
+    std::thread writer([&] {
+        std::size_t done = 0;
+        while (done < text.size()) {
+            const ssize_t n = write(fds[1], text.data() + done, text.size() - done);
+            if (n <= 0) {
+                break;
+            }
+            done += static_cast<std::size_t>(n);
+        }
+        close(fds[1]);
+    });
+    auto lines = lines_of(fds[0], block);
+    writer.join();
+    close(fds[0]);
+    return lines;
+}
+
+TEST(ForEachLine, SplitsPipeAcrossSmallBlocks) {
+    const std::string longer(40, 'x');
+    const auto lines = lines_from_pipe("a\nbc\n\n" + longer + "\nlast", 7);
+    EXPECT_EQ(lines, (std::vector<std::string>{"a", "bc", "", longer, "last"}));
+}
+
+TEST(ForEachLine, EmptyInputCallsNothing) {
+    EXPECT_TRUE(lines_from_pipe("", 16).empty());
+}
+
+TEST(ForEachLine, MapsRegularFileFromCurrentOffset) {
+    char path[] = "/tmp/alarmd_batch_XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    unlink(path);
+    const std::string text = "skip\nStart_Alarm(1): 5 one\r\nView_Alarms\n";
+    ASSERT_EQ(write(fd, text.data(), text.size()), static_cast<ssize_t>(text.size()));
+    ASSERT_EQ(lseek(fd, 5, SEEK_SET), 5);
+    const auto lines = lines_of(fd, 16);
+    close(fd);
+    EXPECT_EQ(lines, (std::vector<std::string>{"Start_Alarm(1): 5 one\r", "View_Alarms"}));
+}
+
+TEST(BatchSubmitter, PostsBatchesAndCountsBadLines) {
+    std::FILE* sink = std::fopen("/dev/null", "w");
+    ASSERT_NE(sink, nullptr);
+    {
+        Scheduler s({.display_threads = 1, .shards = 3, .out = sink});
+        s.start();
+        BatchSubmitter submitter(s, 8, sink);
+        for (int id = 1; id <= 100; ++id) {
+            EXPECT_TRUE(submitter.submit("Start_Alarm(" + std::to_string(id) + "): 60 m"));
+        }
+        EXPECT_TRUE(submitter.submit("   "));
+        EXPECT_FALSE(submitter.submit("Start_Alarm(x): 60 m"));
+        EXPECT_TRUE(submitter.submit("Cancel_Alarm(7)"));
+        submitter.flush();
+        s.drain();
+        EXPECT_EQ(s.pending(), 99u);
+        EXPECT_EQ(submitter.stats().lines, 102u);
+        EXPECT_EQ(submitter.stats().commands, 101u);
+        EXPECT_EQ(submitter.stats().invalid, 1u);
+        s.stop();
+    }
+    std::fclose(sink);
+}
+
+TEST(BatchSubmitter, BulkCommandsReportASummary) {
+    char* buf = nullptr;
+    std::size_t len = 0;
+    std::FILE* out = open_memstream(&buf, &len);
+    {
+        Scheduler s({.display_threads = 1, .shards = 2, .out = out});
+        s.start();
+        BatchSubmitter submitter(s, 1024, out);
+        EXPECT_TRUE(submitter.submit("Start_Alarm(5): 60 queued"));
+        EXPECT_TRUE(submitter.submit("Start_Alarms(1-10): 60 tenant"));
+        EXPECT_EQ(s.pending(), 10u);
+        EXPECT_TRUE(submitter.submit("Cancel_Alarms(2,4-5,99)"));
+        EXPECT_EQ(s.pending(), 7u);
+        s.stop();
+    }
+    std::fclose(out);
+    const std::string text(buf, len);
+    std::free(buf);
+    EXPECT_NE(text.find("Alarms(1-10) 9 of 10 Inserted into Alarm List at "), std::string::npos)
+        << text;
+    EXPECT_NE(text.find(": 60 tenant\n"), std::string::npos) << text;
+    EXPECT_NE(text.find("Alarms(2,4-5,99) 3 of 4 Cancelled at "), std::string::npos) << text;
+}
+
+TEST(BatchSubmitter, ViewSeesEarlierCommands) {
+    char* buf = nullptr;
+    std::size_t len = 0;
+    std::FILE* view = open_memstream(&buf, &len);
+    {
+        Scheduler s({.display_threads = 1, .out = view});
+        s.start();
+        BatchSubmitter submitter(s, 1024, view);
+        EXPECT_TRUE(submitter.submit("Start_Alarm(5): 60 queued"));
+        EXPECT_TRUE(submitter.submit("View_Alarms"));
+        s.stop();
+    }
+    std::fclose(view);
+    const std::string text(buf, len);
+    std::free(buf);
+    EXPECT_NE(text.find("Alarm(5): Expiry = "), std::string::npos) << text;
+}
+
+}  // namespace
+}  // namespace alarmd
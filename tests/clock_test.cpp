@@ -0,0 +1,79 @@
+#include "alarmd/clock.hpp"
+
+#include <mutex>
+#include <string_view>
+
+#include <gtest/gtest.h>
+
+#include "alarmd/cond_var.hpp"
+
+namespace alarmd {
+namespace {
+
+using namespace std::chrono_literals;
+
+std::chrono::microseconds parse(std::string_view text, std::string_view* rest = nullptr) {
+    std::chrono::microseconds d{-1};
+    std::string_view p = text;
+    EXPECT_TRUE(parse_duration(p, d)) << text;
+    if (rest != nullptr) {
+        *rest = p;
+    }
+    return d;
+}
+
+TEST(Duration, ParsesUnitsAndFractions) {
+    EXPECT_EQ(parse("30"), 30s);
+    EXPECT_EQ(parse("30s"), 30s);
+    EXPECT_EQ(parse("1.5s"), 1500ms);
+    EXPECT_EQ(parse("1.5"), 1500ms);
+    EXPECT_EQ(parse("250ms"), 250ms);
+    EXPECT_EQ(parse("0.25ms"), 250us);
+    EXPECT_EQ(parse("500us"), 500us);
+    EXPECT_EQ(parse("0.0000019"), 1us);
+
+    std::string_view rest;
+    EXPECT_EQ(parse("10ms rest", &rest), 10ms);
+    EXPECT_EQ(rest, " rest");
+    // Trailing unit letters are only consumed as a whole.
+    EXPECT_EQ(parse("5m", &rest), 5s);
+    EXPECT_EQ(rest, "m");
+    EXPECT_EQ(parse(std::string_view("7ms", 2), &rest), 7s);
+    EXPECT_EQ(rest, "m");
+}
+
+TEST(Duration, RejectsBadInput) {
+    for (const char* text : {"", "-1", "ms", ".5", "1.", "99999999999999999999"}) {
+        std::chrono::microseconds d{0};
+        std::string_view p = text;
+        EXPECT_FALSE(parse_duration(p, d)) << text;
+        EXPECT_EQ(p, text);
+    }
+}
+
+TEST(Duration, FormatRoundTrips) {
+    char buf[32];
+    EXPECT_STREQ(format_duration(30s, buf, sizeof buf), "30");
+    EXPECT_STREQ(format_duration(1500ms, buf, sizeof buf), "1500ms");
+    EXPECT_STREQ(format_duration(1234us, buf, sizeof buf), "1234us");
+    for (std::chrono::microseconds d : {0us, 7us, 250000us, 90000000us}) {
+        const char* text = format_duration(d, buf, sizeof buf);
+        EXPECT_EQ(parse(text), d);
+    }
+}
+
+TEST(CondVar, TimedWaitUsesMonotonicDeadline) {
+    std::mutex mutex;
+    CondVar cond;
+    std::unique_lock<std::mutex> lock(mutex);
+    const Deadline begin = monotonic_now();
+    while (cond.wait_until(lock, begin + 20'000)) {
+    }
+    const Deadline waited = monotonic_now() - begin;
+    EXPECT_GE(waited, 20'000);
+    EXPECT_LT(waited, 500'000);
+    EXPECT_FALSE(cond.wait_until(lock, begin));
+}
+
+}  // namespace
+}  // namespace alarmd
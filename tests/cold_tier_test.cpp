@@ -0,0 +1,189 @@
+#include "alarmd/cold_tier.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "alarmd/message.hpp"
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr Deadline kBucket = Deadline{1} << ColdTier::kBucketBits;
+
+TEST(ColdTier, InsertFindErase) {
+    ColdTier tier;
+    tier.insert(7, 5 * kBucket + 123, 3600s, "far away", 0);
+    tier.insert(8, 9 * kBucket, 7200s, "further", 42);
+    EXPECT_EQ(tier.size(), 2u);
+    EXPECT_TRUE(tier.contains(7));
+    EXPECT_FALSE(tier.contains(9));
+
+    ColdAlarm a;
+    ASSERT_TRUE(tier.find(7, a));
+    EXPECT_EQ(a.deadline, 5 * kBucket + 123);
+    EXPECT_EQ(a.delay, 3600s);
+    EXPECT_EQ(a.message, "far away");
+    EXPECT_EQ(a.owner, 0u);
+    ASSERT_TRUE(tier.find(8, a));
+    EXPECT_EQ(a.owner, 42u);
+
+    Deadline start;
+    ASSERT_TRUE(tier.first_bucket(start));
+    EXPECT_EQ(start, 5 * kBucket);
+    EXPECT_TRUE(tier.erase(7, &a));
+    EXPECT_EQ(a.message, "far away");
+    EXPECT_FALSE(tier.erase(7));
+    ASSERT_TRUE(tier.first_bucket(start));
+    EXPECT_EQ(start, 9 * kBucket);  // the emptied bucket is gone
+    EXPECT_EQ(tier.stats().buckets, 1u);
+    tier.clear();
+    EXPECT_EQ(tier.size(), 0u);
+    EXPECT_FALSE(tier.first_bucket(start));
+}
+
+TEST(ColdTier, PromotesInInsertionOrderAndSkipsRemovedRows) {
+    ColdTier tier;
+    for (int id = 0; id < 10; ++id) {
+        tier.insert(id, 3 * kBucket + (10 - id), 1s, "row " + std::to_string(id),
+                    static_cast<std::uint32_t>(id));
+    }
+    tier.insert(100, 4 * kBucket, 1s, "next bucket", 0);
+    ASSERT_TRUE(tier.erase(4));
+    std::vector<int> ids;
+    const auto collect = [&ids](const ColdAlarm& a) {
+        EXPECT_EQ(a.message, "row " + std::to_string(a.id));
+        EXPECT_EQ(a.owner, static_cast<std::uint32_t>(a.id));
+        ids.push_back(a.id);
+    };
+    EXPECT_EQ(tier.promote(3, collect), 3u);
+    EXPECT_EQ(ids, (std::vector<int>{0, 1, 2}));
+    EXPECT_FALSE(tier.contains(1));
+    EXPECT_EQ(tier.size(), 7u);
+    EXPECT_EQ(tier.promote(100, collect), 7u);  // ids 3-9, one of them removed
+    EXPECT_EQ(ids, (std::vector<int>{0, 1, 2, 3, 5, 6, 7, 8, 9}));
+    Deadline start;
+    ASSERT_TRUE(tier.first_bucket(start));
+    EXPECT_EQ(start, 4 * kBucket);
+    EXPECT_EQ(tier.size(), 1u);
+}
+
+TEST(ColdTier, KeepsExactDelays) {
+    ColdTier tier;
+    const std::vector<std::chrono::microseconds> delays = {
+        0us, 1500us, 250ms, 72h, 72h + 1us, 24h * 3650, 24h * 3650 + 1ms};
+    for (std::size_t i = 0; i < delays.size(); ++i) {
+        tier.insert(static_cast<int>(i), kBucket, delays[i], std::to_string(i), 0);
+    }
+    ASSERT_TRUE(tier.erase(1));  // a mapped delay, removed
+    for (std::size_t i = 0; i < delays.size(); ++i) {
+        ColdAlarm a;
+        ASSERT_EQ(tier.find(static_cast<int>(i), a), i != 1);
+        if (i != 1) {
+            EXPECT_EQ(a.delay, delays[i]) << i;
+            EXPECT_EQ(a.message, std::to_string(i));  // the stride still finds it
+        }
+    }
+}
+
+TEST(ColdTier, TruncatesLongMessages) {
+    ColdTier tier;
+    tier.insert(1, kBucket, 1s, std::string(500, 'x'), 0);
+    ColdAlarm a;
+    ASSERT_TRUE(tier.find(1, a));
+    EXPECT_EQ(a.message.size(), kMaxMessage);
+}
+
+// Random inserts and removals against std::unordered_map; removal must keep
+// every probe run of the index reachable.
+TEST(ColdTier, MatchesReference) {
+    ColdTier tier;
+    std::unordered_map<int, Deadline> ref;
+    std::mt19937 rng(5);
+    for (int step = 0; step < 100'000; ++step) {
+        const int id = static_cast<int>(rng() % 4096);
+        if (rng() % 2 == 0) {
+            if (ref.count(id) == 0) {
+                const Deadline deadline = static_cast<Deadline>(1 + rng() % 8) * kBucket + step;
+                tier.insert(id, deadline, 1s, "m", 0);
+                ref[id] = deadline;
+            }
+        } else {
+            ASSERT_EQ(tier.erase(id), ref.erase(id) == 1);
+        }
+    }
+    ASSERT_EQ(tier.size(), ref.size());
+    std::size_t visited = 0;
+    tier.for_each([&](const ColdAlarm& a) {
+        ++visited;
+        ASSERT_EQ(ref.at(a.id), a.deadline);
+    });
+    EXPECT_EQ(visited, ref.size());
+    for (const auto& [id, deadline] : ref) {
+        ColdAlarm a;
+        ASSERT_TRUE(tier.find(id, a));
+        EXPECT_EQ(a.deadline, deadline);
+    }
+}
+
+// scan() keeps what for_each plus the query's bounds would, including
+// rows after removed and promoted ones and bounds that split a bucket.
+TEST(ColdTier, ScanMatchesFilteredForEach) {
+    ColdTier tier;
+    std::mt19937 rng(26);
+    for (int id = 0; id < 20'000; ++id) {
+        tier.insert(id, static_cast<Deadline>(2 + rng() % 6) * kBucket + rng(), 1s, "m", 0);
+    }
+    for (int id = 0; id < 20'000; id += 3) {
+        ASSERT_TRUE(tier.erase(id));
+    }
+    tier.promote(500, [](const ColdAlarm&) {});
+    const std::vector<ColdQuery> queries = {
+        {},
+        {.id_lo = 100, .id_hi = 5000},
+        {.from = 3 * kBucket + 1000, .to = 5 * kBucket + kBucket / 2},
+        {.id_lo = 7, .id_hi = 19'000, .from = 4 * kBucket, .to = 4 * kBucket},
+        {.from = 9 * kBucket},
+        {.id_lo = 10, .id_hi = 9},
+    };
+    for (const ColdQuery& q : queries) {
+        std::vector<int> want;
+        tier.for_each([&](const ColdAlarm& a) {
+            if (a.id >= q.id_lo && a.id <= q.id_hi && a.deadline >= q.from && a.deadline <= q.to) {
+                want.push_back(a.id);
+            }
+        });
+        std::vector<int> got;
+        tier.scan(q, [&](const ColdAlarm& a) {
+            EXPECT_EQ(a.message, "m");
+            got.push_back(a.id);
+        });
+        std::sort(want.begin(), want.end());
+        std::sort(got.begin(), got.end());
+        EXPECT_EQ(got, want) << q.id_lo << ".." << q.id_hi << " " << q.from << ".." << q.to;
+    }
+}
+
+// The point of the tier: a far-future alarm with a short message costs a
+// third of the 112-byte node, index slot and heap slot it would otherwise
+// take (about 155 bytes).
+TEST(ColdTier, RowsAreCompact) {
+    ColdTier tier;
+    constexpr int n = 1'000'000;
+    for (int id = 0; id < n; ++id) {
+        tier.insert(id, (2 + id % 48) * kBucket + id, 86400s, "wake up", 0);
+    }
+    const ColdStats stats = tier.stats();
+    EXPECT_EQ(stats.alarms, static_cast<std::size_t>(n));
+    EXPECT_EQ(stats.buckets, 48u);
+    EXPECT_LE(stats.bytes / n, 44u) << stats.bytes / n;
+}
+
+}  // namespace
+}  // namespace alarmd
@@ -0,0 +1,53 @@
+#include "alarmd/cpu_affinity.hpp"
+
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+TEST(CpuAffinity, ParsesCpuLists) {
+    std::vector<int> cpus;
+    ASSERT_TRUE(parse_cpu_list("0-3,8,10-11", cpus));
+    EXPECT_EQ(cpus, (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    ASSERT_TRUE(parse_cpu_list("5", cpus));
+    EXPECT_EQ(cpus, std::vector<int>{5});
+    for (const char* bad : {"", ",", "1,", "3-1", "a", "1-", "-1", "1 2", "99999"}) {
+        EXPECT_FALSE(parse_cpu_list(bad, cpus)) << bad;
+    }
+    EXPECT_EQ(cpus, std::vector<int>{5});  // untouched on failure
+}
+
+TEST(CpuAffinity, PinsTheCallingThread) {
+    std::thread([] {
+        ASSERT_TRUE(pin_current_thread(0));
+        EXPECT_EQ(sched_getcpu(), 0);
+    }).join();
+    EXPECT_NO_THROW(check_cpus({0}));
+    EXPECT_THROW(check_cpus({CPU_SETSIZE - 1}), std::invalid_argument);
+}
+
+TEST(CpuAffinity, FindsTheNodeOfACpu) {
+    EXPECT_GE(numa_node_of_cpu(0), -1);
+    EXPECT_EQ(numa_node_of_cpu(CPU_SETSIZE), -1);
+    // Whether or not the kernel takes the policy, the memory stays usable.
+    const std::size_t size = 1 << 16;
+    void* memory = ::operator new(size, std::align_val_t{4096});
+    const int node = numa_node_of_cpu(0);
+    if (node >= 0) {
+        prefer_numa_node(memory, size, node);
+    }
+    EXPECT_FALSE(prefer_numa_node(memory, size, -1));
+    std::memset(memory, 1, size);
+    ::operator delete(memory, std::align_val_t{4096});
+}
+
+}  // namespace
+}  // namespace alarmd
@@ -0,0 +1,180 @@
+#include "alarmd/display_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+std::vector<FiredAlarm> batch_of(int first, int count) {
+    std::vector<FiredAlarm> batch;
+    for (int id = first; id < first + count; ++id) {
+        batch.push_back({id, {}, Message("m")});
+    }
+    return batch;
+}
+
+TEST(DisplayPool, DeliversEveryAlarmOnce) {
+    std::mutex mutex;
+    std::map<int, int> seen;
+    {
+        DisplayPool pool(4, [&](int, std::vector<FiredAlarm>& chunk) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const FiredAlarm& a : chunk) {
+                ++seen[a.id];
+            }
+        });
+        for (int round = 0; round < 50; ++round) {
+            auto batch = batch_of(round * 100, 100);
+            pool.submit(batch);
+        }
+    }  // the destructor drains the pool
+    ASSERT_EQ(seen.size(), 5000u);
+    for (const auto& [id, count] : seen) {
+        EXPECT_EQ(count, 1) << id;
+    }
+}
+
+TEST(DisplayPool, IdleWorkersStealFromSlowOne) {
+    // Every alarm is homed on worker 1 and its sink is slow; the others have
+    // nothing of their own and must steal to keep up.
+    std::mutex mutex;
+    std::map<int, int> by_worker;
+    const auto begin = std::chrono::steady_clock::now();
+    {
+        DisplayPool pool(4, [&](int worker, std::vector<FiredAlarm>& chunk) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                by_worker[worker] += static_cast<int>(chunk.size());
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        });
+        std::vector<FiredAlarm> batch;
+        for (int i = 0; i < 256; ++i) {
+            batch.push_back({i * 4, {}, Message("slow")});
+        }
+        pool.submit(batch);
+    }
+    EXPECT_GT(by_worker.size(), 1u);
+    int total = 0;
+    for (const auto& [worker, count] : by_worker) {
+        total += count;
+    }
+    EXPECT_EQ(total, 256);
+    // 256 alarms in chunks of at most 32 would take >= 160ms on one worker.
+    EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(150));
+}
+
+// One worker whose sink holds the first chunk until released, so the
+// deque fills up behind it.
+class StalledPool {
+public:
+    explicit StalledPool(OverflowPolicy overflow)
+        : pool_(1,
+                [this](int, std::vector<FiredAlarm>& chunk) {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    stalled_ = true;
+                    cond_.notify_all();
+                    cond_.wait(lock, [this] { return released_; });
+                    for (const FiredAlarm& a : chunk) {
+                        printed_.push_back(a);
+                    }
+                    cond_.notify_all();
+                },
+                {.capacity = 8, .overflow = overflow}) {
+        auto first = batch_of(1000, 1);
+        pool_.submit(first);
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this] { return stalled_; });
+    }
+
+    DisplayPool& pool() { return pool_; }
+    // Lets the sink go and returns the first `n` alarms it prints.
+    std::vector<FiredAlarm> release(std::size_t n) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        released_ = true;
+        cond_.notify_all();
+        cond_.wait(lock, [&] { return printed_.size() >= n; });
+        return printed_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool stalled_ = false;
+    bool released_ = false;
+    std::vector<FiredAlarm> printed_;
+    DisplayPool pool_;  // last: its workers use the members above
+};
+
+TEST(DisplayPool, ShedsPastCapacity) {
+    StalledPool stalled(OverflowPolicy::Shed);
+    auto batch = batch_of(0, 20);
+    stalled.pool().submit(batch);
+    EXPECT_EQ(stalled.pool().queued(), 8u);
+    EXPECT_EQ(stalled.pool().stats().shed, 12u);
+    EXPECT_EQ(stalled.pool().stats().capacity, 8u);
+    EXPECT_EQ(stalled.release(9).size(), 9u);
+}
+
+TEST(DisplayPool, CoalescesDuplicatesOfQueuedAlarms) {
+    StalledPool stalled(OverflowPolicy::Coalesce);
+    auto batch = batch_of(0, 8);
+    for (int i = 0; i < 5; ++i) {
+        batch.push_back({3, {}, Message("m")});
+    }
+    batch.push_back({3, {}, Message("other text")});
+    stalled.pool().submit(batch);
+    const DisplayStats stats = stalled.pool().stats();
+    EXPECT_EQ(stats.coalesced, 5u);
+    EXPECT_EQ(stats.shed, 1u);
+    std::uint32_t folded = 0;
+    for (const FiredAlarm& a : stalled.release(9)) {
+        folded += a.coalesced;
+        if (a.id == 3) {
+            EXPECT_EQ(a.coalesced, 5u);
+        }
+    }
+    EXPECT_EQ(folded, 5u);
+}
+
+TEST(DisplayPool, BlocksUntilThereIsRoom) {
+    StalledPool stalled(OverflowPolicy::Block);
+    std::atomic<bool> returned{false};
+    std::thread producer([&] {
+        auto batch = batch_of(0, 20);
+        stalled.pool().submit(batch);
+        returned = true;
+    });
+    while (stalled.pool().stats().blocked == 0) {
+        std::this_thread::yield();
+    }
+    EXPECT_FALSE(returned);
+    EXPECT_EQ(stalled.pool().queued(), 8u);
+    EXPECT_EQ(stalled.release(21).size(), 21u);
+    producer.join();
+    EXPECT_EQ(stalled.pool().stats().shed, 0u);
+}
+
+TEST(DisplayPool, ParsesOverflowPolicies) {
+    OverflowPolicy policy = OverflowPolicy::Block;
+    EXPECT_TRUE(parse_overflow_policy("coalesce", policy));
+    EXPECT_EQ(policy, OverflowPolicy::Coalesce);
+    EXPECT_STREQ(overflow_policy_name(OverflowPolicy::Shed), "shed");
+    EXPECT_FALSE(parse_overflow_policy("drop", policy));
+}
+
+TEST(DisplayPool, RejectsNoWorkers) {
+    EXPECT_THROW(DisplayPool(0, [](int, std::vector<FiredAlarm>&) {}), std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace alarmd
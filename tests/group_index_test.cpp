@@ -0,0 +1,51 @@
+#include "alarmd/group_index.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+std::vector<int> members(GroupIndex& index, std::string_view tag) {
+    std::vector<int> ids;
+    if (AlarmGroup* group = index.find(tag)) {
+        GroupIndex::for_each(*group, [&ids](const Alarm& a) { ids.push_back(a.id); });
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+TEST(GroupIndex, AddRemoveAndDropEmptyGroups) {
+    GroupIndex index;
+    std::vector<Alarm> alarms(5);
+    for (int i = 0; i < 5; ++i) {
+        alarms[i].id = i;
+        index.add(&alarms[i], i % 2 == 0 ? "even" : "odd");
+    }
+    EXPECT_EQ(index.size(), 2u);
+    EXPECT_EQ(members(index, "even"), (std::vector<int>{0, 2, 4}));
+    EXPECT_EQ(members(index, "odd"), (std::vector<int>{1, 3}));
+    EXPECT_EQ(alarms[3].group->tag, "odd");
+
+    // Head, middle and tail of the list.
+    index.remove(&alarms[4]);
+    index.remove(&alarms[0]);
+    EXPECT_EQ(alarms[0].group, nullptr);
+    EXPECT_EQ(members(index, "even"), (std::vector<int>{2}));
+    EXPECT_EQ(index.find("even")->size, 1u);
+    index.remove(&alarms[0]);  // not in a group any more: no-op
+    index.remove(&alarms[2]);
+    EXPECT_EQ(index.find("even"), nullptr);
+    EXPECT_EQ(index.size(), 1u);
+
+    // An alarm can move to another group.
+    index.remove(&alarms[1]);
+    index.add(&alarms[1], "moved");
+    EXPECT_EQ(members(index, "odd"), (std::vector<int>{3}));
+    EXPECT_EQ(members(index, "moved"), (std::vector<int>{1}));
+}
+
+}  // namespace
+}  // namespace alarmd
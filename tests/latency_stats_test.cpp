@@ -0,0 +1,83 @@
+#include "alarmd/latency_stats.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+TEST(LatencyHistogram, BucketsKeepSixPercentPrecision) {
+    for (std::uint64_t v = 0; v < 16; ++v) {
+        EXPECT_EQ(LatencyHistogram::bucket_of(v), v);
+        EXPECT_EQ(LatencyHistogram::lowest_in(v), v);
+    }
+    std::size_t last = 0;
+    for (std::uint64_t v = 16; v < (std::uint64_t{1} << 40); v += v / 7 + 1) {
+        const std::size_t b = LatencyHistogram::bucket_of(v);
+        ASSERT_LT(b, LatencyHistogram::kBuckets);
+        EXPECT_GE(b, last);
+        last = b;
+        const std::uint64_t lo = LatencyHistogram::lowest_in(b);
+        EXPECT_LE(lo, v);
+        EXPECT_GT(LatencyHistogram::lowest_in(b + 1), v);
+        EXPECT_LE(v - lo, v / 16) << v;
+    }
+    // Values past the top exponent share its buckets.
+    EXPECT_LT(LatencyHistogram::bucket_of(~std::uint64_t{0}), LatencyHistogram::kBuckets);
+}
+
+TEST(LatencyHistogram, Percentiles) {
+    auto h = std::make_unique<LatencyHistogram>();
+    EXPECT_EQ(h->percentile(0.5), 0u);
+    for (int v = 1; v <= 10'000; ++v) {
+        h->record(v * 1000);  // 1us .. 10ms
+    }
+    h->record(-5);  // counts as zero
+    EXPECT_EQ(h->count(), 10'001u);
+    EXPECT_EQ(h->max(), 10'000'000u);
+    EXPECT_NEAR(static_cast<double>(h->percentile(0.5)), 5e6, 5e6 / 16);
+    EXPECT_NEAR(static_cast<double>(h->percentile(0.99)), 9.9e6, 9.9e6 / 16);
+    EXPECT_LE(h->percentile(1.0), h->max());
+    EXPECT_EQ(h->percentile(0.0), 0u);
+}
+
+TEST(LatencyStats, MergesEveryThreadIncludingExitedOnes) {
+    auto before = std::make_unique<LatencyHistogram>();
+    latency_snapshot(Metric::FireLateness, *before);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 1000; ++i) {
+                record_latency(Metric::FireLateness, 500);
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    auto after = std::make_unique<LatencyHistogram>();
+    latency_snapshot(Metric::FireLateness, *after);
+    EXPECT_EQ(after->count() - before->count(), 4000u);
+    EXPECT_EQ(after->sum() - before->sum(), 4000u * 500);
+}
+
+TEST(LatencyStats, RendersEveryMetric) {
+    record_latency(Metric::Parse, 1500);
+    const std::string stats = render_stats(1234);
+    EXPECT_EQ(stats.rfind("Stats at 1234:\n", 0), 0u) << stats;
+    for (std::size_t m = 0; m < kMetricCount; ++m) {
+        EXPECT_NE(stats.find(metric_name(static_cast<Metric>(m))), std::string::npos) << stats;
+    }
+    const std::string prom = render_prometheus();
+    EXPECT_NE(prom.find("# TYPE alarmd_parse_seconds summary\n"), std::string::npos) << prom;
+    EXPECT_NE(prom.find("alarmd_lock_wait_seconds{quantile=\"0.999\"} "), std::string::npos);
+    EXPECT_NE(prom.find("alarmd_fire_lateness_seconds_count "), std::string::npos);
+}
+
+}  // namespace
+}  // namespace alarmd
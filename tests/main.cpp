@@ -0,0 +1,41 @@
+// gtest entry point that also writes a plain-text summary of every run to
+// test_output.txt at the repository root.
+
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+class FileReporter : public ::testing::EmptyTestEventListener {
+public:
+    explicit FileReporter(std::FILE* file) : file_(file) {}
+    ~FileReporter() override { std::fclose(file_); }
+
+    void OnTestEnd(const ::testing::TestInfo& info) override {
+        const auto* result = info.result();
+        std::fprintf(file_, "[%s] %s.%s (%lld ms)\n", result->Passed() ? "  OK  " : "FAILED",
+                     info.test_suite_name(), info.name(),
+                     static_cast<long long>(result->elapsed_time()));
+    }
+
+    void OnTestProgramEnd(const ::testing::UnitTest& unit) override {
+        std::fprintf(file_, "%d tests, %d passed, %d failed, %lld ms\n",
+                     unit.test_to_run_count(), unit.successful_test_count(),
+                     unit.failed_test_count(), static_cast<long long>(unit.elapsed_time()));
+        std::fflush(file_);
+    }
+
+private:
+    std::FILE* file_;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    if (std::FILE* file = std::fopen(ALARMD_TEST_OUTPUT, "w")) {
+        ::testing::UnitTest::GetInstance()->listeners().Append(new FileReporter(file));
+    }
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,67 @@
+#include "alarmd/message.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+TEST(Message, ShortTextIsInline) {
+    Message m("wake up");
+    EXPECT_TRUE(m.is_inline());
+    EXPECT_EQ(m.view(), "wake up");
+    EXPECT_STREQ(m.c_str(), "wake up");
+
+    const std::string edge(Message::kInline, 'x');
+    EXPECT_TRUE(Message(edge).is_inline());
+    EXPECT_FALSE(Message(edge + "x").is_inline());
+}
+
+TEST(Message, LongTextGoesToArena) {
+    for (std::size_t n : {23u, 31u, 32u, 63u, 64u, 127u}) {
+        const std::string text(n, 'a');
+        Message m(text);
+        EXPECT_FALSE(m.is_inline());
+        EXPECT_EQ(m.view(), text);
+        EXPECT_EQ(m.c_str()[n], '\0');
+    }
+    EXPECT_EQ(Message(std::string(kMaxMessage + 10, 'z')).size(), kMaxMessage);
+}
+
+TEST(Message, MoveLeavesSourceEmpty) {
+    const std::string text(60, 'q');
+    Message a(text);
+    Message b(std::move(a));
+    EXPECT_EQ(b.view(), text);
+    EXPECT_TRUE(a.empty());
+
+    Message c("short");
+    c = std::move(b);
+    EXPECT_EQ(c.view(), text);
+    EXPECT_TRUE(b.empty());
+}
+
+TEST(Message, CopyIsDeep) {
+    Message a(std::string(40, 'c'));
+    Message b = a;
+    EXPECT_NE(a.c_str(), b.c_str());
+    EXPECT_EQ(a.view(), b.view());
+    b = Message("x");
+    EXPECT_EQ(a.view(), std::string(40, 'c'));
+}
+
+TEST(Message, ArenaReusesBlocks) {
+    std::vector<Message> held;
+    for (int i = 0; i < 4096; ++i) {
+        held.emplace_back(std::string(50 + i % 70, 'm'));
+    }
+    held.clear();
+    const char* first = Message(std::string(50, 'm')).c_str();
+    EXPECT_EQ(Message(std::string(50, 'n')).c_str(), first);
+}
+
+}  // namespace
+}  // namespace alarmd
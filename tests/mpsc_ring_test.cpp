@@ -0,0 +1,70 @@
+#include "alarmd/mpsc_ring.hpp"
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+TEST(MpscRing, FifoAndBounded) {
+    MpscRing<int> ring(3);
+    EXPECT_EQ(ring.capacity(), 4u);
+    EXPECT_TRUE(ring.empty());
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(ring.try_push(int{i}));
+    }
+    EXPECT_FALSE(ring.try_push(99));
+
+    int v = -1;
+    ASSERT_TRUE(ring.try_pop(v));
+    EXPECT_EQ(v, 0);
+    EXPECT_TRUE(ring.try_push(4));
+    for (int want = 1; want <= 4; ++want) {
+        ASSERT_TRUE(ring.try_pop(v));
+        EXPECT_EQ(v, want);
+    }
+    EXPECT_FALSE(ring.try_pop(v));
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(MpscRing, RejectsZeroCapacity) { EXPECT_THROW(MpscRing<int>(0), std::invalid_argument); }
+
+TEST(MpscRing, ConcurrentProducersKeepPerProducerOrder) {
+    constexpr int kProducers = 4;
+    constexpr int kPerProducer = 50'000;
+    MpscRing<int> ring(256);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&ring, p] {
+            for (int i = 0; i < kPerProducer; ++i) {
+                while (!ring.try_push(p * kPerProducer + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<int> next(kProducers, 0);
+    for (int received = 0; received < kProducers * kPerProducer;) {
+        int v;
+        if (!ring.try_pop(v)) {
+            std::this_thread::yield();
+            continue;
+        }
+        const int p = v / kPerProducer;
+        ASSERT_EQ(v % kPerProducer, next[p]);
+        ++next[p];
+        ++received;
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+    EXPECT_TRUE(ring.empty());
+}
+
+}  // namespace
+}  // namespace alarmd
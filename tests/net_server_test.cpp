@@ -0,0 +1,294 @@
+#include "alarmd/net_server.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+// Blocking test client with a receive timeout.
+class Client {
+public:
+    explicit Client(int port) : fd_(socket(AF_INET, SOCK_STREAM, 0)) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<std::uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        connected_ = connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0;
+        set_timeout();
+    }
+    explicit Client(const std::string& path) : fd_(socket(AF_UNIX, SOCK_STREAM, 0)) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        path.copy(addr.sun_path, sizeof addr.sun_path - 1);
+        connected_ = connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0;
+        set_timeout();
+    }
+    ~Client() { close(fd_); }
+
+    bool connected() const { return connected_; }
+    void send_text(const std::string& text) {
+        ASSERT_EQ(write(fd_, text.data(), text.size()), static_cast<ssize_t>(text.size()));
+    }
+    void shutdown_write() { shutdown(fd_, SHUT_WR); }
+
+    // Reads until `needle` has been received or the timeout expires, and
+    // returns everything read so far.
+    std::string read_until(const std::string& needle) {
+        char buf[4096];
+        while (received_.find(needle) == std::string::npos) {
+            const ssize_t n = read(fd_, buf, sizeof buf);
+            if (n <= 0) {
+                break;
+            }
+            received_.append(buf, static_cast<std::size_t>(n));
+        }
+        return received_;
+    }
+
+private:
+    void set_timeout() {
+        timeval tv{2, 0};
+        setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    }
+
+    int fd_;
+    bool connected_ = false;
+    std::string received_;
+};
+
+TEST(NetServer, RoutesNotificationsToTheOwningClient) {
+    NetServer server({.display_threads = 2, .shards = 2}, {.tcp_port = 0, .tcp_address = "127.0.0.1"});
+    server.start();
+    ASSERT_GT(server.tcp_port(), 0);
+    Client a(server.tcp_port());
+    Client b(server.tcp_port());
+    ASSERT_TRUE(a.connected());
+    ASSERT_TRUE(b.connected());
+
+    a.send_text("Start_Alarm(1): 10ms from a\nStart_Alarm(1): 5 again\n");
+    b.send_text("Start_Alarm(2): 10ms from b\n");
+    const std::string got_a = a.read_until("Alarm(1) Printed by Display Thread ");
+    const std::string got_b = b.read_until("Alarm(2) Printed by Display Thread ");
+    EXPECT_NE(got_a.find("Alarm(1) Inserted into Alarm List at "), std::string::npos) << got_a;
+    EXPECT_NE(got_a.find("Alarm(1) already exists"), std::string::npos) << got_a;
+    EXPECT_NE(got_a.find(": 10ms from a\n"), std::string::npos) << got_a;
+    EXPECT_EQ(got_a.find("Alarm(2)"), std::string::npos) << got_a;
+    EXPECT_NE(got_b.find("Alarm(2) Printed by Display Thread "), std::string::npos) << got_b;
+    EXPECT_EQ(got_b.find("Alarm(1)"), std::string::npos) << got_b;
+    server.stop();
+}
+
+TEST(NetServer, ExpiresAlarmsOnTheEventLoopWithTimerfd) {
+    NetServer server({.display_threads = 1, .shards = 2},
+                     {.tcp_port = 0, .tcp_address = "127.0.0.1", .timerfd = true});
+    server.start();
+    Client c(server.tcp_port());
+    ASSERT_TRUE(c.connected());
+    c.send_text("Start_Alarm(1): 10ms one\nStart_Alarm(2): 20ms two\n");
+    const std::string got = c.read_until("Alarm(2) Printed by Display Thread ");
+    EXPECT_NE(got.find("Alarm(1) Printed by Display Thread "), std::string::npos) << got;
+    EXPECT_NE(got.find("Alarm(2) Printed by Display Thread "), std::string::npos) << got;
+    EXPECT_EQ(server.scheduler().pending(), 0u);
+    server.stop();
+}
+
+TEST(NetServer, ServesUnixSocketAndAnswersBeforeClosing) {
+    const std::string path = "/tmp/alarmd_net_test_" + std::to_string(getpid());
+    NetServer server({.display_threads = 1}, {.unix_path = path});
+    server.start();
+    Client c(path);
+    ASSERT_TRUE(c.connected());
+    c.send_text("bogus\nStart_Alarm(3): 60 kept\nView_Alarms\nCancel_Alarm(3)");
+    c.shutdown_write();
+    const std::string got = c.read_until("Alarm(3) Cancelled at ");
+    EXPECT_EQ(got.rfind("Bad command\n", 0), 0u) << got;
+    EXPECT_NE(got.find("1. Alarm(3): Expiry = "), std::string::npos) << got;
+    EXPECT_NE(got.find("Alarm(3) Cancelled at "), std::string::npos) << got;
+    EXPECT_EQ(server.scheduler().pending(), 0u);
+    server.stop();
+    EXPECT_EQ(server.connections(), 0u);
+}
+
+TEST(NetServer, ViewIsCutToOnePageAndCountsAgainstOutput) {
+    NetServer server({.display_threads = 1},
+                     {.tcp_port = 0, .tcp_address = "127.0.0.1", .max_output = 4096,
+                      .max_view = 10, .max_view_offset = 100});
+    server.start();
+    Client c(server.tcp_port());
+    ASSERT_TRUE(c.connected());
+    c.send_text("Start_Alarms(1-500): 60 listed\nView_Alarms\n");
+    std::string got = c.read_until("alarms\n");
+    EXPECT_NE(got.find("10. Alarm("), std::string::npos) << got;
+    EXPECT_EQ(got.find("11. Alarm("), std::string::npos) << got;
+    EXPECT_NE(got.find("Showing 1-10 of 500 alarms\n"), std::string::npos) << got;
+    c.send_text("View_Alarms offset=101\nView_Alarms offset=100\n");
+    got = c.read_until("Showing 101-110 of 500 alarms\n");
+    EXPECT_NE(got.find("Showing 1-10 of 500 alarms\nView_Alarms offset too large"),
+              std::string::npos)
+        << got;
+    EXPECT_NE(got.find("101. Alarm("), std::string::npos) << got;
+
+    NetServer small({.display_threads = 1},
+                    {.tcp_port = 0, .tcp_address = "127.0.0.1", .max_output = 4096});
+    small.start();
+    Client d(small.tcp_port());
+    ASSERT_TRUE(d.connected());
+    d.send_text("Start_Alarms(1-200): 60 listed\nView_Alarms\nCancel_Alarms(1-200)\n");
+    got = d.read_until("Cancelled at ");
+    EXPECT_NE(got.find("View_Alarms too large"), std::string::npos) << got;
+    EXPECT_EQ(got.find("1. Alarm("), std::string::npos) << got;
+    EXPECT_NE(got.find("200 of 200 Cancelled at "), std::string::npos) << got;
+    small.stop();
+    server.stop();
+}
+
+TEST(NetServer, ServesMetricsOverHttp) {
+    NetServer server({.display_threads = 1}, {.tcp_port = 0, .tcp_address = "127.0.0.1"});
+    server.start();
+    Client c(server.tcp_port());
+    ASSERT_TRUE(c.connected());
+    c.send_text("Start_Alarm(1): 60 parsed\nStats\n");
+    EXPECT_NE(c.read_until("display_latency").find("Stats at "), std::string::npos);
+
+    Client scrape(server.tcp_port());
+    scrape.send_text("GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    const std::string got = scrape.read_until("alarmd_display_latency_seconds_count");
+    EXPECT_EQ(got.rfind("HTTP/1.0 200 OK\r\n", 0), 0u) << got;
+    EXPECT_NE(got.find("alarmd_parse_seconds{quantile=\"0.99\"} "), std::string::npos) << got;
+
+    Client missing(server.tcp_port());
+    missing.send_text("GET /other HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(missing.read_until("\r\n\r\n").rfind("HTTP/1.0 404", 0), 0u);
+    server.stop();
+}
+
+TEST(NetServer, ConfigTogglesTracingAndServesTheTrace) {
+    NetServer server({.display_threads = 1}, {.tcp_port = 0, .tcp_address = "127.0.0.1"});
+    server.start();
+    Client c(server.tcp_port());
+    ASSERT_TRUE(c.connected());
+    c.send_text("Config display=2 trace=on\nStart_Alarm(5): 60 traced\n"
+                "Config dump=/tmp/alarmd_net_trace.json\nConfig trace=off trace=clear\n");
+    const std::string got = c.read_until("trace=off");
+    EXPECT_NE(got.find("display=2 capacity=65536 overflow=block slack=0 flush=1ms trace=on"),
+              std::string::npos)
+        << got;
+    EXPECT_NE(got.find("use GET /trace for the trace"), std::string::npos) << got;
+    EXPECT_EQ(access("/tmp/alarmd_net_trace.json", F_OK), -1);
+
+    c.send_text("Config trace=on\nCancel_Alarm(5)\n");
+    c.read_until("Alarm(5) Cancelled at ");
+    Client scrape(server.tcp_port());
+    scrape.send_text("GET /trace HTTP/1.1\r\n\r\n");
+    const std::string trace = scrape.read_until("]}");
+    EXPECT_EQ(trace.rfind("HTTP/1.0 200 OK\r\nContent-Type: application/json\r\n", 0), 0u)
+        << trace;
+    EXPECT_NE(trace.find("\"name\":\"cancel\""), std::string::npos) << trace;
+    EXPECT_EQ(trace.find("\"name\":\"start\""), std::string::npos) << trace;
+    c.send_text("Config trace=off trace=clear\n");
+    c.read_until("Config at ");
+    server.stop();
+}
+
+TEST(NetServer, TraceIsCutToTheOutputLimit) {
+    NetServer server({.display_threads = 1},
+                     {.tcp_port = 0, .tcp_address = "127.0.0.1", .max_output = 4096});
+    server.start();
+    Client c(server.tcp_port());
+    ASSERT_TRUE(c.connected());
+    c.send_text("Config trace=on\nStart_Alarms(1-100): 60 traced\n");
+    c.read_until("Inserted into Alarm List at ");
+    Client scrape(server.tcp_port());
+    scrape.send_text("GET /trace HTTP/1.1\r\n\r\n");
+    const std::string trace = scrape.read_until("]}");
+    EXPECT_EQ(trace.rfind("HTTP/1.0 200 OK\r\n", 0), 0u) << trace;
+    EXPECT_LE(trace.size(), 4096u);
+    EXPECT_NE(trace.find("\"name\":\"start\""), std::string::npos) << trace;
+    EXPECT_NE(trace.find("\n]}\n"), std::string::npos) << trace;
+    c.send_text("Config trace=off trace=clear\n");
+    c.read_until("trace=off");
+    server.stop();
+}
+
+TEST(NetServer, ThrowsWhenPortIsTaken) {
+    NetServer first({}, {.tcp_port = 0, .tcp_address = "127.0.0.1"});
+    EXPECT_THROW(NetServer({}, {.tcp_port = first.tcp_port(), .tcp_address = "127.0.0.1"}),
+                 std::system_error);
+}
+
+TEST(NetServer, ParsesRoutes) {
+    Route route;
+    ASSERT_TRUE(parse_route("100-199=127.0.0.1:7000", route));
+    EXPECT_EQ(route.ids.lo, 100);
+    EXPECT_EQ(route.ids.hi, 199);
+    EXPECT_EQ(route.address, "127.0.0.1:7000");
+    ASSERT_TRUE(parse_route("5=10.0.0.2:1", route));
+    EXPECT_EQ(route.ids.lo, 5);
+    EXPECT_EQ(route.ids.hi, 5);
+    for (const char* bad : {"", "100-199", "9-1=127.0.0.1:7000", "-1=127.0.0.1:7000",
+                            "1-x=127.0.0.1:7000", "1=localhost:7000", "1=127.0.0.1"}) {
+        EXPECT_FALSE(parse_route(bad, route)) << bad;
+    }
+    EXPECT_THROW(NetServer({}, {.routes = {{{1, 2}, "nowhere"}}}), std::invalid_argument);
+}
+
+// Ids 100-199 live on `other`: their commands and notices pass through the
+// front node, the rest stay on it, and both answer before the client closes.
+TEST(NetServer, RelaysRoutedIdsToTheirNode) {
+    NetServer other({.display_threads = 1}, {.tcp_port = 0, .tcp_address = "127.0.0.1"});
+    other.start();
+    const std::string address = "127.0.0.1:" + std::to_string(other.tcp_port());
+    NetServer front({.display_threads = 1},
+                    {.tcp_port = 0, .tcp_address = "127.0.0.1", .routes = {{{100, 199}, address}}});
+    front.start();
+    Client c(front.tcp_port());
+    ASSERT_TRUE(c.connected());
+    c.send_text("Start_Alarm(150): 10ms remote\nStart_Alarm(7): 60 local\n");
+    const std::string got = c.read_until("Alarm(150) Printed by Display Thread ");
+    EXPECT_NE(got.find("Alarm(150) Inserted into Alarm List at "), std::string::npos) << got;
+    EXPECT_NE(got.find("Alarm(7) Inserted into Alarm List at "), std::string::npos) << got;
+    EXPECT_EQ(front.scheduler().pending(), 1u);
+    EXPECT_EQ(front.connections(), 1u);  // the relay is not a client
+
+    c.send_text("Start_Alarm(199): 60 kept\nCancel_Alarm(199)");
+    c.shutdown_write();
+    const std::string rest = c.read_until("Alarm(199) Cancelled at ");
+    EXPECT_NE(rest.find("Alarm(199) Cancelled at "), std::string::npos) << rest;
+    EXPECT_EQ(other.scheduler().pending(), 0u);
+    front.stop();
+    other.stop();
+}
+
+TEST(NetServer, ReportsAnUnavailableNode) {
+    int port;
+    {
+        NetServer gone({}, {.tcp_port = 0, .tcp_address = "127.0.0.1"});
+        port = gone.tcp_port();
+    }
+    const std::string address = "127.0.0.1:" + std::to_string(port);
+    NetServer front({.display_threads = 1},
+                    {.tcp_port = 0, .tcp_address = "127.0.0.1", .routes = {{{100, 199}, address}}});
+    front.start();
+    Client c(front.tcp_port());
+    ASSERT_TRUE(c.connected());
+    c.send_text("Start_Alarm(100): 60 lost\n");
+    const std::string got = c.read_until(" unavailable\n");
+    EXPECT_NE(got.find("Node " + address + " unavailable\n"), std::string::npos) << got;
+    c.send_text("Start_Alarm(3): 60 local\n");  // the client is still served
+    EXPECT_NE(c.read_until("Alarm(3) Inserted").find("Alarm(3) Inserted"), std::string::npos);
+    EXPECT_EQ(front.connections(), 1u);
+    front.stop();
+}
+
+}  // namespace
+}  // namespace alarmd
@@ -0,0 +1,130 @@
+#include "alarmd/output_writer.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+using namespace std::chrono_literals;
+
+// Temporary regular file, unlinked on creation; contents() rereads it.
+class TempFile {
+public:
+    TempFile() {
+        char path[] = "/tmp/alarmd_out_XXXXXX";
+        fd_ = mkstemp(path);
+        unlink(path);
+    }
+    ~TempFile() { close(fd_); }
+    int fd() const { return fd_; }
+    std::string contents() const {
+        std::string text;
+        char buf[4096];
+        ssize_t n;
+        for (off_t off = 0; (n = pread(fd_, buf, sizeof buf, off)) > 0; off += n) {
+            text.append(buf, static_cast<std::size_t>(n));
+        }
+        return text;
+    }
+
+private:
+    int fd_;
+};
+
+class OutputWriterBackends : public ::testing::TestWithParam<OutputBackend> {};
+
+TEST_P(OutputWriterBackends, KeepsEachSlotInOrderAcrossFlushes) {
+    TempFile file;
+    ASSERT_GE(file.fd(), 0);
+    constexpr int kThreads = 4;
+    constexpr int kLines = 2000;
+    {
+        OutputWriter writer(file.fd(), {.slots = kThreads, .flush_latency = 200us,
+                                        .buffer_size = 4096, .backend = GetParam()});
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&writer, t] {
+                for (int i = 0; i < kLines; ++i) {
+                    writer.write(static_cast<std::size_t>(t),
+                                 std::to_string(t) + ":" + std::to_string(i) + "\n");
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        writer.flush();
+        EXPECT_EQ(writer.dropped(), 0u);
+    }
+    std::vector<int> next(kThreads, 0);
+    int lines = 0;
+    const std::string text = file.contents();
+    for (std::size_t pos = 0; pos < text.size();) {
+        const std::size_t nl = text.find('\n', pos);
+        ASSERT_NE(nl, std::string::npos);
+        const std::string line = text.substr(pos, nl - pos);
+        const std::size_t colon = line.find(':');
+        const int t = std::stoi(line.substr(0, colon));
+        EXPECT_EQ(std::stoi(line.substr(colon + 1)), next[t]++) << line;
+        ++lines;
+        pos = nl + 1;
+    }
+    EXPECT_EQ(lines, kThreads * kLines);
+}
+
+INSTANTIATE_TEST_SUITE_P(, OutputWriterBackends,
+                         ::testing::Values(OutputBackend::Auto, OutputBackend::Writev));
+
+TEST(OutputWriter, FlushesWithinLatencyWithoutAnExplicitFlush) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    OutputWriter writer(fds[1], {.flush_latency = 2ms});
+    const auto begin = std::chrono::steady_clock::now();
+    writer.write(0, "one\n");
+    writer.write(0, "two\n");
+    char buf[16] = {};
+    std::size_t got = 0;
+    while (got < 8) {
+        const ssize_t n = read(fds[0], buf + got, sizeof buf - got);
+        ASSERT_GT(n, 0);
+        got += static_cast<std::size_t>(n);
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - begin, 1s);
+    EXPECT_EQ(std::string(buf, got), "one\ntwo\n");
+    // Both lines were queued well within one latency window.
+    EXPECT_LE(writer.writes(), 2u);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(OutputWriter, SweepsSlotsAsTheyComeIntoUse) {
+    TempFile file;
+    ASSERT_GE(file.fd(), 0);
+    {
+        OutputWriter writer(file.fd(), {.slots = 1025, .flush_latency = 100us});
+        writer.write(0, "a\n");
+        writer.flush();
+        writer.write(1024, "c\n");  // well past the slots written so far
+        writer.write(3, "b\n");
+        writer.flush();
+        writer.write(1025 + 2, "d\n");  // wraps to slot 2
+    }
+    EXPECT_EQ(file.contents(), "a\nb\nc\nd\n");
+}
+
+TEST(OutputWriter, RejectsBadOptions) {
+    EXPECT_THROW(OutputWriter(-1, {}), std::invalid_argument);
+    EXPECT_THROW(OutputWriter(STDOUT_FILENO, {.slots = 0}), std::invalid_argument);
+}
+
+}  // namespace
+}  // namespace alarmd
@@ -0,0 +1,117 @@
+#include "alarmd/parser.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "reference_parser.hpp"
+
+namespace alarmd {
+namespace {
+
+// scanf's %d overflow behaviour is undefined, so the oracle is only
+// meaningful for lines without ten-digit runs.
+bool has_long_number(const std::string& line) {
+    int run = 0;
+    for (char c : line) {
+        run = c >= '0' && c <= '9' ? run + 1 : 0;
+        if (run >= 10) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void expect_same(const std::string& line) {
+    if (has_long_number(line)) {
+        return;
+    }
+    Command got;
+    Command want;
+    const bool ok = parse_command(line, got);
+    if (got.type == CommandType::Stats ||
+        (got.type != CommandType::Invalid && (!got.ids.empty() || !got.group.empty()))) {
+        return;  // the reference knows neither Stats nor the bulk and group forms
+    }
+    ASSERT_EQ(ok, reference_parse_command(line.c_str(), want)) << '"' << line << '"';
+    if (!ok) {
+        EXPECT_EQ(got.type, CommandType::Invalid);
+        return;
+    }
+    EXPECT_EQ(got.type, want.type) << line;
+    EXPECT_EQ(got.id, want.id) << line;
+    EXPECT_EQ(got.delay, want.delay) << line;
+    EXPECT_EQ(got.message, want.message) << line;
+}
+
+template <typename T>
+const T& pick(std::mt19937& rng, const std::vector<T>& options) {
+    return options[rng() % options.size()];
+}
+
+// Builds lines from pieces of the grammar, each with plausible near misses.
+std::string generate(std::mt19937& rng) {
+    static const std::vector<std::string> kSpace = {"", "", " ", "  ", "\t", " \t", "\r", "\v", "\n"};
+    static const std::vector<std::string> kName = {
+        "Start_Alarm(", "Change_Alarm(", "Cancel_Alarm(", "View_Alarms", "Start_Alarm",
+        "start_alarm(", "Cancel_Alarm", "View_Alarm", "Change_Alarm (", "Start_Alarm(("};
+    static const std::vector<std::string> kId = {"0", "7", "42", "-0", "-3", "+5", " 12", "\t9",
+                                                 "123456789", "", "x", "1 2", "2147483647"};
+    static const std::vector<std::string> kClose = {"):", ")", ") :", "):", ":)", "", ")x", ")"};
+    static const std::vector<std::string> kDelay = {"10", "0", "1.5", "1.5s", "250ms", "30us",
+                                                    "1.", ".5", "10msg", "5m", "-1", "", "3s",
+                                                    "0.0000001", "x", "12ms"};
+    static const std::vector<std::string> kMessage = {"", "hi", "wake up", "a\tb", "  padded  ",
+                                                      "x\r", std::string(kMaxMessage, 'm'),
+                                                      std::string(kMaxMessage + 1, 'm'), "(x)"};
+    static const std::vector<std::string> kTail = {"", "\n", "\r\n", " \n", "\n junk", "\n\n",
+                                                   " extra", "\t"};
+    std::string line = pick(rng, kSpace) + pick(rng, kName) + pick(rng, kId) + pick(rng, kClose) +
+                       pick(rng, kSpace) + pick(rng, kDelay) + pick(rng, kSpace) +
+                       pick(rng, kMessage) + pick(rng, kTail);
+    return line;
+}
+
+// Random single-character edits of a valid line.
+std::string mutate(std::mt19937& rng, std::string line) {
+    static const std::string kAlphabet = "SCVa_()0123456789:.smu -+\t\r\n\v\fxz";
+    const int edits = 1 + static_cast<int>(rng() % 3);
+    for (int i = 0; i < edits && !line.empty(); ++i) {
+        const std::size_t pos = rng() % line.size();
+        const char c = kAlphabet[rng() % kAlphabet.size()];
+        switch (rng() % 3) {
+            case 0: line[pos] = c; break;
+            case 1: line.insert(line.begin() + static_cast<std::ptrdiff_t>(pos), c); break;
+            default: line.erase(pos, 1); break;
+        }
+    }
+    return line;
+}
+
+TEST(ParserFuzz, MatchesReferenceOnGeneratedLines) {
+    std::mt19937 rng(2024);
+    for (int i = 0; i < 50'000; ++i) {
+        expect_same(generate(rng));
+        if (HasFatalFailure()) {
+            return;
+        }
+    }
+}
+
+TEST(ParserFuzz, MatchesReferenceOnMutatedCommands) {
+    static const std::vector<std::string> kSeeds = {
+        "Start_Alarm(12): 30 wake up\n", "Change_Alarm(3): 250ms later\r\n",
+        "Cancel_Alarm(7)\n", "View_Alarms\n", "  Start_Alarm( 1):1.5s  x  \n"};
+    std::mt19937 rng(99);
+    for (int i = 0; i < 50'000; ++i) {
+        expect_same(mutate(rng, kSeeds[rng() % kSeeds.size()]));
+        if (HasFatalFailure()) {
+            return;
+        }
+    }
+}
+
+}  // namespace
+}  // namespace alarmd
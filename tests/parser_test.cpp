@@ -0,0 +1,245 @@
+#include "alarmd/parser.hpp"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+TEST(Parser, StartAlarm) {
+    Command cmd;
+    ASSERT_TRUE(parse_command("Start_Alarm(12): 30 wake up\n", cmd));
+    EXPECT_EQ(cmd.type, CommandType::StartAlarm);
+    EXPECT_EQ(cmd.id, 12);
+    EXPECT_EQ(cmd.delay, std::chrono::seconds(30));
+    EXPECT_EQ(cmd.message, "wake up");
+}
+
+TEST(Parser, ChangeAlarm) {
+    Command cmd;
+    ASSERT_TRUE(parse_command("Change_Alarm(3): 5 later\r\n", cmd));
+    EXPECT_EQ(cmd.type, CommandType::ChangeAlarm);
+    EXPECT_EQ(cmd.id, 3);
+    EXPECT_EQ(cmd.delay, std::chrono::seconds(5));
+    EXPECT_EQ(cmd.message, "later");
+}
+
+TEST(Parser, SubSecondDelays) {
+    Command cmd;
+    ASSERT_TRUE(parse_command("Start_Alarm(1): 250ms quick\n", cmd));
+    EXPECT_EQ(cmd.delay, std::chrono::milliseconds(250));
+    EXPECT_EQ(cmd.message, "quick");
+    ASSERT_TRUE(parse_command("Change_Alarm(1):1.5s later\n", cmd));
+    EXPECT_EQ(cmd.delay, std::chrono::milliseconds(1500));
+    // The delay must be followed by whitespace, so units cannot swallow text.
+    EXPECT_FALSE(parse_command("Start_Alarm(1): 10msg\n", cmd));
+    EXPECT_FALSE(parse_command("Start_Alarm(1): 1.5x msg\n", cmd));
+}
+
+TEST(Parser, PeriodicAlarms) {
+    using namespace std::chrono_literals;
+    Command cmd;
+    ASSERT_TRUE(parse_command("Start_Alarm(1): every 30 ping\n", cmd));
+    EXPECT_EQ(cmd.delay, 30s);
+    EXPECT_EQ(cmd.repeats, kRepeatForever);
+    EXPECT_EQ(cmd.message, "ping");
+    ASSERT_TRUE(parse_command("Change_Alarm(1): every 250ms count=4 fast\n", cmd));
+    EXPECT_EQ(cmd.delay, 250ms);
+    EXPECT_EQ(cmd.repeats, 3u);
+    // Fires at 10, 20 and 30 seconds; the next would be past 35.
+    ASSERT_TRUE(parse_command("Start_Alarm(1): every 10 until=35 bounded\n", cmd));
+    EXPECT_EQ(cmd.repeats, 2u);
+    // A one-shot message may still start with the word.
+    ASSERT_TRUE(parse_command("Start_Alarm(1): 5 every day\n", cmd));
+    EXPECT_EQ(cmd.repeats, 0u);
+    EXPECT_EQ(cmd.message, "every day");
+
+    EXPECT_FALSE(parse_command("Start_Alarm(1): every 0 spin\n", cmd));
+    EXPECT_FALSE(parse_command("Start_Alarm(1): every 5 count=0 never\n", cmd));
+    EXPECT_FALSE(parse_command("Start_Alarm(1): every 5 until=4 never\n", cmd));
+    EXPECT_FALSE(parse_command("Start_Alarm(1): every 5 count=3\n", cmd));  // no message
+    EXPECT_FALSE(parse_command("Start_Alarm(1): every5 msg\n", cmd));
+}
+
+TEST(Parser, BulkCommands) {
+    using namespace std::chrono_literals;
+    Command cmd;
+    ASSERT_TRUE(parse_command("Cancel_Alarms(1000-1999)\n", cmd));
+    EXPECT_EQ(cmd.type, CommandType::CancelAlarms);
+    EXPECT_EQ(cmd.ids, "1000-1999");
+    EXPECT_EQ(cmd.id_count, 1000u);
+    ASSERT_TRUE(parse_command("Start_Alarms( 1, 5 ,7-9 ): every 30 count=2 tenant\n", cmd));
+    EXPECT_EQ(cmd.type, CommandType::StartAlarms);
+    EXPECT_EQ(cmd.ids, "1, 5 ,7-9");
+    EXPECT_EQ(cmd.id_count, 5u);
+    EXPECT_EQ(cmd.delay, 30s);
+    EXPECT_EQ(cmd.repeats, 1u);
+    EXPECT_EQ(cmd.message, "tenant");
+    const std::vector<IdRange> ranges = id_ranges(cmd.ids);
+    ASSERT_EQ(ranges.size(), 3u);
+    EXPECT_EQ(ranges[0].lo, 1);
+    EXPECT_EQ(ranges[1].hi, 5);
+    EXPECT_EQ(ranges[2].lo, 7);
+    EXPECT_EQ(ranges[2].hi, 9);
+    ASSERT_TRUE(parse_command("Cancel_Alarms(0-2147483647)", cmd));
+    EXPECT_EQ(cmd.id_count, 2147483648u);
+
+    EXPECT_FALSE(parse_command("Cancel_Alarms()\n", cmd));
+    EXPECT_FALSE(parse_command("Cancel_Alarms(1,)\n", cmd));
+    EXPECT_FALSE(parse_command("Cancel_Alarms(9-3)\n", cmd));
+    EXPECT_FALSE(parse_command("Cancel_Alarms(5-)\n", cmd));
+    EXPECT_FALSE(parse_command("Cancel_Alarms(-5)\n", cmd));
+    EXPECT_FALSE(parse_command("Start_Alarms(1-3): 10\n", cmd));  // no message
+    // Starting every id at once is almost certainly a typo.
+    EXPECT_FALSE(parse_command("Start_Alarms(0-2147483647): 10 all\n", cmd));
+}
+
+TEST(Parser, Groups) {
+    using namespace std::chrono_literals;
+    Command cmd;
+    ASSERT_TRUE(parse_command("Start_Alarm(1): 30 group=tenant-42 wake up\n", cmd));
+    EXPECT_EQ(cmd.group, "tenant-42");
+    EXPECT_EQ(cmd.message, "wake up");
+    ASSERT_TRUE(parse_command("Start_Alarms(1-9): every 5 count=2 group=t.a:b msg\n", cmd));
+    EXPECT_EQ(cmd.group, "t.a:b");
+    EXPECT_EQ(cmd.repeats, 1u);
+    ASSERT_TRUE(parse_command("Change_Alarm(1): 10 later\n", cmd));
+    EXPECT_TRUE(cmd.group.empty());
+
+    ASSERT_TRUE(parse_command("Cancel_Group(tenant-42)\n", cmd));
+    EXPECT_EQ(cmd.type, CommandType::CancelGroup);
+    EXPECT_EQ(cmd.group, "tenant-42");
+    ASSERT_TRUE(parse_command("Change_Group(t1): +30s\n", cmd));
+    EXPECT_EQ(cmd.type, CommandType::ChangeGroup);
+    EXPECT_EQ(cmd.delay, 30s);
+    ASSERT_TRUE(parse_command("Change_Group( t1 ): -250ms", cmd));
+    EXPECT_EQ(cmd.delay, -250ms);
+    ASSERT_TRUE(parse_command("Change_Group(t1): 5", cmd));
+    EXPECT_EQ(cmd.delay, 5s);
+
+    EXPECT_FALSE(parse_command("Start_Alarm(1): 30 group= msg\n", cmd));
+    EXPECT_FALSE(parse_command("Start_Alarm(1): 30 group=a/b msg\n", cmd));
+    EXPECT_FALSE(parse_command("Start_Alarm(1): 30 group=x\n", cmd));  // no message
+    EXPECT_FALSE(parse_command("Start_Alarm(1): 30 group=" + std::string(kMaxGroupTag + 1, 'g') +
+                                   " msg\n",
+                               cmd));
+    EXPECT_TRUE(parse_command("Start_Alarm(1): 30 group=" + std::string(kMaxGroupTag, 'g') +
+                                  " msg\n",
+                              cmd));
+    EXPECT_FALSE(parse_command("Cancel_Group()\n", cmd));
+    EXPECT_FALSE(parse_command("Cancel_Group(a b)\n", cmd));
+    EXPECT_FALSE(parse_command("Change_Group(t1): 5 extra\n", cmd));
+    EXPECT_FALSE(parse_command("Change_Group(t1) +5\n", cmd));
+}
+
+TEST(Parser, Stats) {
+    Command cmd;
+    ASSERT_TRUE(parse_command("Stats\n", cmd));
+    EXPECT_EQ(cmd.type, CommandType::Stats);
+    EXPECT_TRUE(parse_command("  Stats \r\n", cmd));
+    EXPECT_FALSE(parse_command("Stats all\n", cmd));
+    EXPECT_FALSE(parse_command("Statsx\n", cmd));
+    EXPECT_EQ(cmd.type, CommandType::Invalid);
+}
+
+TEST(Parser, Config) {
+    using namespace std::chrono_literals;
+    Command cmd;
+    ASSERT_TRUE(parse_command(
+        "Config display=4 capacity=0 overflow=coalesce slack=2ms flush=0 trace=on\n", cmd));
+    EXPECT_EQ(cmd.type, CommandType::Config);
+    EXPECT_EQ(cmd.config.display_threads, 4);
+    EXPECT_EQ(cmd.config.display_capacity, 0u);
+    EXPECT_EQ(cmd.config.display_overflow, OverflowPolicy::Coalesce);
+    EXPECT_EQ(cmd.config.expiry_slack, 2ms);
+    EXPECT_EQ(cmd.config.flush_latency, 0us);
+    EXPECT_EQ(cmd.config.tracing, true);
+    EXPECT_TRUE(cmd.config.dump.empty());
+
+    ASSERT_TRUE(parse_command("Config trace=off trace=clear dump=/tmp/alarm.json \r\n", cmd));
+    EXPECT_EQ(cmd.config.tracing, false);
+    EXPECT_TRUE(cmd.config.clear_trace);
+    EXPECT_EQ(cmd.config.dump, "/tmp/alarm.json");
+    EXPECT_FALSE(cmd.config.display_threads.has_value());
+
+    EXPECT_FALSE(parse_command("Config\n", cmd));
+    EXPECT_FALSE(parse_command("Config display=0\n", cmd));
+    EXPECT_FALSE(parse_command("Config display=1025\n", cmd));
+    EXPECT_FALSE(parse_command("Config overflow=drop\n", cmd));
+    EXPECT_FALSE(parse_command("Config trace=maybe\n", cmd));
+    EXPECT_FALSE(parse_command("Config dump=\n", cmd));
+    EXPECT_FALSE(parse_command("Config shards=4\n", cmd));
+    EXPECT_FALSE(parse_command("Configdisplay=2\n", cmd));
+    EXPECT_EQ(cmd.type, CommandType::Invalid);
+}
+
+TEST(Parser, CancelAndView) {
+    Command cmd;
+    ASSERT_TRUE(parse_command("Cancel_Alarm(7)\n", cmd));
+    EXPECT_EQ(cmd.type, CommandType::CancelAlarm);
+    EXPECT_EQ(cmd.id, 7);
+
+    ASSERT_TRUE(parse_command("View_Alarms\n", cmd));
+    EXPECT_EQ(cmd.type, CommandType::ViewAlarms);
+    EXPECT_FALSE(cmd.view.paged());
+}
+
+TEST(Parser, ViewFilters) {
+    using namespace std::chrono_literals;
+    Command cmd;
+    EXPECT_FALSE(parse_command("View_Alarms due=1s-250ms\n", cmd));  // empty time range
+    ASSERT_TRUE(
+        parse_command("View_Alarms id=10-20  due=250ms-1.5s\toffset=5 limit=50\r\n", cmd));
+    EXPECT_EQ(cmd.view.id_min, 10);
+    EXPECT_EQ(cmd.view.id_max, 20);
+    EXPECT_EQ(cmd.view.due_min, 250ms);
+    EXPECT_EQ(cmd.view.due_max, 1500ms);
+    EXPECT_EQ(cmd.view.offset, 5u);
+    EXPECT_EQ(cmd.view.limit, 50u);
+    EXPECT_TRUE(cmd.view.paged());
+
+    ASSERT_TRUE(parse_command("View_Alarms id=7", cmd));
+    EXPECT_EQ(cmd.view.id_min, 7);
+    EXPECT_EQ(cmd.view.id_max, 7);
+    ASSERT_TRUE(parse_command("View_Alarms id=100- due=-30s", cmd));
+    EXPECT_EQ(cmd.view.id_min, 100);
+    EXPECT_EQ(cmd.view.id_max, ViewFilter{}.id_max);
+    EXPECT_EQ(cmd.view.due_min, ViewFilter{}.due_min);
+    EXPECT_EQ(cmd.view.due_max, 30s);
+
+    EXPECT_FALSE(parse_command("View_Alarmsid=1\n", cmd));
+    EXPECT_FALSE(parse_command("View_Alarms id=\n", cmd));
+    EXPECT_FALSE(parse_command("View_Alarms id=-\n", cmd));
+    EXPECT_FALSE(parse_command("View_Alarms id=5-1\n", cmd));
+    EXPECT_FALSE(parse_command("View_Alarms id=5x\n", cmd));
+    EXPECT_FALSE(parse_command("View_Alarms due=5s\n", cmd));
+    EXPECT_FALSE(parse_command("View_Alarms limit=-1\n", cmd));
+    EXPECT_FALSE(parse_command("View_Alarms page=2\n", cmd));
+    EXPECT_FALSE(parse_command("View_Alarms limit=99999999999999999999999\n", cmd));
+}
+
+TEST(Parser, RejectsMalformed) {
+    Command cmd;
+    EXPECT_FALSE(parse_command("", cmd));
+    EXPECT_FALSE(parse_command("Start_Alarm(1): 10\n", cmd));
+    EXPECT_FALSE(parse_command("Start_Alarm(1) 10 msg\n", cmd));
+    EXPECT_FALSE(parse_command("Start_Alarm(-1): 10 msg\n", cmd));
+    EXPECT_FALSE(parse_command("Start_Alarm(1): -10 msg\n", cmd));
+    EXPECT_FALSE(parse_command("Cancel_Alarm(1\n", cmd));
+    EXPECT_FALSE(parse_command("Cancel_Alarm(1) extra\n", cmd));
+    EXPECT_FALSE(parse_command("View_Alarmsx\n", cmd));
+    EXPECT_EQ(cmd.type, CommandType::Invalid);
+}
+
+TEST(Parser, RejectsOverlongMessage) {
+    Command cmd;
+    std::string line = "Start_Alarm(1): 10 " + std::string(kMaxMessage + 1, 'x');
+    EXPECT_FALSE(parse_command(line.c_str(), cmd));
+    line = "Start_Alarm(1): 10 " + std::string(kMaxMessage, 'x');
+    EXPECT_TRUE(parse_command(line.c_str(), cmd));
+}
+
+}  // namespace
+}  // namespace alarmd
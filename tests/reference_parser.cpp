@@ -0,0 +1,83 @@
+#include "reference_parser.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+#include "alarmd/clock.hpp"
+
+namespace alarmd {
+
+namespace {
+
+// Trailing text after a complete command must be whitespace only.
+bool only_space(const char* s) {
+    for (; *s != '\0'; ++s) {
+        if (*s != ' ' && *s != '\t' && *s != '\r' && *s != '\n') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Matches the command name and id, then a delay (see parse_duration) and
+// the rest of the line as the message, without copying it.
+bool parse_timed(const char* line, const char* format, Command& cmd) {
+    int start = -1;
+    if (std::sscanf(line, format, &cmd.id, &start) != 1 || start < 0 || cmd.id < 0) {
+        return false;
+    }
+    const char* text = line + start;
+    text += std::strspn(text, " \t");
+    std::string_view rest(text);
+    if (!parse_duration(rest, cmd.delay)) {
+        return false;
+    }
+    text = rest.data();
+    if (*text != ' ' && *text != '\t') {
+        return false;
+    }
+    text += std::strspn(text, " \t");
+    const std::size_t len = std::strcspn(text, "\n");
+    std::string_view message(text, len);
+    // Drop trailing whitespace (e.g. "\r" from CRLF input).
+    while (!message.empty() &&
+           (message.back() == ' ' || message.back() == '\t' || message.back() == '\r')) {
+        message.remove_suffix(1);
+    }
+    if (message.empty() || message.size() > kMaxMessage) {
+        return false;
+    }
+    cmd.message = message;
+    return only_space(text + len);
+}
+
+bool parse_keyword(const char* line, const char* format) {
+    int consumed = 0;
+    return std::sscanf(line, format, &consumed) == 0 && consumed > 0 && only_space(line + consumed);
+}
+
+}  // namespace
+
+bool reference_parse_command(const char* line, Command& cmd) {
+    cmd = Command{};
+    char close = 0;
+    int consumed = 0;
+
+    if (parse_timed(line, " Start_Alarm(%d):%n", cmd)) {
+        cmd.type = CommandType::StartAlarm;
+    } else if (parse_timed(line, " Change_Alarm(%d):%n", cmd)) {
+        cmd.type = CommandType::ChangeAlarm;
+    } else if (std::sscanf(line, " Cancel_Alarm(%d%c%n", &cmd.id, &close, &consumed) == 2 &&
+               close == ')' && cmd.id >= 0 && only_space(line + consumed)) {
+        cmd.type = CommandType::CancelAlarm;
+    } else if (parse_keyword(line, " View_Alarms%n")) {
+        cmd.type = CommandType::ViewAlarms;
+    } else {
+        cmd = Command{};
+        return false;
+    }
+    return true;
+}
+
+}  // namespace alarmd
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "alarmd/parser.hpp"
+
+namespace alarmd {
+
+// The original sscanf-based command parser, kept as the oracle that the
+// fuzz test checks parse_command against. Accepts exactly the same grammar.
+bool reference_parse_command(const char* line, Command& cmd);
+
+}  // namespace alarmd
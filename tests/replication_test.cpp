@@ -0,0 +1,132 @@
+#include "alarmd/replication.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "alarmd/scheduler.hpp"
+#include "test_util.hpp"
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+using namespace std::chrono_literals;
+namespace fs = std::filesystem;
+
+SchedulerOptions leader(const TempDir& dir, int port) {
+    return {.display_threads = 1, .shards = 2, .out = stderr, .data_dir = dir.path(),
+            .commit_interval = 100us, .replica = "127.0.0.1:" + std::to_string(port)};
+}
+
+// What a server started on `dir` recovers.
+std::vector<AlarmView> recovered(const TempDir& dir) {
+    Scheduler s({.display_threads = 1, .out = stderr, .data_dir = dir.path()});
+    s.start();
+    std::vector<AlarmView> alarms;
+    s.snapshot({}, alarms);
+    return alarms;
+}
+
+TEST(Replication, ParsesHostPort) {
+    std::string host;
+    int port = 0;
+    ASSERT_TRUE(parse_host_port("10.0.0.7:5000", host, port));
+    EXPECT_EQ(host, "10.0.0.7");
+    EXPECT_EQ(port, 5000);
+    EXPECT_FALSE(parse_host_port("10.0.0.7", host, port));
+    EXPECT_FALSE(parse_host_port("10.0.0.7:0", host, port));
+    EXPECT_FALSE(parse_host_port("10.0.0.7:70000", host, port));
+    EXPECT_FALSE(parse_host_port("example.com:5000", host, port));
+    EXPECT_THROW(Scheduler({.out = stderr, .replica = "127.0.0.1:5000"}), std::invalid_argument);
+}
+
+TEST(Replication, FollowerRecoversTheLeadersAlarms) {
+    TempDir leader_dir;
+    TempDir follower_dir;
+    LogReplica replica({.dir = follower_dir.path()});
+    replica.start();
+    {
+        Scheduler s(leader(leader_dir, replica.port()));
+        s.start();
+        ASSERT_TRUE(wait_until([&] { return replica.stats().dumps == 1; }));
+        ASSERT_TRUE(s.start_alarm(1, 3600s, "one"));
+        ASSERT_TRUE(s.start_alarm(2, 3600s, "two", 0, "tenant"));
+        ASSERT_TRUE(s.start_alarm(3, 3600s, "three"));
+        ASSERT_TRUE(s.change_alarm(2, 7200s, "changed"));
+        ASSERT_TRUE(s.cancel_alarm(3));
+        ASSERT_TRUE(wait_until([&] { return replica.stats().records == 5; }));
+        EXPECT_TRUE(s.replication().connected);
+        EXPECT_EQ(s.replication().dumps, 1u);
+    }
+    replica.stop();
+    const std::vector<AlarmView> alarms = recovered(follower_dir);
+    ASSERT_EQ(alarms.size(), 2u);
+    EXPECT_EQ(alarms[0].id, 1);
+    EXPECT_EQ(alarms[1].id, 2);
+    EXPECT_EQ(alarms[1].message.view(), "changed");
+    EXPECT_EQ(alarms[1].group.view(), "tenant");
+    EXPECT_EQ(alarms[1].delay, 7200s);
+}
+
+// A follower that comes up late, or comes back after losing the leader,
+// is sent a dump of the current state, so it never keeps a cancelled alarm.
+TEST(Replication, ReconnectingFollowerGetsAFreshDump) {
+    TempDir leader_dir;
+    TempDir follower_dir;
+    auto replica = std::make_unique<LogReplica>(ReplicaOptions{.dir = follower_dir.path()});
+    const int port = replica->port();
+    Scheduler s(leader(leader_dir, port));
+    s.start();
+    for (int id = 0; id < 100; ++id) {
+        ASSERT_TRUE(s.start_alarm(id, 3600s, "early"));
+    }
+    ASSERT_TRUE(s.cancel_alarm(50));
+    replica->start();
+    ASSERT_TRUE(wait_until([&] { return replica->stats().dumps >= 1; }));
+    replica.reset();
+    ASSERT_TRUE(wait_until([&] { return !s.replication().connected; }));
+
+    for (int id = 0; id < 10; ++id) {
+        ASSERT_TRUE(s.cancel_alarm(id));  // missed by the follower
+    }
+    replica = std::make_unique<LogReplica>(ReplicaOptions{.dir = follower_dir.path(), .port = port});
+    replica->start();
+    ASSERT_TRUE(wait_until([&] { return replica->stats().dumps == 1; }));
+    ASSERT_TRUE(s.start_alarm(1000, 3600s, "late"));
+    ASSERT_TRUE(wait_until([&] { return replica->stats().records >= 1; }));
+    s.stop();
+    replica.reset();
+    EXPECT_EQ(recovered(follower_dir).size(), 90u);
+}
+
+// Anything that is not the leader's stream is dropped without touching the
+// directory.
+TEST(Replication, RejectsAForeignStream) {
+    TempDir follower_dir;
+    LogReplica replica({.dir = follower_dir.path()});
+    replica.start();
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<std::uint16_t>(replica.port()));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr), 0);
+    const char junk[] = "Start_Alarm(1): 10 not a log stream\n";
+    ASSERT_GT(write(fd, junk, sizeof junk), 0);
+    char byte;
+    EXPECT_LE(read(fd, &byte, 1), 0);  // closed (or reset) on us
+    close(fd);
+    EXPECT_TRUE(fs::is_empty(follower_dir.path()));
+}
+
+}  // namespace
+}  // namespace alarmd
@@ -0,0 +1,73 @@
+#include "alarmd/row_scan.hpp"
+
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+std::vector<std::uint32_t> reference(const std::vector<std::uint32_t>& offset,
+                                     const std::vector<int>& id,
+                                     const std::vector<std::uint32_t>& delay,
+                                     const RowFilter& f) {
+    std::vector<std::uint32_t> rows;
+    for (std::size_t row = 0; row < offset.size(); ++row) {
+        if (offset[row] >= f.offset_lo && offset[row] <= f.offset_hi && id[row] >= f.id_lo &&
+            id[row] <= f.id_hi && delay[row] != f.dead) {
+            rows.push_back(static_cast<std::uint32_t>(row));
+        }
+    }
+    return rows;
+}
+
+TEST(RowScan, ScalarIsAlwaysSupported) {
+    const std::vector<ScanIsa> isas = supported_scan_isas();
+    ASSERT_FALSE(isas.empty());
+    EXPECT_EQ(isas.front(), ScanIsa::Scalar);
+    EXPECT_EQ(isas.back(), scan_isa());
+    EXPECT_NE(row_scan_kernel(scan_isa()), nullptr);
+}
+
+// Every kernel this CPU runs, over lengths that leave each possible tail
+// and values at the edges of both signed and unsigned compares.
+TEST(RowScan, KernelsMatchReference) {
+    std::mt19937 rng(26);
+    const std::vector<std::uint32_t> offsets = {0, 1, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFE,
+                                                0xFFFFFFFF};
+    const std::vector<int> ids = {std::numeric_limits<int>::min(), -1, 0, 1,
+                                  std::numeric_limits<int>::max()};
+    for (ScanIsa isa : supported_scan_isas()) {
+        const RowScanFn kernel = row_scan_kernel(isa);
+        for (std::size_t rows = 0; rows < 70; ++rows) {
+            std::vector<std::uint32_t> offset(rows);
+            std::vector<int> id(rows);
+            std::vector<std::uint32_t> delay(rows);
+            for (std::size_t row = 0; row < rows; ++row) {
+                offset[row] = rng() % 2 ? offsets[rng() % offsets.size()]
+                                        : static_cast<std::uint32_t>(rng());
+                id[row] = rng() % 2 ? ids[rng() % ids.size()] : static_cast<int>(rng());
+                delay[row] = rng() % 4 == 0 ? 0xFFFFFFFF : 1000;
+            }
+            for (int trial = 0; trial < 20; ++trial) {
+                RowFilter f{.offset_lo = offsets[rng() % offsets.size()],
+                            .offset_hi = offsets[rng() % offsets.size()],
+                            .id_lo = ids[rng() % ids.size()],
+                            .id_hi = ids[rng() % ids.size()]};
+                if (trial % 2 == 0) {
+                    f.offset_lo = static_cast<std::uint32_t>(rng()) / 2;
+                    f.offset_hi = f.offset_lo + static_cast<std::uint32_t>(rng()) / 2;
+                }
+                std::vector<std::uint32_t> out(rows);
+                out.resize(kernel(offset.data(), id.data(), delay.data(), rows, f, out.data()));
+                ASSERT_EQ(out, reference(offset, id, delay, f))
+                    << scan_isa_name(isa) << " rows=" << rows;
+            }
+        }
+    }
+}
+
+}  // namespace
+}  // namespace alarmd
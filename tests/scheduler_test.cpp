@@ -0,0 +1,640 @@
+#include "alarmd/scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sched.h>
+
+#include <gtest/gtest.h>
+
+#include "test_util.hpp"
+
+namespace alarmd {
+namespace {
+
+using namespace std::chrono_literals;
+
+// Captures everything a scheduler prints into a string.
+class Capture {
+public:
+    Capture() : file_(open_memstream(&buf_, &len_)) {}
+    ~Capture() {
+        std::fclose(file_);
+        std::free(buf_);
+    }
+    std::FILE* file() { return file_; }
+    std::string text() {
+        std::fflush(file_);
+        return std::string(buf_, len_);
+    }
+
+private:
+    char* buf_ = nullptr;
+    std::size_t len_ = 0;
+    std::FILE* file_;
+};
+
+TEST(Scheduler, FiresDueAlarm) {
+    Capture out;
+    Scheduler s({.display_threads = 2, .out = out.file()});
+    s.start();
+    ASSERT_TRUE(s.start_alarm(4, 0s, "now"));
+    ASSERT_TRUE(wait_for_fired(s, 1));
+    s.stop();
+    // Worker 1 is its home, but an idle worker 2 may steal it.
+    EXPECT_NE(out.text().find("Alarm(4) Printed by Display Thread "), std::string::npos);
+    EXPECT_EQ(s.pending(), 0u);
+}
+
+TEST(Scheduler, SubSecondAlarmFiresOnTime) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .out = out.file()});
+    s.start();
+    const auto begin = std::chrono::steady_clock::now();
+    ASSERT_TRUE(s.start_alarm(1, 50ms, "quick"));
+    ASSERT_TRUE(wait_for_fired(s, 1));
+    const auto elapsed = std::chrono::steady_clock::now() - begin;
+    EXPECT_GE(elapsed, 50ms);
+    EXPECT_LT(elapsed, 250ms);
+    s.stop();
+    EXPECT_NE(out.text().find(": 50ms quick"), std::string::npos);
+}
+
+TEST(Scheduler, DuplicateAndMissingIds) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .out = out.file()});
+    s.start();
+    EXPECT_TRUE(s.start_alarm(1, 100s, "a"));
+    EXPECT_FALSE(s.start_alarm(1, 100s, "b"));
+    EXPECT_FALSE(s.change_alarm(2, 10s, "c"));
+    EXPECT_FALSE(s.cancel_alarm(2));
+    EXPECT_TRUE(s.change_alarm(1, 200s, "d"));
+    EXPECT_EQ(s.pending(), 1u);
+    EXPECT_TRUE(s.cancel_alarm(1));
+    EXPECT_EQ(s.pending(), 0u);
+}
+
+TEST(Scheduler, ChangeMakesAlarmDue) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .out = out.file()});
+    s.start();
+    ASSERT_TRUE(s.start_alarm(9, 1000s, "later"));
+    ASSERT_TRUE(s.change_alarm(9, 0s, "sooner"));
+    ASSERT_TRUE(wait_for_fired(s, 1));
+    s.stop();
+    EXPECT_NE(out.text().find("sooner"), std::string::npos);
+}
+
+TEST(Scheduler, CancelledAlarmNeverFires) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .out = out.file()});
+    s.start();
+    ASSERT_TRUE(s.start_alarm(1, 1s, "cancelled"));
+    ASSERT_TRUE(s.start_alarm(2, 1s, "kept"));
+    ASSERT_TRUE(s.cancel_alarm(1));
+    EXPECT_FALSE(s.cancel_alarm(1));
+    EXPECT_EQ(s.pending(), 1u);
+
+    // The id is free again while the tombstone is still queued.
+    ASSERT_TRUE(s.start_alarm(1, 1000s, "reused"));
+    EXPECT_EQ(s.pending(), 2u);
+
+    ASSERT_TRUE(wait_for_fired(s, 1));
+    s.stop();
+    std::string text = out.text();
+    EXPECT_NE(text.find("kept"), std::string::npos);
+    EXPECT_EQ(text.find("cancelled"), std::string::npos);
+}
+
+TEST(Scheduler, BulkStartAndCancel) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .shards = 3, .out = out.file()});
+    s.start();
+    ASSERT_TRUE(s.start_alarm(7, 3600s, "single"));
+    std::vector<AlarmRequest> entries;
+    for (int id = 0; id < 1000; ++id) {
+        entries.push_back({RequestKind::Start, id, 3600s, Message("bulk")});
+    }
+    entries.push_back({RequestKind::Start, 3, 3600s, Message("again")});
+    EXPECT_EQ(s.start_alarms(entries), 999u);  // 7 was taken, 3 named twice
+    EXPECT_TRUE(entries.empty());
+    EXPECT_EQ(s.pending(), 1000u);
+    std::vector<AlarmView> alarms;
+    s.snapshot({.id_min = 7, .id_max = 7}, alarms);
+    ASSERT_EQ(alarms.size(), 1u);
+    EXPECT_EQ(alarms[0].message.view(), "single");
+
+    // Spelled out id by id, and a range wider than the alarm count.
+    EXPECT_EQ(s.cancel_alarms({{0, 99}, {50, 149}, {5000, 5000}}), 150u);
+    EXPECT_EQ(s.pending(), 850u);
+    EXPECT_EQ(s.cancel_alarms({{900, std::numeric_limits<int>::max()}}), 100u);
+    EXPECT_EQ(s.pending(), 750u);
+    EXPECT_FALSE(s.cancel_alarm(120));
+    EXPECT_TRUE(s.cancel_alarm(150));
+    s.stop();
+    EXPECT_EQ(s.fired(), 0u);
+}
+
+TEST(Scheduler, GroupCommands) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .shards = 3, .out = out.file()});
+    s.start();
+    for (int id = 0; id < 30; ++id) {
+        ASSERT_TRUE(s.start_alarm(id, 3600s, "tenant", 0, id % 3 == 0 ? "a" : "b"));
+    }
+    ASSERT_TRUE(s.start_alarm(100, 3600s, "untagged"));
+    ASSERT_TRUE(s.change_alarm(0, 7200s, "moved", 0, "b"));   // a -> b
+    ASSERT_TRUE(s.change_alarm(1, 7200s, "stays"));            // keeps b
+    ASSERT_TRUE(s.cancel_alarm(3));                            // leaves a
+    EXPECT_EQ(s.shift_group("nobody", 1s), 0u);
+
+    std::vector<AlarmView> before;
+    s.snapshot({.id_min = 6, .id_max = 6}, before);
+    EXPECT_EQ(s.shift_group("a", -1800s), 8u);
+    std::vector<AlarmView> after;
+    s.snapshot({.id_min = 6, .id_max = 6}, after);
+    ASSERT_EQ(after.size(), 1u);
+    EXPECT_EQ(before[0].deadline - after[0].deadline, std::chrono::microseconds(1800s).count());
+    EXPECT_EQ(after[0].delay, 3600s);
+    EXPECT_EQ(after[0].group.view(), "a");
+
+    EXPECT_EQ(s.cancel_group("a"), 8u);
+    EXPECT_EQ(s.cancel_group("a"), 0u);
+    EXPECT_EQ(s.pending(), 22u);
+    EXPECT_EQ(s.cancel_group("b"), 21u);
+    EXPECT_EQ(s.pending(), 1u);
+
+    // A fired alarm leaves its group.
+    ASSERT_TRUE(s.start_alarm(200, 0s, "now", 0, "c"));
+    ASSERT_TRUE(wait_for_fired(s, 1));
+    EXPECT_EQ(s.cancel_group("c"), 0u);
+    s.stop();
+}
+
+TEST(Scheduler, PeriodicAlarmFiresCountTimes) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .out = out.file()});
+    s.start();
+    ASSERT_TRUE(s.start_alarm(1, 5ms, "tick", 2));
+    ASSERT_TRUE(wait_for_fired(s, 3));
+    std::this_thread::sleep_for(30ms);
+    s.stop();
+    EXPECT_EQ(s.fired(), 3u);
+    EXPECT_EQ(s.pending(), 0u);
+    // Every fire printed its own copy of the message.
+    const std::string text = out.text();
+    std::size_t n = 0;
+    for (std::size_t at = 0; (at = text.find("tick", at)) != std::string::npos; ++at) {
+        ++n;
+    }
+    EXPECT_EQ(n, 3u);
+}
+
+TEST(Scheduler, PeriodicAlarmStaysOnItsGrid) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .queue = QueueKind::Wheel, .out = out.file()});
+    s.start();
+    ASSERT_TRUE(s.start_alarm(1, 20ms, "grid", kRepeatForever));
+    std::vector<AlarmView> view;
+    s.snapshot({}, view);
+    ASSERT_EQ(view.size(), 1u);
+    const Deadline first = view[0].deadline;
+    ASSERT_TRUE(wait_for_fired(s, 3));
+    s.snapshot({}, view);
+    ASSERT_EQ(view.size(), 1u);
+    EXPECT_EQ(view[0].repeats, kRepeatForever);
+    EXPECT_GT(view[0].deadline, first);
+    EXPECT_EQ((view[0].deadline - first) % 20'000, 0);
+    // Re-arming reuses the node.
+    EXPECT_EQ(s.pool_stats().high_water, 1u);
+    ASSERT_TRUE(s.cancel_alarm(1));
+    EXPECT_EQ(s.pending(), 0u);
+}
+
+TEST(Scheduler, SameSecondAlarmsFireAsOneBatch) {
+    Capture out;
+    Scheduler s({.display_threads = 3, .shards = 2, .out = out.file()});
+    s.start();
+    for (int id = 0; id < 500; ++id) {
+        ASSERT_TRUE(s.start_alarm(id, 1s, "tick"));
+    }
+    ASSERT_TRUE(wait_for_fired(s, 500));
+    s.stop();
+    EXPECT_EQ(s.pending(), 0u);
+}
+
+TEST(Scheduler, FullDisplayQueueShedsAndReportsIt) {
+    Scheduler s({.display_threads = 1,
+                 .on_fired = [](int, std::vector<FiredAlarm>&) {
+                     std::this_thread::sleep_for(5ms);
+                 },
+                 .display_capacity = 16,
+                 .display_overflow = OverflowPolicy::Shed});
+    s.start();
+    std::vector<AlarmRequest> storm;
+    for (int id = 0; id < 500; ++id) {
+        storm.push_back({RequestKind::Start, id, 20ms, Message("storm")});
+    }
+    ASSERT_EQ(s.start_alarms(storm), 500u);
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (s.fired() + s.display_stats().shed < 500) {
+        ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+        std::this_thread::sleep_for(1ms);
+    }
+    const DisplayStats stats = s.display_stats();
+    EXPECT_GT(stats.shed, 0u);
+    EXPECT_LE(stats.queued, 16u);
+    EXPECT_EQ(stats.capacity, 16u);
+    EXPECT_NE(s.render_stats(0).find("display_queue    queued="), std::string::npos);
+    EXPECT_NE(s.render_prometheus().find("alarmd_display_shed_total "), std::string::npos);
+}
+
+TEST(Scheduler, SlackFiresNearlyDueAlarmsEarly) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .out = out.file(),
+                 .expiry_slack = std::chrono::milliseconds(1500)});
+    s.start();
+    const auto begin = std::chrono::steady_clock::now();
+    ASSERT_TRUE(s.start_alarm(1, 1s, "early"));
+    ASSERT_TRUE(wait_for_fired(s, 1));
+    EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::milliseconds(500));
+    EXPECT_THROW(Scheduler({.expiry_slack = std::chrono::milliseconds(-1)}), std::invalid_argument);
+}
+
+TEST(Scheduler, ConfigureResizesDisplayWithoutLosingAlarms) {
+    std::mutex mutex;
+    int highest_worker = 0;
+    Scheduler s({.display_threads = 1,
+                 .on_fired = [&](int worker, std::vector<FiredAlarm>&) {
+                     std::lock_guard<std::mutex> lock(mutex);
+                     highest_worker = std::max(highest_worker, worker);
+                 }});
+    s.start();
+    std::vector<AlarmRequest> burst;
+    for (int id = 0; id < 2000; ++id) {
+        burst.push_back({RequestKind::Start, id, std::chrono::microseconds(id * 10), Message("x")});
+    }
+    ASSERT_EQ(s.start_alarms(burst), 2000u);
+    s.configure({.display_threads = 4, .display_capacity = 8,
+                 .display_overflow = OverflowPolicy::Block, .expiry_slack = 1ms});
+    ASSERT_TRUE(wait_for_fired(s, 2000));
+    EXPECT_EQ(s.display_stats().capacity, 4u * 8u);
+    EXPECT_EQ(s.config_summary(),
+              "display=4 capacity=8 overflow=block slack=1ms flush=1ms trace=off");
+    for (int id = 0; id < 200; ++id) {
+        ASSERT_TRUE(s.start_alarm(id, 0s, "again"));
+    }
+    ASSERT_TRUE(wait_for_fired(s, 2200));
+    s.stop();
+    EXPECT_GT(highest_worker, 1);
+    EXPECT_THROW(s.configure({.display_threads = 0}), std::invalid_argument);
+    EXPECT_THROW(s.configure({.display_threads = kMaxDisplayThreads + 1}),
+                 std::invalid_argument);
+    EXPECT_THROW(s.configure({.expiry_slack = -1ms}), std::invalid_argument);
+}
+
+TEST(Scheduler, ChurnReusesPooledNodes) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .shards = 2, .out = out.file()});
+    s.start();
+    for (int id = 0; id < 100; ++id) {
+        ASSERT_TRUE(s.start_alarm(id, 1000s, "steady"));
+    }
+    for (int round = 0; round < 50'000; ++round) {
+        int id = 1000 + round;
+        ASSERT_TRUE(s.start_alarm(id, 1000s, "churn"));
+        ASSERT_TRUE(s.cancel_alarm(id));
+    }
+    PoolStats stats = s.pool_stats();
+    EXPECT_EQ(s.pending(), 100u);
+    // Tombstones are swept well before the pools need a few slabs more.
+    EXPECT_LE(stats.slabs, 8u);
+    EXPECT_GE(stats.live, 100u);
+    EXPECT_LE(stats.high_water, stats.capacity);
+}
+
+TEST(Scheduler, ViewSkipsCancelled) {
+    Capture out;
+    Capture view;
+    Scheduler s({.display_threads = 1, .out = out.file()});
+    s.start();
+    s.start_alarm(1, 100s, "gone");
+    s.start_alarm(2, 100s, "here");
+    s.cancel_alarm(1);
+    s.view_alarms(view.file());
+    std::string text = view.text();
+    EXPECT_EQ(text.find("gone"), std::string::npos);
+    EXPECT_NE(text.find("here"), std::string::npos);
+}
+
+TEST(Scheduler, ViewListsInExpiryOrder) {
+    Capture out;
+    Capture view;
+    Scheduler s({.display_threads = 1, .out = out.file()});
+    s.start();
+    s.start_alarm(1, 300s, "third");
+    s.start_alarm(2, 100s, "first");
+    s.start_alarm(3, 200s, "second");
+    s.view_alarms(view.file());
+    std::string text = view.text();
+    auto first = text.find("Alarm(2)");
+    auto second = text.find("Alarm(3)");
+    auto third = text.find("Alarm(1)");
+    ASSERT_NE(first, std::string::npos);
+    EXPECT_LT(first, second);
+    EXPECT_LT(second, third);
+}
+
+TEST(Scheduler, SnapshotFiltersAndPagesAcrossShards) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .shards = 4, .out = out.file()});
+    s.start();
+    // Alarm i is due after 1000 + i seconds, so expiry order is id order.
+    for (int id = 0; id < 200; ++id) {
+        ASSERT_TRUE(s.start_alarm(id, std::chrono::seconds(1000 + id), "m"));
+    }
+    std::vector<AlarmView> page;
+    EXPECT_EQ(s.snapshot({.id_min = 50, .id_max = 149, .offset = 10, .limit = 5}, page), 100u);
+    ASSERT_EQ(page.size(), 5u);
+    for (std::size_t i = 0; i < page.size(); ++i) {
+        EXPECT_EQ(page[i].id, 60 + static_cast<int>(i));
+    }
+    EXPECT_EQ(s.snapshot({.due_min = 1099500ms, .due_max = 1109500ms}, page), 10u);
+    ASSERT_EQ(page.size(), 10u);
+    EXPECT_EQ(page.front().id, 100);
+    EXPECT_EQ(s.snapshot({.offset = 500}, page), 200u);
+    EXPECT_TRUE(page.empty());
+
+    Capture view;
+    s.view_alarms(view.file(), {.offset = 198});
+    const std::string text = view.text();
+    EXPECT_NE(text.find("199. Alarm(198): "), std::string::npos) << text;
+    EXPECT_NE(text.find("200. Alarm(199): "), std::string::npos) << text;
+    EXPECT_EQ(text.find("Alarm(197)"), std::string::npos) << text;
+    EXPECT_NE(text.find("Showing 199-200 of 200 alarms"), std::string::npos) << text;
+}
+
+TEST(Scheduler, SnapshotPagesAlarmsStartedOutOfOrder) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .shards = 2, .out = out.file(), .cold_horizon = 3600s});
+    s.start();
+    // Alarm i is due after 1000 + (i * 37) % 200 seconds, or that many hours
+    // for the cold half, so later starts keep displacing the kept rows.
+    for (int id = 0; id < 200; ++id) {
+        const std::chrono::seconds delay(1000 + (id * 37) % 200);
+        ASSERT_TRUE(s.start_alarm(id, id % 2 == 0 ? delay : delay * 3600, "m"));
+    }
+    std::vector<AlarmView> all;
+    ASSERT_EQ(s.snapshot({}, all), 200u);
+    std::vector<AlarmView> page;
+    for (const std::size_t offset : {0u, 7u, 95u, 100u, 190u}) {
+        EXPECT_EQ(s.snapshot({.offset = offset, .limit = 10}, page), 200u);
+        ASSERT_EQ(page.size(), 10u);
+        for (std::size_t i = 0; i < page.size(); ++i) {
+            EXPECT_EQ(page[i].id, all[offset + i].id) << offset + i;
+        }
+    }
+}
+
+TEST(Scheduler, RejectsBadOptions) {
+    EXPECT_THROW(Scheduler({.display_threads = 0}), std::invalid_argument);
+    EXPECT_THROW(Scheduler({.display_threads = kMaxDisplayThreads + 1}), std::invalid_argument);
+    EXPECT_THROW(Scheduler({.shards = 0}), std::invalid_argument);
+    EXPECT_THROW(Scheduler({.ring_capacity = 0}), std::invalid_argument);
+    EXPECT_THROW(Scheduler({.cold_horizon = -1s}), std::invalid_argument);
+    EXPECT_THROW(Scheduler({.shard_cpus = {CPU_SETSIZE - 1}}), std::invalid_argument);
+}
+
+TEST(Scheduler, PinnedThreadsStillFire) {
+    Capture out;
+    Scheduler s({.display_threads = 2,
+                 .shards = 2,
+                 .out = out.file(),
+                 .shard_cpus = {0},
+                 .display_cpus = {0}});
+    s.start();
+    ASSERT_TRUE(s.start_alarm(1, 0s, "pinned"));
+    ASSERT_TRUE(s.start_alarm(2, 0s, "pinned"));
+    ASSERT_TRUE(wait_for_fired(s, 2));
+}
+
+TEST(Scheduler, OnlyAnEarlierDeadlineWakesTheAlarmThread) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .out = out.file()});
+    s.start();
+    std::this_thread::sleep_for(20ms);
+    EXPECT_EQ(s.wakeups(), 0u);  // idle: nothing to wait for
+    ASSERT_TRUE(s.start_alarm(1, 3600s, "head"));
+    std::this_thread::sleep_for(20ms);
+    const std::uint64_t woken = s.wakeups();
+    EXPECT_EQ(woken, 1u);
+    for (int id = 2; id < 102; ++id) {
+        ASSERT_TRUE(s.start_alarm(id, 7200s, "behind the head"));
+    }
+    ASSERT_TRUE(s.cancel_alarm(50));
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(s.wakeups(), woken);
+    ASSERT_TRUE(s.start_alarm(200, 0s, "new head"));
+    ASSERT_TRUE(wait_for_fired(s, 1));
+    EXPECT_GT(s.wakeups(), woken);
+}
+
+TEST(Scheduler, ArmCallbackReplacesAlarmThreads) {
+    Capture out;
+    std::mutex mutex;
+    std::vector<Deadline> armed(2, 0);
+    Scheduler s({.display_threads = 1,
+                 .shards = 2,
+                 .out = out.file(),
+                 .on_arm = [&](std::size_t shard, Deadline when) {
+                     std::lock_guard<std::mutex> lock(mutex);
+                     armed[shard] = when;
+                 }});
+    const auto when = [&](std::size_t shard) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return armed[shard];
+    };
+    s.start();
+    for (std::size_t i = 0; i < 2; ++i) {
+        EXPECT_LE(when(i), monotonic_now());  // the first poll is due at once
+        s.poll_shard(i);
+        EXPECT_EQ(when(i), kNoDeadline);
+    }
+    ASSERT_TRUE(s.start_alarm(1, 10ms, "polled"));
+    const std::size_t shard = shard_of(1, 2);
+    const Deadline due = when(shard);
+    EXPECT_NE(due, kNoDeadline);
+    s.poll_shard(shard);  // early: fires nothing
+    EXPECT_EQ(s.fired(), 0u);
+    EXPECT_EQ(when(shard), due);
+    std::this_thread::sleep_for(std::chrono::microseconds(due - monotonic_now()));
+    s.poll_shard(shard);
+    ASSERT_TRUE(wait_for_fired(s, 1));
+    EXPECT_EQ(when(shard), kNoDeadline);
+    s.stop();
+    EXPECT_NE(out.text().find("Alarm(1) Printed by Display Thread "), std::string::npos);
+}
+
+TEST(Scheduler, FarAlarmsLiveInTheColdTier) {
+    Capture out;
+    Scheduler s({.display_threads = 1, .shards = 2, .out = out.file(), .cold_horizon = 3600s});
+    s.start();
+    for (int id = 0; id < 100; ++id) {
+        ASSERT_TRUE(s.start_alarm(id, std::chrono::hours(72) + std::chrono::seconds(id), "far"));
+    }
+    ASSERT_TRUE(s.start_alarm(100, 60s, "near"));
+    ASSERT_TRUE(s.start_alarm(101, 72h, "periodic", 3));  // periodic alarms stay nodes
+    EXPECT_EQ(s.cold_stats().alarms, 100u);
+    EXPECT_EQ(s.pending(), 102u);
+    EXPECT_FALSE(s.start_alarm(3, 1s, "dup"));
+
+    std::vector<AlarmView> page;
+    EXPECT_EQ(s.snapshot({.id_min = 10, .id_max = 19}, page), 10u);
+    ASSERT_EQ(page.size(), 10u);
+    EXPECT_EQ(page[0].id, 10);
+    EXPECT_EQ(page[0].message.view(), "far");
+    EXPECT_EQ(page[0].delay, 72h + 10s);
+
+    ASSERT_TRUE(s.change_alarm(5, 0s, "now"));  // leaves the cold tier and fires
+    ASSERT_TRUE(wait_for_fired(s, 1));
+    ASSERT_TRUE(s.change_alarm(6, 96h, "further"));
+    EXPECT_EQ(s.cold_stats().alarms, 99u);
+    ASSERT_TRUE(s.change_alarm(100, 48h, "pushed out"));  // and a node moves in
+    EXPECT_EQ(s.cold_stats().alarms, 100u);
+    EXPECT_TRUE(s.cancel_alarm(7));
+    EXPECT_FALSE(s.cancel_alarm(7));
+    EXPECT_EQ(s.cancel_alarms({{0, 49}}), 48u);
+    EXPECT_EQ(s.cold_stats().alarms, 51u);
+    s.post({RequestKind::Start, 200, 72h, Message("posted")});
+    s.drain();
+    EXPECT_EQ(s.cold_stats().alarms, 52u);
+    s.stop();
+    const std::string text = out.text();
+    EXPECT_NE(text.find("Alarm(5) Printed by Display Thread "), std::string::npos) << text;
+    EXPECT_NE(s.render_stats(0).find("cold_tier        alarms="), std::string::npos);
+}
+
+TEST(Scheduler, ColdBucketsArePromotedAheadOfTime) {
+    // A horizon that makes the next cold bucket due for promotion in 20 ms.
+    const Deadline now = monotonic_now();
+    Deadline bucket = ColdTier::bucket_start(ColdTier::bucket_of(now) + 1);
+    if (bucket - now < 100'000) {
+        bucket += Deadline{1} << ColdTier::kBucketBits;
+    }
+    const std::chrono::microseconds horizon(bucket - now - 20'000);
+    Capture out;
+    Scheduler s({.display_threads = 1, .out = out.file(), .cold_horizon = horizon});
+    s.start();
+    ASSERT_TRUE(s.start_alarm(1, std::chrono::microseconds(bucket - now + 1'000), "promoted"));
+    EXPECT_EQ(s.cold_stats().alarms, 1u);
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (s.cold_stats().alarms != 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(s.cold_stats().alarms, 0u);
+    EXPECT_EQ(s.pending(), 1u);
+    std::vector<AlarmView> alarms;
+    s.snapshot({}, alarms);
+    ASSERT_EQ(alarms.size(), 1u);
+    EXPECT_EQ(alarms[0].message.view(), "promoted");
+    EXPECT_GE(alarms[0].deadline, bucket);
+}
+
+TEST(Scheduler, PostedRequestsApplyInOrderAndReport) {
+    Capture out;
+    std::mutex mutex;
+    std::vector<std::string> results;
+    auto record = [&](const RequestResult& r) {
+        std::lock_guard<std::mutex> lock(mutex);
+        results.push_back(std::to_string(r.id) + (r.ok ? " ok " : " no ") + std::string(r.message));
+    };
+    // A tiny ring forces the full-ring fallback as well.
+    Scheduler s({.display_threads = 1, .shards = 2, .out = out.file(), .ring_capacity = 2,
+                 .on_result = record});
+    s.start();
+    s.post({RequestKind::Start, 1, 100s, Message("first")});
+    s.post({RequestKind::Start, 1, 100s, Message("dup")});
+    s.post({RequestKind::Change, 1, 200s, Message("changed")});
+    s.post({RequestKind::Cancel, 2, {}, {}});
+    s.post({RequestKind::Start, 2, 0s, Message("fires")});
+    s.post({RequestKind::Start, 3, 100s, Message("three")});
+    s.post({RequestKind::Cancel, 3, {}, {}});
+    s.drain();
+    ASSERT_TRUE(wait_for_fired(s, 1));
+    s.stop();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto order = [&](const std::string& entry) {
+        return std::find(results.begin(), results.end(), entry) - results.begin();
+    };
+    ASSERT_EQ(results.size(), 7u);
+    EXPECT_LT(order("1 ok first"), order("1 no dup"));
+    EXPECT_LT(order("1 no dup"), order("1 ok changed"));
+    EXPECT_LT(order("2 no "), order("2 ok fires"));
+    EXPECT_LT(order("3 ok three"), order("3 ok "));
+    EXPECT_NE(out.text().find("fires"), std::string::npos);
+}
+
+TEST(Scheduler, ShardedCommandsAndFiring) {
+    Capture out;
+    Scheduler s({.display_threads = 3, .shards = 4, .out = out.file()});
+    s.start();
+    for (int id = 0; id < 100; ++id) {
+        ASSERT_TRUE(s.start_alarm(id, 1000s, "later"));
+    }
+    EXPECT_FALSE(s.start_alarm(17, 1000s, "dup"));
+    EXPECT_EQ(s.pending(), 100u);
+    for (int id = 0; id < 100; id += 2) {
+        ASSERT_TRUE(s.cancel_alarm(id));
+    }
+    for (int id = 1; id < 100; id += 10) {
+        ASSERT_TRUE(s.change_alarm(id, 0s, "now"));
+    }
+    ASSERT_TRUE(wait_for_fired(s, 10));
+    EXPECT_EQ(s.pending(), 40u);
+}
+
+TEST(Scheduler, ViewMergesShardsInExpiryOrder) {
+    Capture out;
+    Capture view;
+    Scheduler s({.display_threads = 1, .shards = 5, .out = out.file()});
+    s.start();
+    for (int id = 0; id < 50; ++id) {
+        s.start_alarm(id, std::chrono::seconds(1000 + (id * 37) % 50), "m");
+    }
+    s.view_alarms(view.file());
+    std::string text = view.text();
+
+    long last = 0;
+    int rows = 0;
+    for (std::size_t pos = text.find("Expiry = "); pos != std::string::npos;
+         pos = text.find("Expiry = ", pos + 1)) {
+        long expiry = std::strtol(text.c_str() + pos + 9, nullptr, 10);
+        EXPECT_GE(expiry, last);
+        last = expiry;
+        ++rows;
+    }
+    EXPECT_EQ(rows, 50);
+}
+
+TEST(Shard, ShardOfIsInRangeAndSpreads) {
+    std::vector<int> counts(8);
+    for (int id = 0; id < 8000; ++id) {
+        std::size_t s = shard_of(id, counts.size());
+        ASSERT_LT(s, counts.size());
+        ++counts[s];
+    }
+    for (int n : counts) {
+        EXPECT_GT(n, 800);
+        EXPECT_LT(n, 1200);
+    }
+}
+
+}  // namespace
+}  // namespace alarmd
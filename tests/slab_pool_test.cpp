@@ -0,0 +1,74 @@
+#include "alarmd/slab_pool.hpp"
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+struct Node {
+    explicit Node(int v) : value(v) {}
+    int value;
+    char pad[60];
+};
+
+TEST(SlabPool, CreateDestroyAndStats) {
+    SlabPool<Node> pool(4);
+    std::vector<Node*> nodes;
+    for (int i = 0; i < 10; ++i) {
+        nodes.push_back(pool.create(i));
+        EXPECT_EQ(nodes.back()->value, i);
+    }
+    PoolStats stats = pool.stats();
+    EXPECT_EQ(stats.live, 10u);
+    EXPECT_EQ(stats.slabs, 3u);
+    EXPECT_EQ(stats.capacity, 12u);
+    EXPECT_EQ(stats.high_water, 10u);
+
+    std::set<Node*> distinct(nodes.begin(), nodes.end());
+    EXPECT_EQ(distinct.size(), nodes.size());
+
+    for (Node* n : nodes) {
+        pool.destroy(n);
+    }
+    stats = pool.stats();
+    EXPECT_EQ(stats.live, 0u);
+    EXPECT_EQ(stats.high_water, 10u);
+}
+
+TEST(SlabPool, ReusesFreedNodesWithoutGrowing) {
+    SlabPool<Node> pool(16);
+    std::vector<Node*> live;
+    for (int i = 0; i < 16; ++i) {
+        live.push_back(pool.create(i));
+    }
+    for (int round = 0; round < 1000; ++round) {
+        pool.destroy(live[round % 16]);
+        live[round % 16] = pool.create(round);
+    }
+    EXPECT_EQ(pool.stats().slabs, 1u);
+    EXPECT_EQ(pool.stats().live, 16u);
+    for (Node* n : live) {
+        pool.destroy(n);
+    }
+}
+
+TEST(SlabPool, SlabsArePageAlignedOnTheirNode) {
+    SlabPool<Node> pool(100, 0);  // node 0 exists wherever NUMA is reported at all
+    Node* first = pool.create(1);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(first) % 4096, 0u);  // the slab's first node
+    std::vector<Node*> nodes{first};
+    for (int i = 0; i < 250; ++i) {
+        nodes.push_back(pool.create(i));
+    }
+    EXPECT_EQ(pool.stats().slabs, 3u);
+    for (Node* n : nodes) {
+        pool.destroy(n);
+    }
+}
+
+}  // namespace
+}  // namespace alarmd
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+
+#include "alarmd/scheduler.hpp"
+
+namespace alarmd {
+
+// Fresh data directory, removed with everything in it.
+class TempDir {
+public:
+    TempDir() {
+        char path[] = "/tmp/alarmd_test_XXXXXX";
+        if (mkdtemp(path) == nullptr) {
+            throw std::system_error(errno, std::generic_category(), "mkdtemp");
+        }
+        path_ = path;
+    }
+    ~TempDir() { std::filesystem::remove_all(path_); }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    const std::string& path() const { return path_; }
+
+    // The store's log segments, oldest first.
+    std::vector<std::string> logs() const {
+        std::vector<std::string> names;
+        for (const auto& entry : std::filesystem::directory_iterator(path_)) {
+            if (entry.path().filename().string().starts_with("wal.")) {
+                names.push_back(entry.path().string());
+            }
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+private:
+    std::string path_;
+};
+
+// Polls `done` until it holds; false if it still does not after 5s.
+inline bool wait_until(const std::function<bool()>& done) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+inline bool wait_for_fired(const Scheduler& s, std::uint64_t n) {
+    return wait_until([&] { return s.fired() >= n; });
+}
+
+}  // namespace alarmd
@@ -0,0 +1,213 @@
+#include "alarmd/timer_queue.hpp"
+
+#include <map>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace alarmd {
+namespace {
+
+class TimerQueueTest : public ::testing::TestWithParam<QueueKind> {
+protected:
+    void SetUp() override { queue_ = make_timer_queue(GetParam()); }
+
+    Alarm* push(int id, Deadline deadline) {
+        nodes_.push_back(std::make_unique<Alarm>());
+        Alarm* a = nodes_.back().get();
+        a->id = id;
+        a->deadline = deadline;
+        a->seq = seq_++;
+        queue_->push(a);
+        return a;
+    }
+
+    // Pops every alarm due at `now` and returns their ids in pop order.
+    std::vector<int> drain(Deadline now) {
+        std::vector<int> ids;
+        while (Alarm* a = queue_->pop_due(now)) {
+            EXPECT_LE(a->deadline, now);
+            ids.push_back(a->id);
+        }
+        return ids;
+    }
+
+    std::vector<std::unique_ptr<Alarm>> nodes_;
+    std::unique_ptr<TimerQueue> queue_;
+    std::uint64_t seq_ = 0;
+};
+
+TEST_P(TimerQueueTest, PopsInExpiryOrder) {
+    push(1, 130);
+    push(2, 110);
+    push(3, 120);
+    EXPECT_TRUE(drain(100).empty());
+    EXPECT_EQ(drain(125), (std::vector<int>{2, 3}));
+    EXPECT_EQ(drain(1000), (std::vector<int>{1}));
+    EXPECT_TRUE(queue_->empty());
+}
+
+TEST_P(TimerQueueTest, EqualExpiryIsFifo) {
+    for (int id = 0; id < 10; ++id) {
+        push(id, 500);
+    }
+    EXPECT_EQ(drain(500), (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST_P(TimerQueueTest, Erase) {
+    push(1, 10);
+    Alarm* b = push(2, 20);
+    push(3, 30);
+    queue_->erase(b);
+    EXPECT_EQ(queue_->size(), 2u);
+    EXPECT_EQ(drain(100), (std::vector<int>{1, 3}));
+}
+
+TEST_P(TimerQueueTest, RescheduleMovesInPlace) {
+    Alarm* a = push(1, 10);
+    push(2, 20);
+    Alarm* c = push(3, 30);
+    queue_->reschedule(a, 25, seq_++);
+    queue_->reschedule(c, 5, seq_++);
+    EXPECT_EQ(queue_->size(), 3u);
+    EXPECT_EQ(queue_->peek_due(5), c);
+    EXPECT_EQ(drain(100), (std::vector<int>{3, 2, 1}));
+}
+
+// Both a batch small enough to sift in and one big enough to rebuild the
+// heap must come out in expiry order, FIFO among equal deadlines.
+TEST_P(TimerQueueTest, PushBulkKeepsExpiryOrder) {
+    std::map<std::pair<Deadline, std::uint64_t>, int> ref;
+    for (int id = 0; id < 100; ++id) {
+        const Alarm* a = push(id, 1000 + (id * 7919) % 50);
+        ref[{a->deadline, a->seq}] = id;
+    }
+    for (const int count : {5, 500}) {
+        std::vector<Alarm*> batch;
+        for (int i = 0; i < count; ++i) {
+            nodes_.push_back(std::make_unique<Alarm>());
+            Alarm* a = nodes_.back().get();
+            a->id = static_cast<int>(nodes_.size());
+            a->deadline = 1000 + (a->id * 104729) % 60;
+            a->seq = seq_++;
+            ref[{a->deadline, a->seq}] = a->id;
+            batch.push_back(a);
+        }
+        queue_->push_bulk(batch);
+    }
+    ASSERT_EQ(queue_->size(), ref.size());
+    std::vector<int> want;
+    for (const auto& [key, id] : ref) {
+        want.push_back(id);
+    }
+    EXPECT_EQ(drain(2000), want);
+}
+
+TEST_P(TimerQueueTest, NextExpiryNeverLate) {
+    Deadline when;
+    EXPECT_FALSE(queue_->next_expiry(when));
+    push(1, 1'000'000);
+    push(2, 5'000);
+    ASSERT_TRUE(queue_->next_expiry(when));
+    EXPECT_LE(when, 5'000);
+
+    // Following next_expiry must reach the alarm in a bounded number of steps.
+    std::vector<int> fired;
+    for (int steps = 0; steps < 64 && fired.size() < 2; ++steps) {
+        ASSERT_TRUE(queue_->next_expiry(when));
+        for (int id : drain(when)) {
+            fired.push_back(id);
+        }
+    }
+    EXPECT_EQ(fired, (std::vector<int>{2, 1}));
+}
+
+TEST_P(TimerQueueTest, ForEachVisitsAll) {
+    for (int id = 0; id < 100; ++id) {
+        push(id, 1000 + id * 37 % 11);
+    }
+    std::size_t n = 0;
+    queue_->for_each([&](const Alarm&) { ++n; });
+    EXPECT_EQ(n, 100u);
+    std::size_t released = 0;
+    queue_->clear([&](Alarm*) { ++released; });
+    EXPECT_EQ(released, 100u);
+    EXPECT_TRUE(queue_->empty());
+}
+
+TEST_P(TimerQueueTest, PurgeCancelled) {
+    for (int id = 0; id < 200; ++id) {
+        push(id, 1000 + (id * 7919) % 500)->cancelled = id % 3 != 0;
+    }
+    std::size_t released = 0;
+    EXPECT_EQ(queue_->purge_cancelled([&](Alarm* a) {
+                  EXPECT_TRUE(a->cancelled);
+                  ++released;
+              }),
+              133u);
+    EXPECT_EQ(released, 133u);
+    EXPECT_EQ(queue_->size(), 67u);
+    std::vector<int> ids = drain(2000);
+    ASSERT_EQ(ids.size(), 67u);
+    for (int id : ids) {
+        EXPECT_EQ(id % 3, 0);
+    }
+}
+
+// Random pushes, erases and pops against an ordered map as the reference.
+TEST_P(TimerQueueTest, MatchesReference) {
+    std::mt19937 rng(7);
+    std::map<std::pair<Deadline, std::uint64_t>, int> ref;
+    std::vector<Alarm*> live;
+    Deadline now = 1'700'000'000;
+    int next_id = 0;
+
+    for (int step = 0; step < 20000; ++step) {
+        int op = static_cast<int>(rng() % 10);
+        if (op < 6) {
+            // Mix near, mid and very far expiries to exercise every wheel level.
+            Deadline span = Deadline{1} << (rng() % 42);
+            const std::uint64_t r = std::uint64_t{rng()} << 32 | rng();
+            Alarm* a = push(next_id++, now + static_cast<Deadline>(r % static_cast<std::uint64_t>(span)));
+            ref[{a->deadline, a->seq}] = a->id;
+            live.push_back(a);
+        } else if (op < 8 && !live.empty()) {
+            std::size_t i = rng() % live.size();
+            Alarm* a = live[i];
+            ref.erase({a->deadline, a->seq});
+            queue_->erase(a);
+            live[i] = live.back();
+            live.pop_back();
+        } else {
+            now += static_cast<Deadline>(rng() % 200'000);
+            while (!ref.empty() && ref.begin()->first.first <= now) {
+                Alarm* a = queue_->pop_due(now);
+                ASSERT_NE(a, nullptr);
+                ASSERT_EQ(a->id, ref.begin()->second);
+                ref.erase(ref.begin());
+                std::erase(live, a);
+            }
+            ASSERT_EQ(queue_->pop_due(now), nullptr);
+        }
+        ASSERT_EQ(queue_->size(), ref.size());
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(AllQueues, TimerQueueTest,
+                         ::testing::Values(QueueKind::List, QueueKind::Heap, QueueKind::Wheel),
+                         [](const auto& info) { return queue_kind_name(info.param); });
+
+TEST(QueueKind, ParsesNames) {
+    QueueKind kind;
+    ASSERT_TRUE(parse_queue_kind("wheel", kind));
+    EXPECT_EQ(kind, QueueKind::Wheel);
+    ASSERT_TRUE(parse_queue_kind("list", kind));
+    EXPECT_EQ(kind, QueueKind::List);
+    EXPECT_FALSE(parse_queue_kind("tree", kind));
+}
+
+}  // namespace
+}  // namespace alarmd
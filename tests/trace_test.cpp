@@ -0,0 +1,155 @@
+#include "alarmd/trace.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "alarmd/clock.hpp"
+#include "alarmd/scheduler.hpp"
+
+namespace alarmd {
+namespace {
+
+using namespace std::chrono_literals;
+
+std::size_t count(const std::string& text, const std::string& what) {
+    std::size_t n = 0;
+    for (std::size_t at = text.find(what); at != std::string::npos;
+         at = text.find(what, at + what.size())) {
+        ++n;
+    }
+    return n;
+}
+
+// Leaves tracing off and the rings empty for whichever test runs next.
+class Trace : public ::testing::Test {
+protected:
+    void SetUp() override { clear_trace(); }
+    void TearDown() override {
+        set_tracing(false);
+        clear_trace();
+    }
+};
+
+TEST_F(Trace, RecordsOnlyWhileOn) {
+    trace(TraceKind::Start, 7);
+    EXPECT_EQ(count(render_chrome_trace(), "\"name\":"), 0u);
+    set_tracing(true);
+    trace(TraceKind::Start, 7);
+    trace(TraceKind::Cancel, 7);
+    set_tracing(false);
+    trace(TraceKind::Fire, 7);
+    const std::string text = render_chrome_trace();
+    EXPECT_EQ(text.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+    EXPECT_EQ(count(text, "\"name\":\"start\""), 1u);
+    EXPECT_EQ(count(text, "\"name\":\"cancel\""), 1u);
+    EXPECT_EQ(count(text, "\"name\":\"fire\""), 0u);
+    EXPECT_NE(text.find("\"args\":{\"id\":7}"), std::string::npos);
+}
+
+TEST_F(Trace, PrintIsASpanFromTheFire) {
+    set_tracing(true);
+    const std::int64_t fired = monotonic_ns();
+    trace(TraceKind::Print, 3, fired);
+    const std::string text = render_chrome_trace();
+    EXPECT_EQ(count(text, "\"name\":\"print\",\"cat\":\"alarm\",\"ph\":\"X\""), 1u);
+    EXPECT_NE(text.find("\"dur\":"), std::string::npos);
+}
+
+TEST_F(Trace, KeepsExitedThreadsUntilCleared) {
+    set_tracing(true);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 100; ++i) {
+                trace(TraceKind::Fire, t * 1000 + i);
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(count(render_chrome_trace(), "\"name\":\"fire\""), 300u);
+    clear_trace();
+    EXPECT_EQ(count(render_chrome_trace(), "\"name\":"), 0u);
+}
+
+TEST_F(Trace, RingOverwritesTheOldestEvents) {
+    set_tracing(true);
+    std::thread([] {
+        for (std::size_t i = 0; i < kTraceRing + 10; ++i) {
+            trace(TraceKind::Start, static_cast<int>(i));
+        }
+    }).join();
+    const std::string text = render_chrome_trace();
+    EXPECT_EQ(count(text, "\"name\":\"start\""), kTraceRing);
+    EXPECT_EQ(text.find("\"args\":{\"id\":9}}"), std::string::npos);
+    EXPECT_NE(text.find("\"args\":{\"id\":10}}"), std::string::npos);
+}
+
+TEST_F(Trace, MaxEventsKeepsTheLatestOfEachRing) {
+    set_tracing(true);
+    std::thread([] {
+        for (int i = 0; i < 10; ++i) {
+            trace(TraceKind::Start, 1000 + i);
+        }
+    }).join();
+    std::thread([] {
+        for (int i = 0; i < 100; ++i) {
+            trace(TraceKind::Fire, i);
+        }
+    }).join();
+    // The quiet ring keeps all 10 and leaves the rest of its share to the other.
+    const std::string text = render_chrome_trace(30);
+    EXPECT_EQ(count(text, "\"name\":\"start\""), 10u);
+    EXPECT_EQ(count(text, "\"name\":\"fire\""), 20u);
+    EXPECT_EQ(text.find("\"args\":{\"id\":79}}"), std::string::npos);
+    EXPECT_NE(text.find("\"args\":{\"id\":80}}"), std::string::npos);
+    EXPECT_EQ(count(render_chrome_trace(0), "\"name\":"), 0u);
+}
+
+TEST_F(Trace, SchedulerRecordsAlarmLifecycle) {
+    Scheduler s({.display_threads = 1, .on_fired = [](int, std::vector<FiredAlarm>&) {}});
+    s.start();
+    s.configure({.tracing = true});
+    EXPECT_NE(s.config_summary().find("trace=on"), std::string::npos);
+    ASSERT_TRUE(s.start_alarm(1, 0s, "now"));
+    ASSERT_TRUE(s.start_alarm(2, 60s, "later"));
+    ASSERT_TRUE(s.change_alarm(2, 120s, "later still"));
+    ASSERT_TRUE(s.cancel_alarm(2));
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while (s.fired() < 1) {
+        ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+        std::this_thread::sleep_for(1ms);
+    }
+    s.stop();
+    s.configure({.tracing = false});
+
+    char path[] = "/tmp/alarmd_trace_XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    ASSERT_TRUE(write_chrome_trace(path));
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    std::remove(path);
+    EXPECT_EQ(count(text.str(), "\"name\":\"start\""), 2u);
+    EXPECT_EQ(count(text.str(), "\"name\":\"change\""), 1u);
+    EXPECT_EQ(count(text.str(), "\"name\":\"cancel\""), 1u);
+    EXPECT_EQ(count(text.str(), "\"name\":\"fire\""), 1u);
+    EXPECT_EQ(count(text.str(), "\"name\":\"print\""), 1u);
+    EXPECT_FALSE(write_chrome_trace("/nonexistent/dir/trace.json"));
+}
+
+}  // namespace
+}  // namespace alarmd